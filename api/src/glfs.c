@@ -84,7 +84,8 @@ glusterfs_ctx_defaults_init (glusterfs_ctx_t *ctx)
 		goto err;
 	}
 
-	ctx->event_pool = event_pool_new (DEFAULT_EVENT_POOL_SIZE);
+	ctx->event_pool = event_pool_new (DEFAULT_EVENT_POOL_SIZE,
+					  STARTING_EVENT_THREADS);
 	if (!ctx->event_pool) {
 		goto err;
 	}
@@ -504,6 +505,7 @@ glfs_poller (void *data)
 
 	fs = data;
 
+	/* starts the pool of event dispatcher threads and waits on it */
 	event_dispatch (fs->ctx->event_pool);
 
 	return NULL;
@@ -5669,6 +5669,10 @@ cli_print_volume_status_clients (dict_t *dict, gf_boolean_t notbrick)
         char            *clientname = NULL;
         uint64_t        bytesread = 0;
         uint64_t        byteswrite = 0;
+        int32_t         queuedepth = 0;
+        uint64_t        throttletime = 0;
+        char            queuedepth_str[16] = {0,};
+        char            throttletime_str[32] = {0,};
         char            key[1024] = {0,};
         int             i = 0;
         int             j = 0;
@@ -5731,10 +5735,12 @@ cli_print_volume_status_clients (dict_t *dict, gf_boolean_t notbrick)
                 if (client_count == 0)
                         continue;
 
-                cli_out ("%-48s %15s %15s", "Hostname", "BytesRead",
-                         "BytesWritten");
-                cli_out ("%-48s %15s %15s", "--------", "---------",
-                         "------------");
+                cli_out ("%-48s %15s %15s %10s %12s", "Hostname",
+                         "BytesRead", "BytesWritten", "QueueDepth",
+                         "ThrottleMs");
+                cli_out ("%-48s %15s %15s %10s %12s", "--------",
+                         "---------", "------------", "----------",
+                         "----------");
                 for (j =0; j < client_count; j++) {
                         memset (key, 0, sizeof (key));
                         snprintf (key, sizeof (key),
@@ -5757,8 +5763,31 @@ cli_print_volume_status_clients (dict_t *dict, gf_boolean_t notbrick)
                         if (ret)
                                 goto out;
 
-                        cli_out ("%-48s %15"PRIu64" %15"PRIu64,
-                                 clientname, bytesread, byteswrite);
+                        /* not sent by older bricks */
+                        strcpy (queuedepth_str, "N/A");
+                        memset (key, 0, sizeof (key));
+                        snprintf (key, sizeof (key),
+                                 "brick%d.client%d.queuedepth", i, j);
+                        ret = dict_get_int32 (dict, key, &queuedepth);
+                        if (!ret)
+                                snprintf (queuedepth_str,
+                                          sizeof (queuedepth_str), "%d",
+                                          queuedepth);
+
+                        strcpy (throttletime_str, "N/A");
+                        memset (key, 0, sizeof (key));
+                        snprintf (key, sizeof (key),
+                                 "brick%d.client%d.throttletime", i, j);
+                        ret = dict_get_uint64 (dict, key, &throttletime);
+                        if (!ret)
+                                snprintf (throttletime_str,
+                                          sizeof (throttletime_str),
+                                          "%"PRIu64, throttletime);
+
+                        cli_out ("%-48s %15"PRIu64" %15"PRIu64" %10s "
+                                 "%12s", clientname, bytesread,
+                                 byteswrite, queuedepth_str,
+                                 throttletime_str);
                 }
         }
 out:
@@ -700,6 +700,8 @@ cli_xml_output_vol_status_clients (xmlTextWriterPtr writer, dict_t *dict,
         char            *hostname = NULL;
         uint64_t        bytes_read = 0;
         uint64_t        bytes_write = 0;
+        int32_t         queue_depth = 0;
+        uint64_t        throttle_time = 0;
         char            key[1024] = {0,};
         int             i = 0;
 
@@ -754,6 +756,30 @@ cli_xml_output_vol_status_clients (xmlTextWriterPtr writer, dict_t *dict,
                                                        "%"PRIu64, bytes_write);
                 XML_RET_CHECK_AND_GOTO (ret, out);
 
+                /* not sent by older bricks */
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "brick%d.client%d.queuedepth",
+                          brick_index, i);
+                ret = dict_get_int32 (dict, key, &queue_depth);
+                if (!ret) {
+                        ret = xmlTextWriterWriteFormatElement (writer,
+                                                       (xmlChar *)"queueDepth",
+                                                       "%d", queue_depth);
+                        XML_RET_CHECK_AND_GOTO (ret, out);
+                }
+
+                memset (key, 0, sizeof (key));
+                snprintf (key, sizeof (key), "brick%d.client%d.throttletime",
+                          brick_index, i);
+                ret = dict_get_uint64 (dict, key, &throttle_time);
+                if (!ret) {
+                        ret = xmlTextWriterWriteFormatElement (writer,
+                                                       (xmlChar *)"throttleTime",
+                                                       "%"PRIu64,
+                                                       throttle_time);
+                        XML_RET_CHECK_AND_GOTO (ret, out);
+                }
+
                 /* </client> */
                 ret = xmlTextWriterEndElement (writer);
                 XML_RET_CHECK_AND_GOTO (ret, out);
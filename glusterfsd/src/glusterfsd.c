@@ -217,6 +217,25 @@ static struct argp_option gf_options[] = {
          " [default: \"off\"]"},
         {"secure-mgmt", ARGP_SECURE_MGMT_KEY, "BOOL", OPTION_ARG_OPTIONAL,
          "Override default for secure (SSL) management connections"},
+        {"event-threads", ARGP_EVENT_THREADS_KEY, "N", 0,
+         "Use N threads to dispatch network events "
+         "[default: 2]"},
+        {"timer-threads", ARGP_TIMER_THREADS_KEY, "N", 0,
+         "Use N threads to run timer callbacks, 0 runs them on the "
+         "timer thread [default: 0]"},
+        {"latency-sample-rate", ARGP_LATENCY_SAMPLE_RATE_KEY, "N", 0,
+         "Measure fop latencies from startup, timing one fop in N "
+         "[default: measurement off, toggled by SIGUSR2, timing all fops]"},
+        {"iobuf-huge-pages", ARGP_IOBUF_HUGE_PAGES_KEY, "BOOL",
+         OPTION_ARG_OPTIONAL, "Back the I/O buffer arenas with 2MB huge "
+         "pages, transparent ones if none are reserved [default: \"off\"]"},
+        {"mem-profile-rate", ARGP_MEM_PROFILE_RATE_KEY, "N", 0,
+         "Record the call site of one allocation in N on average, and "
+         "report the sites holding the most memory in statedumps "
+         "[default: off]"},
+        {"synctask-stack-size", ARGP_SYNCTASK_STACK_SIZE_KEY, "SIZE", 0,
+         "Stack size of the tasks running syncops, at least 16KB "
+         "[default: 2MB]"},
         {0, 0, 0, 0, "Miscellaneous Options:"},
         {0, }
 };
@@ -1157,6 +1176,71 @@ parse_opts (int key, char *arg, struct argp_state *state)
                 argp_failure (state, -1, 0,
                               "unknown secure-mgmt setting \"%s\"", arg);
                 break;
+
+        case ARGP_EVENT_THREADS_KEY:
+                if (gf_string2int (arg, &cmd_args->event_threads) == 0 &&
+                    cmd_args->event_threads > 0 &&
+                    cmd_args->event_threads <= EVENT_MAX_THREADS)
+                        break;
+
+                argp_failure (state, -1, 0,
+                              "invalid event thread count %s. Valid range: "
+                              "[1,32]", arg);
+                break;
+
+        case ARGP_TIMER_THREADS_KEY:
+                if (gf_string2int (arg, &cmd_args->timer_threads) == 0 &&
+                    cmd_args->timer_threads >= 0 &&
+                    cmd_args->timer_threads <= GF_TIMER_MAX_THREADS)
+                        break;
+
+                argp_failure (state, -1, 0,
+                              "invalid timer thread count %s. Valid range: "
+                              "[0,16]", arg);
+                break;
+
+        case ARGP_LATENCY_SAMPLE_RATE_KEY:
+                if (gf_string2uint32 (arg, &cmd_args->latency_sample_rate) == 0
+                    && cmd_args->latency_sample_rate >= 1)
+                        break;
+
+                argp_failure (state, -1, 0,
+                              "invalid latency sample rate %s", arg);
+                break;
+
+        case ARGP_IOBUF_HUGE_PAGES_KEY:
+                if (!arg)
+                        arg = "on";
+
+                if (gf_string2boolean (arg, &b) == 0) {
+                        cmd_args->iobuf_huge_pages = b;
+                        break;
+                }
+
+                argp_failure (state, -1, 0,
+                              "unknown iobuf-huge-pages setting \"%s\"",
+                              arg);
+                break;
+
+        case ARGP_MEM_PROFILE_RATE_KEY:
+                if (gf_string2uint32 (arg, &cmd_args->mem_profile_rate) == 0
+                    && cmd_args->mem_profile_rate >= 1)
+                        break;
+
+                argp_failure (state, -1, 0,
+                              "invalid memory profile rate %s", arg);
+                break;
+
+        case ARGP_SYNCTASK_STACK_SIZE_KEY:
+                if (gf_string2bytesize_size (arg,
+                                             &cmd_args->synctask_stack_size)
+                    == 0 && cmd_args->synctask_stack_size >=
+                    SYNCENV_MIN_STACKSIZE)
+                        break;
+
+                argp_failure (state, -1, 0,
+                              "invalid synctask stack size %s", arg);
+                break;
 	}
 
         return 0;
@@ -1330,7 +1414,8 @@ glusterfs_ctx_defaults_init (glusterfs_ctx_t *ctx)
                 goto out;
         }
 
-        ctx->event_pool = event_pool_new (DEFAULT_EVENT_POOL_SIZE);
+        ctx->event_pool = event_pool_new (DEFAULT_EVENT_POOL_SIZE,
+                                          STARTING_EVENT_THREADS);
         if (!ctx->event_pool) {
                 gf_msg ("", GF_LOG_CRITICAL, 0, glusterfsd_msg_14, "event");
                 goto out;
@@ -1396,6 +1481,7 @@ glusterfs_ctx_defaults_init (glusterfs_ctx_t *ctx)
         cmd_args->log_format = gf_logformat_withmsgid;
         cmd_args->log_buf_size = GF_LOG_LRU_BUFSIZE_DEFAULT;
         cmd_args->log_flush_timeout = GF_LOG_FLUSH_TIMEOUT_DEFAULT;
+        cmd_args->event_threads = STARTING_EVENT_THREADS;
 
         cmd_args->mac_compat = GF_OPTION_DISABLE;
 #ifdef GF_DARWIN_HOST_OS
@@ -1514,6 +1600,17 @@ parse_cmdline (int argc, char *argv[], glusterfs_ctx_t *ctx)
 
         ctx->secure_mgmt = cmd_args->secure_mgmt;
 
+        if (cmd_args->latency_sample_rate) {
+                ctx->latency_sample_rate = cmd_args->latency_sample_rate;
+                ctx->measure_latency = 1;
+        }
+
+        if (cmd_args->iobuf_huge_pages)
+                iobuf_pool_set_huge_pages (ctx->iobuf_pool, _gf_true);
+
+        if (cmd_args->mem_profile_rate)
+                gf_mem_profile_set_rate (cmd_args->mem_profile_rate);
+
         if (ENABLE_DEBUG_MODE == cmd_args->debug_mode) {
                 cmd_args->log_level = GF_LOG_DEBUG;
                 cmd_args->log_file = gf_strdup ("/dev/stderr");
@@ -2030,7 +2127,11 @@ main (int argc, char *argv[])
         if (ret)
                 goto out;
 
-	ctx->env = syncenv_new (0, 0, 0);
+        /* the flusher thread would not survive the fork in daemonize () */
+        if (gf_log_enable_async (ctx))
+                gf_msg ("", GF_LOG_WARNING, 0, glusterfsd_msg_34);
+
+	ctx->env = syncenv_new (ctx->cmd_args.synctask_stack_size, 0, 0);
         if (!ctx->env) {
                 gf_msg ("", GF_LOG_ERROR, 0, glusterfsd_msg_31);
                 goto out;
@@ -2040,6 +2141,11 @@ main (int argc, char *argv[])
         if (ret)
                 goto out;
 
+        ret = event_reconfigure_threads (ctx->event_pool,
+                                         ctx->cmd_args.event_threads);
+        if (ret)
+                goto out;
+
         ret = event_dispatch (ctx->event_pool);
 
 out:
@@ -92,6 +92,12 @@ enum argp_option_keys {
         ARGP_LOG_BUF_SIZE                 = 170,
         ARGP_LOG_FLUSH_TIMEOUT            = 171,
         ARGP_SECURE_MGMT_KEY              = 172,
+        ARGP_EVENT_THREADS_KEY            = 173,
+        ARGP_TIMER_THREADS_KEY            = 174,
+        ARGP_LATENCY_SAMPLE_RATE_KEY      = 175,
+        ARGP_IOBUF_HUGE_PAGES_KEY         = 176,
+        ARGP_MEM_PROFILE_RATE_KEY         = 177,
+        ARGP_SYNCTASK_STACK_SIZE_KEY      = 178,
 };
 
 struct _gfd_vol_top_priv_t {
@@ -162,6 +162,10 @@ gf_client_clienttable_destroy (clienttable_t *clienttable)
 #if (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1)) && !defined(__i386__)
 # define INCREMENT_ATOMIC(lk,op) __sync_add_and_fetch(&op, 1)
 # define DECREMENT_ATOMIC(lk,op) __sync_sub_and_fetch(&op, 1)
+# define DECREMENT_UNLESS_LAST(lk,op) ({ int _v;                         \
+        do { _v = op; } while (_v > 1 &&                                  \
+                !__sync_bool_compare_and_swap (&op, _v, _v - 1));         \
+        _v > 1; })
 #else
 /* These are only here for old gcc, e.g. on RHEL5 i386.
  * We're not ever going to use this in an if stmt,
@@ -169,6 +173,8 @@ gf_client_clienttable_destroy (clienttable_t *clienttable)
 # define INCREMENT_ATOMIC(lk,op) do { LOCK (&lk); ++op; UNLOCK (&lk); } while (0)
 /* this is a gcc 'statement expression', it works with llvm/clang too */
 # define DECREMENT_ATOMIC(lk,op) ({ LOCK (&lk); --op; UNLOCK (&lk); op; })
+# define DECREMENT_UNLESS_LAST(lk,op) ({ int _v; LOCK (&lk); _v = op;      \
+        if (_v > 1) --op; UNLOCK (&lk); _v > 1; })
 #endif
 
 /*
@@ -320,6 +326,23 @@ gf_client_put (client_t *client, gf_boolean_t *detached)
         }
 }
 
+/*
+ * Drops a bind of a client that other connections are bound to as well.
+ * Returns false, and drops nothing, when the caller holds the last one.
+ */
+gf_boolean_t
+gf_client_put_shared (client_t *client)
+{
+        gf_boolean_t shared = _gf_false;
+
+        shared = DECREMENT_UNLESS_LAST (client->ref.lock, client->ref.bind);
+
+        gf_log_callingfn ("client_t", GF_LOG_DEBUG, "%s: bind_ref: %d, "
+                          "shared: %d", client->client_uid, client->ref.bind,
+                          shared);
+        return shared;
+}
+
 client_t *
 gf_client_ref (client_t *client)
 {
@@ -0,0 +1,329 @@
+/*
+   Copyright (c) 2015 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "xlator.h"
+#include "compound-fop-utils.h"
+
+gf_boolean_t
+compound_fop_supported (glusterfs_fop_t fop)
+{
+        switch (fop) {
+        case GF_FOP_FXATTROP:
+        case GF_FOP_FINODELK:
+                return _gf_true;
+        default:
+                return _gf_false;
+        }
+}
+
+
+compound_args_t *
+compound_args_new (int count)
+{
+        compound_args_t *args = NULL;
+
+        if (count <= 0 || count > GF_COMPOUND_MAX_FOPS)
+                return NULL;
+
+        args = GF_CALLOC (1, sizeof (*args), gf_common_mt_compound_args_t);
+        if (!args)
+                return NULL;
+
+        args->fops = GF_CALLOC (count, sizeof (*args->fops),
+                                gf_common_mt_compound_args_t);
+        if (!args->fops) {
+                GF_FREE (args);
+                return NULL;
+        }
+        args->count = count;
+
+        return args;
+}
+
+
+void
+compound_args_destroy (compound_args_t *args)
+{
+        compound_fop_args_t *fop = NULL;
+        int                  i   = 0;
+
+        if (!args)
+                return;
+
+        for (i = 0; i < args->count; i++) {
+                fop = &args->fops[i];
+
+                if (fop->fd)
+                        fd_unref (fop->fd);
+                if (fop->xattr)
+                        dict_unref (fop->xattr);
+                if (fop->xdata)
+                        dict_unref (fop->xdata);
+                GF_FREE (fop->volume);
+        }
+
+        GF_FREE (args->fops);
+        GF_FREE (args);
+}
+
+
+static compound_fop_args_t *
+compound_args_member (compound_args_t *args, int i, glusterfs_fop_t fop,
+                      dict_t *xdata)
+{
+        compound_fop_args_t *member = NULL;
+
+        if (!args || i < 0 || i >= args->count)
+                return NULL;
+
+        member = &args->fops[i];
+        member->fop = fop;
+        if (xdata)
+                member->xdata = dict_ref (xdata);
+
+        return member;
+}
+
+
+int
+compound_args_fxattrop (compound_args_t *args, int i, fd_t *fd,
+                        gf_xattrop_flags_t optype, dict_t *xattr,
+                        dict_t *xdata)
+{
+        compound_fop_args_t *member = NULL;
+
+        member = compound_args_member (args, i, GF_FOP_FXATTROP, xdata);
+        if (!member)
+                return -1;
+
+        member->fd = fd_ref (fd);
+        member->optype = optype;
+        if (xattr)
+                member->xattr = dict_ref (xattr);
+
+        return 0;
+}
+
+
+int
+compound_args_finodelk (compound_args_t *args, int i, const char *volume,
+                        fd_t *fd, int32_t cmd, struct gf_flock *flock,
+                        dict_t *xdata)
+{
+        compound_fop_args_t *member = NULL;
+
+        member = compound_args_member (args, i, GF_FOP_FINODELK, xdata);
+        if (!member)
+                return -1;
+
+        member->volume = gf_strdup (volume);
+        if (!member->volume)
+                return -1;
+        member->fd = fd_ref (fd);
+        member->cmd = cmd;
+        member->flock = *flock;
+
+        return 0;
+}
+
+
+compound_args_cbk_t *
+compound_args_cbk_new (int count)
+{
+        compound_args_cbk_t *args_cbk = NULL;
+
+        if (count <= 0 || count > GF_COMPOUND_MAX_FOPS)
+                return NULL;
+
+        args_cbk = GF_CALLOC (1, sizeof (*args_cbk),
+                              gf_common_mt_compound_args_t);
+        if (!args_cbk)
+                return NULL;
+
+        args_cbk->fops = GF_CALLOC (count, sizeof (*args_cbk->fops),
+                                    gf_common_mt_compound_args_t);
+        if (!args_cbk->fops) {
+                GF_FREE (args_cbk);
+                return NULL;
+        }
+        args_cbk->count = count;
+
+        return args_cbk;
+}
+
+
+void
+compound_args_cbk_destroy (compound_args_cbk_t *args_cbk)
+{
+        compound_fop_cbk_args_t *rsp = NULL;
+        int                      i   = 0;
+
+        if (!args_cbk)
+                return;
+
+        for (i = 0; i < args_cbk->count; i++) {
+                rsp = &args_cbk->fops[i];
+
+                if (rsp->xattr)
+                        dict_unref (rsp->xattr);
+                if (rsp->xdata)
+                        dict_unref (rsp->xdata);
+        }
+
+        GF_FREE (args_cbk->fops);
+        GF_FREE (args_cbk);
+}
+
+
+void
+compound_args_cbk_set (compound_args_cbk_t *args_cbk, int i, int32_t op_ret,
+                       int32_t op_errno, dict_t *xattr, dict_t *xdata)
+{
+        compound_fop_cbk_args_t *rsp = NULL;
+
+        if (!args_cbk || i < 0 || i >= args_cbk->count)
+                return;
+
+        rsp = &args_cbk->fops[i];
+
+        rsp->op_ret = op_ret;
+        rsp->op_errno = op_errno;
+
+        if (xattr)
+                rsp->xattr = dict_ref (xattr);
+        if (xdata)
+                rsp->xdata = dict_ref (xdata);
+}
+
+
+/* Carrying out a compound as a sequence of the fops of its members, for the
+ * xlators which do not handle compounds themselves. The members are wound
+ * one after the other to @this, so that the xlator sees each of them as an
+ * ordinary fop.
+ */
+typedef struct {
+        compound_args_t     *args;
+        compound_args_cbk_t *args_cbk;
+        int                  next;
+} compound_unroll_local_t;
+
+static int
+compound_unroll_next (call_frame_t *frame, xlator_t *this);
+
+
+static int
+compound_unroll_fxattrop_cbk (call_frame_t *frame, void *cookie,
+                              xlator_t *this, int32_t op_ret, int32_t op_errno,
+                              dict_t *xattr, dict_t *xdata)
+{
+        compound_unroll_local_t *local = frame->local;
+
+        compound_args_cbk_set (local->args_cbk, (long) cookie, op_ret,
+                               op_errno, xattr, xdata);
+
+        return compound_unroll_next (frame, this);
+}
+
+
+static int
+compound_unroll_finodelk_cbk (call_frame_t *frame, void *cookie,
+                              xlator_t *this, int32_t op_ret, int32_t op_errno,
+                              dict_t *xdata)
+{
+        compound_unroll_local_t *local = frame->local;
+
+        compound_args_cbk_set (local->args_cbk, (long) cookie, op_ret,
+                               op_errno, NULL, xdata);
+
+        return compound_unroll_next (frame, this);
+}
+
+
+static int
+compound_unroll_next (call_frame_t *frame, xlator_t *this)
+{
+        compound_unroll_local_t *local  = frame->local;
+        compound_args_cbk_t     *rsps   = NULL;
+        compound_fop_args_t     *member = NULL;
+        long                     i      = 0;
+
+        while (local->next < local->args->count) {
+                i = local->next++;
+                member = &local->args->fops[i];
+
+                switch (member->fop) {
+                case GF_FOP_FXATTROP:
+                        STACK_WIND_COOKIE (frame, compound_unroll_fxattrop_cbk,
+                                           (void *) i, this,
+                                           this->fops->fxattrop, member->fd,
+                                           member->optype, member->xattr,
+                                           member->xdata);
+                        return 0;
+                case GF_FOP_FINODELK:
+                        STACK_WIND_COOKIE (frame, compound_unroll_finodelk_cbk,
+                                           (void *) i, this,
+                                           this->fops->finodelk,
+                                           member->volume, member->fd,
+                                           member->cmd, &member->flock,
+                                           member->xdata);
+                        return 0;
+                default:
+                        compound_args_cbk_set (local->args_cbk, i, -1,
+                                               ENOTSUP, NULL, NULL);
+                        break;
+                }
+        }
+
+        rsps = local->args_cbk;
+        frame->local = NULL;
+        GF_FREE (local);
+
+        STACK_UNWIND_STRICT (compound, frame, 0, 0, rsps, NULL);
+
+        compound_args_cbk_destroy (rsps);
+
+        return 0;
+}
+
+
+int
+compound_fop_unroll (call_frame_t *frame, xlator_t *this,
+                     compound_args_t *args, dict_t *xdata)
+{
+        compound_unroll_local_t *local    = NULL;
+        int                      op_errno = ENOMEM;
+
+        if (!args || !args->count) {
+                op_errno = EINVAL;
+                goto err;
+        }
+
+        local = GF_CALLOC (1, sizeof (*local), gf_common_mt_compound_args_t);
+        if (!local)
+                goto err;
+
+        local->args = args;
+        local->args_cbk = compound_args_cbk_new (args->count);
+        if (!local->args_cbk)
+                goto err;
+
+        frame->local = local;
+
+        return compound_unroll_next (frame, this);
+err:
+        GF_FREE (local);
+        STACK_UNWIND_STRICT (compound, frame, -1, op_errno, NULL, NULL);
+        return 0;
+}
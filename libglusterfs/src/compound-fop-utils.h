@@ -0,0 +1,52 @@
+/*
+   Copyright (c) 2015 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _COMPOUND_FOP_UTILS_H
+#define _COMPOUND_FOP_UTILS_H
+
+#include "xlator.h"
+
+/* largest number of fops in a compound */
+#define GF_COMPOUND_MAX_FOPS 16
+
+gf_boolean_t
+compound_fop_supported (glusterfs_fop_t fop);
+
+compound_args_t *
+compound_args_new (int count);
+
+void
+compound_args_destroy (compound_args_t *args);
+
+int
+compound_args_fxattrop (compound_args_t *args, int i, fd_t *fd,
+                        gf_xattrop_flags_t optype, dict_t *xattr,
+                        dict_t *xdata);
+
+int
+compound_args_finodelk (compound_args_t *args, int i, const char *volume,
+                        fd_t *fd, int32_t cmd, struct gf_flock *flock,
+                        dict_t *xdata);
+
+compound_args_cbk_t *
+compound_args_cbk_new (int count);
+
+void
+compound_args_cbk_destroy (compound_args_cbk_t *args_cbk);
+
+void
+compound_args_cbk_set (compound_args_cbk_t *args_cbk, int i, int32_t op_ret,
+                       int32_t op_errno, dict_t *xattr, dict_t *xdata);
+
+int
+compound_fop_unroll (call_frame_t *frame, xlator_t *this,
+                     compound_args_t *args, dict_t *xdata);
+
+#endif /* _COMPOUND_FOP_UTILS_H */
@@ -26,6 +26,7 @@
 #endif
 
 #include "xlator.h"
+#include "compound-fop-utils.h"
 
 /* FAILURE_CBK function section */
 
@@ -365,6 +366,13 @@ default_zerofill_failure_cbk (call_frame_t *frame, int32_t op_errno)
         return 0;
 }
 
+int32_t
+default_compound_failure_cbk (call_frame_t *frame, int32_t op_errno)
+{
+        STACK_UNWIND_STRICT (compound, frame, -1, op_errno, NULL, NULL);
+        return 0;
+}
+
 
 int32_t
 default_getspec_failure_cbk (call_frame_t *frame, int32_t op_errno)
@@ -1286,6 +1294,16 @@ default_zerofill_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         return 0;
 }
 
+int32_t
+default_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno,
+                      compound_args_cbk_t *args_cbk, dict_t *xdata)
+{
+        STACK_UNWIND_STRICT (compound, frame, op_ret, op_errno, args_cbk,
+                             xdata);
+        return 0;
+}
+
 
 int32_t
 default_getspec_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
@@ -2160,6 +2178,19 @@ default_zerofill(call_frame_t *frame, xlator_t *this, fd_t *fd,
         return 0;
 }
 
+/* Unlike the other fops, a compound is not passed down as it is: it is
+ * carried out here as a sequence of the fops of its members, so that an
+ * xlator which does not know about compounds still sees every one of them.
+ * Only the xlators which can send or handle a compound as a whole (the
+ * protocol ones) implement this fop.
+ */
+int32_t
+default_compound (call_frame_t *frame, xlator_t *this, compound_args_t *args,
+                  dict_t *xdata)
+{
+        return compound_fop_unroll (frame, this, args, xdata);
+}
+
 
 int32_t
 default_forget (xlator_t *this, inode_t *inode)
@@ -2246,6 +2277,7 @@ struct xlator_fops _default_fops = {
 	.fallocate = default_fallocate,
 	.discard = default_discard,
         .zerofill = default_zerofill,
+        .compound = default_compound,
 
         .getspec = default_getspec,
 };
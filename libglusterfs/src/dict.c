@@ -15,6 +15,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <fnmatch.h>
+#include <stdarg.h>
 
 #ifndef _CONFIG_H
 #define _CONFIG_H
@@ -29,6 +30,7 @@
 #include "compat.h"
 #include "byte-order.h"
 #include "globals.h"
+#include "iobuf.h"
 
 data_t *
 get_new_data ()
@@ -40,42 +42,47 @@ get_new_data ()
                 return NULL;
         }
 
-        LOCK_INIT (&data->lock);
         return data;
 }
 
+/* Point @data at a private copy of @len bytes from @value, kept inline when
+ * it is small enough. */
+static int
+data_copy_value (data_t *data, const void *value, int32_t len)
+{
+        if (len <= DICT_DATA_INLINE_SIZE) {
+                data->data = data->inline_data;
+                memcpy (data->data, value, len);
+        } else {
+                data->data = memdup (value, len);
+                if (!data->data)
+                        return -1;
+        }
+
+        data->len = len;
+
+        return 0;
+}
+
 dict_t *
 get_new_dict_full (int size_hint)
 {
-        dict_t *dict = mem_get0 (THIS->ctx->dict_pool);
+        dict_t  *dict = mem_get0 (THIS->ctx->dict_pool);
+        int32_t  hash_size = DICT_HASH_INLINE_SIZE;
 
         if (!dict) {
                 return NULL;
         }
 
-        dict->hash_size = size_hint;
-        if (size_hint == 1) {
-                /*
-                 * This is the only case we ever see currently.  If we ever
-                 * need to support resizing the hash table, the resize function
-                 * will have to take into account the possibility that
-                 * "members" is not separately allocated (i.e. don't just call
-                 * realloc() blindly.
-                 */
-                dict->members = &dict->members_internal;
-        }
-        else {
-                /*
-                 * We actually need to allocate space for size_hint *pointers*
-                 * but we actually allocate space for one *structure*.  Since
-                 * a data_pair_t consists of five pointers, we're wasting four
-                 * pointers' worth for N=1, and will overrun what we allocated
-                 * for N>5.  If anybody ever starts using size_hint, we'll need
-                 * to fix this.
-                 */
-                GF_ASSERT (size_hint <=
-                           (sizeof(data_pair_t) / sizeof(data_pair_t *)));
-                dict->members = mem_get0 (THIS->ctx->dict_pair_pool);
+        while (hash_size < size_hint)
+                hash_size <<= 1;
+
+        dict->hash_size = hash_size;
+        if (hash_size == DICT_HASH_INLINE_SIZE) {
+                dict->members = dict->members_internal;
+        } else {
+                dict->members = GF_CALLOC (hash_size, sizeof (data_pair_t *),
+                                           gf_common_mt_dict_members);
                 if (!dict->members) {
                         mem_put (dict);
                         return NULL;
@@ -137,9 +144,7 @@ void
 data_destroy (data_t *data)
 {
         if (data) {
-                LOCK_DESTROY (&data->lock);
-
-                if (!data->is_static) {
+                if (!data->is_static && data->data != data->inline_data) {
                         if (data->data) {
                                 if (data->is_stdalloc)
                                         free (data->data);
@@ -148,6 +153,9 @@ data_destroy (data_t *data)
                         }
                 }
 
+                if (data->iobuf)
+                        iobuf_unref (data->iobuf);
+
                 data->len = 0xbabababa;
                 if (!data->is_const)
                         mem_put (data);
@@ -171,41 +179,144 @@ data_copy (data_t *old)
         if (old) {
                 newdata->len = old->len;
                 if (old->data) {
-                        newdata->data = memdup (old->data, old->len);
-                        if (!newdata->data)
+                        if (data_copy_value (newdata, old->data, old->len))
                                 goto err_out;
                 }
         }
 
-        LOCK_INIT (&newdata->lock);
         return newdata;
 
 err_out:
 
-        FREE (newdata->data);
         mem_put (newdata);
 
         return NULL;
 }
 
+/* Returns @data itself, or a private copy of it if it borrows its value from
+ * an iobuf, so that caching it does not pin the whole iobuf. */
+data_t *
+data_unborrow (data_t *data)
+{
+        if (!data || !data->iobuf)
+                return data;
+
+        return data_copy (data);
+}
+
+/*
+ * The members index is an open-addressed table of pair pointers with linear
+ * probing. Each pair caches the hash of its key, so a probe only falls back
+ * to strcmp() when the hashes match. hash_size is always a power of two and
+ * the table is kept at most three quarters full, so every probe sequence
+ * ends at an empty slot.
+ */
+
+/* Returns the slot holding @key, or the empty slot which ends its probe
+ * sequence. */
+static uint32_t
+_dict_lookup_slot (dict_t *this, char *key, uint32_t hash)
+{
+        uint32_t     mask = this->hash_size - 1;
+        uint32_t     i    = hash & mask;
+        data_pair_t *pair = NULL;
+
+        while ((pair = this->members[i]) != NULL) {
+                if (pair->key_hash == hash && !strcmp (pair->key, key))
+                        break;
+                i = (i + 1) & mask;
+        }
+
+        return i;
+}
+
 static data_pair_t *
 _dict_lookup (dict_t *this, char *key)
 {
+        uint32_t hash = 0;
+
         if (!this || !key) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING,
                                   "!this || !key (%s)", key);
                 return NULL;
         }
 
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
-        data_pair_t *pair;
+        hash = SuperFastHash (key, strlen (key));
+
+        return this->members[_dict_lookup_slot (this, key, hash)];
+}
 
-        for (pair = this->members[hashval]; pair != NULL; pair = pair->hash_next) {
-                if (pair->key && !strcmp (pair->key, key))
-                        return pair;
+static int
+_dict_resize (dict_t *this, int32_t hash_size)
+{
+        data_pair_t **members = NULL;
+        data_pair_t  *pair    = NULL;
+        uint32_t      mask    = hash_size - 1;
+        uint32_t      i       = 0;
+
+        members = GF_CALLOC (hash_size, sizeof (*members),
+                             gf_common_mt_dict_members);
+        if (!members)
+                return -1;
+
+        /* members_list is newest first, so pairs added with duplicate keys
+         * keep their relative order in the probe sequence */
+        for (pair = this->members_list; pair; pair = pair->next) {
+                i = pair->key_hash & mask;
+                while (members[i])
+                        i = (i + 1) & mask;
+                members[i] = pair;
         }
 
-        return NULL;
+        if (this->members != this->members_internal)
+                GF_FREE (this->members);
+
+        this->members = members;
+        this->hash_size = hash_size;
+
+        return 0;
+}
+
+/* Empty slot @i, shifting back any later pair of the same run which would
+ * otherwise become unreachable. */
+static void
+_dict_index_remove (dict_t *this, uint32_t i)
+{
+        uint32_t     mask = this->hash_size - 1;
+        uint32_t     j    = i;
+        uint32_t     home = 0;
+        data_pair_t *pair = NULL;
+
+        for (;;) {
+                j = (j + 1) & mask;
+                pair = this->members[j];
+                if (!pair)
+                        break;
+
+                /* the pair can move to i unless its home slot lies
+                 * cyclically in (i, j] */
+                home = pair->key_hash & mask;
+                if (((j - home) & mask) >= ((j - i) & mask)) {
+                        this->members[i] = pair;
+                        i = j;
+                }
+        }
+
+        this->members[i] = NULL;
+}
+
+static void
+_dict_pair_free (dict_t *this, data_pair_t *pair)
+{
+        if (pair->key != pair->inline_key)
+                GF_FREE (pair->key);
+
+        if (pair == &this->free_pair) {
+                this->free_pair_in_use = _gf_false;
+        }
+        else {
+                mem_put (pair);
+        }
 }
 
 int32_t
@@ -234,44 +345,43 @@ dict_lookup (dict_t *this, char *key, data_t **data)
 static int32_t
 _dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
 {
-        int hashval;
-        data_pair_t *pair;
-        char key_free = 0;
-        int tmp = 0;
-        int ret = 0;
+        data_pair_t *pair = NULL;
+        data_pair_t *tmp  = NULL;
+        char         ref_key[32] = {0,};
+        size_t       keylen = 0;
+        uint32_t     hash = 0;
+        uint32_t     mask = 0;
+        uint32_t     i = 0;
 
         if (!key) {
-                ret = gf_asprintf (&key, "ref:%p", value);
-                if (-1 == ret) {
-                        gf_log ("dict", GF_LOG_WARNING, "asprintf failed %s", key);
-                        return -1;
-                }
-                key_free = 1;
+                snprintf (ref_key, sizeof (ref_key), "ref:%p", value);
+                key = ref_key;
         }
 
-        tmp = SuperFastHash (key, strlen (key));
-        hashval = (tmp % this->hash_size);
+        keylen = strlen (key);
+        hash = SuperFastHash (key, keylen);
 
         /* Search for a existing key if 'replace' is asked for */
         if (replace) {
-                pair = _dict_lookup (this, key);
+                pair = this->members[_dict_lookup_slot (this, key, hash)];
 
                 if (pair) {
                         data_t *unref_data = pair->value;
                         pair->value = data_ref (value);
                         data_unref (unref_data);
-                        if (key_free)
-                                GF_FREE (key);
                         /* Indicates duplicate key */
                         return 0;
                 }
         }
 
+        if ((this->count + 1) * 4 > this->hash_size * 3) {
+                if (_dict_resize (this, this->hash_size * 2) < 0)
+                        return -1;
+        }
+
         if (this->free_pair_in_use) {
                 pair = mem_get0 (THIS->ctx->dict_pair_pool);
                 if (!pair) {
-                        if (key_free)
-                                GF_FREE (key);
                         return -1;
                 }
         }
@@ -280,29 +390,35 @@ _dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
                 this->free_pair_in_use = _gf_true;
         }
 
-        if (key_free) {
-                /* It's ours.  Use it. */
-                pair->key = key;
-                key_free = 0;
+        if (keylen < DICT_KEY_INLINE_SIZE) {
+                pair->key = pair->inline_key;
         }
         else {
-                pair->key = (char *) GF_CALLOC (1, strlen (key) + 1,
+                pair->key = (char *) GF_CALLOC (1, keylen + 1,
                                                 gf_common_mt_char);
                 if (!pair->key) {
-                        if (pair == &this->free_pair) {
-                                this->free_pair_in_use = _gf_false;
-                        }
-                        else {
-                                mem_put (pair);
-                        }
+                        pair->key = pair->inline_key;
+                        _dict_pair_free (this, pair);
                         return -1;
                 }
-                strcpy (pair->key, key);
         }
+        memcpy (pair->key, key, keylen + 1);
+        pair->key_hash = hash;
         pair->value = data_ref (value);
 
-        pair->hash_next = this->members[hashval];
-        this->members[hashval] = pair;
+        /* With dict_add() the key may already be present; the newer pair
+         * takes the earlier slot so that lookups keep finding it first. */
+        mask = this->hash_size - 1;
+        tmp = pair;
+        for (i = hash & mask; this->members[i]; i = (i + 1) & mask) {
+                if (this->members[i]->key_hash == hash &&
+                    !strcmp (this->members[i]->key, key)) {
+                        data_pair_t *older = this->members[i];
+                        this->members[i] = tmp;
+                        tmp = older;
+                }
+        }
+        this->members[i] = tmp;
 
         pair->next = this->members_list;
         pair->prev = NULL;
@@ -311,8 +427,6 @@ _dict_set (dict_t *this, char *key, data_t *value, gf_boolean_t replace)
         this->members_list = pair;
         this->count++;
 
-        if (key_free)
-                GF_FREE (key);
         return 0;
 }
 
@@ -386,48 +500,38 @@ dict_get (dict_t *this, char *key)
 void
 dict_del (dict_t *this, char *key)
 {
+        data_pair_t *pair = NULL;
+        uint32_t     hash = 0;
+        uint32_t     i = 0;
+
         if (!this || !key) {
                 gf_log_callingfn ("dict", GF_LOG_WARNING,
                                   "!this || key=%s", key);
                 return;
         }
 
+        hash = SuperFastHash (key, strlen (key));
+
         LOCK (&this->lock);
 
-        int hashval = SuperFastHash (key, strlen (key)) % this->hash_size;
-        data_pair_t *pair = this->members[hashval];
-        data_pair_t *prev = NULL;
+        i = _dict_lookup_slot (this, key, hash);
+        pair = this->members[i];
 
-        while (pair) {
-                if (strcmp (pair->key, key) == 0) {
-                        if (prev)
-                                prev->hash_next = pair->hash_next;
-                        else
-                                this->members[hashval] = pair->hash_next;
+        if (pair) {
+                _dict_index_remove (this, i);
 
-                        data_unref (pair->value);
+                data_unref (pair->value);
 
-                        if (pair->prev)
-                                pair->prev->next = pair->next;
-                        else
-                                this->members_list = pair->next;
+                if (pair->prev)
+                        pair->prev->next = pair->next;
+                else
+                        this->members_list = pair->next;
 
-                        if (pair->next)
-                                pair->next->prev = pair->prev;
+                if (pair->next)
+                        pair->next->prev = pair->prev;
 
-                        GF_FREE (pair->key);
-                        if (pair == &this->free_pair) {
-                                this->free_pair_in_use = _gf_false;
-                        }
-                        else {
-                                mem_put (pair);
-                        }
-                        this->count--;
-                        break;
-                }
-
-                prev = pair;
-                pair = pair->hash_next;
+                _dict_pair_free (this, pair);
+                this->count--;
         }
 
         UNLOCK (&this->lock);
@@ -451,15 +555,12 @@ dict_destroy (dict_t *this)
         while (prev) {
                 pair = pair->next;
                 data_unref (prev->value);
-                GF_FREE (prev->key);
-                if (prev != &this->free_pair) {
-                        mem_put (prev);
-                }
+                _dict_pair_free (this, prev);
                 prev = pair;
         }
 
-        if (this->members != &this->members_internal) {
-                mem_put (this->members);
+        if (this->members != this->members_internal) {
+                GF_FREE (this->members);
         }
 
         GF_FREE (this->extra_free);
@@ -509,6 +610,8 @@ dict_ref (dict_t *this)
         return this;
 }
 
+/* A data_t is not modified once it is shared, so the refcount is all that
+ * needs to be kept consistent between threads. */
 void
 data_unref (data_t *this)
 {
@@ -519,12 +622,7 @@ data_unref (data_t *this)
                 return;
         }
 
-        LOCK (&this->lock);
-
-        this->refcount--;
-        ref = this->refcount;
-
-        UNLOCK (&this->lock);
+        ref = __sync_sub_and_fetch (&this->refcount, 1);
 
         if (!ref)
                 data_destroy (this);
@@ -538,197 +636,102 @@ data_ref (data_t *this)
                 return NULL;
         }
 
-        LOCK (&this->lock);
-
-        this->refcount++;
-
-        UNLOCK (&this->lock);
+        __sync_add_and_fetch (&this->refcount, 1);
 
         return this;
 }
 
-data_t *
-int_to_data (int64_t value)
+/* Format a value into a new data_t, inline unless it does not fit. */
+static data_t *
+data_from_fmt (const char *fmt, ...)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
+        data_t  *data = NULL;
+        va_list  ap;
+        int      ret = 0;
 
+        data = get_new_data ();
         if (!data) {
                 return NULL;
         }
 
-        ret = gf_asprintf (&data->data, "%"PRId64, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
+        va_start (ap, fmt);
+        ret = vsnprintf (data->inline_data, DICT_DATA_INLINE_SIZE, fmt, ap);
+        va_end (ap);
+
+        if (ret >= 0 && ret < DICT_DATA_INLINE_SIZE) {
+                data->data = data->inline_data;
+        } else {
+                va_start (ap, fmt);
+                ret = gf_vasprintf (&data->data, fmt, ap);
+                va_end (ap);
+                if (-1 == ret) {
+                        gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
+                        mem_put (data);
+                        return NULL;
+                }
         }
-        data->len = strlen (data->data) + 1;
+
+        data->len = ret + 1;
 
         return data;
 }
 
 data_t *
-data_from_int64 (int64_t value)
+int_to_data (int64_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRId64, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-        data->len = strlen (data->data) + 1;
+        return data_from_fmt ("%"PRId64, value);
+}
 
-        return data;
+data_t *
+data_from_int64 (int64_t value)
+{
+        return data_from_fmt ("%"PRId64, value);
 }
 
 data_t *
 data_from_int32 (int32_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRId32, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRId32, value);
 }
 
 data_t *
 data_from_int16 (int16_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRId16, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRId16, value);
 }
 
 data_t *
 data_from_int8 (int8_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%d", value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%d", value);
 }
 
 data_t *
 data_from_uint64 (uint64_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRIu64, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRIu64, value);
 }
 
 static data_t *
 data_from_double (double value)
 {
-        data_t *data = NULL;
-        int     ret  = 0;
-
-        data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-
-        ret = gf_asprintf (&data->data, "%f", value);
-        if (ret == -1) {
-                return NULL;
-        }
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%f", value);
 }
 
 
 data_t *
 data_from_uint32 (uint32_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRIu32, value);
-        if (-1 == ret) {
-                gf_log ("dict", GF_LOG_DEBUG, "asprintf failed");
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRIu32, value);
 }
 
 
 data_t *
 data_from_uint16 (uint16_t value)
 {
-        int     ret = 0;
-        data_t *data = get_new_data ();
-
-        if (!data) {
-                return NULL;
-        }
-        ret = gf_asprintf (&data->data, "%"PRIu16, value);
-        if (-1 == ret) {
-                return NULL;
-        }
-
-        data->len = strlen (data->data) + 1;
-
-        return data;
+        return data_from_fmt ("%"PRIu16, value);
 }
 
-
 data_t *
 data_from_ptr (void *value)
 {
@@ -2530,18 +2533,62 @@ out:
 
 
 /**
- * dict_unserialize - unserialize a buffer into a dict
+ * dict_serialize_into - serialize a dictionary into a buffer of known size
  *
- * @buf:  buf containing serialized dict
- * @size: size of the @buf
- * @fill: dict to fill in
+ * @this: dict to serialize
+ * @buf:  buffer to serialize into
+ * @size: space available in @buf
  *
- * @return: success: 0
- *          failure: -errno
+ * Unlike a dict_serialized_length() and dict_serialize() pair, the length
+ * is computed under the same lock as the serialization, so a dict which
+ * grows in between cannot overrun @buf.
+ *
+ * @return: success: length of the serialized dict
+ *          failure: -errno, -ENOSPC if it does not fit in @size
  */
 
 int32_t
-dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
+dict_serialize_into (dict_t *this, char *buf, int32_t size)
+{
+        int           ret    = -EINVAL;
+        int           len    = 0;
+
+        if (!this || !buf) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING,
+                                  "dict OR buf is NULL");
+                goto out;
+        }
+
+        LOCK (&this->lock);
+        {
+                len = _dict_serialized_length (this);
+                if (len < 0) {
+                        ret = len;
+                        goto unlock;
+                }
+
+                if (len > size) {
+                        ret = -ENOSPC;
+                        goto unlock;
+                }
+
+                ret = _dict_serialize (this, buf);
+                if (ret == 0)
+                        ret = len;
+        }
+unlock:
+        UNLOCK (&this->lock);
+out:
+        return ret;
+}
+
+
+/* With @iobuf set, values of at least DICT_DATA_BORROW_MIN bytes point
+ * straight into @orig_buf, which must lie within @iobuf, and keep a ref on
+ * it. */
+static int32_t
+_dict_unserialize (char *orig_buf, int32_t size, dict_t **fill,
+                   struct iobuf *iobuf)
 {
         char   *buf = NULL;
         int     ret   = -1;
@@ -2646,9 +2693,18 @@ dict_unserialize (char *orig_buf, int32_t size, dict_t **fill)
                         goto out;
                 }
                 value = get_new_data ();
-                value->len  = vallen;
-                value->data = memdup (buf, vallen);
-                value->is_static = 0;
+                if (!value)
+                        goto out;
+
+                if (iobuf && vallen >= DICT_DATA_BORROW_MIN) {
+                        value->data = buf;
+                        value->len  = vallen;
+                        value->is_static = 1;
+                        value->iobuf = iobuf_ref (iobuf);
+                } else if (data_copy_value (value, buf, vallen)) {
+                        mem_put (value);
+                        goto out;
+                }
                 buf += vallen;
 
                 dict_add (*fill, key, value);
@@ -2660,6 +2716,55 @@ out:
 }
 
 
+/**
+ * dict_unserialize - unserialize a buffer into a dict
+ *
+ * @buf:  buf containing serialized dict
+ * @size: size of the @buf
+ * @fill: dict to fill in
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_unserialize (char *buf, int32_t size, dict_t **fill)
+{
+        return _dict_unserialize (buf, size, fill, NULL);
+}
+
+
+/**
+ * dict_unserialize_borrowed - unserialize a buffer into a dict, without
+ *                             copying the values out of it
+ *
+ * @buf:   buf containing serialized dict
+ * @size:  size of the @buf
+ * @fill:  dict to fill in
+ * @iobuf: iobuf holding @buf
+ *
+ * Values of DICT_DATA_BORROW_MIN bytes or more reference @buf directly, and
+ * hold a ref on @iobuf for as long as they live, even if they are shared
+ * with other dicts. Anything that keeps such a value past the fop should
+ * take a data_unborrow () copy of it instead.
+ *
+ * @return: success: 0
+ *          failure: -errno
+ */
+
+int32_t
+dict_unserialize_borrowed (char *buf, int32_t size, dict_t **fill,
+                           struct iobuf *iobuf)
+{
+        if (!iobuf) {
+                gf_log_callingfn ("dict", GF_LOG_WARNING, "iobuf is NULL");
+                return -1;
+        }
+
+        return _dict_unserialize (buf, size, fill, iobuf);
+}
+
+
 /**
  * dict_allocate_and_serialize - serialize a dictionary into an allocated buffer
  *
@@ -26,6 +26,8 @@ typedef struct _data data_t;
 typedef struct _dict dict_t;
 typedef struct _data_pair data_pair_t;
 
+struct iobuf;
+
 
 #define GF_PROTOCOL_DICT_SERIALIZE(this,from_dict,to,len,ope,labl) do { \
                 int    ret     = 0;                                     \
@@ -62,6 +64,23 @@ typedef struct _data_pair data_pair_t;
                                                                         \
         } while (0)
 
+/* Number of index slots embedded in dict_t. The index is kept at most
+ * three quarters full, so dicts of up to 24 keys (which covers nearly all
+ * xdata) never allocate a separate table. */
+#define DICT_HASH_INLINE_SIZE     32
+
+/* Keys shorter than this are stored in the pair itself. */
+#define DICT_KEY_INLINE_SIZE      64
+
+/* Values up to this length (including the terminating '\0' of strings) are
+ * stored in the data_t itself. This is enough for any formatted int64_t. */
+#define DICT_DATA_INLINE_SIZE     24
+
+/* Only values at least this long are borrowed from an iobuf by
+ * dict_unserialize_borrowed (); shorter ones are cheaper to copy than to
+ * keep the whole iobuf alive for. */
+#define DICT_DATA_BORROW_MIN      4096
+
 struct _data {
         unsigned char  is_static:1;
         unsigned char  is_const:1;
@@ -69,28 +88,30 @@ struct _data {
         int32_t        len;
         char          *data;
         int32_t        refcount;
-        gf_lock_t      lock;
+        struct iobuf  *iobuf;           /* pins a borrowed ->data */
+        char           inline_data[DICT_DATA_INLINE_SIZE];
 };
 
 struct _data_pair {
-        struct _data_pair *hash_next;
         struct _data_pair *prev;
         struct _data_pair *next;
         data_t            *value;
         char              *key;
+        uint32_t           key_hash;
+        char               inline_key[DICT_KEY_INLINE_SIZE];
 };
 
 struct _dict {
         unsigned char   is_static:1;
-        int32_t         hash_size;
+        int32_t         hash_size;      /* slots in members, a power of two */
         int32_t         count;
         int32_t         refcount;
-        data_pair_t   **members;
+        data_pair_t   **members;        /* open-addressed index of pairs */
         data_pair_t    *members_list;
         char           *extra_free;
         char           *extra_stdfree;
         gf_lock_t       lock;
-        data_pair_t    *members_internal;
+        data_pair_t    *members_internal[DICT_HASH_INLINE_SIZE];
         data_pair_t     free_pair;
         gf_boolean_t    free_pair_in_use;
 };
@@ -110,7 +131,10 @@ int dict_reset (dict_t *dict);
 
 int32_t dict_serialized_length (dict_t *dict);
 int32_t dict_serialize (dict_t *dict, char *buf);
+int32_t dict_serialize_into (dict_t *dict, char *buf, int32_t size);
 int32_t dict_unserialize (char *buf, int32_t size, dict_t **fill);
+int32_t dict_unserialize_borrowed (char *buf, int32_t size, dict_t **fill,
+                                   struct iobuf *iobuf);
 
 int32_t dict_allocate_and_serialize (dict_t *this, char **buf, u_int *length);
 
@@ -160,6 +184,7 @@ void *data_to_ptr (data_t *data);
 
 data_t *get_new_data ();
 data_t * data_copy (data_t *old);
+data_t *data_unborrow (data_t *data);
 dict_t *get_new_dict_full (int size_hint);
 dict_t *get_new_dict ();
 
@@ -31,33 +31,242 @@
 #include <sys/epoll.h>
 
 
+struct event_slot_epoll {
+        int              fd;
+        int              events;
+        int              gen;
+        int              in_handler;
+        int              free_pending; /* put on free list after handler */
+        int              next_free;
+        void            *data;
+        event_handler_t  handler;
+        gf_lock_t        lock;
+};
+
+
+static struct event_slot_epoll *
+event_slot_get (struct event_pool *event_pool, int idx)
+{
+        struct event_slot_epoll *table = NULL;
+
+        if (idx < 0 || idx >= EVENT_EPOLL_TABLES * EVENT_EPOLL_SLOTS)
+                return NULL;
+
+        table = event_pool->ereg[idx / EVENT_EPOLL_SLOTS];
+        if (!table)
+                return NULL;
+
+        return &table[idx % EVENT_EPOLL_SLOTS];
+}
+
+
 static int
-__event_getindex (struct event_pool *event_pool, int fd, int idx)
+__event_newtable (struct event_pool *event_pool)
 {
-        int  ret = -1;
-        int  i = 0;
+        struct event_slot_epoll *table = NULL;
+        int                      table_idx = 0;
+        int                      i = 0;
+
+        table_idx = event_pool->etables;
+        if (table_idx == EVENT_EPOLL_TABLES) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "all %d event registry tables are in use",
+                        EVENT_EPOLL_TABLES);
+                return -1;
+        }
 
-        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+        table = GF_CALLOC (EVENT_EPOLL_SLOTS, sizeof (*table),
+                           gf_common_mt_ereg);
+        if (!table)
+                return -1;
+
+        /* chain the new slots in index order in front of the free list */
+        for (i = 0; i < EVENT_EPOLL_SLOTS; i++) {
+                table[i].fd = -1;
+                table[i].next_free = (i == EVENT_EPOLL_SLOTS - 1) ?
+                        event_pool->efree :
+                        table_idx * EVENT_EPOLL_SLOTS + i + 1;
+                LOCK_INIT (&table[i].lock);
+        }
+
+        event_pool->ereg[table_idx] = table;
+        event_pool->efree = table_idx * EVENT_EPOLL_SLOTS;
+        event_pool->etables++;
+
+        return 0;
+}
 
-        if (idx > -1 && idx < event_pool->used) {
-                if (event_pool->reg[idx].fd == fd)
-                        ret = idx;
+
+static int
+event_slot_alloc (struct event_pool *event_pool)
+{
+        struct event_slot_epoll *slot = NULL;
+        int                      idx = -1;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                if (event_pool->efree == -1 &&
+                    __event_newtable (event_pool) != 0)
+                        goto unlock;
+
+                idx = event_pool->efree;
+                slot = event_slot_get (event_pool, idx);
+                event_pool->efree = slot->next_free;
+                slot->next_free = -1;
+                event_pool->used++;
         }
+unlock:
+        pthread_mutex_unlock (&event_pool->mutex);
 
-        for (i=0; ret == -1 && i<event_pool->used; i++) {
-                if (event_pool->reg[i].fd == fd) {
-                        ret = i;
-                        break;
+        return idx;
+}
+
+
+static void
+event_slot_dealloc (struct event_pool *event_pool, int idx)
+{
+        struct event_slot_epoll *slot = NULL;
+
+        slot = event_slot_get (event_pool, idx);
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                slot->next_free = event_pool->efree;
+                event_pool->efree = idx;
+                event_pool->used--;
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
+}
+
+
+/* Must be called with slot->lock held. Returns non-zero if the slot can
+ * go back on the free list right away, otherwise the dispatcher thread
+ * executing its handler puts it back once the handler returns.
+ */
+static int
+__event_slot_release (struct event_slot_epoll *slot)
+{
+        /* the generation bump makes sure that no dispatcher thread will
+           call the handler of this registration again, even if the slot
+           gets reused by another fd */
+        slot->fd = -1;
+        slot->gen++;
+        slot->handler = NULL;
+        slot->data = NULL;
+
+        if (slot->in_handler) {
+                slot->free_pending = 1;
+                return 0;
+        }
+
+        return 1;
+}
+
+
+/* Slow path, only for callers which lost track of the index returned by
+ * event_register ().
+ */
+static int
+event_slot_find (struct event_pool *event_pool, int fd)
+{
+        struct event_slot_epoll *table = NULL;
+        int                      etables = 0;
+        int                      i = 0;
+        int                      j = 0;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                etables = event_pool->etables;
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
+
+        for (i = 0; i < etables; i++) {
+                table = event_pool->ereg[i];
+                for (j = 0; j < EVENT_EPOLL_SLOTS; j++) {
+                        if (table[j].fd == fd)
+                                return i * EVENT_EPOLL_SLOTS + j;
                 }
         }
 
+        return -1;
+}
+
+
+/* Returns the slot registered for fd with its lock held, NULL if fd is
+ * not registered.
+ */
+static struct event_slot_epoll *
+event_slot_lock (struct event_pool *event_pool, int fd, int *idx_p)
+{
+        struct event_slot_epoll *slot = NULL;
+        int                      idx = *idx_p;
+
+        slot = event_slot_get (event_pool, idx);
+        if (slot) {
+                LOCK (&slot->lock);
+                if (slot->fd == fd)
+                        goto out;
+                UNLOCK (&slot->lock);
+        }
+
+        idx = event_slot_find (event_pool, fd);
+        slot = event_slot_get (event_pool, idx);
+        if (!slot)
+                return NULL;
+
+        LOCK (&slot->lock);
+        if (slot->fd != fd) {
+                UNLOCK (&slot->lock);
+                return NULL;
+        }
 out:
-        return ret;
+        *idx_p = idx;
+        return slot;
+}
+
+
+static int
+__event_slot_set_events (struct event_slot_epoll *slot, int poll_in,
+                         int poll_out)
+{
+        switch (poll_in) {
+        case 1:
+                slot->events |= EPOLLIN;
+                break;
+        case 0:
+                slot->events &= ~EPOLLIN;
+                break;
+        case -1:
+                /* do nothing */
+                break;
+        default:
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "invalid poll_in value %d", poll_in);
+                break;
+        }
+
+        switch (poll_out) {
+        case 1:
+                slot->events |= EPOLLOUT;
+                break;
+        case 0:
+                slot->events &= ~EPOLLOUT;
+                break;
+        case -1:
+                /* do nothing */
+                break;
+        default:
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "invalid poll_out value %d", poll_out);
+                break;
+        }
+
+        return slot->events;
 }
 
 
 static struct event_pool *
-event_pool_new_epoll (int count)
+event_pool_new_epoll (int count, int eventthreadcount)
 {
         struct event_pool *event_pool = NULL;
         int                epfd = -1;
@@ -68,23 +277,11 @@ event_pool_new_epoll (int count)
         if (!event_pool)
                 goto out;
 
-        event_pool->count = count;
-        event_pool->reg = GF_CALLOC (event_pool->count,
-                                     sizeof (*event_pool->reg),
-                                     gf_common_mt_reg);
-
-        if (!event_pool->reg) {
-                GF_FREE (event_pool);
-                event_pool = NULL;
-                goto out;
-        }
-
         epfd = epoll_create (count);
 
         if (epfd == -1) {
                 gf_log ("epoll", GF_LOG_ERROR, "epoll fd creation failed (%s)",
                         strerror (errno));
-                GF_FREE (event_pool->reg);
                 GF_FREE (event_pool);
                 event_pool = NULL;
                 goto out;
@@ -93,6 +290,13 @@ event_pool_new_epoll (int count)
         event_pool->fd = epfd;
 
         event_pool->count = count;
+        event_pool->efree = -1;
+
+        if (eventthreadcount < 1)
+                eventthreadcount = 1;
+        if (eventthreadcount > EVENT_MAX_THREADS)
+                eventthreadcount = EVENT_MAX_THREADS;
+        event_pool->eventthreadcount = eventthreadcount;
 
         pthread_mutex_init (&event_pool->mutex, NULL);
         pthread_cond_init (&event_pool->cond, NULL);
@@ -107,75 +311,41 @@ event_register_epoll (struct event_pool *event_pool, int fd,
                       event_handler_t handler,
                       void *data, int poll_in, int poll_out)
 {
-        int                 idx = -1;
-        int                 ret = -1;
-        struct epoll_event  epoll_event = {0, };
-        struct event_data  *ev_data = (void *)&epoll_event.data;
+        int                      idx = -1;
+        int                      ret = -1;
+        int                      do_free = 0;
+        struct event_slot_epoll *slot = NULL;
+        struct epoll_event       epoll_event = {0, };
+        struct event_data       *ev_data = (void *)&epoll_event.data;
 
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-        pthread_mutex_lock (&event_pool->mutex);
-        {
-                if (event_pool->count == event_pool->used) {
-                        event_pool->count *= 2;
-
-                        event_pool->reg = GF_REALLOC (event_pool->reg,
-                                                      event_pool->count *
-                                                      sizeof (*event_pool->reg));
-
-                        if (!event_pool->reg) {
-                                gf_log ("epoll", GF_LOG_ERROR,
-                                        "event registry re-allocation failed");
-                                goto unlock;
-                        }
-                }
-
-                idx = event_pool->used;
-                event_pool->used++;
+        idx = event_slot_alloc (event_pool);
+        if (idx == -1) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "could not find slot for fd=%d", fd);
+                goto out;
+        }
 
-                event_pool->reg[idx].fd = fd;
-                event_pool->reg[idx].events = EPOLLPRI;
-                event_pool->reg[idx].handler = handler;
-                event_pool->reg[idx].data = data;
+        slot = event_slot_get (event_pool, idx);
 
-                switch (poll_in) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLIN;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLIN;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_in value %d", poll_in);
-                        break;
-                }
-
-                switch (poll_out) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLOUT;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLOUT;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_out value %d", poll_out);
-                        break;
-                }
+        LOCK (&slot->lock);
+        {
+                slot->fd = fd;
+                slot->events = EPOLLPRI;
+                slot->handler = handler;
+                slot->data = data;
 
-                event_pool->changed = 1;
+                __event_slot_set_events (slot, poll_in, poll_out);
 
-                epoll_event.events = event_pool->reg[idx].events;
-                ev_data->fd = fd;
+                /* EPOLLONESHOT makes sure that a registered fd is handed
+                 * to at most one dispatcher thread at a time. The fd is
+                 * re-armed once its handler has returned.
+                 */
+                epoll_event.events = slot->events | EPOLLONESHOT;
                 ev_data->idx = idx;
+                ev_data->gen = slot->gen;
 
                 ret = epoll_ctl (event_pool->fd, EPOLL_CTL_ADD, fd,
                                  &epoll_event);
@@ -184,14 +354,17 @@ event_register_epoll (struct event_pool *event_pool, int fd,
                         gf_log ("epoll", GF_LOG_ERROR,
                                 "failed to add fd(=%d) to epoll fd(=%d) (%s)",
                                 fd, event_pool->fd, strerror (errno));
+                        do_free = __event_slot_release (slot);
                         goto unlock;
                 }
 
-                pthread_cond_broadcast (&event_pool->cond);
+                ret = idx;
         }
 unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
+        UNLOCK (&slot->lock);
 
+        if (do_free)
+                event_slot_dealloc (event_pool, idx);
 out:
         return ret;
 }
@@ -200,71 +373,37 @@ out:
 static int
 event_unregister_epoll (struct event_pool *event_pool, int fd, int idx_hint)
 {
-        int  idx = -1;
-        int  ret = -1;
-
-        struct epoll_event epoll_event = {0, };
-        struct event_data *ev_data = (void *)&epoll_event.data;
-        int                lastidx = -1;
+        int                      idx = idx_hint;
+        int                      ret = -1;
+        int                      do_free = 0;
+        struct event_slot_epoll *slot = NULL;
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-        pthread_mutex_lock (&event_pool->mutex);
+        slot = event_slot_lock (event_pool, fd, &idx);
+        if (!slot) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "index not found for fd=%d (idx_hint=%d)",
+                        fd, idx_hint);
+                errno = ENOENT;
+                goto out;
+        }
         {
-                idx = __event_getindex (event_pool, fd, idx_hint);
-
-                if (idx == -1) {
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "index not found for fd=%d (idx_hint=%d)",
-                                fd, idx_hint);
-                        errno = ENOENT;
-                        goto unlock;
-                }
-
                 ret = epoll_ctl (event_pool->fd, EPOLL_CTL_DEL, fd, NULL);
 
-                /* if ret is -1, this array member should never be accessed */
-                /* if it is 0, the array member might be used by idx_cache
-                 * in which case the member should not be accessed till
-                 * it is reallocated
-                 */
-
-                event_pool->reg[idx].fd = -1;
+                /* release the slot even if EPOLL_CTL_DEL failed */
+                do_free = __event_slot_release (slot);
 
                 if (ret == -1) {
                         gf_log ("epoll", GF_LOG_ERROR,
                                 "fail to del fd(=%d) from epoll fd(=%d) (%s)",
                                 fd, event_pool->fd, strerror (errno));
-                        goto unlock;
                 }
-
-                lastidx = event_pool->used - 1;
-                if (lastidx == idx) {
-                        event_pool->used--;
-                        goto unlock;
-                }
-
-                epoll_event.events = event_pool->reg[lastidx].events;
-                ev_data->fd = event_pool->reg[lastidx].fd;
-                ev_data->idx = idx;
-
-                ret = epoll_ctl (event_pool->fd, EPOLL_CTL_MOD, ev_data->fd,
-                                 &epoll_event);
-                if (ret == -1) {
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "fail to modify fd(=%d) index %d to %d (%s)",
-                                ev_data->fd, event_pool->used, idx,
-                                strerror (errno));
-                        goto unlock;
-                }
-
-                /* just replace the unregistered idx by last one */
-                event_pool->reg[idx] = event_pool->reg[lastidx];
-                event_pool->used--;
         }
-unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
+        UNLOCK (&slot->lock);
 
+        if (do_free)
+                event_slot_dealloc (event_pool, idx);
 out:
         return ret;
 }
@@ -274,62 +413,39 @@ static int
 event_select_on_epoll (struct event_pool *event_pool, int fd, int idx_hint,
                        int poll_in, int poll_out)
 {
-        int idx = -1;
-        int ret = -1;
-
-        struct epoll_event epoll_event = {0, };
-        struct event_data *ev_data = (void *)&epoll_event.data;
+        int                      idx = idx_hint;
+        int                      ret = -1;
+        struct event_slot_epoll *slot = NULL;
+        struct epoll_event       epoll_event = {0, };
+        struct event_data       *ev_data = (void *)&epoll_event.data;
 
 
         GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-        pthread_mutex_lock (&event_pool->mutex);
+        slot = event_slot_lock (event_pool, fd, &idx);
+        if (!slot) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "index not found for fd=%d (idx_hint=%d)",
+                        fd, idx_hint);
+                errno = ENOENT;
+                goto out;
+        }
         {
-                idx = __event_getindex (event_pool, fd, idx_hint);
-
-                if (idx == -1) {
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "index not found for fd=%d (idx_hint=%d)",
-                                fd, idx_hint);
-                        errno = ENOENT;
-                        goto unlock;
-                }
+                __event_slot_set_events (slot, poll_in, poll_out);
 
-                switch (poll_in) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLIN;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLIN;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_in value %d", poll_in);
-                        break;
-                }
+                ret = idx;
 
-                switch (poll_out) {
-                case 1:
-                        event_pool->reg[idx].events |= EPOLLOUT;
-                        break;
-                case 0:
-                        event_pool->reg[idx].events &= ~EPOLLOUT;
-                        break;
-                case -1:
-                        /* do nothing */
-                        break;
-                default:
-                        gf_log ("epoll", GF_LOG_ERROR,
-                                "invalid poll_out value %d", poll_out);
-                        break;
-                }
+                /* A dispatcher thread is executing the handler of this fd
+                 * and will re-arm it with the new events once the handler
+                 * returns. Re-arming here would let a second thread into
+                 * the handler of the same fd.
+                 */
+                if (slot->in_handler)
+                        goto unlock;
 
-                epoll_event.events = event_pool->reg[idx].events;
-                ev_data->fd = fd;
+                epoll_event.events = slot->events | EPOLLONESHOT;
                 ev_data->idx = idx;
+                ev_data->gen = slot->gen;
 
                 ret = epoll_ctl (event_pool->fd, EPOLL_CTL_MOD, fd,
                                  &epoll_event);
@@ -337,11 +453,13 @@ event_select_on_epoll (struct event_pool *event_pool, int fd, int idx_hint,
                         gf_log ("epoll", GF_LOG_ERROR,
                                 "failed to modify fd(=%d) events to %d",
                                 fd, epoll_event.events);
+                        goto unlock;
                 }
+
+                ret = idx;
         }
 unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
-
+        UNLOCK (&slot->lock);
 out:
         return ret;
 }
@@ -349,84 +467,145 @@ out:
 
 static int
 event_dispatch_epoll_handler (struct event_pool *event_pool,
-                              struct epoll_event *events, int i)
+                              struct epoll_event *event)
 {
-        struct event_data  *event_data = NULL;
-        event_handler_t     handler = NULL;
-        void               *data = NULL;
-        int                 idx = -1;
-        int                 ret = -1;
+        struct event_data       *ev_data = NULL;
+        struct event_slot_epoll *slot = NULL;
+        event_handler_t          handler = NULL;
+        void                    *data = NULL;
+        int                      idx = -1;
+        int                      gen = -1;
+        int                      fd = -1;
+        int                      do_free = 0;
+        int                      ret = -1;
+
+
+        ev_data = (void *)&event->data;
+        idx = ev_data->idx;
+        gen = ev_data->gen;
+
+        slot = event_slot_get (event_pool, idx);
+        if (!slot) {
+                gf_log ("epoll", GF_LOG_ERROR,
+                        "invalid slot index %d in event", idx);
+                goto out;
+        }
+
+        LOCK (&slot->lock);
+        {
+                if (slot->fd == -1 || slot->gen != gen) {
+                        /* fd got unregistered in another thread, the
+                         * slot might even be in use by another fd now */
+                        gf_log ("epoll", GF_LOG_DEBUG,
+                                "stale event on idx=%d, gen=%d, events=%d, "
+                                "slot->gen=%d", idx, gen, event->events,
+                                slot->gen);
+                        goto pre_unlock;
+                }
 
+                fd = slot->fd;
+                handler = slot->handler;
+                data = slot->data;
 
-        event_data = (void *)&events[i].data;
-        handler = NULL;
-        data = NULL;
+                slot->in_handler++;
+        }
+pre_unlock:
+        UNLOCK (&slot->lock);
 
-        pthread_mutex_lock (&event_pool->mutex);
+        if (!handler)
+                goto out;
+
+        ret = handler (fd, idx, data,
+                       (event->events & (EPOLLIN|EPOLLPRI)),
+                       (event->events & (EPOLLOUT)),
+                       (event->events & (EPOLLERR|EPOLLHUP)));
+
+        LOCK (&slot->lock);
         {
-                idx = __event_getindex (event_pool, event_data->fd,
-                                        event_data->idx);
+                slot->in_handler--;
+
+                if (slot->gen != gen) {
+                        /* event_unregister() happened while we were
+                         * in handler () */
+                        if (slot->in_handler == 0 && slot->free_pending) {
+                                slot->free_pending = 0;
+                                do_free = 1;
+                        }
+                        goto post_unlock;
+                }
 
-                if (idx == -1) {
+                /* re-arm with the current events, which also picks up
+                 * the changes made by event_select_on() while we were
+                 * in handler () */
+                event->events = slot->events | EPOLLONESHOT;
+                if (epoll_ctl (event_pool->fd, EPOLL_CTL_MOD, fd,
+                               event) == -1) {
                         gf_log ("epoll", GF_LOG_ERROR,
-                                "index not found for fd(=%d) (idx_hint=%d)",
-                                event_data->fd, event_data->idx);
-                        goto unlock;
+                                "failed to re-arm fd(=%d) idx=%d (%s)",
+                                fd, idx, strerror (errno));
                 }
-
-                handler = event_pool->reg[idx].handler;
-                data = event_pool->reg[idx].data;
         }
-unlock:
-        pthread_mutex_unlock (&event_pool->mutex);
+post_unlock:
+        UNLOCK (&slot->lock);
 
-        if (handler)
-                ret = handler (event_data->fd, event_data->idx, data,
-                               (events[i].events & (EPOLLIN|EPOLLPRI)),
-                               (events[i].events & (EPOLLOUT)),
-                               (events[i].events & (EPOLLERR|EPOLLHUP)));
+        if (do_free)
+                event_slot_dealloc (event_pool, idx);
+out:
         return ret;
 }
 
 
-static int
-event_dispatch_epoll (struct event_pool *event_pool)
+static void *
+event_dispatch_epoll_worker (void *data)
 {
-        struct epoll_event *events = NULL;
-        int                 size = 0;
-        int                 i = 0;
-        int                 ret = -1;
+        struct event_thread_data *ev_data = data;
+        struct event_pool        *event_pool = NULL;
+        struct epoll_event        event;
+        int                       myindex = -1;
+        int                       timetodie = 0;
+        int                       ret = -1;
 
-        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+        GF_VALIDATE_OR_GOTO ("event", ev_data, out);
 
-        while (1) {
-                pthread_mutex_lock (&event_pool->mutex);
-                {
-                        while (event_pool->used == 0)
-                                pthread_cond_wait (&event_pool->cond,
-                                                   &event_pool->mutex);
+        event_pool = ev_data->event_pool;
+        myindex = ev_data->event_index;
 
-                        if (event_pool->used > event_pool->evcache_size) {
-                                GF_FREE (event_pool->evcache);
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
 
-                                event_pool->evcache = events = NULL;
+        gf_log ("epoll", GF_LOG_INFO, "Started thread with index %d",
+                myindex);
 
-                                event_pool->evcache_size =
-                                        event_pool->used + 256;
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                event_pool->activethreadcount++;
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
 
-                                events = GF_CALLOC (event_pool->evcache_size,
-                                                    sizeof (struct epoll_event),
-                                                    gf_common_mt_epoll_event);
-                                if (!events)
-                                        break;
+        for (;;) {
+                if (event_pool->eventthreadcount < myindex) {
+                        /* the thread count was reduced below our index,
+                         * re-check under the lock before exiting */
+                        pthread_mutex_lock (&event_pool->mutex);
+                        {
+                                if (event_pool->eventthreadcount < myindex) {
+                                        event_pool->pollers[myindex - 1] = 0;
+                                        event_pool->activethreadcount--;
+                                        timetodie = 1;
+                                }
+                        }
+                        pthread_mutex_unlock (&event_pool->mutex);
 
-                                event_pool->evcache = events;
+                        if (timetodie) {
+                                gf_log ("epoll", GF_LOG_INFO,
+                                        "Exited thread with index %d",
+                                        myindex);
+                                goto out;
                         }
                 }
-                pthread_mutex_unlock (&event_pool->mutex);
 
-                ret = epoll_wait (event_pool->fd, event_pool->evcache,
-                                  event_pool->evcache_size, -1);
+                /* one event per wakeup, so that a burst of events is
+                 * spread across all the dispatcher threads */
+                ret = epoll_wait (event_pool->fd, &event, 1, -1);
 
                 if (ret == 0)
                         /* timeout */
@@ -436,17 +615,130 @@ event_dispatch_epoll (struct event_pool *event_pool)
                         /* sys call */
                         continue;
 
-                size = ret;
+                if (ret == -1) {
+                        gf_log ("epoll", GF_LOG_ERROR,
+                                "epoll_wait failed on epoll fd(=%d) (%s)",
+                                event_pool->fd, strerror (errno));
+                        continue;
+                }
+
+                ret = event_dispatch_epoll_handler (event_pool, &event);
+        }
+out:
+        GF_FREE (ev_data);
+
+        return NULL;
+}
+
+
+/* Must be called with event_pool->mutex held. Starts dispatcher threads
+ * for the indices in [1, eventthreadcount] which do not have one running.
+ */
+static int
+__event_start_threads (struct event_pool *event_pool)
+{
+        struct event_thread_data *ev_data = NULL;
+        pthread_t                 t_id;
+        int                       i = 0;
+        int                       ret = 0;
 
-                for (i = 0; i < size; i++) {
-                        if (!events || !events[i].events)
-                                continue;
+        for (i = 0; i < event_pool->eventthreadcount; i++) {
+                if (event_pool->pollers[i] != 0)
+                        continue;
 
-                        ret = event_dispatch_epoll_handler (event_pool,
-                                                            events, i);
+                ev_data = GF_CALLOC (1, sizeof (*ev_data),
+                                     gf_common_mt_event_thread_data);
+                if (!ev_data) {
+                        ret = -1;
+                        break;
                 }
+
+                ev_data->event_pool = event_pool;
+                ev_data->event_index = i + 1;
+
+                if (gf_thread_create (&t_id, NULL,
+                                      event_dispatch_epoll_worker,
+                                      ev_data) != 0) {
+                        gf_log ("epoll", GF_LOG_WARNING,
+                                "failed to start dispatcher thread with "
+                                "index %d", i + 1);
+                        GF_FREE (ev_data);
+                        ret = -1;
+                        break;
+                }
+
+                pthread_detach (t_id);
+                event_pool->pollers[i] = t_id;
+        }
+
+        return ret;
+}
+
+
+static int
+event_dispatch_epoll (struct event_pool *event_pool)
+{
+        int ret = -1;
+
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                ret = __event_start_threads (event_pool);
+
+                /* carry on with fewer threads, as long as we have one */
+                if (event_pool->pollers[0] != 0)
+                        ret = 0;
+        }
+        pthread_mutex_unlock (&event_pool->mutex);
+
+        if (ret)
+                goto out;
+
+        /* The thread with index 1 is never asked to exit, wait on it
+         * forever like the single threaded dispatcher used to */
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                while (event_pool->pollers[0] != 0)
+                        pthread_cond_wait (&event_pool->cond,
+                                           &event_pool->mutex);
         }
+        pthread_mutex_unlock (&event_pool->mutex);
+out:
+        return ret;
+}
+
 
+static int
+event_reconfigure_threads_epoll (struct event_pool *event_pool, int value)
+{
+        int ret = 0;
+
+        GF_VALIDATE_OR_GOTO ("event", event_pool, out);
+
+        if (value < 1)
+                value = 1;
+        if (value > EVENT_MAX_THREADS)
+                value = EVENT_MAX_THREADS;
+
+        pthread_mutex_lock (&event_pool->mutex);
+        {
+                if (event_pool->eventthreadcount == value)
+                        goto unlock;
+
+                gf_log ("epoll", GF_LOG_INFO,
+                        "changing event thread count from %d to %d",
+                        event_pool->eventthreadcount, value);
+
+                event_pool->eventthreadcount = value;
+
+                /* threads get started only once event_dispatch () runs,
+                 * surplus threads exit on their next wakeup */
+                if (event_pool->pollers[0] != 0)
+                        ret = __event_start_threads (event_pool);
+        }
+unlock:
+        pthread_mutex_unlock (&event_pool->mutex);
 out:
         return ret;
 }
@@ -457,7 +749,8 @@ struct event_ops event_ops_epoll = {
         .event_register   = event_register_epoll,
         .event_select_on  = event_select_on_epoll,
         .event_unregister = event_unregister_epoll,
-        .event_dispatch   = event_dispatch_epoll
+        .event_dispatch   = event_dispatch_epoll,
+        .event_reconfigure_threads = event_reconfigure_threads_epoll
 };
 
 #endif
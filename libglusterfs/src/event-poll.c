@@ -81,7 +81,7 @@ out:
 
 
 static struct event_pool *
-event_pool_new_poll (int count)
+event_pool_new_poll (int count, int eventthreadcount)
 {
         struct event_pool *event_pool = NULL;
         int                ret = -1;
@@ -157,6 +157,12 @@ event_pool_new_poll (int count)
                 return NULL;
         }
 
+        if (eventthreadcount > 1) {
+                gf_log ("poll", GF_LOG_INFO,
+                        "poll based event handling is single threaded, "
+                        "ignoring event thread count %d", eventthreadcount);
+        }
+
         return event_pool;
 }
 
@@ -18,11 +18,18 @@
 
 #include <pthread.h>
 
+#define EVENT_MAX_THREADS  32
+#define STARTING_EVENT_THREADS  2
+
+#define EVENT_EPOLL_TABLES 1024
+#define EVENT_EPOLL_SLOTS 1024
+
 struct event_pool;
 struct event_ops;
+struct event_slot_epoll;
 struct event_data {
-	int fd;
 	int idx;
+	int gen;
 } __attribute__ ((__packed__, __may_alias__));
 
 
@@ -43,6 +50,13 @@ struct event_pool {
 		event_handler_t handler;
 	} *reg;
 
+	/* epoll registrations live in fixed size tables of slots which are
+	   allocated on demand and never moved or freed, so that a slot can
+	   be looked up by its index without holding the pool mutex. */
+	struct event_slot_epoll *ereg[EVENT_EPOLL_TABLES];
+	int etables; /* number of tables allocated in ereg */
+	int efree; /* index of the first free slot, -1 if none */
+
 	int used;
 	int changed;
 
@@ -51,10 +65,21 @@ struct event_pool {
 
 	void *evcache;
 	int evcache_size;
+
+	/* NOTE: the thread count is honoured only by the epoll backend,
+	 * the poll backend always dispatches from a single thread. */
+	int eventthreadcount; /* number of dispatcher threads wanted */
+	int activethreadcount; /* number of dispatcher threads running */
+	pthread_t pollers[EVENT_MAX_THREADS];
+};
+
+struct event_thread_data {
+	struct event_pool *event_pool;
+	int event_index;
 };
 
 struct event_ops {
-        struct event_pool * (*new) (int count);
+        struct event_pool * (*new) (int count, int eventthreadcount);
 
         int (*event_register) (struct event_pool *event_pool, int fd,
                                event_handler_t handler,
@@ -66,9 +91,12 @@ struct event_ops {
         int (*event_unregister) (struct event_pool *event_pool, int fd, int idx);
 
         int (*event_dispatch) (struct event_pool *event_pool);
+
+        int (*event_reconfigure_threads) (struct event_pool *event_pool,
+                                          int newcount);
 };
 
-struct event_pool * event_pool_new (int count);
+struct event_pool * event_pool_new (int count, int eventthreadcount);
 int event_select_on (struct event_pool *event_pool, int fd, int idx,
 		     int poll_in, int poll_out);
 int event_register (struct event_pool *event_pool, int fd,
@@ -76,5 +104,6 @@ int event_register (struct event_pool *event_pool, int fd,
 		    void *data, int poll_in, int poll_out);
 int event_unregister (struct event_pool *event_pool, int fd, int idx);
 int event_dispatch (struct event_pool *event_pool);
+int event_reconfigure_threads (struct event_pool *event_pool, int value);
 
 #endif /* _EVENT_H_ */
@@ -261,6 +261,7 @@ typedef enum {
 	GF_FOP_FALLOCATE,
 	GF_FOP_DISCARD,
         GF_FOP_ZEROFILL,
+        GF_FOP_COMPOUND,
         GF_FOP_MAXVALUE,
 } glusterfs_fop_t;
 
@@ -425,6 +426,25 @@ struct _cmd_args {
 
         /* Should management connections use SSL? */
         int             secure_mgmt;
+
+        /* Number of event dispatcher threads */
+        int             event_threads;
+
+        /* Number of threads running timer callbacks, 0 runs them on the
+           timer thread */
+        int             timer_threads;
+
+        /* Measure latencies from startup, timing 1 frame in this many */
+        uint32_t        latency_sample_rate;
+
+        /* Back the iobuf arenas with huge pages */
+        int             iobuf_huge_pages;
+
+        /* Sample one allocation in this many by call site */
+        uint32_t        mem_profile_rate;
+
+        /* Stack size of the synctasks, 0 for the default */
+        size_t          synctask_stack_size;
 };
 typedef struct _cmd_args cmd_args_t;
 
@@ -472,6 +492,8 @@ struct _glusterfs_ctx {
         void               *mgmt;   /* xlator implementing MOPs for centralized logging, volfile server */
         void               *listener; /* listener of the commands from glusterd */
         unsigned char       measure_latency; /* toggle switch for latency measurement */
+        uint32_t            latency_sample_rate; /* time 1 frame in this
+                                                    many, 0 or 1 for all */
         pthread_t           sigwaiter;
 	char               *cmdlinestr;
         struct mem_pool    *stub_mem_pool;
@@ -46,14 +46,32 @@ __inode_unref (inode_t *inode);
 static int
 inode_table_prune (inode_table_t *table);
 
+static void
+inode_unref_batch_flush (void);
+
 void
 fd_dump (struct list_head *head, char *prefix);
 
-static int
-hash_dentry (inode_t *parent, const char *name, int mod)
+/* spreads the hash over all 32 bits: buckets and stripes are chosen by
+   the low ones (this is the murmur3 finalizer) */
+static uint32_t
+hash_mix (uint32_t hash)
 {
-        int hash = 0;
-        int ret = 0;
+        hash ^= hash >> 16;
+        hash *= 0x85ebca6b;
+        hash ^= hash >> 13;
+        hash *= 0xc2b2ae35;
+        hash ^= hash >> 16;
+
+        return hash;
+}
+
+
+static uint32_t
+hash_dentry (inode_t *parent, const char *name)
+{
+        uint32_t      hash = 0;
+        unsigned long p = (unsigned long)parent;
 
         hash = *name;
         if (hash) {
@@ -61,20 +79,321 @@ hash_dentry (inode_t *parent, const char *name, int mod)
                         hash = (hash << 5) - hash + *name;
                 }
         }
-        ret = (hash + (unsigned long)parent) % mod;
 
-        return ret;
+        return hash_mix (hash ^ (uint32_t)(p ^ (p >> 32)));
+}
+
+
+static uint32_t
+hash_gfid (uuid_t uuid)
+{
+        uint32_t hash = 0;
+
+        hash = uuid[15] + (uuid[14] << 8) + (uuid[13] << 16) +
+                (uuid[12] << 24);
+
+        return hash_mix (hash);
+}
+
+
+static uint32_t
+hash_of_inode (struct list_head *entry)
+{
+        return hash_gfid (list_entry (entry, inode_t, hash)->gfid);
+}
+
+
+static uint32_t
+hash_of_dentry (struct list_head *entry)
+{
+        dentry_t *dentry = list_entry (entry, dentry_t, hash);
+
+        return hash_dentry (dentry->parent, dentry->name);
+}
+
+
+static gf_lock_t *
+inode_hash_lock (struct _inode_hash *hash, uint32_t hashval)
+{
+        return &hash->stripes[hashval % INODE_TABLE_STRIPES].lock;
+}
+
+
+/* caller holds table->lock, or the stripe lock of hashval */
+static struct list_head *
+inode_hash_bucket (struct _inode_hash *hash, uint32_t hashval)
+{
+        uint32_t idx = 0;
+
+        if (hash->old_buckets) {
+                idx = hashval & (hash->old_size - 1);
+                if (idx >= hash->rehash_idx)
+                        return &hash->old_buckets[idx];
+        }
+
+        return &hash->buckets[hashval & (hash->size - 1)];
+}
+
+
+static uint32_t
+inode_hash_size_round (uint32_t size)
+{
+        uint32_t rounded = INODE_TABLE_STRIPES;
+
+        while (rounded < size && rounded < INODE_HASH_MAX_SIZE)
+                rounded <<= 1;
+
+        return rounded;
+}
+
+
+static struct list_head *
+inode_hash_buckets_new (uint32_t size)
+{
+        struct list_head *buckets = NULL;
+        uint32_t          i = 0;
+
+        buckets = GF_CALLOC (size, sizeof (*buckets), gf_common_mt_list_head);
+        if (!buckets)
+                return NULL;
+
+        for (i = 0; i < size; i++)
+                INIT_LIST_HEAD (&buckets[i]);
+
+        return buckets;
 }
 
 
 static int
-hash_gfid (uuid_t uuid, int mod)
+inode_hash_init (struct _inode_hash *hash, uint32_t size,
+                 uint32_t (*hashfn) (struct list_head *entry))
 {
-        int ret = 0;
+        int i = 0;
+
+        hash->size = inode_hash_size_round (size);
+        hash->buckets = inode_hash_buckets_new (hash->size);
+        if (!hash->buckets)
+                return -1;
 
-        ret = uuid[15] + (uuid[14] << 8);
+        hash->hashfn = hashfn;
 
-        return ret;
+        for (i = 0; i < INODE_TABLE_STRIPES; i++)
+                LOCK_INIT (&hash->stripes[i].lock);
+
+        return 0;
+}
+
+
+static void
+inode_hash_fini (struct _inode_hash *hash)
+{
+        int i = 0;
+
+        GF_FREE (hash->buckets);
+        GF_FREE (hash->old_buckets);
+
+        if (!hash->hashfn)
+                return;
+
+        for (i = 0; i < INODE_TABLE_STRIPES; i++)
+                LOCK_DESTROY (&hash->stripes[i].lock);
+}
+
+
+static void
+__inode_hash_lock_all (struct _inode_hash *hash)
+{
+        int i = 0;
+
+        for (i = 0; i < INODE_TABLE_STRIPES; i++)
+                LOCK (&hash->stripes[i].lock);
+}
+
+
+static void
+__inode_hash_unlock_all (struct _inode_hash *hash)
+{
+        int i = 0;
+
+        for (i = INODE_TABLE_STRIPES - 1; i >= 0; i--)
+                UNLOCK (&hash->stripes[i].lock);
+}
+
+
+/* Moves up to @count old buckets to the new array, each under its own
+ * stripe lock. The old array is released once it is empty.
+ */
+static void
+__inode_hash_migrate (struct _inode_hash *hash, int count)
+{
+        struct list_head *bucket = NULL;
+        struct list_head *entry = NULL;
+        gf_lock_t        *lock = NULL;
+        uint32_t          hashval = 0;
+
+        while (count-- && hash->rehash_idx < hash->old_size) {
+                bucket = &hash->old_buckets[hash->rehash_idx];
+                lock = &hash->stripes[hash->rehash_idx %
+                                      INODE_TABLE_STRIPES].lock;
+
+                LOCK (lock);
+                {
+                        while (!list_empty (bucket)) {
+                                entry = bucket->next;
+                                hashval = hash->hashfn (entry);
+                                list_move (entry, &hash->buckets[hashval &
+                                                                 (hash->size - 1)]);
+                        }
+                        hash->rehash_idx++;
+                }
+                UNLOCK (lock);
+        }
+
+        if (hash->rehash_idx < hash->old_size)
+                return;
+
+        bucket = hash->old_buckets;
+
+        __inode_hash_lock_all (hash);
+        {
+                hash->old_buckets = NULL;
+                hash->old_size = 0;
+                hash->rehash_idx = 0;
+        }
+        __inode_hash_unlock_all (hash);
+
+        GF_FREE (bucket);
+}
+
+
+/* Doubles the number of buckets. The new array is set up before any of
+ * the stripe locks is taken, lookups are only held off while the arrays
+ * are switched.
+ */
+static void
+__inode_hash_grow (inode_table_t *table, struct _inode_hash *hash)
+{
+        struct list_head *buckets = NULL;
+        uint32_t          size = 0;
+
+        if (hash->size >= INODE_HASH_MAX_SIZE)
+                return;
+
+        size = hash->size << 1;
+        buckets = inode_hash_buckets_new (size);
+        if (!buckets) {
+                gf_log (table->name, GF_LOG_WARNING,
+                        "failed to grow hash to %u buckets", size);
+                return;
+        }
+
+        __inode_hash_lock_all (hash);
+        {
+                hash->old_buckets = hash->buckets;
+                hash->old_size = hash->size;
+                hash->rehash_idx = 0;
+                hash->buckets = buckets;
+                hash->size = size;
+        }
+        __inode_hash_unlock_all (hash);
+
+        gf_log (table->name, GF_LOG_DEBUG, "growing hash to %u buckets "
+                "(%u entries)", size, hash->count);
+}
+
+
+/* caller holds table->lock */
+static void
+__inode_hash_del (struct _inode_hash *hash, struct list_head *entry,
+                  uint32_t hashval)
+{
+        gf_lock_t *lock = NULL;
+
+        if (list_empty (entry))
+                return;
+
+        lock = inode_hash_lock (hash, hashval);
+
+        LOCK (lock);
+        {
+                list_del_init (entry);
+        }
+        UNLOCK (lock);
+
+        hash->count--;
+}
+
+
+/* caller holds table->lock */
+static void
+__inode_hash_add (inode_table_t *table, struct _inode_hash *hash,
+                  struct list_head *entry, uint32_t hashval)
+{
+        gf_lock_t *lock = NULL;
+
+        __inode_hash_del (hash, entry, hashval);
+
+        lock = inode_hash_lock (hash, hashval);
+
+        LOCK (lock);
+        {
+                list_add (entry, inode_hash_bucket (hash, hashval));
+        }
+        UNLOCK (lock);
+
+        hash->count++;
+
+        if (hash->old_buckets)
+                __inode_hash_migrate (hash, 4);
+        else if (hash->count > hash->size)
+                __inode_hash_grow (table, hash);
+}
+
+
+/* Takes a reference on an inode which is already referenced by someone
+ * else. Fails if the count is zero: the inode is then in the lru list, or
+ * on its way there, and the 0 -> 1 transition has to be made under
+ * table->lock by __inode_ref ().
+ */
+static int
+inode_ref_if_active (inode_t *inode)
+{
+        uint32_t ref = 0;
+        uint32_t old = 0;
+
+        ref = inode->ref;
+        while (ref) {
+                if (__is_root_gfid (inode->gfid))
+                        return 1;
+
+                old = __sync_val_compare_and_swap (&inode->ref, ref, ref + 1);
+                if (old == ref)
+                        return 1;
+                ref = old;
+        }
+
+        return 0;
+}
+
+
+/* Drops a reference unless it is the last one, which has to go through
+ * table->lock to move the inode to the lru or purge list.
+ */
+static int
+inode_unref_if_shared (inode_t *inode)
+{
+        uint32_t ref = 0;
+        uint32_t old = 0;
+
+        ref = inode->ref;
+        while (ref > 1) {
+                old = __sync_val_compare_and_swap (&inode->ref, ref, ref - 1);
+                if (old == ref)
+                        return 1;
+                ref = old;
+        }
+
+        return 0;
 }
 
 
@@ -82,7 +401,6 @@ static void
 __dentry_hash (dentry_t *dentry)
 {
         inode_table_t   *table = NULL;
-        int              hash = 0;
 
         if (!dentry) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "dentry not found");
@@ -90,11 +408,9 @@ __dentry_hash (dentry_t *dentry)
         }
 
         table = dentry->inode->table;
-        hash = hash_dentry (dentry->parent, dentry->name,
-                            table->hashsize);
 
-        list_del_init (&dentry->hash);
-        list_add (&dentry->hash, &table->name_hash[hash]);
+        __inode_hash_add (table, &table->name_hash, &dentry->hash,
+                          hash_dentry (dentry->parent, dentry->name));
 }
 
 
@@ -113,12 +429,20 @@ __is_dentry_hashed (dentry_t *dentry)
 static void
 __dentry_unhash (dentry_t *dentry)
 {
+        inode_table_t   *table = NULL;
+
         if (!dentry) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "dentry not found");
                 return;
         }
 
-        list_del_init (&dentry->hash);
+        if (list_empty (&dentry->hash))
+                return;
+
+        table = dentry->inode->table;
+
+        __inode_hash_del (&table->name_hash, &dentry->hash,
+                          hash_dentry (dentry->parent, dentry->name));
 }
 
 
@@ -229,7 +553,8 @@ __inode_unhash (inode_t *inode)
                 return;
         }
 
-        list_del_init (&inode->hash);
+        __inode_hash_del (&inode->table->inode_hash, &inode->hash,
+                          hash_gfid (inode->gfid));
 }
 
 
@@ -249,7 +574,6 @@ static void
 __inode_hash (inode_t *inode)
 {
         inode_table_t *table = NULL;
-        int            hash = 0;
 
         if (!inode) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "inode not found");
@@ -257,10 +581,9 @@ __inode_hash (inode_t *inode)
         }
 
         table = inode->table;
-        hash = hash_gfid (inode->gfid, 65536);
 
-        list_del_init (&inode->hash);
-        list_add (&inode->hash, &table->inode_hash[hash]);
+        __inode_hash_add (table, &table->inode_hash, &inode->hash,
+                          hash_gfid (inode->gfid));
 }
 
 
@@ -398,9 +721,9 @@ __inode_unref (inode_t *inode)
 
         GF_ASSERT (inode->ref);
 
-        --inode->ref;
-
-        if (!inode->ref) {
+        /* only the last reference is dropped under table->lock, so the
+           count cannot change under us once it reaches zero */
+        if (!__sync_sub_and_fetch (&inode->ref, 1)) {
                 inode->table->active_size--;
 
                 if (inode->nlookup)
@@ -435,20 +758,135 @@ __inode_ref (inode_t *inode)
         if (__is_root_gfid(inode->gfid) && inode->ref)
                 return inode;
 
-        inode->ref++;
+        __sync_add_and_fetch (&inode->ref, 1);
 
         return inode;
 }
 
 
+/*
+ * Dropping the last reference on an inode moves it to the lru or purge
+ * list, under table->lock. Rather than taking the lock every time, each
+ * thread parks such last references in a small batch and drops them all
+ * at once when the batch is full, grouped by table. A parked inode stays
+ * active and can be referenced again without the lock in the meantime.
+ * At most INODE_UNREF_BATCH - 1 inodes per thread are kept active this
+ * way; inode_forget () flushes the caller's batch.
+ */
+
+#define INODE_UNREF_BATCH 32
+
+struct inode_unref_batch {
+        int      count;
+        inode_t *inodes[INODE_UNREF_BATCH];
+};
+
+static pthread_once_t inode_unref_batch_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  inode_unref_batch_key;
+
+
+static void
+__inode_unref_batch_flush (struct inode_unref_batch *batch)
+{
+        inode_table_t *table = NULL;
+        int            i = 0;
+        int            j = 0;
+
+        while (batch->count) {
+                table = batch->inodes[0]->table;
+
+                pthread_mutex_lock (&table->lock);
+                {
+                        for (i = 0, j = 0; i < batch->count; i++) {
+                                if (batch->inodes[i]->table == table)
+                                        __inode_unref (batch->inodes[i]);
+                                else
+                                        batch->inodes[j++] = batch->inodes[i];
+                        }
+                        batch->count = j;
+                }
+                pthread_mutex_unlock (&table->lock);
+
+                inode_table_prune (table);
+        }
+}
+
+
+static void
+inode_unref_batch_destroy (void *data)
+{
+        struct inode_unref_batch *batch = data;
+
+        __inode_unref_batch_flush (batch);
+        FREE (batch);
+}
+
+
+static void
+inode_unref_batch_init (void)
+{
+        pthread_key_create (&inode_unref_batch_key, inode_unref_batch_destroy);
+}
+
+
+static struct inode_unref_batch *
+inode_unref_batch_get (void)
+{
+        struct inode_unref_batch *batch = NULL;
+
+        pthread_once (&inode_unref_batch_once, inode_unref_batch_init);
+
+        batch = pthread_getspecific (inode_unref_batch_key);
+        if (batch)
+                return batch;
+
+        batch = CALLOC (1, sizeof (*batch));
+        if (!batch)
+                return NULL;
+
+        pthread_setspecific (inode_unref_batch_key, batch);
+
+        return batch;
+}
+
+
+static void
+inode_unref_batch_flush (void)
+{
+        struct inode_unref_batch *batch = NULL;
+
+        pthread_once (&inode_unref_batch_once, inode_unref_batch_init);
+
+        batch = pthread_getspecific (inode_unref_batch_key);
+        if (batch)
+                __inode_unref_batch_flush (batch);
+}
+
+
 inode_t *
 inode_unref (inode_t *inode)
 {
-        inode_table_t *table = NULL;
+        inode_table_t            *table = NULL;
+        struct inode_unref_batch *batch = NULL;
 
         if (!inode)
                 return NULL;
 
+        /* see __inode_unref () */
+        if (__is_root_gfid (inode->gfid))
+                return inode;
+
+        if (inode_unref_if_shared (inode))
+                return inode;
+
+        batch = inode_unref_batch_get ();
+        if (batch) {
+                batch->inodes[batch->count++] = inode;
+                if (batch->count == INODE_UNREF_BATCH)
+                        __inode_unref_batch_flush (batch);
+                return inode;
+        }
+
         table = inode->table;
 
         pthread_mutex_lock (&table->lock);
@@ -471,6 +909,9 @@ inode_ref (inode_t *inode)
         if (!inode)
                 return NULL;
 
+        if (inode_ref_if_active (inode))
+                return inode;
+
         table = inode->table;
 
         pthread_mutex_lock (&table->lock);
@@ -615,19 +1056,21 @@ __inode_forget (inode_t *inode, uint64_t nlookup)
 }
 
 
+/* caller holds table->lock, or the name stripe lock of the bucket */
 dentry_t *
 __dentry_grep (inode_table_t *table, inode_t *parent, const char *name)
 {
-        int       hash = 0;
+        uint32_t  hash = 0;
         dentry_t *dentry = NULL;
         dentry_t *tmp = NULL;
 
         if (!table || !name || !parent)
                 return NULL;
 
-        hash = hash_dentry (parent, name, table->hashsize);
+        hash = hash_dentry (parent, name);
 
-        list_for_each_entry (tmp, &table->name_hash[hash], hash) {
+        list_for_each_entry (tmp, inode_hash_bucket (&table->name_hash, hash),
+                             hash) {
                 if (tmp->parent == parent && !strcmp (tmp->name, name)) {
                         dentry = tmp;
                         break;
@@ -643,6 +1086,8 @@ inode_grep (inode_table_t *table, inode_t *parent, const char *name)
 {
         inode_t   *inode = NULL;
         dentry_t  *dentry = NULL;
+        gf_lock_t *lock = NULL;
+        int        found = 0;
 
         if (!table || !parent || !name) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING,
@@ -650,6 +1095,28 @@ inode_grep (inode_table_t *table, inode_t *parent, const char *name)
                 return NULL;
         }
 
+        lock = inode_hash_lock (&table->name_hash, hash_dentry (parent, name));
+        LOCK (lock);
+        {
+                dentry = __dentry_grep (table, parent, name);
+
+                if (dentry) {
+                        inode = dentry->inode;
+                        found = inode_ref_if_active (inode);
+                }
+        }
+        UNLOCK (lock);
+
+        if (!dentry)
+                return NULL;
+
+        if (found)
+                return inode;
+
+        /* not referenced by anyone, take it out of the lru under the
+           table lock */
+        inode = NULL;
+
         pthread_mutex_lock (&table->lock);
         {
                 dentry = __dentry_grep (table, parent, name);
@@ -715,6 +1182,7 @@ inode_grep_for_gfid (inode_table_t *table, inode_t *parent, const char *name,
 {
         inode_t   *inode = NULL;
         dentry_t  *dentry = NULL;
+        gf_lock_t *lock = NULL;
         int        ret = -1;
 
         if (!table || !parent || !name) {
@@ -723,7 +1191,8 @@ inode_grep_for_gfid (inode_table_t *table, inode_t *parent, const char *name,
                 return ret;
         }
 
-        pthread_mutex_lock (&table->lock);
+        lock = inode_hash_lock (&table->name_hash, hash_dentry (parent, name));
+        LOCK (lock);
         {
                 dentry = __dentry_grep (table, parent, name);
 
@@ -736,7 +1205,7 @@ inode_grep_for_gfid (inode_table_t *table, inode_t *parent, const char *name,
                         ret = 0;
                 }
         }
-        pthread_mutex_unlock (&table->lock);
+        UNLOCK (lock);
 
         return ret;
 }
@@ -758,12 +1227,13 @@ __is_root_gfid (uuid_t gfid)
 }
 
 
+/* caller holds table->lock, or the inode stripe lock of the bucket */
 inode_t *
 __inode_find (inode_table_t *table, uuid_t gfid)
 {
         inode_t   *inode = NULL;
         inode_t   *tmp = NULL;
-        int        hash = 0;
+        uint32_t   hash = 0;
 
         if (!table) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "table not found");
@@ -773,9 +1243,10 @@ __inode_find (inode_table_t *table, uuid_t gfid)
         if (__is_root_gfid (gfid))
                 return table->root;
 
-        hash = hash_gfid (gfid, 65536);
+        hash = hash_gfid (gfid);
 
-        list_for_each_entry (tmp, &table->inode_hash[hash], hash) {
+        list_for_each_entry (tmp, inode_hash_bucket (&table->inode_hash, hash),
+                             hash) {
                 if (uuid_compare (tmp->gfid, gfid) == 0) {
                         inode = tmp;
                         break;
@@ -791,12 +1262,33 @@ inode_t *
 inode_find (inode_table_t *table, uuid_t gfid)
 {
         inode_t   *inode = NULL;
+        gf_lock_t *lock = NULL;
+        int        found = 0;
 
         if (!table) {
                 gf_log_callingfn (THIS->name, GF_LOG_WARNING, "table not found");
                 return NULL;
         }
 
+        lock = inode_hash_lock (&table->inode_hash, hash_gfid (gfid));
+        LOCK (lock);
+        {
+                inode = __inode_find (table, gfid);
+                if (inode)
+                        found = inode_ref_if_active (inode);
+        }
+        UNLOCK (lock);
+
+        if (!inode)
+                return NULL;
+
+        if (found)
+                return inode;
+
+        /* not referenced by anyone, take it out of the lru under the
+           table lock */
+        inode = NULL;
+
         pthread_mutex_lock (&table->lock);
         {
                 inode = __inode_find (table, gfid);
@@ -958,6 +1450,9 @@ inode_forget (inode_t *inode, uint64_t nlookup)
         }
         pthread_mutex_unlock (&table->lock);
 
+        /* let the inode go now if this thread held the last reference */
+        inode_unref_batch_flush ();
+
         inode_table_prune (table);
 
         return 0;
@@ -1288,6 +1783,12 @@ inode_table_prune (inode_table_t *table)
         if (!table)
                 return -1;
 
+        /* unlocked peek, the caller made its own changes to the lists
+           before calling us */
+        if (!(table->lru_limit && table->lru_size > table->lru_limit) &&
+            list_empty (&table->purge))
+                return 0;
+
         INIT_LIST_HEAD (&purge);
 
         pthread_mutex_lock (&table->lock);
@@ -1341,11 +1842,11 @@ __inode_table_init_root (inode_table_t *table)
 
 
 inode_table_t *
-inode_table_new (size_t lru_limit, xlator_t *xl)
+inode_table_new_with_size (size_t lru_limit, xlator_t *xl,
+                           uint32_t dentry_hashsize, uint32_t inode_hashsize)
 {
         inode_table_t *new = NULL;
         int            ret = -1;
-        int            i = 0;
 
         new = (void *)GF_CALLOC(1, sizeof (*new), gf_common_mt_inode_table_t);
         if (!new)
@@ -1356,8 +1857,6 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
 
         new->lru_limit = lru_limit;
 
-        new->hashsize = 14057; /* TODO: Random Number?? */
-
         /* In case FUSE is initing the inode table. */
         if (lru_limit == 0)
                 lru_limit = DEFAULT_INODE_MEMPOOL_ENTRIES;
@@ -1372,18 +1871,18 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
         if (!new->dentry_pool)
                 goto out;
 
-        new->inode_hash = (void *)GF_CALLOC (65536,
-                                             sizeof (struct list_head),
-                                             gf_common_mt_list_head);
-        if (!new->inode_hash)
+        ret = inode_hash_init (&new->inode_hash, inode_hashsize,
+                               hash_of_inode);
+        if (ret)
                 goto out;
 
-        new->name_hash = (void *)GF_CALLOC (new->hashsize,
-                                            sizeof (struct list_head),
-                                            gf_common_mt_list_head);
-        if (!new->name_hash)
+        ret = inode_hash_init (&new->name_hash, dentry_hashsize,
+                               hash_of_dentry);
+        if (ret)
                 goto out;
 
+        ret = -1;
+
         /* if number of fd open in one process is more than this,
            we may hit perf issues */
         new->fd_mem_pool = mem_pool_new (fd_t, 1024);
@@ -1391,15 +1890,6 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
         if (!new->fd_mem_pool)
                 goto out;
 
-        for (i = 0; i < 65536; i++) {
-                INIT_LIST_HEAD (&new->inode_hash[i]);
-        }
-
-
-        for (i = 0; i < new->hashsize; i++) {
-                INIT_LIST_HEAD (&new->name_hash[i]);
-        }
-
         INIT_LIST_HEAD (&new->active);
         INIT_LIST_HEAD (&new->lru);
         INIT_LIST_HEAD (&new->purge);
@@ -1418,8 +1908,8 @@ inode_table_new (size_t lru_limit, xlator_t *xl)
 out:
         if (ret) {
                 if (new) {
-                        GF_FREE (new->inode_hash);
-                        GF_FREE (new->name_hash);
+                        inode_hash_fini (&new->inode_hash);
+                        inode_hash_fini (&new->name_hash);
                         if (new->dentry_pool)
                                 mem_pool_destroy (new->dentry_pool);
                         if (new->inode_pool)
@@ -1433,6 +1923,15 @@ out:
 }
 
 
+inode_table_t *
+inode_table_new (size_t lru_limit, xlator_t *xl)
+{
+        return inode_table_new_with_size (lru_limit, xl,
+                                          DEFAULT_DENTRY_HASH_SIZE,
+                                          DEFAULT_INODE_HASH_SIZE);
+}
+
+
 inode_t *
 inode_from_path (inode_table_t *itable, const char *path)
 {
@@ -1905,6 +2404,72 @@ unlock:
         return;
 }
 
+static void
+inode_hash_chain_stats (struct list_head *buckets, uint32_t from, uint32_t to,
+                        uint32_t *used, uint32_t *max_chain,
+                        uint32_t *histogram, int nhist)
+{
+        struct list_head *pos = NULL;
+        uint32_t          i = 0;
+        uint32_t          len = 0;
+
+        for (i = from; i < to; i++) {
+                len = 0;
+                list_for_each (pos, &buckets[i])
+                        len++;
+
+                if (!len)
+                        continue;
+
+                (*used)++;
+                if (len > *max_chain)
+                        *max_chain = len;
+                histogram[len < nhist ? len - 1 : nhist - 1]++;
+        }
+}
+
+
+/* caller holds table->lock */
+static void
+inode_hash_dump (struct _inode_hash *hash, char *key, char *prefix,
+                 char *name)
+{
+        uint32_t used = 0;
+        uint32_t max_chain = 0;
+        uint32_t histogram[8] = {0, };
+        int      i = 0;
+
+        inode_hash_chain_stats (hash->buckets, 0, hash->size, &used,
+                                &max_chain, histogram, 8);
+        if (hash->old_buckets)
+                inode_hash_chain_stats (hash->old_buckets, hash->rehash_idx,
+                                        hash->old_size, &used, &max_chain,
+                                        histogram, 8);
+
+        gf_proc_dump_build_key (key, prefix, "%s.size", name);
+        gf_proc_dump_write (key, "%u", hash->size);
+        gf_proc_dump_build_key (key, prefix, "%s.entries", name);
+        gf_proc_dump_write (key, "%u", hash->count);
+        gf_proc_dump_build_key (key, prefix, "%s.used_buckets", name);
+        gf_proc_dump_write (key, "%u", used);
+        gf_proc_dump_build_key (key, prefix, "%s.avg_chain_length", name);
+        gf_proc_dump_write (key, "%.2f", used ? (double)hash->count / used : 0);
+        gf_proc_dump_build_key (key, prefix, "%s.max_chain_length", name);
+        gf_proc_dump_write (key, "%u", max_chain);
+        for (i = 0; i < 8; i++) {
+                gf_proc_dump_build_key (key, prefix, "%s.chains_of_%d%s",
+                                        name, i + 1, (i == 7) ? "+" : "");
+                gf_proc_dump_write (key, "%u", histogram[i]);
+        }
+        if (hash->old_buckets) {
+                gf_proc_dump_build_key (key, prefix, "%s.rehash_pending",
+                                        name);
+                gf_proc_dump_write (key, "%u",
+                                    hash->old_size - hash->rehash_idx);
+        }
+}
+
+
 void
 inode_table_dump (inode_table_t *itable, char *prefix)
 {
@@ -1922,8 +2487,6 @@ inode_table_dump (inode_table_t *itable, char *prefix)
                 return;
         }
 
-        gf_proc_dump_build_key(key, prefix, "hashsize");
-        gf_proc_dump_write(key, "%d", itable->hashsize);
         gf_proc_dump_build_key(key, prefix, "name");
         gf_proc_dump_write(key, "%s", itable->name);
 
@@ -1936,6 +2499,9 @@ inode_table_dump (inode_table_t *itable, char *prefix)
         gf_proc_dump_build_key(key, prefix, "purge_size");
         gf_proc_dump_write(key, "%d", itable->purge_size);
 
+        inode_hash_dump (&itable->inode_hash, key, prefix, "inode_hash");
+        inode_hash_dump (&itable->name_hash, key, prefix, "dentry_hash");
+
         INODE_DUMP_LIST(&itable->active, key, prefix, "active");
         INODE_DUMP_LIST(&itable->lru, key, prefix, "lru");
         INODE_DUMP_LIST(&itable->purge, key, prefix, "purge");
@@ -20,6 +20,9 @@
 #include <sys/types.h>
 
 #define DEFAULT_INODE_MEMPOOL_ENTRIES   32 * 1024
+#define DEFAULT_INODE_HASH_SIZE         65536
+#define DEFAULT_DENTRY_HASH_SIZE        16384
+#define INODE_HASH_MAX_SIZE             (1 << 24)
 #define INODE_PATH_FMT "<gfid:%s>"
 struct _inode_table;
 typedef struct _inode_table inode_table_t;
@@ -36,15 +39,41 @@ typedef struct _dentry dentry_t;
 #include "uuid.h"
 
 
+/* The inode and dentry hash chains are protected by stripe locks, so that
+   lookups do not need table->lock. Modifications of the chains are done
+   holding both table->lock and the stripe lock. */
+#define INODE_TABLE_STRIPES     64
+
+struct _inode_table_stripe {
+        gf_lock_t          lock;
+        char               pad[64 - (sizeof (gf_lock_t) % 64)];
+};
+
+/* The number of buckets is a power of two, at least INODE_TABLE_STRIPES,
+   and doubles when there are more entries than buckets. Growing does not
+   move the entries at once: the old buckets below rehash_idx have been
+   migrated to the new array, the others are migrated a few at a time by
+   later insertions. An entry and its bucket in either array use the same
+   stripe lock, chosen by the low bits of the hash. */
+struct _inode_hash {
+        struct list_head  *buckets;
+        uint32_t           size;
+        struct list_head  *old_buckets; /* being migrated, or NULL */
+        uint32_t           old_size;
+        uint32_t           rehash_idx;
+        uint32_t           count;       /* entries in the hash */
+        uint32_t           (*hashfn) (struct list_head *entry);
+        struct _inode_table_stripe stripes[INODE_TABLE_STRIPES];
+};
+
 struct _inode_table {
-        pthread_mutex_t    lock;
-        size_t             hashsize;    /* bucket size of inode hash and dentry hash */
+        pthread_mutex_t    lock;        /* lists, dentry links, 0 <-> 1 ref */
         char              *name;        /* name of the inode table, just for gf_log() */
         inode_t           *root;        /* root directory inode, with number 1 */
         xlator_t          *xl;          /* xlator to be called to do purge */
         uint32_t           lru_limit;   /* maximum LRU cache size */
-        struct list_head  *inode_hash;  /* buckets for inode hash table */
-        struct list_head  *name_hash;   /* buckets for dentry hash table */
+        struct _inode_hash inode_hash;  /* inodes by gfid */
+        struct _inode_hash name_hash;   /* dentries by parent and name */
         struct list_head   active;      /* list of inodes currently active (in an fop) */
         uint32_t           active_size; /* count of inodes in active list */
         struct list_head   lru;         /* list of inodes recently used.
@@ -91,7 +120,8 @@ struct _inode {
         gf_lock_t            lock;
         uint64_t             nlookup;
         uint32_t             fd_count;      /* Open fd count */
-        uint32_t             ref;           /* reference count on this inode */
+        uint32_t             ref;           /* reference count on this inode,
+                                               updated atomically */
         ia_type_t            ia_type;       /* what kind of file */
         struct list_head     fd_list;       /* list of open files on this inode */
         struct list_head     dentry_list;   /* list of directory entries for this inode */
@@ -109,6 +139,10 @@ struct _inode {
 inode_table_t *
 inode_table_new (size_t lru_limit, xlator_t *xl);
 
+inode_table_t *
+inode_table_new_with_size (size_t lru_limit, xlator_t *xl,
+                           uint32_t dentry_hashsize, uint32_t inode_hashsize);
+
 inode_t *
 inode_new (inode_table_t *table);
 
@@ -15,7 +15,7 @@
 
 
 /*
-  TODO: implement destroy margins and prefetching of arenas
+  TODO: implement prefetching of arenas
 */
 
 #define IOBUF_ARENA_MAX_INDEX  (sizeof (gf_iobuf_init_config) /         \
@@ -68,6 +68,223 @@ gf_iobuf_get_pagesize (size_t page_size)
         return size;
 }
 
+/*
+ * Each thread keeps a magazine of free iobufs per pool, with a stack of
+ * iobufs for every size class which is small enough to be cached (see
+ * GF_IOBUF_MAGAZINE_BYTES). iobuf_get2 () and iobuf_put () use it without
+ * taking iobuf_pool->mutex. An empty stack is refilled with half a stack
+ * of iobufs from the arenas, and a full one gives half of its iobufs back,
+ * both under the mutex. Cached iobufs count as active in their arenas.
+ * Magazines of exiting threads give all their iobufs back.
+ */
+
+struct iobuf_magazine {
+        struct list_head    list;       /* in iobuf_pool->magazines */
+        struct iobuf_pool  *iobuf_pool;
+        uint64_t            cache_gen;
+        uint64_t            hits;
+        int                 count[IOBUF_ARENA_MAX_INDEX];
+        struct iobuf       *iobufs[IOBUF_ARENA_MAX_INDEX]
+                                  [GF_IOBUF_MAGAZINE_MAX];
+};
+
+struct iobuf_thread_cache {
+        struct iobuf_magazine *mags[GF_IOBUF_POOL_MAX_CACHED];
+};
+
+static pthread_once_t     iobuf_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t      iobuf_cache_key;
+static pthread_mutex_t    iobuf_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct iobuf_pool *iobuf_cache_owner[GF_IOBUF_POOL_MAX_CACHED];
+static uint64_t           iobuf_cache_gen;
+
+void __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena);
+
+
+static int
+iobuf_magazine_size (int index)
+{
+        size_t size = 0;
+
+        size = GF_IOBUF_MAGAZINE_BYTES / gf_iobuf_init_config[index].pagesize;
+        if (size > GF_IOBUF_MAGAZINE_MAX)
+                size = GF_IOBUF_MAGAZINE_MAX;
+
+        return size;
+}
+
+
+static void
+__iobuf_magazine_empty (struct iobuf_pool *iobuf_pool,
+                        struct iobuf_magazine *mag)
+{
+        struct iobuf *iobuf = NULL;
+        int           i = 0;
+
+        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                while (mag->count[i]) {
+                        iobuf = mag->iobufs[i][--mag->count[i]];
+                        __iobuf_put (iobuf, iobuf->iobuf_arena);
+                }
+        }
+}
+
+
+static void
+iobuf_cache_destroy (void *data)
+{
+        struct iobuf_thread_cache *cache = data;
+        struct iobuf_magazine     *mag = NULL;
+        struct iobuf_pool         *iobuf_pool = NULL;
+        int                        i = 0;
+
+        for (i = 0; i < GF_IOBUF_POOL_MAX_CACHED; i++) {
+                mag = cache->mags[i];
+                if (!mag)
+                        continue;
+
+                pthread_mutex_lock (&iobuf_cache_lock);
+                {
+                        iobuf_pool = mag->iobuf_pool;
+                        if (iobuf_cache_owner[i] != iobuf_pool ||
+                            iobuf_pool->cache_gen != mag->cache_gen)
+                                /* the pool is gone, and so are the
+                                   iobufs */
+                                goto unlock;
+
+                        pthread_mutex_lock (&iobuf_pool->mutex);
+                        {
+                                __iobuf_magazine_empty (iobuf_pool, mag);
+                                iobuf_pool->cache_hits += mag->hits;
+                                list_del_init (&mag->list);
+                        }
+                        pthread_mutex_unlock (&iobuf_pool->mutex);
+                }
+unlock:
+                pthread_mutex_unlock (&iobuf_cache_lock);
+
+                FREE (mag);
+        }
+
+        FREE (cache);
+}
+
+
+static void
+iobuf_cache_init (void)
+{
+        pthread_key_create (&iobuf_cache_key, iobuf_cache_destroy);
+}
+
+
+/* Returns the calling thread's magazine for iobuf_pool, NULL if the pool
+ * is not cached per-thread.
+ */
+static struct iobuf_magazine *
+iobuf_magazine_get (struct iobuf_pool *iobuf_pool)
+{
+        struct iobuf_thread_cache *cache = NULL;
+        struct iobuf_magazine     *mag = NULL;
+
+        if (iobuf_pool->cache_id == -1)
+                return NULL;
+
+        cache = pthread_getspecific (iobuf_cache_key);
+        if (!cache) {
+                cache = CALLOC (1, sizeof (*cache));
+                if (!cache)
+                        return NULL;
+
+                pthread_setspecific (iobuf_cache_key, cache);
+        }
+
+        mag = cache->mags[iobuf_pool->cache_id];
+        if (mag && mag->iobuf_pool == iobuf_pool &&
+            mag->cache_gen == iobuf_pool->cache_gen)
+                return mag;
+
+        /* first use of this pool by the thread, or the magazine belonged
+           to a pool which has been destroyed since */
+        FREE (mag);
+        cache->mags[iobuf_pool->cache_id] = NULL;
+
+        mag = CALLOC (1, sizeof (*mag));
+        if (!mag)
+                return NULL;
+
+        INIT_LIST_HEAD (&mag->list);
+        mag->iobuf_pool = iobuf_pool;
+        mag->cache_gen = iobuf_pool->cache_gen;
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                list_add (&mag->list, &iobuf_pool->magazines);
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        cache->mags[iobuf_pool->cache_id] = mag;
+
+        return mag;
+}
+
+
+static void
+iobuf_pool_cache_register (struct iobuf_pool *iobuf_pool)
+{
+        int i = 0;
+
+        pthread_once (&iobuf_cache_once, iobuf_cache_init);
+
+        iobuf_pool->cache_id = -1;
+        INIT_LIST_HEAD (&iobuf_pool->magazines);
+
+        pthread_mutex_lock (&iobuf_cache_lock);
+        {
+                for (i = 0; i < GF_IOBUF_POOL_MAX_CACHED; i++) {
+                        if (iobuf_cache_owner[i])
+                                continue;
+
+                        iobuf_cache_owner[i] = iobuf_pool;
+                        iobuf_pool->cache_id = i;
+                        iobuf_pool->cache_gen = ++iobuf_cache_gen;
+                        break;
+                }
+        }
+        pthread_mutex_unlock (&iobuf_cache_lock);
+}
+
+
+static void
+iobuf_pool_cache_unregister (struct iobuf_pool *iobuf_pool)
+{
+        struct iobuf_magazine *mag = NULL;
+        struct iobuf_magazine *tmp = NULL;
+
+        if (iobuf_pool->cache_id == -1)
+                return;
+
+        pthread_mutex_lock (&iobuf_cache_lock);
+        {
+                iobuf_cache_owner[iobuf_pool->cache_id] = NULL;
+
+                /* the magazines are freed by their threads, once they see
+                   the pool is gone */
+                pthread_mutex_lock (&iobuf_pool->mutex);
+                {
+                        list_for_each_entry_safe (mag, tmp,
+                                                  &iobuf_pool->magazines,
+                                                  list) {
+                                list_del_init (&mag->list);
+                        }
+                }
+                pthread_mutex_unlock (&iobuf_pool->mutex);
+
+                iobuf_pool->cache_id = -1;
+        }
+        pthread_mutex_unlock (&iobuf_cache_lock);
+}
+
+
 void
 __iobuf_arena_init_iobufs (struct iobuf_arena *iobuf_arena)
 {
@@ -88,7 +305,6 @@ __iobuf_arena_init_iobufs (struct iobuf_arena *iobuf_arena)
         iobuf = iobuf_arena->iobufs;
         for (i = 0; i < iobuf_cnt; i++) {
                 INIT_LIST_HEAD (&iobuf->list);
-                LOCK_INIT (&iobuf->lock);
 
                 iobuf->iobuf_arena = iobuf_arena;
 
@@ -176,13 +392,45 @@ __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
         rounded_size = gf_iobuf_get_pagesize (page_size);
 
         iobuf_arena->page_size  = rounded_size;
+        iobuf_arena->index      = gf_iobuf_get_arena_index (rounded_size);
+
+        /* a huge page is not shared between arenas, so fill it */
+        if (iobuf_pool->huge_pages)
+                num_iobufs = (GF_IOBUF_HUGE_PAGE_SIZE /
+                              rounded_size) *
+                        ((rounded_size * num_iobufs +
+                          GF_IOBUF_HUGE_PAGE_SIZE - 1) /
+                         GF_IOBUF_HUGE_PAGE_SIZE);
+
         iobuf_arena->page_count = num_iobufs;
 
         iobuf_arena->arena_size = rounded_size * num_iobufs;
 
-        iobuf_arena->mem_base = mmap (NULL, iobuf_arena->arena_size,
-                                      PROT_READ|PROT_WRITE,
-                                      MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        iobuf_arena->mem_base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (iobuf_pool->huge_pages) {
+                iobuf_arena->mem_base = mmap (NULL, iobuf_arena->arena_size,
+                                              PROT_READ|PROT_WRITE,
+                                              MAP_PRIVATE|MAP_ANONYMOUS|
+                                              MAP_HUGETLB, -1, 0);
+                if (iobuf_arena->mem_base != MAP_FAILED)
+                        iobuf_arena->huge = _gf_true;
+        }
+#endif
+        /* no huge pages reserved, or no MAP_HUGETLB: ask for transparent
+           huge pages instead */
+        if (iobuf_arena->mem_base == MAP_FAILED) {
+                iobuf_arena->mem_base = mmap (NULL, iobuf_arena->arena_size,
+                                              PROT_READ|PROT_WRITE,
+                                              MAP_PRIVATE|MAP_ANONYMOUS,
+                                              -1, 0);
+#ifdef MADV_HUGEPAGE
+                if (iobuf_pool->huge_pages &&
+                    iobuf_arena->mem_base != MAP_FAILED)
+                        madvise (iobuf_arena->mem_base,
+                                 iobuf_arena->arena_size, MADV_HUGEPAGE);
+#endif
+        }
         if (iobuf_arena->mem_base == MAP_FAILED) {
                 gf_log (THIS->name, GF_LOG_WARNING, "maping failed");
                 goto err;
@@ -294,6 +542,8 @@ iobuf_pool_destroy (struct iobuf_pool *iobuf_pool)
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
+        iobuf_pool_cache_unregister (iobuf_pool);
+
         for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
                 list_for_each_entry_safe (iobuf_arena, tmp,
                                           &iobuf_pool->arenas[i], list) {
@@ -326,6 +576,7 @@ iobuf_create_stdalloc_arena (struct iobuf_pool *iobuf_pool)
         iobuf_arena->iobuf_pool = iobuf_pool;
 
         iobuf_arena->page_size = 0x7fffffff;
+        iobuf_arena->index = -1;
 
         list_add_tail (&iobuf_arena->list,
                        &iobuf_pool->arenas[IOBUF_ARENA_MAX_INDEX]);
@@ -356,6 +607,9 @@ iobuf_pool_new (void)
         }
 
         iobuf_pool->default_page_size  = 128 * GF_UNIT_KB;
+        iobuf_pool->prune_time = time (NULL);
+
+        iobuf_pool_cache_register (iobuf_pool);
 
         arena_size = 0;
         for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
@@ -377,33 +631,85 @@ out:
 }
 
 
+/* Releases the idle arenas of each size class beyond what the peak use of
+ * the class since the last prune needed, keeping one arena's worth of
+ * iobufs free on top of it. This keeps arenas around a workload which
+ * cycles through its buffers, instead of unmapping an arena the moment
+ * it goes idle and mapping it again for the next burst.
+ */
 void
-__iobuf_arena_prune (struct iobuf_pool *iobuf_pool,
-                     struct iobuf_arena *iobuf_arena, int index)
+__iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
 {
-        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+        struct iobuf_arena *iobuf_arena = NULL;
+        struct iobuf_arena *tmp         = NULL;
+        size_t              capacity    = 0;
+        size_t              need        = 0;
+        int                 i           = 0;
 
-        /* code flow comes here only if the arena is in purge list and we can
-         * free the arena only if we have atleast one arena in 'arenas' list
-         * (ie, at least few iobufs free in arena), that way, there won't
-         * be spurious mmap/unmap of buffers
-         */
-        if (list_empty (&iobuf_pool->arenas[index]))
-                goto out;
+        for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
+                if (list_empty (&iobuf_pool->purge[i]))
+                        goto next;
 
-        /* All cases matched, destroy */
-        list_del_init (&iobuf_arena->list);
-        iobuf_pool->arena_cnt--;
+                capacity = 0;
+                list_for_each_entry (iobuf_arena, &iobuf_pool->arenas[i],
+                                     list)
+                        capacity += iobuf_arena->page_count;
+                list_for_each_entry (iobuf_arena, &iobuf_pool->filled[i],
+                                     list)
+                        capacity += iobuf_arena->page_count;
 
-        __iobuf_arena_destroy (iobuf_arena);
+                list_for_each_entry_safe (iobuf_arena, tmp,
+                                          &iobuf_pool->purge[i], list) {
+                        need = iobuf_pool->peak_active[i] +
+                                iobuf_arena->page_count;
+                        if (capacity < need) {
+                                capacity += iobuf_arena->page_count;
+                                continue;
+                        }
+
+                        list_del_init (&iobuf_arena->list);
+                        iobuf_pool->arena_cnt--;
+                        iobuf_pool->arenas_pruned++;
+                        __iobuf_arena_destroy (iobuf_arena);
+                }
+next:
+                iobuf_pool->peak_active[i] = iobuf_pool->active_cnt[i];
+        }
+
+        iobuf_pool->prune_time = time (NULL);
+}
+
+
+static void
+__iobuf_pool_maybe_prune (struct iobuf_pool *iobuf_pool)
+{
+        if (time (NULL) - iobuf_pool->prune_time >= GF_IOBUF_PRUNE_INTERVAL)
+                __iobuf_pool_prune (iobuf_pool);
+}
+
+
+void
+iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
+{
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                __iobuf_pool_prune (iobuf_pool);
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
 
 out:
         return;
 }
 
 
+/* Arenas allocated from now on are backed by huge pages, or not. The idle
+ * arenas are mapped again to match, the busy ones keep their pages until
+ * they are pruned.
+ */
 void
-iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
+iobuf_pool_set_huge_pages (struct iobuf_pool *iobuf_pool, gf_boolean_t enable)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_arena *tmp         = NULL;
@@ -413,17 +719,37 @@ iobuf_pool_prune (struct iobuf_pool *iobuf_pool)
 
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
+                if (iobuf_pool->huge_pages == enable)
+                        goto unlock;
+
+                iobuf_pool->huge_pages = enable;
+
                 for (i = 0; i < IOBUF_ARENA_MAX_INDEX; i++) {
-                        if (list_empty (&iobuf_pool->arenas[i])) {
-                                continue;
+                        list_for_each_entry_safe (iobuf_arena, tmp,
+                                                  &iobuf_pool->purge[i],
+                                                  list) {
+                                list_del_init (&iobuf_arena->list);
+                                iobuf_pool->arena_cnt--;
+                                __iobuf_arena_destroy (iobuf_arena);
                         }
 
                         list_for_each_entry_safe (iobuf_arena, tmp,
-                                                  &iobuf_pool->purge[i], list) {
-                                __iobuf_arena_prune (iobuf_pool, iobuf_arena, i);
+                                                  &iobuf_pool->arenas[i],
+                                                  list) {
+                                if (iobuf_arena->active_cnt)
+                                        continue;
+                                list_del_init (&iobuf_arena->list);
+                                iobuf_pool->arena_cnt--;
+                                __iobuf_arena_destroy (iobuf_arena);
                         }
+
+                        if (list_empty (&iobuf_pool->arenas[i]))
+                                __iobuf_pool_add_arena (iobuf_pool,
+                                        gf_iobuf_init_config[i].pagesize,
+                                        gf_iobuf_init_config[i].num_pages);
                 }
         }
+unlock:
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
 out:
@@ -467,23 +793,6 @@ out:
 }
 
 
-struct iobuf *
-__iobuf_ref (struct iobuf *iobuf)
-{
-        iobuf->ref++;
-
-        return iobuf;
-}
-
-
-struct iobuf *
-__iobuf_unref (struct iobuf *iobuf)
-{
-        iobuf->ref--;
-
-        return iobuf;
-}
-
 struct iobuf *
 __iobuf_get (struct iobuf_arena *iobuf_arena, size_t page_size)
 {
@@ -507,18 +816,15 @@ __iobuf_get (struct iobuf_arena *iobuf_arena, size_t page_size)
         /* no resetting requied for this element */
         iobuf_arena->alloc_cnt++;
 
+        index = iobuf_arena->index;
+        if (++iobuf_pool->active_cnt[index] > iobuf_pool->peak_active[index])
+                iobuf_pool->peak_active[index] =
+                        iobuf_pool->active_cnt[index];
+
         if (iobuf_arena->max_active < iobuf_arena->active_cnt)
                 iobuf_arena->max_active = iobuf_arena->active_cnt;
 
         if (iobuf_arena->passive_cnt == 0) {
-                index = gf_iobuf_get_arena_index (page_size);
-                if (index == -1) {
-                        gf_log ("iobuf", GF_LOG_ERROR, "page_size (%zu) of "
-                                "iobufs in arena being added is greater "
-                                "than max available", page_size);
-                        goto out;
-                }
-
                 list_del (&iobuf_arena->list);
                 list_add (&iobuf_arena->list, &iobuf_pool->filled[index]);
         }
@@ -554,7 +860,6 @@ iobuf_get_from_stdalloc (struct iobuf_pool *iobuf_pool, size_t page_size)
 
         iobuf->ptr = GF_ALIGN_BUF (iobuf->free_ptr, GF_IOBUF_ALIGN_SIZE);
         iobuf->iobuf_arena = iobuf_arena;
-        LOCK_INIT (&iobuf->lock);
 
         /* Hold a ref because you are allocating and using it */
         iobuf->ref = 1;
@@ -571,12 +876,39 @@ out:
 }
 
 
+/* Loads half a stack of iobufs of class index into the magazine */
+static void
+__iobuf_magazine_refill (struct iobuf_pool *iobuf_pool,
+                         struct iobuf_magazine *mag, int index)
+{
+        struct iobuf_arena *iobuf_arena = NULL;
+        size_t              page_size   = 0;
+        int                 count       = 0;
+
+        page_size = gf_iobuf_init_config[index].pagesize;
+        count = iobuf_magazine_size (index) / 2;
+
+        while (mag->count[index] < count) {
+                iobuf_arena = __iobuf_select_arena (iobuf_pool, page_size);
+                if (!iobuf_arena)
+                        break;
+
+                mag->iobufs[index][mag->count[index]++] =
+                        __iobuf_get (iobuf_arena, page_size);
+        }
+
+        iobuf_pool->cache_refills++;
+}
+
+
 struct iobuf *
 iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
 {
-        struct iobuf       *iobuf        = NULL;
-        struct iobuf_arena *iobuf_arena  = NULL;
-        size_t              rounded_size = 0;
+        struct iobuf          *iobuf        = NULL;
+        struct iobuf_arena    *iobuf_arena  = NULL;
+        struct iobuf_magazine *mag          = NULL;
+        size_t                 rounded_size = 0;
+        int                    index        = 0;
 
         if (page_size == 0) {
                 page_size = iobuf_pool->default_page_size;
@@ -597,6 +929,16 @@ iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
                 return iobuf;
         }
 
+        index = gf_iobuf_get_arena_index (rounded_size);
+        if (iobuf_magazine_size (index))
+                mag = iobuf_magazine_get (iobuf_pool);
+
+        if (mag && mag->count[index]) {
+                iobuf = mag->iobufs[index][--mag->count[index]];
+                mag->hits++;
+                goto ref;
+        }
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 /* most eligible arena for picking an iobuf */
@@ -608,11 +950,18 @@ iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
                 if (!iobuf)
                         goto unlock;
 
-                __iobuf_ref (iobuf);
+                if (mag)
+                        __iobuf_magazine_refill (iobuf_pool, mag, index);
+
+                __iobuf_pool_maybe_prune (iobuf_pool);
          }
 unlock:
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
+ref:
+        if (iobuf)
+                iobuf->ref = 1;
+
         return iobuf;
 }
 
@@ -620,31 +969,12 @@ struct iobuf *
 iobuf_get (struct iobuf_pool *iobuf_pool)
 {
         struct iobuf       *iobuf        = NULL;
-        struct iobuf_arena *iobuf_arena  = NULL;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
 
-        pthread_mutex_lock (&iobuf_pool->mutex);
-        {
-                /* most eligible arena for picking an iobuf */
-                iobuf_arena = __iobuf_select_arena (iobuf_pool,
-                                                    iobuf_pool->default_page_size);
-                if (!iobuf_arena) {
-                        gf_log (THIS->name, GF_LOG_WARNING, "arena not found");
-                        goto unlock;
-                }
-
-                iobuf = __iobuf_get (iobuf_arena,
-                                     iobuf_pool->default_page_size);
-                if (!iobuf) {
-                        gf_log (THIS->name, GF_LOG_WARNING, "iobuf not found");
-                        goto unlock;
-                }
-
-                __iobuf_ref (iobuf);
-        }
-unlock:
-        pthread_mutex_unlock (&iobuf_pool->mutex);
+        iobuf = iobuf_get2 (iobuf_pool, iobuf_pool->default_page_size);
+        if (!iobuf)
+                gf_log (THIS->name, GF_LOG_WARNING, "iobuf not found");
 
 out:
         return iobuf;
@@ -661,13 +991,12 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 
         iobuf_pool = iobuf_arena->iobuf_pool;
 
-        index = gf_iobuf_get_arena_index (iobuf_arena->page_size);
+        index = iobuf_arena->index;
         if (index == -1) {
                 gf_log ("iobuf", GF_LOG_DEBUG, "freeing the iobuf (%p) "
                         "allocated with standard calloc()", iobuf);
 
                 /* free up properly without bothering about lists and all */
-                LOCK_DESTROY (&iobuf->lock);
                 GF_FREE (iobuf->free_ptr);
                 GF_FREE (iobuf);
                 return;
@@ -680,14 +1009,15 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 
         list_del_init (&iobuf->list);
         iobuf_arena->active_cnt--;
+        iobuf_pool->active_cnt[index]--;
 
         list_add (&iobuf->list, &iobuf_arena->passive.list);
         iobuf_arena->passive_cnt++;
 
+        /* idle arenas are released by __iobuf_pool_prune () */
         if (iobuf_arena->active_cnt == 0) {
                 list_del (&iobuf_arena->list);
                 list_add_tail (&iobuf_arena->list, &iobuf_pool->purge[index]);
-                __iobuf_arena_prune (iobuf_pool, iobuf_arena, index);
         }
 out:
         return;
@@ -697,8 +1027,11 @@ out:
 void
 iobuf_put (struct iobuf *iobuf)
 {
-        struct iobuf_arena *iobuf_arena = NULL;
-        struct iobuf_pool  *iobuf_pool = NULL;
+        struct iobuf_arena    *iobuf_arena = NULL;
+        struct iobuf_pool     *iobuf_pool  = NULL;
+        struct iobuf_magazine *mag         = NULL;
+        int                    index       = 0;
+        int                    size        = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
@@ -714,9 +1047,35 @@ iobuf_put (struct iobuf *iobuf)
                 return;
         }
 
+        index = iobuf_arena->index;
+        if (index == -1) {
+                __iobuf_put (iobuf, iobuf_arena);
+                return;
+        }
+
+        size = iobuf_magazine_size (index);
+        if (size)
+                mag = iobuf_magazine_get (iobuf_pool);
+
+        if (mag && mag->count[index] < size) {
+                mag->iobufs[index][mag->count[index]++] = iobuf;
+                return;
+        }
+
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
                 __iobuf_put (iobuf, iobuf_arena);
+
+                /* the stack is full, give half of it back */
+                if (mag) {
+                        while (mag->count[index] > size / 2) {
+                                iobuf = mag->iobufs[index][--mag->count[index]];
+                                __iobuf_put (iobuf, iobuf->iobuf_arena);
+                        }
+                        iobuf_pool->cache_drains++;
+                }
+
+                __iobuf_pool_maybe_prune (iobuf_pool);
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
@@ -732,12 +1091,7 @@ iobuf_unref (struct iobuf *iobuf)
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
-        LOCK (&iobuf->lock);
-        {
-                __iobuf_unref (iobuf);
-                ref = iobuf->ref;
-        }
-        UNLOCK (&iobuf->lock);
+        ref = __sync_sub_and_fetch (&iobuf->ref, 1);
 
         if (!ref)
                 iobuf_put (iobuf);
@@ -752,11 +1106,7 @@ iobuf_ref (struct iobuf *iobuf)
 {
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
-        LOCK (&iobuf->lock);
-        {
-                __iobuf_ref (iobuf);
-        }
-        UNLOCK (&iobuf->lock);
+        __sync_add_and_fetch (&iobuf->ref, 1);
 
 out:
         return iobuf;
@@ -785,7 +1135,7 @@ iobref_new ()
 
         LOCK_INIT (&iobref->lock);
 
-        iobref->ref++;
+        iobref->ref = 1;
 
         return iobref;
 }
@@ -796,11 +1146,7 @@ iobref_ref (struct iobref *iobref)
 {
         GF_VALIDATE_OR_GOTO ("iobuf", iobref, out);
 
-        LOCK (&iobref->lock);
-        {
-                iobref->ref++;
-        }
-        UNLOCK (&iobref->lock);
+        __sync_add_and_fetch (&iobref->ref, 1);
 
 out:
         return iobref;
@@ -838,11 +1184,7 @@ iobref_unref (struct iobref *iobref)
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobref, out);
 
-        LOCK (&iobref->lock);
-        {
-                ref = (--iobref->ref);
-        }
-        UNLOCK (&iobref->lock);
+        ref = __sync_sub_and_fetch (&iobref->ref, 1);
 
         if (!ref)
                 iobref_destroy (iobref);
@@ -975,6 +1317,45 @@ out:
 }
 
 
+/* Returns the iobuf of @iobref which holds [@ptr, @ptr + @len), without
+ * taking a ref on it. iobufs allocated outside of the arenas are skipped,
+ * as their real size is not known. */
+struct iobuf *
+iobref_find (struct iobref *iobref, void *ptr, size_t len)
+{
+        int           i = 0;
+        struct iobuf *iobuf = NULL;
+        struct iobuf *found = NULL;
+        char         *base = NULL;
+
+        GF_VALIDATE_OR_GOTO ("iobuf", iobref, out);
+
+        LOCK (&iobref->lock);
+        {
+                for (i = 0; i < iobref->alloced; i++) {
+                        iobuf = iobref->iobrefs[i];
+                        if (!iobuf)
+                                continue;
+
+                        if (iobuf->free_ptr || !iobuf->iobuf_arena)
+                                continue;
+
+                        base = iobuf->ptr;
+                        if ((char *)ptr >= base &&
+                            ((char *)ptr - base) + len <=
+                            iobuf->iobuf_arena->page_size) {
+                                found = iobuf;
+                                break;
+                        }
+                }
+        }
+        UNLOCK (&iobref->lock);
+
+out:
+        return found;
+}
+
+
 size_t
 iobuf_size (struct iobuf *iobuf)
 {
@@ -1023,24 +1404,14 @@ void
 iobuf_info_dump (struct iobuf *iobuf, const char *key_prefix)
 {
         char   key[GF_DUMP_MAX_BUF_LEN];
-        struct iobuf my_iobuf;
-        int    ret = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
-        memset(&my_iobuf, 0, sizeof(my_iobuf));
-
-        ret = TRY_LOCK(&iobuf->lock);
-        if (ret) {
-                return;
-        }
-        memcpy(&my_iobuf, iobuf, sizeof(my_iobuf));
-        UNLOCK(&iobuf->lock);
-
+        /* cached iobufs are active with no ref */
         gf_proc_dump_build_key(key, key_prefix,"ref");
-        gf_proc_dump_write(key, "%d", my_iobuf.ref);
+        gf_proc_dump_write(key, "%d", iobuf->ref);
         gf_proc_dump_build_key(key, key_prefix,"ptr");
-        gf_proc_dump_write(key, "%p", my_iobuf.ptr);
+        gf_proc_dump_write(key, "%p", iobuf->ptr);
 
 out:
         return;
@@ -1067,6 +1438,8 @@ iobuf_arena_info_dump (struct iobuf_arena *iobuf_arena, const char *key_prefix)
         gf_proc_dump_write(key, "%"PRIu64, iobuf_arena->max_active);
         gf_proc_dump_build_key(key, key_prefix, "page_size");
         gf_proc_dump_write(key, "%"PRIu64, iobuf_arena->page_size);
+        gf_proc_dump_build_key(key, key_prefix, "huge_pages");
+        gf_proc_dump_write(key, "%d", iobuf_arena->huge);
         list_for_each_entry (trav, &iobuf_arena->active.list, list) {
                 gf_proc_dump_build_key(key, key_prefix,"active_iobuf.%d", i++);
                 gf_proc_dump_add_section(key);
@@ -1082,6 +1455,8 @@ iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
 {
         char               msg[1024];
         struct iobuf_arena *trav = NULL;
+        struct iobuf_magazine *mag = NULL;
+        uint64_t           hits = 0;
         int                i = 1;
         int                j = 0;
         int                ret = -1;
@@ -1105,6 +1480,30 @@ iobuf_stats_dump (struct iobuf_pool *iobuf_pool)
                            iobuf_pool->arena_cnt);
         gf_proc_dump_write("iobuf_pool.request_misses", "%"PRId64,
                            iobuf_pool->request_misses);
+        gf_proc_dump_write("iobuf_pool.huge_pages", "%d",
+                           iobuf_pool->huge_pages);
+        gf_proc_dump_write("iobuf_pool.arenas_pruned", "%"PRIu64,
+                           iobuf_pool->arenas_pruned);
+
+        /* the hits of live threads are read without their owners
+           knowing, they are statistics */
+        hits = iobuf_pool->cache_hits;
+        list_for_each_entry (mag, &iobuf_pool->magazines, list)
+                hits += mag->hits;
+        gf_proc_dump_write("iobuf_pool.cache_hits", "%"PRIu64, hits);
+        gf_proc_dump_write("iobuf_pool.cache_refills", "%"PRIu64,
+                           iobuf_pool->cache_refills);
+        gf_proc_dump_write("iobuf_pool.cache_drains", "%"PRIu64,
+                           iobuf_pool->cache_drains);
+
+        for (j = 0; j < IOBUF_ARENA_MAX_INDEX; j++) {
+                snprintf (msg, sizeof (msg), "iobuf_pool.class.%zu.active",
+                          gf_iobuf_init_config[j].pagesize);
+                gf_proc_dump_write (msg, "%d", iobuf_pool->active_cnt[j]);
+                snprintf (msg, sizeof (msg), "iobuf_pool.class.%zu.peak",
+                          gf_iobuf_init_config[j].pagesize);
+                gf_proc_dump_write (msg, "%d", iobuf_pool->peak_active[j]);
+        }
 
         for (j = 0; j < IOBUF_ARENA_MAX_INDEX; j++) {
                 list_for_each_entry (trav, &iobuf_pool->arenas[j], list) {
@@ -35,6 +35,21 @@
 
 #define GF_IOBUF_ALIGN_SIZE 512
 
+/* A thread keeps up to this many bytes of free iobufs of each size class
+ * cached, and never more than GF_IOBUF_MAGAZINE_MAX iobufs of a class.
+ * Classes whose page size exceeds the byte count are not cached. */
+#define GF_IOBUF_MAGAZINE_BYTES  (256 * GF_UNIT_KB)
+#define GF_IOBUF_MAGAZINE_MAX    16
+/* Pools beyond this many do not get per-thread caches. */
+#define GF_IOBUF_POOL_MAX_CACHED 16
+
+/* Arenas of a pool with huge pages enabled are sized in multiples of this */
+#define GF_IOBUF_HUGE_PAGE_SIZE  (2 * GF_UNIT_MB)
+
+/* Seconds over which the peak use of a size class is measured, idle arenas
+ * beyond what the peak needed are released at the end of the period */
+#define GF_IOBUF_PRUNE_INTERVAL  10
+
 /* one allocatable unit for the consumers of the IOBUF API */
 /* each unit hosts @page_size bytes of memory */
 struct iobuf;
@@ -62,8 +77,7 @@ struct iobuf {
         };
         struct iobuf_arena  *iobuf_arena;
 
-        gf_lock_t            lock; /* for ->ptr and ->ref */
-        int                  ref;  /* 0 == passive, >0 == active */
+        int                  ref;  /* 0 == passive, >0 == active, atomic */
 
         void                *ptr;  /* usable memory region by the consumer */
 
@@ -86,6 +100,8 @@ struct iobuf_arena {
                                            (iobuf_pool->arena_size / page_size)
                                            * page_size */
         size_t              page_count;
+        int                 index;      /* size class, -1 for stdalloc */
+        gf_boolean_t        huge;       /* mapped from huge pages */
 
         struct iobuf_pool  *iobuf_pool;
 
@@ -122,11 +138,31 @@ struct iobuf_pool {
 
         uint64_t            request_misses; /* mostly the requests for higher
                                                value of iobufs */
+
+        int                 active_cnt[GF_VARIABLE_IOBUF_COUNT];
+        /* iobufs of each size class out of the arenas, whether in use or
+           cached by a thread */
+        int                 peak_active[GF_VARIABLE_IOBUF_COUNT];
+        /* highest active_cnt since the last prune */
+        time_t              prune_time;
+        uint64_t            arenas_pruned;
+
+        gf_boolean_t        huge_pages;
+
+        int                 cache_id;   /* -1 if not cached per-thread */
+        uint64_t            cache_gen;
+        struct list_head    magazines;  /* magazines loaded by threads */
+        uint64_t            cache_hits; /* of the threads which exited */
+        uint64_t            cache_refills;
+        uint64_t            cache_drains;
 };
 
 
 struct iobuf_pool *iobuf_pool_new (void);
 void iobuf_pool_destroy (struct iobuf_pool *iobuf_pool);
+void iobuf_pool_prune (struct iobuf_pool *iobuf_pool);
+void iobuf_pool_set_huge_pages (struct iobuf_pool *iobuf_pool,
+                                gf_boolean_t enable);
 struct iobuf *iobuf_get (struct iobuf_pool *iobuf_pool);
 void iobuf_unref (struct iobuf *iobuf);
 struct iobuf *iobuf_ref (struct iobuf *iobuf);
@@ -152,6 +188,7 @@ void iobref_unref (struct iobref *iobref);
 int iobref_add (struct iobref *iobref, struct iobuf *iobuf);
 int iobref_merge (struct iobref *to, struct iobref *from);
 void iobref_clear (struct iobref *iobref);
+struct iobuf *iobref_find (struct iobref *iobref, void *ptr, size_t len);
 
 size_t iobuf_size (struct iobuf *iobuf);
 size_t iobref_size (struct iobref *iobref);
@@ -19,6 +19,7 @@
 #include "xlator.h"
 #include "common-utils.h"
 #include "statedump.h"
+#include "timespec.h"
 
 
 void
@@ -115,40 +116,112 @@ gf_set_fop_from_fn_pointer (call_frame_t *frame, struct xlator_fops *fops, void
 }
 
 
+/* Per-thread state of the frame sampler, see gf_latency_sample () */
+static pthread_once_t gf_latency_sampler_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  gf_latency_sampler_key;
+
+
+static void
+gf_latency_sampler_destroy (void *data)
+{
+        FREE (data);
+}
+
+
+static void
+gf_latency_sampler_init (void)
+{
+        pthread_key_create (&gf_latency_sampler_key,
+                            gf_latency_sampler_destroy);
+}
+
+
+/* Decides whether the frame being created is to be timed: with a sample
+ * rate of N, each frame is, independently of the others, with a chance of
+ * 1 in N. As the choice does not depend on the fop (unlike picking every
+ * Nth frame, which would alias with the order in which a client sends its
+ * fops), scaling the samples of a fop by N gives unbiased counts and
+ * totals, and the mean of the samples is that of all calls. */
+int
+gf_latency_sample (glusterfs_ctx_t *ctx)
+{
+        uint32_t *state = NULL;
+        uint32_t  x = 0;
+
+        if (ctx->latency_sample_rate <= 1)
+                return 1;
+
+        pthread_once (&gf_latency_sampler_once, gf_latency_sampler_init);
+
+        state = pthread_getspecific (gf_latency_sampler_key);
+        if (!state) {
+                state = CALLOC (1, sizeof (*state));
+                if (!state)
+                        return 0;
+                *state = ((uint32_t) (unsigned long) pthread_self () ^
+                          (uint32_t) time (NULL)) | 1;
+                pthread_setspecific (gf_latency_sampler_key, state);
+        }
+
+        /* xorshift32 */
+        x = *state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *state = x;
+
+        return (x % ctx->latency_sample_rate) == 0;
+}
+
+
 void
 gf_update_latency (call_frame_t *frame)
 {
         double elapsed;
-        struct timeval *begin, *end;
+        double weight;
+        struct timespec *begin, *end;
 
         fop_latency_t *lat;
 
         begin = &frame->begin;
         end   = &frame->end;
 
-        elapsed = (end->tv_sec - begin->tv_sec) * 1e6
-                + (end->tv_usec - begin->tv_usec);
+        elapsed = (TS ((*end)) - TS ((*begin))) / 1e3;
+
+        /* each sample stands for this many calls */
+        weight = frame->this->ctx->latency_sample_rate;
+        if (weight < 1)
+                weight = 1;
 
         lat = &frame->this->latencies[frame->op];
 
-        lat->total += elapsed;
-        lat->count++;
-        lat->mean = lat->mean + (elapsed - lat->mean) / lat->count;
+        lat->total += elapsed * weight;
+        lat->count += weight;
+        lat->mean = lat->mean + (elapsed - lat->mean) * weight / lat->count;
 }
 
 void
 gf_latency_begin (call_frame_t *frame, void *fn)
 {
+        if (!gf_latency_sample (frame->this->ctx))
+                return;
+
         gf_set_fop_from_fn_pointer (frame, frame->this->fops, fn);
+        if (frame->op == -1)
+                return;
 
-        gettimeofday (&frame->begin, NULL);
+        timespec_now (&frame->begin);
 }
 
 
 void
 gf_latency_end (call_frame_t *frame)
 {
-        gettimeofday (&frame->end, NULL);
+        /* not timed, or measurement was turned on after it was wound */
+        if (!frame->begin.tv_sec)
+                return;
+
+        timespec_now (&frame->end);
 
         gf_update_latency (frame);
 }
@@ -59,6 +59,19 @@ gf_log_inject_timer_event (glusterfs_ctx_t *ctx);
 static void
 gf_log_flush_extra_msgs (glusterfs_ctx_t *ctx, uint32_t new);
 
+static int
+gf_log_glusterlog (glusterfs_ctx_t *ctx, const char *domain, const char *file,
+                   const char *function, int32_t line, gf_loglevel_t level,
+                   int errnum, uint64_t msgid, char **appmsgstr, char *callstr,
+                   struct timeval tv, int graph_id, gf_log_format_t fmt);
+
+static void
+gf_log_async_flush (glusterfs_ctx_t *ctx);
+
+static int
+gf_log_write_line (glusterfs_ctx_t *ctx, gf_loglevel_t level, const char *msg,
+                   int plain);
+
 static char *gf_level_strings[] = {"",  /* NONE */
                 "M", /* EMERGENCY */
                 "A", /* ALERT */
@@ -150,6 +163,7 @@ gf_log_flush (void)
         ctx = this->ctx;
 
         if (ctx && ctx->log.logger == gf_logger_glusterlog) {
+                gf_log_async_flush (ctx);
                 pthread_mutex_lock (&ctx->log.logfile_mutex);
                 fflush (ctx->log.gf_log_logfile);
                 pthread_mutex_unlock (&ctx->log.logfile_mutex);
@@ -407,6 +421,9 @@ gf_log_globals_fini (void)
          * rotate state, possibly under a lock */
         pthread_mutex_destroy (&THIS->ctx->log.logfile_mutex);
         pthread_mutex_destroy (&THIS->ctx->log.log_buf_lock);
+        pthread_mutex_destroy (&THIS->ctx->log.ring_lock);
+        pthread_mutex_destroy (&THIS->ctx->log.flusher_lock);
+        pthread_cond_destroy (&THIS->ctx->log.flusher_cond);
 }
 
 void
@@ -431,6 +448,12 @@ gf_log_disable_suppression_before_exit (glusterfs_ctx_t *ctx)
         }
         pthread_mutex_unlock (&ctx->log.log_buf_lock);
 
+        /* whatever is logged from now on (the backtrace of a crash, say)
+           must not wait in a ring for the flusher */
+        if (ctx->log.async) {
+                ctx->log.async = 0;
+                gf_log_async_flush (ctx);
+        }
 }
 
 /** gf_log_fini - function to perform the cleanup of the log information
@@ -451,6 +474,7 @@ gf_log_fini (void *data)
         }
 
         gf_log_disable_suppression_before_exit (ctx);
+        gf_log_disable_async (ctx);
 
         pthread_mutex_lock (&ctx->log.logfile_mutex);
         {
@@ -659,6 +683,11 @@ gf_log_globals_init (void *data)
 
         INIT_LIST_HEAD (&ctx->log.lru_queue);
 
+        pthread_mutex_init (&ctx->log.ring_lock, NULL);
+        pthread_mutex_init (&ctx->log.flusher_lock, NULL);
+        pthread_cond_init (&ctx->log.flusher_cond, NULL);
+        INIT_LIST_HEAD (&ctx->log.rings);
+
 #ifdef GF_LINUX_HOST_OS
         /* For the 'syslog' output. one can grep 'GlusterFS' in syslog
            for serious logs */
@@ -771,13 +800,9 @@ _gf_log_callingfn (const char *domain, const char *file, const char *function,
 {
         const char     *basename        = NULL;
         xlator_t       *this            = NULL;
-        char           *str1            = NULL;
         char           *str2            = NULL;
-        char           *msg             = NULL;
-        char            timestr[256]    = {0,};
         char            callstr[4096]   = {0,};
         struct timeval  tv              = {0,};
-        size_t          len             = 0;
         int             ret             = 0;
         va_list         ap;
         glusterfs_ctx_t *ctx = NULL;
@@ -792,18 +817,6 @@ _gf_log_callingfn (const char *domain, const char *file, const char *function,
         if (level > ctx->log.loglevel)
                 goto out;
 
-        static char *level_strings[] = {"",  /* NONE */
-                                        "M", /* EMERGENCY */
-                                        "A", /* ALERT */
-                                        "C", /* CRITICAL */
-                                        "E", /* ERROR */
-                                        "W", /* WARNING */
-                                        "N", /* NOTICE */
-                                        "I", /* INFO */
-                                        "D", /* DEBUG */
-                                        "T", /* TRACE */
-                                        ""};
-
         if (!domain || !file || !function || !fmt) {
                 fprintf (stderr,
                          "logging: %s:%s():%d: invalid argument\n",
@@ -867,58 +880,21 @@ _gf_log_callingfn (const char *domain, const char *file, const char *function,
         ret = gettimeofday (&tv, NULL);
         if (-1 == ret)
                 goto out;
-        va_start (ap, fmt);
-        gf_time_fmt (timestr, sizeof timestr, tv.tv_sec, gf_timefmt_FT);
-        snprintf (timestr + strlen (timestr), sizeof timestr - strlen (timestr),
-                  ".%"GF_PRI_SUSECONDS, tv.tv_usec);
-
-        ret = gf_asprintf (&str1, "[%s] %s [%s:%d:%s] %s %d-%s: ",
-                           timestr, level_strings[level],
-                           basename, line, function, callstr,
-                           ((this->graph) ? this->graph->id:0), domain);
-        if (-1 == ret) {
-                goto out;
-        }
 
+        va_start (ap, fmt);
         ret = vasprintf (&str2, fmt, ap);
+        va_end (ap);
         if (-1 == ret) {
+                str2 = NULL;
                 goto out;
         }
 
-        va_end (ap);
-
-        len = strlen (str1);
-        msg = GF_MALLOC (len + strlen (str2) + 1, gf_common_mt_char);
-
-        strcpy (msg, str1);
-        strcpy (msg + len, str2);
-
-        pthread_mutex_lock (&ctx->log.logfile_mutex);
-        {
-                if (ctx->log.logfile) {
-                        fprintf (ctx->log.logfile, "%s\n", msg);
-                        fflush (ctx->log.logfile);
-                } else if (ctx->log.loglevel >= level) {
-                        fprintf (stderr, "%s\n", msg);
-                        fflush (stderr);
-                }
-
-#ifdef GF_LINUX_HOST_OS
-                /* We want only serious log in 'syslog', not our debug
-                   and trace logs */
-                if (ctx->log.gf_log_syslog && level &&
-                    (level <= ctx->log.sys_log_level))
-                        syslog ((level-1), "%s\n", msg);
-#endif
-        }
-
-        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+        ret = gf_log_glusterlog (ctx, domain, basename, function, line, level,
+                                 0, 0, &str2, callstr,
+                                 tv, ((this->graph) ? this->graph->id:0),
+                                 gf_logformat_traditional);
 
 out:
-        GF_FREE (msg);
-
-        GF_FREE (str1);
-
         FREE (str2);
 
         return ret;
@@ -948,26 +924,7 @@ _gf_msg_plain_internal (gf_loglevel_t level, const char *msg)
                  * to the gluster log. The ideal way to do things would be to
                  * not have the extra control file check */
         case gf_logger_glusterlog:
-                pthread_mutex_lock (&ctx->log.logfile_mutex);
-                {
-                        if (ctx->log.logfile) {
-                                fprintf (ctx->log.logfile, "%s\n", msg);
-                                fflush (ctx->log.logfile);
-                        } else {
-                                fprintf (stderr, "%s\n", msg);
-                                fflush (stderr);
-                        }
-
-#ifdef GF_LINUX_HOST_OS
-                        /* We want only serious logs in 'syslog', not our debug
-                                * and trace logs */
-                        if (ctx->log.gf_log_syslog && level &&
-                                (level <= ctx->log.sys_log_level))
-                                syslog ((level-1), "%s\n", msg);
-#endif
-                }
-                pthread_mutex_unlock (&ctx->log.logfile_mutex);
-
+                gf_log_write_line (ctx, level, msg, 1);
                 break;
         }
 
@@ -1344,11 +1301,15 @@ gf_log_syslog (glusterfs_ctx_t *ctx, const char *domain, const char *file,
         return 0;
 }
 
-static int
-gf_log_glusterlog (glusterfs_ctx_t *ctx, const char *domain, const char *file,
-                   const char *function, int32_t line, gf_loglevel_t level,
-                   int errnum, uint64_t msgid, char **appmsgstr, char *callstr,
-                   struct timeval tv, int graph_id, gf_log_format_t fmt)
+/* Formats a message the way the gluster log file has it. Returns the line
+   (to be GF_FREE'd), or NULL. */
+static char *
+gf_log_glusterlog_format (const char *domain, const char *file,
+                          const char *function, int32_t line,
+                          gf_loglevel_t level, int errnum, uint64_t msgid,
+                          const char *appmsgstr, const char *callstr,
+                          struct timeval tv, int graph_id,
+                          gf_log_format_t fmt)
 {
         char             timestr[GF_LOG_TIMESTR_SIZE] = {0,};
         char            *header = NULL;
@@ -1357,9 +1318,6 @@ gf_log_glusterlog (glusterfs_ctx_t *ctx, const char *domain, const char *file,
         size_t           hlen  = 0, flen = 0, mlen = 0;
         int              ret  = 0;
 
-        /* rotate if required */
-        gf_log_rotate(ctx);
-
         /* format the time stamp */
         gf_time_fmt (timestr, sizeof timestr, tv.tv_sec, gf_timefmt_FT);
         snprintf (timestr + strlen (timestr), sizeof timestr - strlen (timestr),
@@ -1414,47 +1372,649 @@ gf_log_glusterlog (glusterfs_ctx_t *ctx, const char *domain, const char *file,
         /* generate the full message to log */
         hlen = strlen (header);
         flen = footer? strlen (footer) : 0;
-        mlen = strlen (*appmsgstr);
+        mlen = strlen (appmsgstr);
         msg = GF_MALLOC (hlen + flen + mlen + 1, gf_common_mt_char);
+        if (!msg)
+                goto err;
 
         strcpy (msg, header);
-        strcpy (msg + hlen, *appmsgstr);
+        strcpy (msg + hlen, appmsgstr);
         if (footer)
                 strcpy (msg + hlen + mlen, footer);
 
-        pthread_mutex_lock (&ctx->log.logfile_mutex);
-        {
-                if (ctx->log.logfile) {
-                        fprintf (ctx->log.logfile, "%s\n", msg);
-                        fflush (ctx->log.logfile);
-                } else if (ctx->log.loglevel >= level) {
-                        fprintf (stderr, "%s\n", msg);
-                        fflush (stderr);
-                }
+err:
+        GF_FREE (header);
+        GF_FREE (footer);
+
+        return msg;
+}
+
+/* Called with the logfile mutex held, the caller flushes the stream. */
+static void
+__gf_log_write_line (glusterfs_ctx_t *ctx, gf_loglevel_t level,
+                     const char *msg, int plain)
+{
+        if (ctx->log.logfile) {
+                fprintf (ctx->log.logfile, "%s\n", msg);
+        } else if (plain || ctx->log.loglevel >= level) {
+                fprintf (stderr, "%s\n", msg);
+        }
 
 #ifdef GF_LINUX_HOST_OS
-                /* We want only serious logs in 'syslog', not our debug
-                 * and trace logs */
-                if (ctx->log.gf_log_syslog && level &&
-                        (level <= ctx->log.sys_log_level))
-                        syslog ((level-1), "%s\n", msg);
+        /* We want only serious logs in 'syslog', not our debug
+         * and trace logs */
+        if (ctx->log.gf_log_syslog && level &&
+                (level <= ctx->log.sys_log_level))
+                syslog ((level-1), "%s\n", msg);
 #endif
-        }
+}
 
+static void
+gf_log_write_line_sync (glusterfs_ctx_t *ctx, gf_loglevel_t level,
+                        const char *msg, int plain)
+{
+        pthread_mutex_lock (&ctx->log.logfile_mutex);
+        {
+                __gf_log_write_line (ctx, level, msg, plain);
+                fflush (ctx->log.logfile ? ctx->log.logfile : stderr);
+        }
         /* TODO: Plugin in memory log buffer retention here. For logs not
          * flushed during cores, it would be useful to retain some of the last
          * few messages in memory */
         pthread_mutex_unlock (&ctx->log.logfile_mutex);
-        ret = 0;
+}
 
-err:
-        GF_FREE (msg);
-        GF_FREE (header);
-        GF_FREE (footer);
 
+/* Asynchronous logging
+ *
+ * Once gf_log_enable_async () has been called, the gluster log file is
+ * written by a flusher thread. Every thread that logs gets a ring of
+ * GF_LOG_RING_SIZE bytes, of which it is the only producer, and appends
+ * binary records to it without taking any lock: the fields of the message,
+ * and its text already printf-formatted (the arguments cannot outlive the
+ * call). The flusher is the only consumer of all rings. It merges them in
+ * timestamp order, formats the header of each message, writes them out and
+ * flushes the stream once per batch.
+ *
+ * A record which does not fit in a full ring is dropped and counted if it
+ * is of INFO level or below, the flusher logs the count. More important
+ * records are never dropped: the thread drains the rings itself (or, if it
+ * cannot, writes the message synchronously).
+ */
+
+#define GF_LOG_RING_SIZE        (64 * 1024)
+#define GF_LOG_REC_MAX          (GF_LOG_RING_SIZE / 4)
+#define GF_LOG_DRAIN_BATCH      4096
+
+enum gf_log_rec_type {
+        GF_LOG_REC_MSG,         /* formatted by the flusher */
+        GF_LOG_REC_LINE,        /* complete line */
+};
+
+struct gf_log_rec {
+        uint32_t        len;            /* of the whole record */
+        uint16_t        type;
+        uint16_t        level;
+        uint16_t        fmt;
+        uint16_t        plain;
+        int32_t         line;
+        int32_t         errnum;
+        int32_t         graph_id;
+        uint64_t        msgid;
+        struct timeval  tv;
+        uint32_t        domain_len;
+        uint32_t        file_len;
+        uint32_t        function_len;
+        uint32_t        callstr_len;    /* 0 if no callstr */
+        uint32_t        msg_len;
+        /* followed by domain, file, function, callstr and message, each
+           nul terminated */
+};
+
+struct gf_log_ring {
+        struct list_head        list;
+        glusterfs_ctx_t        *ctx;
+        uint64_t                head;           /* written by the owner */
+        uint64_t                tail;           /* written by the flusher */
+        uint64_t                dropped;        /* written by the owner */
+        uint64_t                reported;       /* written by the flusher */
+        int                     orphaned;       /* the owner has exited */
+        char                    buf[GF_LOG_RING_SIZE];
+};
+
+static pthread_once_t  gf_log_ring_once = PTHREAD_ONCE_INIT;
+static pthread_key_t   gf_log_ring_key;
+/* the ring key of threads which must log synchronously (the flusher) */
+static char            gf_log_ring_none;
+
+
+static void
+gf_log_ring_destroy (void *data)
+{
+        struct gf_log_ring *ring = data;
+
+        if (data == &gf_log_ring_none)
+                return;
+
+        /* freed by the flusher once drained */
+        __sync_synchronize ();
+        ring->orphaned = 1;
+}
+
+
+static void
+gf_log_ring_init (void)
+{
+        pthread_key_create (&gf_log_ring_key, gf_log_ring_destroy);
+}
+
+
+static struct gf_log_ring *
+gf_log_ring_get (glusterfs_ctx_t *ctx)
+{
+        struct gf_log_ring *ring = NULL;
+
+        pthread_once (&gf_log_ring_once, gf_log_ring_init);
+
+        ring = pthread_getspecific (gf_log_ring_key);
+        if (ring == (void *) &gf_log_ring_none)
+                return NULL;
+        if (ring)
+                return (ring->ctx == ctx) ? ring : NULL;
+
+        ring = CALLOC (1, sizeof (*ring));
+        if (!ring)
+                return NULL;
+
+        ring->ctx = ctx;
+        INIT_LIST_HEAD (&ring->list);
+
+        pthread_mutex_lock (&ctx->log.ring_lock);
+        {
+                list_add_tail (&ring->list, &ctx->log.rings);
+        }
+        pthread_mutex_unlock (&ctx->log.ring_lock);
+
+        pthread_setspecific (gf_log_ring_key, ring);
+
+        return ring;
+}
+
+
+static void
+gf_log_ring_put (struct gf_log_ring *ring, uint64_t *pos, const void *data,
+                 size_t len)
+{
+        size_t off = *pos % GF_LOG_RING_SIZE;
+        size_t first = min (len, GF_LOG_RING_SIZE - off);
+
+        memcpy (ring->buf + off, data, first);
+        memcpy (ring->buf, (char *)data + first, len - first);
+        *pos += len;
+}
+
+
+static void
+gf_log_ring_get_bytes (struct gf_log_ring *ring, uint64_t pos, void *data,
+                       size_t len)
+{
+        size_t off = pos % GF_LOG_RING_SIZE;
+        size_t first = min (len, GF_LOG_RING_SIZE - off);
+
+        memcpy (data, ring->buf + off, first);
+        memcpy ((char *)data + first, ring->buf, len - first);
+}
+
+
+static void
+gf_log_flusher_wake (glusterfs_ctx_t *ctx)
+{
+        /* pairs with the barrier in gf_log_flusher_proc () */
+        __sync_synchronize ();
+        if (!ctx->log.flusher_idle)
+                return;
+
+        pthread_mutex_lock (&ctx->log.flusher_lock);
+        {
+                pthread_cond_signal (&ctx->log.flusher_cond);
+        }
+        pthread_mutex_unlock (&ctx->log.flusher_lock);
+}
+
+
+/* Queues a message for the flusher. Returns 0 if the message was queued
+   (or dropped), -1 if the caller has to write it itself. */
+static int
+gf_log_async_submit (glusterfs_ctx_t *ctx, enum gf_log_rec_type type,
+                     gf_loglevel_t level, int plain, const char *domain,
+                     const char *file, const char *function, int32_t line,
+                     int errnum, uint64_t msgid, const char *msg,
+                     const char *callstr, struct timeval tv, int graph_id,
+                     gf_log_format_t fmt)
+{
+        struct gf_log_ring *ring = NULL;
+        struct gf_log_rec   rec = {0, };
+        uint64_t            head = 0;
+        uint64_t            tail = 0;
+        int                 retried = 0;
+
+        if (!ctx->log.async)
+                return -1;
+
+        ring = gf_log_ring_get (ctx);
+        if (!ring)
+                return -1;
+
+        rec.type = type;
+        rec.level = level;
+        rec.fmt = fmt;
+        rec.plain = plain;
+        rec.line = line;
+        rec.errnum = errnum;
+        rec.graph_id = graph_id;
+        rec.msgid = msgid;
+        rec.tv = tv;
+        rec.domain_len = strlen (domain) + 1;
+        rec.file_len = strlen (file) + 1;
+        rec.function_len = strlen (function) + 1;
+        rec.callstr_len = callstr ? strlen (callstr) + 1 : 0;
+        rec.msg_len = strlen (msg) + 1;
+        rec.len = sizeof (rec) + rec.domain_len + rec.file_len +
+                rec.function_len + rec.callstr_len + rec.msg_len;
+
+        if (rec.len > GF_LOG_REC_MAX) {
+                gf_log_async_flush (ctx);
+                return -1;
+        }
+
+retry:
+        head = ring->head;
+        tail = ring->tail;
+        __sync_synchronize ();
+
+        if (GF_LOG_RING_SIZE - (head - tail) < rec.len) {
+                if (level >= GF_LOG_INFO) {
+                        ring->dropped++;
+                        gf_log_flusher_wake (ctx);
+                        return 0;
+                }
+                if (retried)
+                        return -1;
+                gf_log_async_flush (ctx);
+                retried = 1;
+                goto retry;
+        }
+
+        gf_log_ring_put (ring, &head, &rec, sizeof (rec));
+        gf_log_ring_put (ring, &head, domain, rec.domain_len);
+        gf_log_ring_put (ring, &head, file, rec.file_len);
+        gf_log_ring_put (ring, &head, function, rec.function_len);
+        if (callstr)
+                gf_log_ring_put (ring, &head, callstr, rec.callstr_len);
+        gf_log_ring_put (ring, &head, msg, rec.msg_len);
+
+        /* the record must be complete before the flusher can see it */
+        __sync_synchronize ();
+        ring->head = head;
+
+        gf_log_flusher_wake (ctx);
+
+        return 0;
+}
+
+
+static void
+__gf_log_async_write_rec (glusterfs_ctx_t *ctx, struct gf_log_rec *rec)
+{
+        char       *domain = NULL;
+        char       *file = NULL;
+        char       *function = NULL;
+        char       *callstr = NULL;
+        char       *msg = NULL;
+        char       *line = NULL;
+
+        domain = (char *)(rec + 1);
+        file = domain + rec->domain_len;
+        function = file + rec->file_len;
+        callstr = rec->callstr_len ? function + rec->function_len : NULL;
+        msg = function + rec->function_len + rec->callstr_len;
+
+        if (rec->type == GF_LOG_REC_MSG) {
+                line = gf_log_glusterlog_format (domain, file, function,
+                                                 rec->line, rec->level,
+                                                 rec->errnum, rec->msgid, msg,
+                                                 callstr, rec->tv,
+                                                 rec->graph_id, rec->fmt);
+                if (!line)
+                        return;
+        }
+
+        pthread_mutex_lock (&ctx->log.logfile_mutex);
+        {
+                __gf_log_write_line (ctx, rec->level, line ? line : msg,
+                                     rec->plain);
+        }
+        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+
+        GF_FREE (line);
+}
+
+
+static void
+__gf_log_async_report_drops (glusterfs_ctx_t *ctx, uint64_t dropped)
+{
+        struct timeval  tv = {0, };
+        char            msg[128] = {0, };
+        char           *line = NULL;
+
+        gettimeofday (&tv, NULL);
+        snprintf (msg, sizeof (msg), "%"PRIu64" log messages dropped, the "
+                  "log ring of their thread was full", dropped);
+
+        line = gf_log_glusterlog_format ("logging-infra", "logging.c",
+                                         __FUNCTION__, __LINE__,
+                                         GF_LOG_WARNING, 0, 0, msg, NULL, tv,
+                                         0, ctx->log.logformat);
+        if (!line)
+                return;
+
+        pthread_mutex_lock (&ctx->log.logfile_mutex);
+        {
+                __gf_log_write_line (ctx, GF_LOG_WARNING, line, 0);
+        }
+        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+
+        GF_FREE (line);
+}
+
+
+/* Writes out what the rings hold, oldest message first. Called with
+   ring_lock held, which makes the caller the consumer of all rings. */
+static void
+__gf_log_async_drain (glusterfs_ctx_t *ctx)
+{
+        struct gf_log_ring *ring = NULL;
+        struct gf_log_ring *tmp = NULL;
+        struct gf_log_ring *oldest = NULL;
+        struct gf_log_rec   rec = {0, };
+        struct timeval      oldest_tv = {0, };
+        uint64_t            dropped = 0;
+        int                 count = 0;
+
+        for (count = 0; count < GF_LOG_DRAIN_BATCH; count++) {
+                oldest = NULL;
+                list_for_each_entry (ring, &ctx->log.rings, list) {
+                        if (ring->tail == ring->head)
+                                continue;
+                        __sync_synchronize ();
+
+                        gf_log_ring_get_bytes (ring, ring->tail, &rec,
+                                               sizeof (rec));
+                        if (!oldest || timercmp (&rec.tv, &oldest_tv, <)) {
+                                oldest = ring;
+                                oldest_tv = rec.tv;
+                        }
+                }
+                if (!oldest)
+                        break;
+
+                gf_log_ring_get_bytes (oldest, oldest->tail, &rec,
+                                       sizeof (rec));
+                gf_log_ring_get_bytes (oldest, oldest->tail,
+                                       ctx->log.ring_scratch, rec.len);
+
+                /* the slot may be reused once the tail has moved */
+                __sync_synchronize ();
+                oldest->tail += rec.len;
+
+                __gf_log_async_write_rec (ctx,
+                        (struct gf_log_rec *) ctx->log.ring_scratch);
+        }
+
+        list_for_each_entry_safe (ring, tmp, &ctx->log.rings, list) {
+                if (ring->dropped != ring->reported) {
+                        dropped += ring->dropped - ring->reported;
+                        ring->reported = ring->dropped;
+                }
+
+                __sync_synchronize ();
+                if (ring->orphaned && ring->tail == ring->head) {
+                        list_del_init (&ring->list);
+                        FREE (ring);
+                }
+        }
+
+        if (dropped)
+                __gf_log_async_report_drops (ctx, dropped);
+
+        if (count || dropped) {
+                pthread_mutex_lock (&ctx->log.logfile_mutex);
+                {
+                        fflush (ctx->log.logfile ? ctx->log.logfile : stderr);
+                }
+                pthread_mutex_unlock (&ctx->log.logfile_mutex);
+        }
+}
+
+
+/* Drains the rings from any thread. Gives up after a while if the rings
+   are being drained by a thread which does not let go, as can happen when
+   called on a crash. */
+static void
+gf_log_async_flush (glusterfs_ctx_t *ctx)
+{
+        int tries = 0;
+
+        if (!ctx->log.flusher_running)
+                return;
+
+        while (pthread_mutex_trylock (&ctx->log.ring_lock) != 0) {
+                if (++tries > 100)
+                        return;
+                usleep (10000);
+        }
+        {
+                __gf_log_async_drain (ctx);
+        }
+        pthread_mutex_unlock (&ctx->log.ring_lock);
+}
+
+
+static int
+gf_log_rings_pending (glusterfs_ctx_t *ctx)
+{
+        struct gf_log_ring *ring = NULL;
+        int                 pending = 0;
+
+        pthread_mutex_lock (&ctx->log.ring_lock);
+        {
+                list_for_each_entry (ring, &ctx->log.rings, list) {
+                        if (ring->tail != ring->head ||
+                            ring->dropped != ring->reported) {
+                                pending = 1;
+                                break;
+                        }
+                }
+        }
+        pthread_mutex_unlock (&ctx->log.ring_lock);
+
+        return pending;
+}
+
+
+static void *
+gf_log_flusher_proc (void *data)
+{
+        glusterfs_ctx_t *ctx = data;
+        struct timespec  timeout = {0, };
+
+        pthread_once (&gf_log_ring_once, gf_log_ring_init);
+        pthread_setspecific (gf_log_ring_key, &gf_log_ring_none);
+
+        while (1) {
+                gf_log_rotate (ctx);
+
+                pthread_mutex_lock (&ctx->log.ring_lock);
+                {
+                        __gf_log_async_drain (ctx);
+                }
+                pthread_mutex_unlock (&ctx->log.ring_lock);
+
+                pthread_mutex_lock (&ctx->log.flusher_lock);
+                {
+                        if (ctx->log.async_stop) {
+                                pthread_mutex_unlock (&ctx->log.flusher_lock);
+                                break;
+                        }
+
+                        ctx->log.flusher_idle = 1;
+                        /* pairs with the barrier in gf_log_flusher_wake () */
+                        __sync_synchronize ();
+
+                        if (!gf_log_rings_pending (ctx)) {
+                                /* wake up now and then for log rotation */
+                                timeout.tv_sec = time (NULL) + 1;
+                                pthread_cond_timedwait (&ctx->log.flusher_cond,
+                                                        &ctx->log.flusher_lock,
+                                                        &timeout);
+                        }
+
+                        ctx->log.flusher_idle = 0;
+                }
+                pthread_mutex_unlock (&ctx->log.flusher_lock);
+        }
+
+        pthread_mutex_lock (&ctx->log.ring_lock);
+        {
+                __gf_log_async_drain (ctx);
+        }
+        pthread_mutex_unlock (&ctx->log.ring_lock);
+
+        return NULL;
+}
+
+
+/**
+ * gf_log_enable_async - write the gluster log file from a flusher thread
+ * @data - glusterfs context
+ *
+ * Must be called after the process has daemonized.
+ * @return: success: 0
+ *          failure: -1
+ */
+int
+gf_log_enable_async (void *data)
+{
+        glusterfs_ctx_t *ctx = data;
+        int              ret = -1;
+
+        if (!ctx)
+                goto out;
+
+        if (ctx->log.flusher_running) {
+                ret = 0;
+                goto out;
+        }
+
+        ctx->log.ring_scratch = MALLOC (GF_LOG_REC_MAX);
+        if (!ctx->log.ring_scratch)
+                goto out;
+
+        ctx->log.async_stop = 0;
+        ret = gf_thread_create (&ctx->log.flusher, NULL, gf_log_flusher_proc,
+                                ctx);
+        if (ret) {
+                FREE (ctx->log.ring_scratch);
+                ctx->log.ring_scratch = NULL;
+                goto out;
+        }
+
+        ctx->log.flusher_running = 1;
+        ctx->log.async = 1;
+out:
         return ret;
 }
 
+
+/**
+ * gf_log_disable_async - stop the flusher thread, after it has written out
+ *                        what is left in the rings
+ * @data - glusterfs context
+ */
+void
+gf_log_disable_async (void *data)
+{
+        glusterfs_ctx_t *ctx = data;
+
+        if (!ctx || !ctx->log.flusher_running)
+                return;
+
+        ctx->log.async = 0;
+
+        pthread_mutex_lock (&ctx->log.flusher_lock);
+        {
+                ctx->log.async_stop = 1;
+                pthread_cond_signal (&ctx->log.flusher_cond);
+        }
+        pthread_mutex_unlock (&ctx->log.flusher_lock);
+
+        pthread_join (ctx->log.flusher, NULL);
+        ctx->log.flusher_running = 0;
+
+        FREE (ctx->log.ring_scratch);
+        ctx->log.ring_scratch = NULL;
+}
+
+
+static int
+gf_log_write_line (glusterfs_ctx_t *ctx, gf_loglevel_t level, const char *msg,
+                   int plain)
+{
+        struct timeval tv = {0, };
+
+        if (ctx->log.async) {
+                gettimeofday (&tv, NULL);
+                if (gf_log_async_submit (ctx, GF_LOG_REC_LINE, level, plain,
+                                         "", "", "", 0, 0, 0, msg, NULL, tv,
+                                         0, 0) == 0)
+                        return 0;
+        }
+
+        gf_log_write_line_sync (ctx, level, msg, plain);
+
+        return 0;
+}
+
+
+static int
+gf_log_glusterlog (glusterfs_ctx_t *ctx, const char *domain, const char *file,
+                   const char *function, int32_t line, gf_loglevel_t level,
+                   int errnum, uint64_t msgid, char **appmsgstr, char *callstr,
+                   struct timeval tv, int graph_id, gf_log_format_t fmt)
+{
+        char            *msg  = NULL;
+
+        if (gf_log_async_submit (ctx, GF_LOG_REC_MSG, level, 0, domain, file,
+                                 function, line, errnum, msgid, *appmsgstr,
+                                 callstr, tv, graph_id, fmt) == 0)
+                return 0;
+
+        /* rotate if required */
+        gf_log_rotate(ctx);
+
+        msg = gf_log_glusterlog_format (domain, file, function, line, level,
+                                        errnum, msgid, *appmsgstr, callstr, tv,
+                                        graph_id, fmt);
+        if (!msg)
+                return -1;
+
+        gf_log_write_line_sync (ctx, level, msg, 0);
+
+        GF_FREE (msg);
+
+        return 0;
+}
+
 static int
 gf_syslog_log_repetitions (const char *domain, const char *file,
                            const char *function, int32_t line,
@@ -1555,29 +2115,7 @@ gf_glusterlog_log_repetitions (glusterfs_ctx_t *ctx, const char *domain,
         strcpy (msg + hlen, *appmsgstr);
         strcpy (msg + hlen + mlen, footer);
 
-        pthread_mutex_lock (&ctx->log.logfile_mutex);
-        {
-                if (ctx->log.logfile) {
-                        fprintf (ctx->log.logfile, "%s\n", msg);
-                        fflush (ctx->log.logfile);
-                } else if (ctx->log.loglevel >= level) {
-                        fprintf (stderr, "%s\n", msg);
-                        fflush (stderr);
-                }
-
-#ifdef GF_LINUX_HOST_OS
-                /* We want only serious logs in 'syslog', not our debug
-                 * and trace logs */
-                if (ctx->log.gf_log_syslog && level &&
-                        (level <= ctx->log.sys_log_level))
-                        syslog ((level-1), "%s\n", msg);
-#endif
-        }
-
-        /* TODO: Plugin in memory log buffer retention here. For logs not
-         * flushed during cores, it would be useful to retain some of the last
-         * few messages in memory */
-        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+        gf_log_write_line (ctx, level, msg, 0);
         ret = 0;
 
 err:
@@ -2041,13 +2579,11 @@ _gf_msg (const char *domain, const char *file, const char *function,
                         ret = 0;
         }
 
-        pthread_mutex_lock (&ctx->log.logfile_mutex);
-        {
-                if (ctx->log.logfile) {
-                        log_inited = 1;
-                }
-        }
-        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+        /* the log file is only ever replaced by another one once opened,
+           taking the logfile mutex to look at it would serialize the
+           callers against the flusher */
+        if (ctx->log.logfile)
+                log_inited = 1;
 
         /* form the message */
         va_start (ap, fmt);
@@ -2087,16 +2623,10 @@ _gf_log (const char *domain, const char *file, const char *function, int line,
          gf_loglevel_t level, const char *fmt, ...)
 {
         const char    *basename = NULL;
-        FILE          *new_logfile = NULL;
         va_list        ap;
-        char           timestr[GF_LOG_TIMESTR_SIZE] = {0,};
         struct timeval tv = {0,};
-        char          *str1 = NULL;
         char          *str2 = NULL;
-        char          *msg  = NULL;
-        size_t         len  = 0;
         int            ret  = 0;
-        int            fd   = -1;
         xlator_t      *this = NULL;
         glusterfs_ctx_t *ctx = NULL;
 
@@ -2110,18 +2640,6 @@ _gf_log (const char *domain, const char *file, const char *function, int line,
         if (level > ctx->log.loglevel)
                 goto out;
 
-        static char *level_strings[] = {"",  /* NONE */
-                                        "M", /* EMERGENCY */
-                                        "A", /* ALERT */
-                                        "C", /* CRITICAL */
-                                        "E", /* ERROR */
-                                        "W", /* WARNING */
-                                        "N", /* NOTICE */
-                                        "I", /* INFO */
-                                        "D", /* DEBUG */
-                                        "T", /* TRACE */
-                                        ""};
-
         if (!domain || !file || !function || !fmt) {
                 fprintf (stderr,
                          "logging: %s:%s():%d: invalid argument\n",
@@ -2156,95 +2674,24 @@ _gf_log (const char *domain, const char *file, const char *function, int line,
                 goto err;
         }
 
-        if (ctx->log.logrotate) {
-                ctx->log.logrotate = 0;
-
-                fd = open (ctx->log.filename,
-                           O_CREAT | O_RDONLY, S_IRUSR | S_IWUSR);
-                if (fd < 0) {
-                        gf_log ("logrotate", GF_LOG_ERROR,
-                                "%s", strerror (errno));
-                        return -1;
-                }
-                close (fd);
-
-                new_logfile = fopen (ctx->log.filename, "a");
-                if (!new_logfile) {
-                        gf_log ("logrotate", GF_LOG_CRITICAL,
-                                "failed to open logfile %s (%s)",
-                                ctx->log.filename, strerror (errno));
-                        goto log;
-                }
-
-                pthread_mutex_lock (&ctx->log.logfile_mutex);
-                {
-                        if (ctx->log.logfile)
-                                fclose (ctx->log.logfile);
-
-                        ctx->log.gf_log_logfile =
-                                ctx->log.logfile = new_logfile;
-                }
-                pthread_mutex_unlock (&ctx->log.logfile_mutex);
-
-        }
-
-log:
         ret = gettimeofday (&tv, NULL);
         if (-1 == ret)
                 goto out;
-        va_start (ap, fmt);
-        gf_time_fmt (timestr, sizeof timestr, tv.tv_sec, gf_timefmt_FT);
-        snprintf (timestr + strlen (timestr), sizeof timestr - strlen (timestr),
-                  ".%"GF_PRI_SUSECONDS, tv.tv_usec);
-
-        ret = gf_asprintf (&str1, "[%s] %s [%s:%d:%s] %d-%s: ",
-                           timestr, level_strings[level],
-                           basename, line, function,
-                           ((this->graph)?this->graph->id:0), domain);
-        if (-1 == ret) {
-                goto err;
-        }
 
+        va_start (ap, fmt);
         ret = vasprintf (&str2, fmt, ap);
-        if (-1 == ret) {
-                goto err;
-        }
-
         va_end (ap);
-
-        len = strlen (str1);
-        msg = GF_MALLOC (len + strlen (str2) + 1, gf_common_mt_char);
-
-        strcpy (msg, str1);
-        strcpy (msg + len, str2);
-
-        pthread_mutex_lock (&ctx->log.logfile_mutex);
-        {
-
-                if (ctx->log.logfile) {
-                        fprintf (ctx->log.logfile, "%s\n", msg);
-                        fflush (ctx->log.logfile);
-                } else if (ctx->log.loglevel >= level) {
-                        fprintf (stderr, "%s\n", msg);
-                        fflush (stderr);
-                }
-
-#ifdef GF_LINUX_HOST_OS
-                /* We want only serious log in 'syslog', not our debug
-                   and trace logs */
-                if (ctx->log.gf_log_syslog && level &&
-                    (level <= ctx->log.sys_log_level))
-                        syslog ((level-1), "%s\n", msg);
-#endif
+        if (-1 == ret) {
+                str2 = NULL;
+                goto out;
         }
 
-        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+        gf_log_glusterlog (ctx, domain, basename, function, line, level, 0, 0,
+                           &str2, NULL, tv,
+                           ((this->graph)?this->graph->id:0),
+                           gf_logformat_traditional);
 
 err:
-        GF_FREE (msg);
-
-        GF_FREE (str1);
-
         FREE (str2);
 
 out:
@@ -119,6 +119,18 @@ typedef struct gf_log_handle_ {
         uint32_t          timeout;
         pthread_mutex_t   log_buf_lock;
         struct _gf_timer *log_flush_timer;
+
+        /* asynchronous logging, see gf_log_enable_async () */
+        char              async;
+        char              async_stop;
+        char              flusher_running;
+        int               flusher_idle;
+        pthread_t         flusher;
+        pthread_mutex_t   ring_lock;      /* rings list, draining */
+        pthread_mutex_t   flusher_lock;
+        pthread_cond_t    flusher_cond;
+        struct list_head  rings;
+        char             *ring_scratch;
 } gf_log_handle_t;
 
 
@@ -143,6 +155,9 @@ int gf_log_init (void *data, const char *filename, const char *ident);
 
 void gf_log_logrotate (int signum);
 
+int gf_log_enable_async (void *data);
+void gf_log_disable_async (void *data);
+
 void gf_log_cleanup (void);
 
 /* Internal interfaces to log messages with message IDs */
@@ -8,19 +8,36 @@
   cases as published by the Free Software Foundation.
 */
 
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
 #include "mem-pool.h"
 #include "logging.h"
 #include "xlator.h"
+#include "statedump.h"
 #include <stdlib.h>
 #include <stdarg.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+#ifdef HAVE_BACKTRACE
+#include <execinfo.h>
+#else
+#include "execinfo_compat.h"
+#endif
 
 #define GF_MEM_POOL_LIST_BOUNDARY        (sizeof(struct list_head))
-#define GF_MEM_POOL_PTR                  (sizeof(struct mem_pool*))
+#define GF_MEM_POOL_PTR                  (sizeof(struct mem_pool_slab*))
 #define GF_MEM_POOL_PAD_BOUNDARY         (GF_MEM_POOL_LIST_BOUNDARY  + GF_MEM_POOL_PTR + sizeof(int))
 #define mem_pool_chunkhead2ptr(head)     ((head) + GF_MEM_POOL_PAD_BOUNDARY)
 #define mem_pool_ptr2chunkhead(ptr)      ((ptr) - GF_MEM_POOL_PAD_BOUNDARY)
 #define is_mem_chunk_in_use(ptr)         (*ptr == 1)
-#define mem_pool_from_ptr(ptr)           ((ptr) + GF_MEM_POOL_LIST_BOUNDARY)
+#define mem_pool_slab_from_ptr(ptr)      ((ptr) + GF_MEM_POOL_LIST_BOUNDARY)
+#define mem_pool_in_use_from_ptr(ptr)    ((ptr) + GF_MEM_POOL_LIST_BOUNDARY + \
+                                          GF_MEM_POOL_PTR)
 
 #define GLUSTERFS_ENV_MEM_ACCT_STR  "GLUSTERFS_DISABLE_MEM_ACCT"
 
@@ -45,12 +62,321 @@ gf_mem_acct_enable_set (void *data)
         return;
 }
 
+static struct mem_acct_shard *
+gf_mem_acct_shard (xlator_t *xl, uint32_t type)
+{
+        unsigned long   idx = 0;
+
+#ifdef GF_LINUX_HOST_OS
+        int             cpu = sched_getcpu ();
+
+        if (cpu >= 0)
+                idx = cpu;
+        else
+#endif
+                idx = (unsigned long) pthread_self () >> 8;
+
+        idx %= xl->mem_acct.num_shards;
+
+        return &xl->mem_acct.shards[idx * xl->mem_acct.shard_stride + type];
+}
+
+
+void
+gf_mem_acct_fold (xlator_t *xl, uint32_t type)
+{
+        struct mem_acct_rec     *rec = NULL;
+        struct mem_acct_shard   *shard = NULL;
+        int64_t                  size = 0;
+        int64_t                  num_allocs = 0;
+        uint64_t                 total_allocs = 0;
+        uint32_t                 i = 0;
+
+        rec = &xl->mem_acct.rec[type];
+
+        LOCK (&rec->lock);
+        {
+                /* the shards are read while they are being updated, so the
+                   sum is a snapshot that may be a few allocations behind */
+                for (i = 0; i < xl->mem_acct.num_shards; i++) {
+                        shard = &xl->mem_acct.shards[i *
+                                                     xl->mem_acct.shard_stride
+                                                     + type];
+                        size += *(volatile int64_t *)&shard->size;
+                        num_allocs += *(volatile int64_t *)&shard->num_allocs;
+                        total_allocs +=
+                                *(volatile uint64_t *)&shard->total_allocs;
+                }
+
+                rec->size = (size > 0) ? size : 0;
+                rec->num_allocs = (num_allocs > 0) ? num_allocs : 0;
+                rec->total_allocs = total_allocs;
+                rec->max_size = max (rec->max_size, rec->size);
+                rec->max_num_allocs = max (rec->max_num_allocs,
+                                           rec->num_allocs);
+        }
+        UNLOCK (&rec->lock);
+}
+
+
+/* Sampled allocation-site profiler. The sites live in an open-addressed
+ * table keyed by a hash of the backtrace, the xlator and the type; a
+ * sampled allocation keeps its site index in the header padding so that
+ * its free can be charged back to the site. */
+struct mem_profile_site {
+        uint64_t        hash;           /* 0 free, 1 while being filled */
+        xlator_t       *xl;
+        uint32_t        type;
+        int             depth;
+        void           *frames[GF_MEM_PROFILE_DEPTH];
+        int64_t         live_allocs;
+        int64_t         live_bytes;
+        uint64_t        samples;
+};
+
+#define GF_MEM_PROFILE_PROBES   16
+/* the frames of gf_mem_profile_sample, gf_mem_set_acct_info and the
+   GF_*ALLOC entry point are left out of the sites, the first two are
+   kept out of line so that the count holds */
+#define GF_MEM_PROFILE_SKIP     3
+
+static struct mem_profile_site  *gf_mem_profile_sites;
+static uint32_t                  gf_mem_profile_rate;
+static uint64_t                  gf_mem_profile_dropped;
+static uint64_t                  gf_mem_profile_seq;
+static pthread_key_t             gf_mem_profile_key;
+static pthread_mutex_t           gf_mem_profile_lock =
+                                        PTHREAD_MUTEX_INITIALIZER;
+
+
+static uint64_t
+gf_mem_profile_hash (uint64_t hash, uint64_t val)
+{
+        int     i = 0;
+
+        /* FNV-1a, a byte at a time */
+        for (i = 0; i < sizeof (val); i++) {
+                hash ^= (val >> (i * 8)) & 0xff;
+                hash *= 1099511628211ULL;
+        }
+
+        return hash;
+}
+
+
 int
+gf_mem_profile_set_rate (uint32_t rate)
+{
+        void    *frames[GF_MEM_PROFILE_DEPTH];
+        int      ret = 0;
+
+        pthread_mutex_lock (&gf_mem_profile_lock);
+        {
+                if (rate && !gf_mem_profile_sites) {
+                        ret = pthread_key_create (&gf_mem_profile_key, NULL);
+                        if (ret)
+                                goto unlock;
+
+                        gf_mem_profile_sites = CALLOC (GF_MEM_PROFILE_SITES,
+                                                       sizeof (struct mem_profile_site));
+                        if (!gf_mem_profile_sites) {
+                                pthread_key_delete (gf_mem_profile_key);
+                                ret = -1;
+                                goto unlock;
+                        }
+
+                        /* the first backtrace() may load the unwinder,
+                           take that hit here rather than in an allocation */
+                        backtrace (frames, GF_MEM_PROFILE_DEPTH);
+                }
+
+                /* the table is kept when sampling stops, frees of the
+                   sampled allocations still find their sites */
+                gf_mem_profile_rate = rate;
+        }
+unlock:
+        pthread_mutex_unlock (&gf_mem_profile_lock);
+
+        return ret;
+}
+
+
+static uint32_t __attribute__ ((noinline))
+gf_mem_profile_sample (xlator_t *xl, uint32_t type, size_t size, void *ptr)
+{
+        void                    *frames[GF_MEM_PROFILE_DEPTH +
+                                        GF_MEM_PROFILE_SKIP];
+        struct mem_profile_site *site = NULL;
+        uint32_t                 rate = 0;
+        uintptr_t                countdown = 0;
+        uint64_t                 seq = 0;
+        uint64_t                 hash = 0;
+        uint32_t                 idx = 0;
+        int                      depth = 0;
+        int                      i = 0;
+
+        rate = gf_mem_profile_rate;
+        if (!rate)
+                return 0;
+
+        /* the countdown lives in the key's value itself, no allocation */
+        countdown = (uintptr_t) pthread_getspecific (gf_mem_profile_key);
+        if (countdown > 1) {
+                pthread_setspecific (gf_mem_profile_key,
+                                     (void *)(countdown - 1));
+                return 0;
+        }
+
+        /* the next sample is 1 to 2*rate-1 allocations away, one in rate
+           on average without locking onto periodic allocation patterns;
+           the sequence number is only bumped on samples */
+        seq = __sync_add_and_fetch (&gf_mem_profile_seq, 1);
+        countdown = 1 + gf_mem_profile_hash (14695981039346656037ULL,
+                                             seq ^ (uintptr_t) ptr)
+                        % (2 * (uint64_t) rate - 1);
+        pthread_setspecific (gf_mem_profile_key, (void *) countdown);
+
+        depth = backtrace (frames, GF_MEM_PROFILE_DEPTH + GF_MEM_PROFILE_SKIP)
+                - GF_MEM_PROFILE_SKIP;
+        if (depth < 0)
+                depth = 0;
+
+        hash = gf_mem_profile_hash (14695981039346656037ULL, (uintptr_t) xl);
+        hash = gf_mem_profile_hash (hash, type);
+        for (i = 0; i < depth; i++)
+                hash = gf_mem_profile_hash (hash,
+                                    (uintptr_t) frames[GF_MEM_PROFILE_SKIP + i]);
+        if (hash <= 1)
+                hash += 2;
+
+        for (i = 0; i < GF_MEM_PROFILE_PROBES; i++) {
+                idx = (hash + i) & (GF_MEM_PROFILE_SITES - 1);
+                site = &gf_mem_profile_sites[idx];
+
+                if (site->hash == hash)
+                        break;
+
+                if (site->hash == 0 &&
+                    __sync_bool_compare_and_swap (&site->hash, 0, 1)) {
+                        site->xl = xl;
+                        site->type = type;
+                        site->depth = depth;
+                        memcpy (site->frames, &frames[GF_MEM_PROFILE_SKIP],
+                                depth * sizeof (void *));
+                        __sync_synchronize ();
+                        site->hash = hash;
+                        break;
+                }
+        }
+
+        if (i == GF_MEM_PROFILE_PROBES) {
+                __sync_fetch_and_add (&gf_mem_profile_dropped, 1);
+                return 0;
+        }
+
+        __sync_fetch_and_add (&site->samples, 1);
+        __sync_fetch_and_add (&site->live_allocs, 1);
+        __sync_fetch_and_add (&site->live_bytes, size);
+
+        return idx + 1;
+}
+
+
+static void
+gf_mem_profile_release (uint32_t site_idx, size_t size)
+{
+        struct mem_profile_site *site = NULL;
+
+        if (!site_idx || !gf_mem_profile_sites)
+                return;
+
+        site = &gf_mem_profile_sites[site_idx - 1];
+
+        __sync_fetch_and_sub (&site->live_allocs, 1);
+        __sync_fetch_and_sub (&site->live_bytes, size);
+}
+
+
+void
+gf_mem_profile_dump (void)
+{
+        struct mem_profile_site *site = NULL;
+        struct mem_profile_site *top[GF_MEM_PROFILE_TOP_K] = {NULL, };
+        const char              *typestr = NULL;
+        char                   **symbols = NULL;
+        char                     key[GF_DUMP_MAX_BUF_LEN];
+        int                      used = 0;
+        int                      i = 0;
+        int                      j = 0;
+
+        if (!gf_mem_profile_sites)
+                return;
+
+        for (i = 0; i < GF_MEM_PROFILE_SITES; i++) {
+                site = &gf_mem_profile_sites[i];
+                if (site->hash <= 1 || site->live_bytes <= 0)
+                        continue;
+                if (used == GF_MEM_PROFILE_TOP_K &&
+                    site->live_bytes <= top[used - 1]->live_bytes)
+                        continue;
+
+                if (used < GF_MEM_PROFILE_TOP_K)
+                        used++;
+                for (j = used - 1;
+                     j > 0 && top[j - 1]->live_bytes < site->live_bytes; j--)
+                        top[j] = top[j - 1];
+                top[j] = site;
+        }
+
+        gf_proc_dump_add_section ("mem-profile");
+        gf_proc_dump_write ("sample_rate", "%u", gf_mem_profile_rate);
+        gf_proc_dump_write ("dropped_samples", "%"PRIu64,
+                            gf_mem_profile_dropped);
+        gf_proc_dump_write ("suspect_count", "%d", used);
+
+        for (i = 0; i < used; i++) {
+                site = top[i];
+
+                typestr = NULL;
+                if (site->xl->mem_acct.rec)
+                        typestr = site->xl->mem_acct.rec[site->type].typestr;
+
+                gf_proc_dump_add_section ("mem-profile.suspect[%d]", i);
+                gf_proc_dump_write ("xlator", "%s", site->xl->name);
+                gf_proc_dump_write ("type", "%s",
+                                    typestr ? typestr : "(unknown)");
+                gf_proc_dump_write ("samples", "%"PRIu64, site->samples);
+                gf_proc_dump_write ("live_allocs", "%"PRId64,
+                                    site->live_allocs);
+                gf_proc_dump_write ("live_bytes", "%"PRId64,
+                                    site->live_bytes);
+                /* every sample stands for rate allocations */
+                gf_proc_dump_write ("estimated_live_bytes", "%"PRIu64,
+                                    (uint64_t) site->live_bytes *
+                                    max (gf_mem_profile_rate, 1));
+
+                symbols = backtrace_symbols (site->frames, site->depth);
+                for (j = 0; j < site->depth; j++) {
+                        snprintf (key, sizeof (key), "frame[%d]", j);
+                        if (symbols)
+                                gf_proc_dump_write (key, "%s", symbols[j]);
+                        else
+                                gf_proc_dump_write (key, "%p",
+                                                    site->frames[j]);
+                }
+                free (symbols);
+        }
+}
+
+
+int __attribute__ ((noinline))
 gf_mem_set_acct_info (xlator_t *xl, char **alloc_ptr, size_t size,
 		      uint32_t type, const char *typestr)
 {
 
-        char    *ptr = NULL;
+        char                    *ptr = NULL;
+        struct mem_acct_shard   *shard = NULL;
+        uint64_t                 total_allocs = 0;
 
         if (!alloc_ptr)
                 return -1;
@@ -63,21 +389,15 @@ gf_mem_set_acct_info (xlator_t *xl, char **alloc_ptr, size_t size,
 
         GF_ASSERT (type <= xl->mem_acct.num_types);
 
-        LOCK(&xl->mem_acct.rec[type].lock);
-        {
-		if (!xl->mem_acct.rec[type].typestr)
-			xl->mem_acct.rec[type].typestr = typestr;
-                xl->mem_acct.rec[type].size += size;
-                xl->mem_acct.rec[type].num_allocs++;
-                xl->mem_acct.rec[type].total_allocs++;
-                xl->mem_acct.rec[type].max_size =
-                        max (xl->mem_acct.rec[type].max_size,
-                             xl->mem_acct.rec[type].size);
-                xl->mem_acct.rec[type].max_num_allocs =
-                        max (xl->mem_acct.rec[type].max_num_allocs,
-                             xl->mem_acct.rec[type].num_allocs);
-        }
-        UNLOCK(&xl->mem_acct.rec[type].lock);
+        if (!xl->mem_acct.rec[type].typestr)
+                xl->mem_acct.rec[type].typestr = typestr;
+
+        shard = gf_mem_acct_shard (xl, type);
+        __sync_fetch_and_add (&shard->size, size);
+        __sync_fetch_and_add (&shard->num_allocs, 1);
+        total_allocs = __sync_add_and_fetch (&shard->total_allocs, 1);
+        if ((total_allocs % GF_MEM_ACCT_FOLD_INTERVAL) == 0)
+                gf_mem_acct_fold (xl, type);
 
         *(uint32_t *)(ptr) = type;
         ptr = ptr + 4;
@@ -87,7 +407,10 @@ gf_mem_set_acct_info (xlator_t *xl, char **alloc_ptr, size_t size,
         ptr += sizeof (xlator_t *);
         *(uint32_t *)(ptr) = GF_MEM_HEADER_MAGIC;
         ptr = ptr + 4;
-        ptr = ptr + 8; //padding
+        //padding, the first word holds the profiler site
+        *(uint32_t *)(ptr) = gf_mem_profile_rate ?
+                gf_mem_profile_sample (xl, type, size, ptr) : 0;
+        ptr = ptr + 8;
         *(uint32_t *) (ptr + size) = GF_MEM_TRAILER_MAGIC;
 
         *alloc_ptr = (void *)ptr;
@@ -154,6 +477,8 @@ __gf_realloc (void *ptr, size_t size)
         xlator_t        *xl = NULL;
         uint32_t        type = 0;
         char            *new_ptr;
+        uint32_t        site = 0;
+        size_t          old_size = 0;
 
         if (!THIS->ctx->mem_acct_enable)
                 return REALLOC (ptr, size);
@@ -166,9 +491,14 @@ __gf_realloc (void *ptr, size_t size)
 
         GF_ASSERT (*(uint32_t *)orig_ptr == GF_MEM_HEADER_MAGIC);
 
+        site = *(uint32_t *)((char *)ptr - 8);
+
         orig_ptr = orig_ptr - sizeof(xlator_t *);
         xl = *((xlator_t **)orig_ptr);
 
+        orig_ptr = orig_ptr - sizeof (size_t);
+        memcpy (&old_size, orig_ptr, sizeof (size_t));
+
         orig_ptr = (char *)ptr - GF_MEM_HEADER_SIZE;
         type = *(uint32_t *)orig_ptr;
 
@@ -178,6 +508,8 @@ __gf_realloc (void *ptr, size_t size)
                 return NULL;
         }
 
+        gf_mem_profile_release (site, old_size);
+
         /*
          * We used to pass (char **)&ptr as the second
          * argument after the value of realloc was saved
@@ -236,6 +568,7 @@ __gf_free (void *free_ptr)
         char            *ptr = NULL;
         uint32_t        type = 0;
         xlator_t        *xl = NULL;
+        struct mem_acct_shard *shard = NULL;
 
         if (!THIS->ctx->mem_acct_enable) {
                 FREE (free_ptr);
@@ -275,29 +608,401 @@ __gf_free (void *free_ptr)
 
         *(uint32_t *) ((char *)free_ptr + req_size) = 0;
 
-        LOCK (&xl->mem_acct.rec[type].lock);
-        {
-                xl->mem_acct.rec[type].size -= req_size;
-                xl->mem_acct.rec[type].num_allocs--;
-        }
-        UNLOCK (&xl->mem_acct.rec[type].lock);
+        shard = gf_mem_acct_shard (xl, type);
+        __sync_fetch_and_sub (&shard->size, req_size);
+        __sync_fetch_and_sub (&shard->num_allocs, 1);
+
+        gf_mem_profile_release (*(uint32_t *)((char *)free_ptr - 8),
+                                req_size);
 free:
         FREE (ptr);
 }
 
 
 
+/*
+ * Memory pools hand out fixed size chunks carved out of slabs. A slab
+ * holds chunks_per_slab chunks, slabs are added when a pool runs dry and
+ * released again once they are entirely free (keeping one spare).
+ *
+ * Every chunk is preceded by a header:
+ *   struct list_head       links the chunk on its slab's free list
+ *   struct mem_pool_slab * slab the chunk belongs to
+ *   int                    in use flag
+ *
+ * On top of the slabs each thread keeps a magazine of free chunks per
+ * pool, which mem_get () and mem_put () use without taking any lock.
+ * When a magazine runs empty (or full) it is exchanged against a full
+ * (or empty) one in the pool's depot under pool->lock. Taking a full
+ * magazine filled by another thread is accounted as a steal.
+ */
+
+struct mem_pool_thread_cache {
+        int                       node;
+        struct mem_pool_magazine *mags[GF_MEM_POOL_MAX_CACHED];
+};
+
+static pthread_once_t    mem_pool_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t     mem_pool_cache_key;
+static pthread_mutex_t   mem_pool_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mem_pool  *mem_pool_cache_owner[GF_MEM_POOL_MAX_CACHED];
+static uint64_t          mem_pool_cache_gen;
+
+static void
+__mem_pool_magazine_drain (struct mem_pool *pool,
+                           struct mem_pool_magazine *mag, int count,
+                           struct list_head *released);
+static void
+mem_pool_slabs_release (struct list_head *released);
+
+
+static int
+mem_pool_current_node (void)
+{
+#if defined(GF_LINUX_HOST_OS) && defined(SYS_getcpu)
+        unsigned int cpu = 0;
+        unsigned int node = 0;
+
+        if (syscall (SYS_getcpu, &cpu, &node, NULL) == 0)
+                return node;
+#endif
+        return 0;
+}
+
+
+static void
+mem_pool_cache_destroy (void *data)
+{
+        struct mem_pool_thread_cache *cache = data;
+        struct mem_pool_magazine     *mag = NULL;
+        struct mem_pool              *pool = NULL;
+        struct list_head              released;
+        int                           i = 0;
+
+        INIT_LIST_HEAD (&released);
+
+        for (i = 0; i < GF_MEM_POOL_MAX_CACHED; i++) {
+                mag = cache->mags[i];
+                if (!mag)
+                        continue;
+
+                pthread_mutex_lock (&mem_pool_cache_lock);
+                {
+                        pool = mag->pool;
+                        if (!pool || mem_pool_cache_owner[i] != pool ||
+                            pool->cache_gen != mag->cache_gen) {
+                                /* the pool is gone */
+                                FREE (mag);
+                                goto unlock;
+                        }
+
+                        /* hand the cached chunks over to the depot */
+                        LOCK (&pool->lock);
+                        {
+                                pool->pool_hits += mag->hits;
+                                mag->hits = 0;
+                                list_del_init (&mag->list);
+                                if (mag->count) {
+                                        list_add_tail (&mag->list,
+                                                       &pool->depot_full);
+                                        pool->depot_full_count++;
+                                } else {
+                                        list_add (&mag->list,
+                                                  &pool->depot_empty);
+                                }
+
+                                /* same cap as in mem_put () */
+                                if (pool->depot_full_count >
+                                    GF_MEM_POOL_DEPOT_MAX) {
+                                        mag = list_entry (pool->depot_full.next,
+                                                  struct mem_pool_magazine,
+                                                  list);
+                                        __mem_pool_magazine_drain (pool, mag,
+                                                GF_MEM_POOL_MAGAZINE_SIZE,
+                                                &released);
+                                        list_move (&mag->list,
+                                                   &pool->depot_empty);
+                                        pool->depot_full_count--;
+                                }
+                        }
+                        UNLOCK (&pool->lock);
+                }
+unlock:
+                pthread_mutex_unlock (&mem_pool_cache_lock);
+        }
+
+        mem_pool_slabs_release (&released);
+        FREE (cache);
+}
+
+
+static void
+mem_pool_cache_init (void)
+{
+        pthread_key_create (&mem_pool_cache_key, mem_pool_cache_destroy);
+}
+
+
+/* Returns the calling thread's magazine for pool, NULL if the pool is
+ * not cached per-thread.
+ */
+static struct mem_pool_magazine *
+mem_pool_magazine_get (struct mem_pool *pool)
+{
+        struct mem_pool_thread_cache *cache = NULL;
+        struct mem_pool_magazine     *mag = NULL;
+
+        if (pool->cache_id == -1)
+                return NULL;
+
+        cache = pthread_getspecific (mem_pool_cache_key);
+        if (!cache) {
+                cache = CALLOC (1, sizeof (*cache));
+                if (!cache)
+                        return NULL;
+
+                cache->node = mem_pool_current_node ();
+                pthread_setspecific (mem_pool_cache_key, cache);
+        }
+
+        mag = cache->mags[pool->cache_id];
+        if (mag && mag->pool == pool && mag->cache_gen == pool->cache_gen)
+                return mag;
+
+        /* first use of this pool by the thread, or the magazine belonged
+           to a pool which has been destroyed since */
+        FREE (mag);
+        cache->mags[pool->cache_id] = NULL;
+
+        mag = CALLOC (1, sizeof (*mag));
+        if (!mag)
+                return NULL;
+
+        INIT_LIST_HEAD (&mag->list);
+        mag->pool = pool;
+        mag->cache_gen = pool->cache_gen;
+        mag->owner = pthread_self ();
+
+        LOCK (&pool->lock);
+        {
+                list_add (&mag->list, &pool->magazines);
+        }
+        UNLOCK (&pool->lock);
+
+        cache->mags[pool->cache_id] = mag;
+
+        return mag;
+}
+
+
+static int
+mem_pool_thread_node (void)
+{
+        struct mem_pool_thread_cache *cache = NULL;
+
+        cache = pthread_getspecific (mem_pool_cache_key);
+        if (cache)
+                return cache->node;
+
+        return mem_pool_current_node ();
+}
+
+
+/* Allocates and initializes a slab outside of pool->lock. The chunks
+ * are written to by the allocating thread, so with a first-touch NUMA
+ * policy the slab memory is local to the thread which needed it.
+ */
+static struct mem_pool_slab *
+mem_pool_slab_new (struct mem_pool *pool, int node)
+{
+        struct mem_pool_slab  *slab = NULL;
+        struct list_head      *list = NULL;
+        struct mem_pool_slab **slab_ptr = NULL;
+        int                    i = 0;
+
+#ifdef DEBUG
+        /* every chunk comes from the heap, for the benefit of valgrind */
+        return NULL;
+#endif
+        slab = GF_CALLOC (1, sizeof (*slab), gf_common_mt_mem_pool_slab);
+        if (!slab)
+                return NULL;
+
+        slab->base = GF_CALLOC (pool->chunks_per_slab,
+                                pool->padded_sizeof_type, gf_common_mt_long);
+        if (!slab->base) {
+                GF_FREE (slab);
+                return NULL;
+        }
+
+        INIT_LIST_HEAD (&slab->slab_list);
+        INIT_LIST_HEAD (&slab->partial_list);
+        INIT_LIST_HEAD (&slab->free);
+        slab->pool = pool;
+        slab->node = node;
+        slab->nr_chunks = pool->chunks_per_slab;
+        slab->nr_free = slab->nr_chunks;
+
+        for (i = 0; i < slab->nr_chunks; i++) {
+                list = slab->base + (i * pool->padded_sizeof_type);
+                INIT_LIST_HEAD (list);
+                slab_ptr = mem_pool_slab_from_ptr ((void *)list);
+                *slab_ptr = slab;
+                list_add_tail (list, &slab->free);
+        }
+
+        return slab;
+}
+
+
+static void
+mem_pool_slab_free (struct mem_pool_slab *slab)
+{
+        GF_FREE (slab->base);
+        GF_FREE (slab);
+}
+
+
+static void
+__mem_pool_slab_add (struct mem_pool *pool, struct mem_pool_slab *slab)
+{
+        list_add_tail (&slab->slab_list, &pool->slabs);
+        list_add_tail (&slab->partial_list, &pool->partial);
+
+        pool->slab_count++;
+        if (pool->max_slab_count < pool->slab_count)
+                pool->max_slab_count = pool->slab_count;
+        pool->empty_slab_count++;
+        pool->slab_free_count += slab->nr_free;
+}
+
+
+/* Takes a chunk from the slabs, preferring a slab local to node.
+ * Returns NULL if all slabs are full.
+ */
+static void *
+__mem_pool_slab_get (struct mem_pool *pool, int node)
+{
+        struct mem_pool_slab *slab = NULL;
+        struct mem_pool_slab *tmp = NULL;
+        struct list_head     *list = NULL;
+        int                   scanned = 0;
+        int                   used = 0;
+
+        if (list_empty (&pool->partial))
+                return NULL;
+
+        list_for_each_entry (tmp, &pool->partial, partial_list) {
+                if (tmp->node == node) {
+                        slab = tmp;
+                        break;
+                }
+                /* do not walk the whole list for a perfect match */
+                if (++scanned == 4)
+                        break;
+        }
+        if (!slab)
+                slab = list_entry (pool->partial.next, struct mem_pool_slab,
+                                   partial_list);
+
+        if (slab->nr_free == slab->nr_chunks)
+                pool->empty_slab_count--;
+
+        list = slab->free.next;
+        list_del_init (list);
+        slab->nr_free--;
+        pool->slab_free_count--;
+
+        if (!slab->nr_free)
+                list_del_init (&slab->partial_list);
+
+        /* chunks cached by threads count as allocated here, the exact
+           figure is computed by mem_pool_refresh_stats () */
+        used = pool->slab_count * pool->chunks_per_slab -
+               pool->slab_free_count;
+        if (pool->max_alloc < used)
+                pool->max_alloc = used;
+
+        return list;
+}
+
+
+/* Returns a chunk to its slab. A slab which becomes entirely free is
+ * moved to released, for the caller to free outside of pool->lock,
+ * unless it is the only spare slab of the pool.
+ */
+static void
+__mem_pool_slab_put (struct mem_pool *pool, struct list_head *head,
+                     struct list_head *released)
+{
+        struct mem_pool_slab *slab = NULL;
+
+        slab = *(struct mem_pool_slab **)mem_pool_slab_from_ptr ((void *)head);
+
+        if (slab == &pool->heap_slab) {
+                pool->curr_stdalloc--;
+                GF_FREE (head);
+                return;
+        }
+
+        list_add (head, &slab->free);
+        slab->nr_free++;
+        pool->slab_free_count++;
+
+        if (slab->nr_free == 1)
+                list_add (&slab->partial_list, &pool->partial);
+
+        if (slab->nr_free < slab->nr_chunks)
+                return;
+
+        if (!pool->empty_slab_count || pool->slab_count == 1) {
+                pool->empty_slab_count++;
+                return;
+        }
+
+        list_del_init (&slab->partial_list);
+        list_del_init (&slab->slab_list);
+        pool->slab_count--;
+        pool->slab_free_count -= slab->nr_free;
+        pool->slabs_freed++;
+        list_add (&slab->slab_list, released);
+}
+
+
+static void
+__mem_pool_magazine_drain (struct mem_pool *pool,
+                           struct mem_pool_magazine *mag, int count,
+                           struct list_head *released)
+{
+        while (mag->count && count--)
+                __mem_pool_slab_put (pool, mag->chunks[--mag->count],
+                                     released);
+}
+
+
+static void
+mem_pool_slabs_release (struct list_head *released)
+{
+        struct mem_pool_slab *slab = NULL;
+        struct mem_pool_slab *tmp = NULL;
+
+        list_for_each_entry_safe (slab, tmp, released, slab_list) {
+                list_del (&slab->slab_list);
+                mem_pool_slab_free (slab);
+        }
+}
+
+
 struct mem_pool *
 mem_pool_new_fn (unsigned long sizeof_type,
                  unsigned long count, char *name)
 {
-        struct mem_pool  *mem_pool = NULL;
-        unsigned long     padded_sizeof_type = 0;
-        GF_UNUSED void             *pool = NULL;
-        GF_UNUSED int               i = 0;
-        int               ret = 0;
-        GF_UNUSED struct list_head *list = NULL;
-        glusterfs_ctx_t  *ctx = NULL;
+        struct mem_pool      *mem_pool = NULL;
+        GF_UNUSED struct mem_pool_slab *slab = NULL;
+        unsigned long         padded_sizeof_type = 0;
+        int                   ret = 0;
+        GF_UNUSED int         i = 0;
+        glusterfs_ctx_t      *ctx = NULL;
 
         if (!sizeof_type || !count) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR, "invalid argument");
@@ -319,29 +1024,48 @@ mem_pool_new_fn (unsigned long sizeof_type,
         }
 
         LOCK_INIT (&mem_pool->lock);
-        INIT_LIST_HEAD (&mem_pool->list);
+        INIT_LIST_HEAD (&mem_pool->slabs);
+        INIT_LIST_HEAD (&mem_pool->partial);
+        INIT_LIST_HEAD (&mem_pool->magazines);
+        INIT_LIST_HEAD (&mem_pool->depot_full);
+        INIT_LIST_HEAD (&mem_pool->depot_empty);
         INIT_LIST_HEAD (&mem_pool->global_list);
+        mem_pool->heap_slab.pool = mem_pool;
 
         mem_pool->padded_sizeof_type = padded_sizeof_type;
         mem_pool->real_sizeof_type = sizeof_type;
+        mem_pool->chunks_per_slab = count;
 
+        pthread_once (&mem_pool_cache_once, mem_pool_cache_init);
+
+        mem_pool->cache_id = -1;
 #ifndef DEBUG
-        mem_pool->cold_count = count;
-        pool = GF_CALLOC (count, padded_sizeof_type, gf_common_mt_long);
-        if (!pool) {
-                GF_FREE (mem_pool->name);
-                GF_FREE (mem_pool);
-                return NULL;
-        }
+        pthread_mutex_lock (&mem_pool_cache_lock);
+        {
+                for (i = 0; i < GF_MEM_POOL_MAX_CACHED; i++) {
+                        if (mem_pool_cache_owner[i])
+                                continue;
 
-        for (i = 0; i < count; i++) {
-                list = pool + (i * (padded_sizeof_type));
-                INIT_LIST_HEAD (list);
-                list_add_tail (list, &mem_pool->list);
+                        mem_pool_cache_owner[i] = mem_pool;
+                        mem_pool->cache_id = i;
+                        mem_pool->cache_gen = ++mem_pool_cache_gen;
+                        break;
+                }
         }
+        pthread_mutex_unlock (&mem_pool_cache_lock);
+
+        if (mem_pool->cache_id == -1)
+                gf_log_callingfn ("mem-pool", GF_LOG_DEBUG,
+                                  "no per-thread cache for pool %s",
+                                  mem_pool->name);
 
-        mem_pool->pool = pool;
-        mem_pool->pool_end = pool + (count * (padded_sizeof_type));
+        /* the first slab is allocated upfront, like it always was */
+        slab = mem_pool_slab_new (mem_pool, mem_pool_thread_node ());
+        if (!slab) {
+                mem_pool_destroy (mem_pool);
+                return NULL;
+        }
+        __mem_pool_slab_add (mem_pool, slab);
 #endif
 
         /* add this pool to the global list */
@@ -373,191 +1097,336 @@ mem_get0 (struct mem_pool *mem_pool)
         return ptr;
 }
 
+
+/* Slow path of mem_get (), called with pool->lock held. */
+static void *
+__mem_pool_refill (struct mem_pool *pool, struct mem_pool_magazine *mag,
+                   int node)
+{
+        struct mem_pool_magazine *full = NULL;
+        struct mem_pool_thread_cache *cache = NULL;
+        void                     *ptr = NULL;
+        int                       i = 0;
+
+        pool->pool_misses++;
+
+        if (mag && !list_empty (&pool->depot_full)) {
+                full = list_entry (pool->depot_full.next,
+                                   struct mem_pool_magazine, list);
+                pool->depot_full_count--;
+
+                if (!pthread_equal (full->owner, pthread_self ()))
+                        pool->pool_steals++;
+
+                /* swap our empty magazine for the full one */
+                list_move (&full->list, &pool->magazines);
+                list_move (&mag->list, &pool->depot_empty);
+                full->hits = mag->hits;
+                full->owner = pthread_self ();
+                mag->hits = 0;
+
+                cache = pthread_getspecific (mem_pool_cache_key);
+                cache->mags[pool->cache_id] = full;
+
+                return full->chunks[--full->count];
+        }
+
+        ptr = __mem_pool_slab_get (pool, node);
+        if (!ptr || !mag)
+                return ptr;
+
+        /* load half a magazine, so that a thread alternating between
+           mem_get () and mem_put () does not bounce off the depot */
+        for (i = 0; i < GF_MEM_POOL_MAGAZINE_SIZE / 2; i++) {
+                mag->chunks[mag->count] = __mem_pool_slab_get (pool, node);
+                if (!mag->chunks[mag->count])
+                        break;
+                mag->count++;
+        }
+
+        return ptr;
+}
+
+
 void *
 mem_get (struct mem_pool *mem_pool)
 {
-        struct list_head *list = NULL;
-        void             *ptr = NULL;
-        int             *in_use = NULL;
-        struct mem_pool **pool_ptr = NULL;
+        struct mem_pool_magazine *mag = NULL;
+        struct mem_pool_slab     *slab = NULL;
+        struct mem_pool_slab    **slab_ptr = NULL;
+        void                     *ptr = NULL;
+        int                      *in_use = NULL;
+        int                       node = 0;
 
         if (!mem_pool) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return NULL;
         }
 
+        mag = mem_pool_magazine_get (mem_pool);
+        if (mag && mag->count) {
+                mag->hits++;
+                ptr = mag->chunks[--mag->count];
+                goto fwd_addr_out;
+        }
+
+        node = mem_pool_thread_node ();
+
         LOCK (&mem_pool->lock);
         {
-                mem_pool->alloc_count++;
-                if (mem_pool->cold_count) {
-                        list = mem_pool->list.next;
-                        list_del (list);
+                ptr = __mem_pool_refill (mem_pool, mag, node);
+        }
+        UNLOCK (&mem_pool->lock);
 
-                        mem_pool->hot_count++;
-                        mem_pool->cold_count--;
+        if (ptr)
+                goto fwd_addr_out;
 
-                        if (mem_pool->max_alloc < mem_pool->hot_count)
-                                mem_pool->max_alloc = mem_pool->hot_count;
+        /* all slabs are in use, add one */
+        slab = mem_pool_slab_new (mem_pool, node);
 
-                        ptr = list;
-                        in_use = (ptr + GF_MEM_POOL_LIST_BOUNDARY +
-                                  GF_MEM_POOL_PTR);
-                        *in_use = 1;
+        LOCK (&mem_pool->lock);
+        {
+                if (slab)
+                        __mem_pool_slab_add (mem_pool, slab);
 
-                        goto fwd_addr_out;
-                }
+                ptr = __mem_pool_slab_get (mem_pool, node);
+                if (ptr)
+                        goto unlock;
 
-                /* This is a problem area. If we've run out of
-                 * chunks in our slab above, we need to allocate
-                 * enough memory to service this request.
-                 * The problem is, these individual chunks will fail
-                 * the first address range check in __is_member. Now, since
-                 * we're not allocating a full second slab, we wont have
-                 * enough info perform the range check in __is_member.
-                 *
-                 * I am working around this by performing a regular allocation
-                 * , just the way the caller would've done when not using the
-                 * mem-pool. That also means, we're not padding the size with
-                 * the list_head structure because, this will not be added to
-                 * the list of chunks that belong to the mem-pool allocated
-                 * initially.
-                 *
-                 * This is the best we can do without adding functionality for
-                 * managing multiple slabs. That does not interest us at present
-                 * because it is too much work knowing that a better slab
-                 * allocator is coming RSN.
+                /* This is the slab allocation having failed (or DEBUG).
+                 * Hand out a chunk from the heap, it is returned to the
+                 * heap by mem_put ().
                  */
-                mem_pool->pool_misses++;
-                mem_pool->curr_stdalloc++;
-                if (mem_pool->max_stdalloc < mem_pool->curr_stdalloc)
-                        mem_pool->max_stdalloc = mem_pool->curr_stdalloc;
                 ptr = GF_CALLOC (1, mem_pool->padded_sizeof_type,
                                  gf_common_mt_mem_pool);
+                if (!ptr)
+                        goto unlock;
 
-                /* Memory coming from the heap need not be transformed from a
-                 * chunkhead to a usable pointer since it is not coming from
-                 * the pool.
-                 */
-        }
-fwd_addr_out:
-        pool_ptr = mem_pool_from_ptr (ptr);
-        *pool_ptr = (struct mem_pool *)mem_pool;
-        ptr = mem_pool_chunkhead2ptr (ptr);
-        UNLOCK (&mem_pool->lock);
-
-        return ptr;
-}
-
+                slab_ptr = mem_pool_slab_from_ptr (ptr);
+                *slab_ptr = &mem_pool->heap_slab;
 
-static int
-__is_member (struct mem_pool *pool, void *ptr)
-{
-        if (!pool || !ptr) {
-                gf_log_callingfn ("mem-pool", GF_LOG_ERROR, "invalid argument");
-                return -1;
+                mem_pool->curr_stdalloc++;
+                if (mem_pool->max_stdalloc < mem_pool->curr_stdalloc)
+                        mem_pool->max_stdalloc = mem_pool->curr_stdalloc;
         }
+unlock:
+        UNLOCK (&mem_pool->lock);
 
-        if (ptr < pool->pool || ptr >= pool->pool_end)
-                return 0;
+        if (!ptr)
+                return NULL;
 
-        if ((mem_pool_ptr2chunkhead (ptr) - pool->pool)
-            % pool->padded_sizeof_type)
-                return -1;
+fwd_addr_out:
+        in_use = mem_pool_in_use_from_ptr (ptr);
+        *in_use = 1;
 
-        return 1;
+        return mem_pool_chunkhead2ptr (ptr);
 }
 
 
 void
 mem_put (void *ptr)
 {
-        struct list_head *list = NULL;
-        int    *in_use = NULL;
-        void   *head = NULL;
-        struct mem_pool **tmp = NULL;
-        struct mem_pool *pool = NULL;
+        struct mem_pool_magazine *mag = NULL;
+        struct mem_pool_magazine *empty = NULL;
+        struct mem_pool_thread_cache *cache = NULL;
+        struct list_head          released;
+        struct mem_pool_slab    **tmp = NULL;
+        struct mem_pool_slab     *slab = NULL;
+        struct mem_pool          *pool = NULL;
+        int                      *in_use = NULL;
+        void                     *head = NULL;
 
         if (!ptr) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR, "invalid argument");
                 return;
         }
 
-        list = head = mem_pool_ptr2chunkhead (ptr);
-        tmp = mem_pool_from_ptr (head);
-        if (!tmp) {
+        head = mem_pool_ptr2chunkhead (ptr);
+        tmp = mem_pool_slab_from_ptr (head);
+        slab = *tmp;
+        if (!slab) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR,
                                   "ptr header is corrupted");
                 return;
         }
 
-        pool = *tmp;
+        pool = slab->pool;
         if (!pool) {
                 gf_log_callingfn ("mem-pool", GF_LOG_ERROR,
                                   "mem-pool ptr is NULL");
                 return;
         }
+
+        if (slab != &pool->heap_slab &&
+            (head < slab->base ||
+             (head - slab->base) % pool->padded_sizeof_type)) {
+                /* For some reason, the address given does not align
+                 * with the expected start of a chunk that includes
+                 * the list headers also. Sounds like a problem in
+                 * layers of clouds up above us. ;)
+                 */
+                abort ();
+        }
+
+        in_use = mem_pool_in_use_from_ptr (head);
+        if (!is_mem_chunk_in_use (in_use)) {
+                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
+                                  "mem_put called on freed ptr %p of mem "
+                                  "pool %p", ptr, pool);
+                return;
+        }
+        *in_use = 0;
+
+        mag = NULL;
+        if (slab != &pool->heap_slab)
+                mag = mem_pool_magazine_get (pool);
+
+        if (mag && mag->count < GF_MEM_POOL_MAGAZINE_SIZE) {
+                mag->chunks[mag->count++] = head;
+                return;
+        }
+
+        INIT_LIST_HEAD (&released);
+
         LOCK (&pool->lock);
         {
+                if (!mag) {
+                        __mem_pool_slab_put (pool, head, &released);
+                        goto unlock;
+                }
 
-                switch (__is_member (pool, ptr))
-                {
-                case 1:
-                        in_use = (head + GF_MEM_POOL_LIST_BOUNDARY +
-                                  GF_MEM_POOL_PTR);
-                        if (!is_mem_chunk_in_use(in_use)) {
-                                gf_log_callingfn ("mem-pool", GF_LOG_CRITICAL,
-                                                  "mem_put called on freed ptr %p of mem "
-                                                  "pool %p", ptr, pool);
-                                break;
-                        }
-                        pool->hot_count--;
-                        pool->cold_count++;
-                        *in_use = 0;
-                        list_add (list, &pool->list);
-                        break;
-                case -1:
-                        /* For some reason, the address given is within
-                         * the address range of the mem-pool but does not align
-                         * with the expected start of a chunk that includes
-                         * the list headers also. Sounds like a problem in
-                         * layers of clouds up above us. ;)
-                         */
-                        abort ();
-                        break;
-                case 0:
-                        /* The address is outside the range of the mem-pool. We
-                         * assume here that this address was allocated at a
-                         * point when the mem-pool was out of chunks in mem_get
-                         * or the programmer has made a mistake by calling the
-                         * wrong de-allocation interface. We do
-                         * not have enough info to distinguish between the two
-                         * situations.
-                         */
-                        pool->curr_stdalloc--;
-                        GF_FREE (list);
-                        break;
-                default:
-                        /* log error */
-                        break;
+                if (list_empty (&pool->depot_empty)) {
+                        /* no magazine to swap with, make room */
+                        __mem_pool_magazine_drain (pool, mag,
+                                        GF_MEM_POOL_MAGAZINE_SIZE / 2,
+                                        &released);
+                        mag->chunks[mag->count++] = head;
+                        goto unlock;
+                }
+
+                /* swap our full magazine for an empty one */
+                empty = list_entry (pool->depot_empty.next,
+                                    struct mem_pool_magazine, list);
+                list_move (&empty->list, &pool->magazines);
+                list_move_tail (&mag->list, &pool->depot_full);
+                pool->depot_full_count++;
+                empty->hits = mag->hits;
+                empty->owner = pthread_self ();
+                mag->hits = 0;
+
+                cache = pthread_getspecific (mem_pool_cache_key);
+                cache->mags[pool->cache_id] = empty;
+                empty->chunks[empty->count++] = head;
+
+                /* do not let the depot hoard chunks which could go back
+                   to the slabs */
+                if (pool->depot_full_count > GF_MEM_POOL_DEPOT_MAX) {
+                        mag = list_entry (pool->depot_full.next,
+                                          struct mem_pool_magazine, list);
+                        __mem_pool_magazine_drain (pool, mag,
+                                        GF_MEM_POOL_MAGAZINE_SIZE,
+                                        &released);
+                        list_move (&mag->list, &pool->depot_empty);
+                        pool->depot_full_count--;
+                }
+        }
+unlock:
+        UNLOCK (&pool->lock);
+
+        mem_pool_slabs_release (&released);
+}
+
+
+/* Folds the per-thread counters into the pool counters. The magazines
+ * of other threads are read without synchronisation, the result is an
+ * approximation which is good enough for statedumps.
+ */
+void
+mem_pool_refresh_stats (struct mem_pool *pool)
+{
+        struct mem_pool_magazine *mag = NULL;
+        uint64_t                  hits = 0;
+        int                       cached = 0;
+        int                       total = 0;
+
+        if (!pool)
+                return;
+
+        LOCK (&pool->lock);
+        {
+                list_for_each_entry (mag, &pool->magazines, list) {
+                        hits += mag->hits;
+                        cached += mag->count;
                 }
+                list_for_each_entry (mag, &pool->depot_full, list) {
+                        cached += mag->count;
+                }
+
+                total = pool->slab_count * pool->chunks_per_slab +
+                        pool->curr_stdalloc;
+
+                pool->cold_count = pool->slab_free_count + cached;
+                pool->hot_count = total - pool->cold_count;
+                pool->alloc_count = pool->pool_misses + pool->pool_hits +
+                                    hits;
         }
         UNLOCK (&pool->lock);
 }
 
+
 void
 mem_pool_destroy (struct mem_pool *pool)
 {
+        struct mem_pool_magazine *mag = NULL;
+        struct mem_pool_magazine *tmp = NULL;
+        struct mem_pool_slab     *slab = NULL;
+        struct mem_pool_slab     *stmp = NULL;
+
         if (!pool)
                 return;
 
+        mem_pool_refresh_stats (pool);
+
         gf_log (THIS->name, GF_LOG_INFO, "size=%lu max=%d total=%"PRIu64,
                 pool->padded_sizeof_type, pool->max_alloc, pool->alloc_count);
 
         list_del (&pool->global_list);
 
+        pthread_mutex_lock (&mem_pool_cache_lock);
+        {
+                if (pool->cache_id != -1)
+                        mem_pool_cache_owner[pool->cache_id] = NULL;
+
+                /* magazines loaded by threads are freed by their owners
+                   once they notice that the pool is gone */
+                LOCK (&pool->lock);
+                {
+                        list_for_each_entry_safe (mag, tmp, &pool->magazines,
+                                                  list) {
+                                list_del_init (&mag->list);
+                                mag->pool = NULL;
+                                mag->count = 0;
+                        }
+                }
+                UNLOCK (&pool->lock);
+        }
+        pthread_mutex_unlock (&mem_pool_cache_lock);
+
+        list_for_each_entry_safe (mag, tmp, &pool->depot_full, list) {
+                list_del (&mag->list);
+                FREE (mag);
+        }
+        list_for_each_entry_safe (mag, tmp, &pool->depot_empty, list) {
+                list_del (&mag->list);
+                FREE (mag);
+        }
+        list_for_each_entry_safe (slab, stmp, &pool->slabs, slab_list) {
+                list_del (&slab->slab_list);
+                mem_pool_slab_free (slab);
+        }
+
         LOCK_DESTROY (&pool->lock);
         GF_FREE (pool->name);
-        GF_FREE (pool->pool);
         GF_FREE (pool);
 
         return;
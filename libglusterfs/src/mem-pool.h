@@ -15,6 +15,7 @@
 #include "locking.h"
 #include "logging.h"
 #include "mem-types.h"
+#include <pthread.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
@@ -34,9 +35,27 @@
 #define GF_MEM_HEADER_MAGIC  0xCAFEBABE
 #define GF_MEM_TRAILER_MAGIC 0xBAADF00D
 
+/* Allocations and frees are counted in per-cpu shards, so that threads
+ * on different cpus never write the same cache line. The shards of a
+ * type are folded into its mem_acct_rec when the counters are read, and
+ * every GF_MEM_ACCT_FOLD_INTERVAL allocations on a shard so that the
+ * max_* watermarks follow the peaks between two statedumps. */
+#define GF_MEM_ACCT_MAX_SHARDS     16
+#define GF_MEM_ACCT_FOLD_INTERVAL  1024
+
+struct mem_acct_shard {
+        int64_t         size;           /* frees may land on other shards */
+        int64_t         num_allocs;
+        uint64_t        total_allocs;
+};
+
 struct mem_acct {
-        uint32_t            num_types;
+        uint32_t                 num_types;
+        uint32_t                 num_shards;
         struct mem_acct_rec     *rec;
+        /* num_shards rows of shard_stride entries, one per type */
+        struct mem_acct_shard   *shards;
+        uint32_t                 shard_stride;
 };
 
 struct mem_acct_rec {
@@ -46,9 +65,16 @@ struct mem_acct_rec {
         uint32_t        num_allocs;
         uint32_t        total_allocs;
         uint32_t        max_num_allocs;
-        gf_lock_t       lock;
+        gf_lock_t       lock;           /* serialises the folds */
 };
 
+/* Sampled allocation-site profiler: on average one allocation in rate
+ * records a hash of its backtrace, and the sites holding the most
+ * sampled memory are reported as leak suspects in the statedump. */
+#define GF_MEM_PROFILE_SITES       4096
+#define GF_MEM_PROFILE_DEPTH       8
+#define GF_MEM_PROFILE_TOP_K       20
+
 
 void *
 __gf_calloc (size_t cnt, size_t size, uint32_t type, const char *typestr);
@@ -176,17 +202,64 @@ out:
         return dup_mem;
 }
 
+/* Number of chunks a thread keeps cached per pool. */
+#define GF_MEM_POOL_MAGAZINE_SIZE       32
+/* Full magazines kept in a pool's depot before they are emptied back
+ * into the slabs, which is what allows idle slabs to be released. */
+#define GF_MEM_POOL_DEPOT_MAX           16
+/* Pools beyond this many do not get per-thread caches. */
+#define GF_MEM_POOL_MAX_CACHED          1024
+
+struct mem_pool;
+
+struct mem_pool_slab {
+        struct list_head  slab_list;    /* in pool->slabs */
+        struct list_head  partial_list; /* in pool->partial if nr_free */
+        struct list_head  free;         /* free chunks of this slab */
+        struct mem_pool  *pool;
+        void             *base;
+        int               nr_chunks;
+        int               nr_free;
+        int               node;         /* NUMA node of the allocator */
+};
+
+struct mem_pool_magazine {
+        struct list_head  list;         /* pool->magazines or a depot */
+        struct mem_pool  *pool;
+        uint64_t          cache_gen;
+        pthread_t         owner;        /* thread which filled it */
+        uint64_t          hits;
+        int               count;
+        void             *chunks[GF_MEM_POOL_MAGAZINE_SIZE];
+};
+
 struct mem_pool {
-        struct list_head  list;
-        int               hot_count;
-        int               cold_count;
         gf_lock_t         lock;
         unsigned long     padded_sizeof_type;
-        void             *pool;
-        void             *pool_end;
         int               real_sizeof_type;
+        int               chunks_per_slab;
+        struct list_head  slabs;
+        struct list_head  partial;
+        int               slab_count;
+        int               max_slab_count;
+        int               empty_slab_count;
+        uint64_t          slabs_freed;
+        int               slab_free_count;
+        /* chunks allocated from the heap when a slab could not be */
+        struct mem_pool_slab heap_slab;
+        struct list_head  magazines;    /* magazines loaded by threads */
+        struct list_head  depot_full;
+        struct list_head  depot_empty;
+        int               depot_full_count;
+        int               cache_id;     /* -1 if not cached per-thread */
+        uint64_t          cache_gen;
+        /* the counters below are refreshed by mem_pool_refresh_stats () */
+        int               hot_count;
+        int               cold_count;
         uint64_t          alloc_count;
+        uint64_t          pool_hits;
         uint64_t          pool_misses;
+        uint64_t          pool_steals;
         int               max_alloc;
         int               curr_stdalloc;
         int               max_stdalloc;
@@ -204,7 +277,14 @@ void *mem_get (struct mem_pool *pool);
 void *mem_get0 (struct mem_pool *pool);
 
 void mem_pool_destroy (struct mem_pool *pool);
+void mem_pool_refresh_stats (struct mem_pool *pool);
 
 void gf_mem_acct_enable_set (void *ctx);
 
+struct _xlator;
+void gf_mem_acct_fold (struct _xlator *xl, uint32_t type);
+
+int gf_mem_profile_set_rate (uint32_t rate);
+void gf_mem_profile_dump (void);
+
 #endif /* _MEM_POOL_H */
@@ -125,6 +125,12 @@ enum gf_common_mem_types_ {
 	gf_common_mt_strfd_t              = 109,
 	gf_common_mt_strfd_data_t         = 110,
         gf_common_mt_regex_t              = 111,
+        gf_common_mt_event_thread_data    = 112,
+        gf_common_mt_ereg                 = 113,
+        gf_common_mt_mem_pool_slab        = 114,
+        gf_common_mt_dict_members         = 115,
+        gf_common_mt_compound_args_t      = 116,
+        gf_common_mt_drc_buckets_t        = 117,
         gf_common_mt_end
 };
 #endif
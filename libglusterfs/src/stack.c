@@ -44,12 +44,8 @@ create_frame (xlator_t *xl, call_pool_t *pool)
         stack->frames.this = xl;
         stack->ctx = xl->ctx;
 
-        if (stack->ctx->measure_latency) {
-                if (gettimeofday (&stack->tv, NULL) == -1)
-                        gf_log ("stack", GF_LOG_ERROR, "gettimeofday () failed."
-                                " (%s)", strerror (errno));
-                memcpy (&stack->frames.begin, &stack->tv, sizeof (stack->tv));
-        }
+        if (stack->ctx->measure_latency && gf_latency_sample (stack->ctx))
+                timespec_now (&stack->frames.begin);
 
         LOCK (&pool->lock);
         {
@@ -73,6 +69,7 @@ gf_proc_dump_call_frame (call_frame_t *call_frame, const char *key_buf,...)
         call_frame_t my_frame;
         int  ret = -1;
         char timestr[256] = {0,};
+        struct timeval tv = {0,};
 
         if (!call_frame)
                 return;
@@ -92,12 +89,13 @@ gf_proc_dump_call_frame (call_frame_t *call_frame, const char *key_buf,...)
         memcpy(&my_frame, call_frame, sizeof(my_frame));
         UNLOCK(&call_frame->lock);
 
-        if (my_frame.this->ctx->measure_latency) {
-                gf_time_fmt (timestr, sizeof timestr, my_frame.begin.tv_sec,
+        if (my_frame.begin.tv_sec) {
+                timespec_to_wallclock (&my_frame.begin, &tv);
+                gf_time_fmt (timestr, sizeof timestr, tv.tv_sec,
                              gf_timefmt_FT);
                 snprintf (timestr + strlen (timestr),
                           sizeof timestr - strlen (timestr),
-                          ".%"GF_PRI_SUSECONDS, my_frame.begin.tv_usec);
+                          ".%"GF_PRI_SUSECONDS, tv.tv_usec);
                 gf_proc_dump_write("frame-creation-time", "%s", timestr);
         }
 
@@ -138,6 +136,7 @@ gf_proc_dump_call_stack (call_stack_t *call_stack, const char *key_buf,...)
         call_frame_t *trav;
         int32_t cnt, i;
         char timestr[256] = {0,};
+        struct timeval tv = {0,};
 
         if (!call_stack)
                 return;
@@ -151,12 +150,13 @@ gf_proc_dump_call_stack (call_stack_t *call_stack, const char *key_buf,...)
         vsnprintf(prefix, GF_DUMP_MAX_BUF_LEN, key_buf, ap);
         va_end(ap);
 
-        if (call_stack->ctx->measure_latency) {
-                gf_time_fmt (timestr, sizeof timestr, call_stack->tv.tv_sec,
+        if (call_stack->frames.begin.tv_sec) {
+                timespec_to_wallclock (&call_stack->frames.begin, &tv);
+                gf_time_fmt (timestr, sizeof timestr, tv.tv_sec,
                              gf_timefmt_FT);
                 snprintf (timestr + strlen (timestr),
                           sizeof timestr - strlen (timestr),
-                          ".%"GF_PRI_SUSECONDS, call_stack->tv.tv_usec);
+                          ".%"GF_PRI_SUSECONDS, tv.tv_usec);
         gf_proc_dump_write("callstack-creation-time", "%s", timestr);
         }
 
@@ -37,6 +37,7 @@ typedef struct call_pool call_pool_t;
 #include "globals.h"
 #include "lkowner.h"
 #include "client_t.h"
+#include "timespec.h"
 
 #define NFS_PID 1
 #define LOW_PRIO_PROC_PID -1
@@ -75,8 +76,9 @@ struct _call_frame_t {
         gf_boolean_t  complete;
 
         glusterfs_fop_t op;
-        struct timeval begin;      /* when this frame was created */
-        struct timeval end;        /* when this frame completed */
+        struct timespec begin;     /* when this frame was created, on the
+                                      monotonic clock, zero if not timed */
+        struct timespec end;       /* when this frame completed */
         const char      *wind_from;
         const char      *wind_to;
         const char      *unwind_from;
@@ -112,7 +114,6 @@ struct _call_stack_t {
 
         int32_t                       op;
         int8_t                        type;
-        struct timeval                tv;
 };
 
 
@@ -134,6 +135,9 @@ gf_latency_begin (call_frame_t *frame, void *fn);
 void
 gf_latency_end (call_frame_t *frame);
 
+int
+gf_latency_sample (glusterfs_ctx_t *ctx);
+
 static inline void
 FRAME_DESTROY (call_frame_t *frame)
 {
@@ -433,13 +437,9 @@ copy_frame (call_frame_t *frame)
         newstack->lk_owner = oldstack->lk_owner;
         newstack->ctx = oldstack->ctx;
 
-        if (newstack->ctx->measure_latency) {
-                if (gettimeofday (&newstack->tv, NULL) == -1)
-                        gf_log ("stack", GF_LOG_ERROR, "gettimeofday () failed."
-                                " (%s)", strerror (errno));
-                memcpy (&newstack->frames.begin, &newstack->tv,
-                        sizeof (newstack->tv));
-        }
+        if (newstack->ctx->measure_latency &&
+            gf_latency_sample (newstack->ctx))
+                timespec_now (&newstack->frames.begin);
 
         LOCK_INIT (&newstack->frames.lock);
         LOCK_INIT (&newstack->stack_lock);
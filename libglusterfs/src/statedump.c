@@ -219,8 +219,8 @@ gf_proc_dump_write (char *key, char *value, ...)
 static void
 gf_proc_dump_xlator_mem_info (xlator_t *xl)
 {
-        int     i = 0;
-        struct mem_acct rec = {0,};
+        int                  i = 0;
+        struct mem_acct_rec *rec = NULL;
 
         if (!xl)
                 return;
@@ -232,22 +232,20 @@ gf_proc_dump_xlator_mem_info (xlator_t *xl)
         gf_proc_dump_write ("num_types", "%d", xl->mem_acct.num_types);
 
         for (i = 0; i < xl->mem_acct.num_types; i++) {
-                if (!(memcmp (&xl->mem_acct.rec[i], &rec,
-                              sizeof (struct mem_acct))))
+                gf_mem_acct_fold (xl, i);
+
+                rec = &xl->mem_acct.rec[i];
+                if (!rec->total_allocs)
                         continue;
 
                 gf_proc_dump_add_section ("%s.%s - usage-type %s memusage",
-                                          xl->type, xl->name,
-                                          xl->mem_acct.rec[i].typestr);
-                gf_proc_dump_write ("size", "%u", xl->mem_acct.rec[i].size);
-                gf_proc_dump_write ("num_allocs", "%u",
-                                    xl->mem_acct.rec[i].num_allocs);
-                gf_proc_dump_write ("max_size", "%u",
-                                    xl->mem_acct.rec[i].max_size);
+                                          xl->type, xl->name, rec->typestr);
+                gf_proc_dump_write ("size", "%u", rec->size);
+                gf_proc_dump_write ("num_allocs", "%u", rec->num_allocs);
+                gf_proc_dump_write ("max_size", "%u", rec->max_size);
                 gf_proc_dump_write ("max_num_allocs", "%u",
-                                    xl->mem_acct.rec[i].max_num_allocs);
-                gf_proc_dump_write ("total_allocs", "%u",
-                                    xl->mem_acct.rec[i].total_allocs);
+                                    rec->max_num_allocs);
+                gf_proc_dump_write ("total_allocs", "%u", rec->total_allocs);
         }
 
         return;
@@ -256,7 +254,8 @@ gf_proc_dump_xlator_mem_info (xlator_t *xl)
 static void
 gf_proc_dump_xlator_mem_info_only_in_use (xlator_t *xl)
 {
-        int     i = 0;
+        int                  i = 0;
+        struct mem_acct_rec *rec = NULL;
 
         if (!xl)
                 return;
@@ -268,22 +267,21 @@ gf_proc_dump_xlator_mem_info_only_in_use (xlator_t *xl)
         gf_proc_dump_write ("num_types", "%d", xl->mem_acct.num_types);
 
         for (i = 0; i < xl->mem_acct.num_types; i++) {
-                if (!xl->mem_acct.rec[i].size)
+                gf_mem_acct_fold (xl, i);
+
+                rec = &xl->mem_acct.rec[i];
+                if (!rec->size)
                         continue;
 
                 gf_proc_dump_add_section ("%s.%s - usage-type %d", xl->type,
                                           xl->name,i);
 
-                gf_proc_dump_write ("size", "%u",
-                                    xl->mem_acct.rec[i].size);
-                gf_proc_dump_write ("max_size", "%u",
-                                    xl->mem_acct.rec[i].max_size);
-                gf_proc_dump_write ("num_allocs", "%u",
-                                    xl->mem_acct.rec[i].num_allocs);
+                gf_proc_dump_write ("size", "%u", rec->size);
+                gf_proc_dump_write ("max_size", "%u", rec->max_size);
+                gf_proc_dump_write ("num_allocs", "%u", rec->num_allocs);
                 gf_proc_dump_write ("max_num_allocs", "%u",
-                                    xl->mem_acct.rec[i].max_num_allocs);
-                gf_proc_dump_write ("total_allocs", "%u",
-                                    xl->mem_acct.rec[i].total_allocs);
+                                    rec->max_num_allocs);
+                gf_proc_dump_write ("total_allocs", "%u", rec->total_allocs);
         }
 
         return;
@@ -315,6 +313,7 @@ gf_proc_dump_mem_info ()
 #endif
         gf_proc_dump_xlator_mem_info(&global_xlator);
 
+        gf_mem_profile_dump ();
 }
 
 void
@@ -380,6 +379,8 @@ gf_proc_dump_mempool_info (glusterfs_ctx_t *ctx)
         gf_proc_dump_add_section ("mempool");
 
         list_for_each_entry (pool, &ctx->mempool_list, global_list) {
+                mem_pool_refresh_stats (pool);
+
                 gf_proc_dump_write ("-----", "-----");
                 gf_proc_dump_write ("pool-name", "%s", pool->name);
                 gf_proc_dump_write ("hot-count", "%d", pool->hot_count);
@@ -392,6 +393,16 @@ gf_proc_dump_mempool_info (glusterfs_ctx_t *ctx)
                 gf_proc_dump_write ("pool-misses", "%"PRIu64, pool->pool_misses);
                 gf_proc_dump_write ("cur-stdalloc", "%d", pool->curr_stdalloc);
                 gf_proc_dump_write ("max-stdalloc", "%d", pool->max_stdalloc);
+
+                gf_proc_dump_write ("pool-hits", "%"PRIu64,
+                                    pool->alloc_count - pool->pool_misses);
+                gf_proc_dump_write ("pool-steals", "%"PRIu64,
+                                    pool->pool_steals);
+                gf_proc_dump_write ("slab-count", "%d", pool->slab_count);
+                gf_proc_dump_write ("max-slab-count", "%d",
+                                    pool->max_slab_count);
+                gf_proc_dump_write ("slabs-freed", "%"PRIu64,
+                                    pool->slabs_freed);
         }
 }
 
@@ -407,6 +418,8 @@ gf_proc_dump_mempool_info_to_dict (glusterfs_ctx_t *ctx, dict_t *dict)
                 return;
 
         list_for_each_entry (pool, &ctx->mempool_list, global_list) {
+                mem_pool_refresh_stats (pool);
+
                 memset (key, 0, sizeof (key));
                 snprintf (key, sizeof (key), "pool%d.name", count);
                 ret = dict_set_str (dict, key, pool->name);
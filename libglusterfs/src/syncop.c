@@ -15,6 +15,8 @@
 
 #include "syncop.h"
 
+#include <sys/mman.h>
+
 int
 syncopctx_setfsuid (void *uid)
 {
@@ -281,22 +283,223 @@ __wait (struct synctask *task)
 }
 
 
-void
-synctask_yield (struct synctask *task)
+/*
+ * Task stacks are mapped with a guard page below them, so that an
+ * overflow faults instead of running into the neighbouring memory, and
+ * kept on a per syncenv free list when their task is done: most tasks
+ * are short and the next one starts on a stack that is already mapped
+ * and faulted in. The list entry lives at the bottom of the free stack.
+ */
+static void *
+synctask_stack_get (struct syncenv *env)
+{
+        struct list_head *free_stack = NULL;
+        char             *base = NULL;
+
+        pthread_mutex_lock (&env->stack_lock);
+        {
+                if (!list_empty (&env->stacks)) {
+                        free_stack = env->stacks.next;
+                        list_del (free_stack);
+                        env->stack_count--;
+                }
+        }
+        pthread_mutex_unlock (&env->stack_lock);
+
+        if (free_stack)
+                return free_stack;
+
+        base = mmap (NULL, env->guardsize + env->stacksize,
+                     PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS |
+                     MAP_NORESERVE, -1, 0);
+        if (base == MAP_FAILED)
+                return NULL;
+
+        if (mprotect (base, env->guardsize, PROT_NONE) != 0) {
+                gf_log ("syncop", GF_LOG_WARNING,
+                        "cannot protect the guard page of a stack (%s)",
+                        strerror (errno));
+        }
+
+        return base + env->guardsize;
+}
+
+
+static void
+synctask_stack_put (struct syncenv *env, void *stack)
 {
-        xlator_t *oldTHIS = THIS;
+        if (!stack)
+                return;
 
+        pthread_mutex_lock (&env->stack_lock);
+        {
+                if (env->stack_count < env->stack_max) {
+                        list_add (stack, &env->stacks);
+                        env->stack_count++;
+                        stack = NULL;
+                }
+        }
+        pthread_mutex_unlock (&env->stack_lock);
+
+        if (stack)
+                munmap ((char *)stack - env->guardsize,
+                        env->guardsize + env->stacksize);
+}
+
+
+#ifdef GF_SYNCTASK_FAST_SWITCH
+/*
+ * synctask_ctx_switch (&save_sp, sp) pushes the registers the callee has
+ * to preserve, with the SSE and x87 control words, stores the stack
+ * pointer in save_sp, and pops the same from the stack at sp. A new
+ * task starts in synctask_ctx_start, which calls r13 with r12 as the
+ * argument; see synctask_ctx_make ().
+ */
+void synctask_ctx_switch (void **save_sp, void *sp);
+void synctask_ctx_start (void);
+
+__asm__ (
+        ".text\n"
+        ".p2align 4\n"
+        ".globl synctask_ctx_switch\n"
+        ".hidden synctask_ctx_switch\n"
+        ".type synctask_ctx_switch, @function\n"
+        "synctask_ctx_switch:\n"
+        "        pushq %rbp\n"
+        "        pushq %rbx\n"
+        "        pushq %r12\n"
+        "        pushq %r13\n"
+        "        pushq %r14\n"
+        "        pushq %r15\n"
+        "        subq $8, %rsp\n"
+        "        stmxcsr (%rsp)\n"
+        "        fnstcw 4(%rsp)\n"
+        "        movq %rsp, (%rdi)\n"
+        "        movq %rsi, %rsp\n"
+        "        ldmxcsr (%rsp)\n"
+        "        fldcw 4(%rsp)\n"
+        "        addq $8, %rsp\n"
+        "        popq %r15\n"
+        "        popq %r14\n"
+        "        popq %r13\n"
+        "        popq %r12\n"
+        "        popq %rbx\n"
+        "        popq %rbp\n"
+        "        ret\n"
+        ".size synctask_ctx_switch, .-synctask_ctx_switch\n"
+        ".p2align 4\n"
+        ".globl synctask_ctx_start\n"
+        ".hidden synctask_ctx_start\n"
+        ".type synctask_ctx_start, @function\n"
+        "synctask_ctx_start:\n"
+        "        movq %r12, %rdi\n"
+        "        callq *%r13\n"
+        "        ud2\n"
+        ".size synctask_ctx_start, .-synctask_ctx_start\n"
+);
+
+
+/* Lays out the stack of a new task as synctask_ctx_switch () leaves it,
+   to return into synctask_ctx_start with the stack pointer aligned as
+   at a call. */
+static int
+synctask_ctx_make (struct synctask *task, void (*fn) (struct synctask *))
+{
+        uintptr_t *sp = NULL;
+
+        sp = (uintptr_t *)(((uintptr_t)task->stack + task->env->stacksize) &
+                           ~(uintptr_t)15);
+
+        *--sp = (uintptr_t) synctask_ctx_start;
+        *--sp = 0;                      /* rbp */
+        *--sp = 0;                      /* rbx */
+        *--sp = (uintptr_t) task;       /* r12 */
+        *--sp = (uintptr_t) fn;         /* r13 */
+        *--sp = 0;                      /* r14 */
+        *--sp = 0;                      /* r15 */
+        *--sp = 0x037f00001f80ULL;      /* default fpu control, mxcsr */
+
+        task->sp = sp;
+
+        return 0;
+}
+
+
+static void
+synctask_ctx_leave (struct synctask *task)
+{
+        synctask_ctx_switch (&task->sp, task->proc->sched_sp);
+}
+
+
+static void
+synctask_ctx_enter (struct synctask *task)
+{
+        synctask_ctx_switch (&task->proc->sched_sp, task->sp);
+}
+
+#else /* !GF_SYNCTASK_FAST_SWITCH */
+
+static int
+synctask_ctx_make (struct synctask *task, void (*fn) (struct synctask *))
+{
+        if (getcontext (&task->ctx) < 0) {
+                gf_log ("syncop", GF_LOG_ERROR,
+                        "getcontext failed (%s)",
+                        strerror (errno));
+                return -1;
+        }
+
+        task->ctx.uc_stack.ss_sp   = task->stack;
+        task->ctx.uc_stack.ss_size = task->env->stacksize;
+
+        makecontext (&task->ctx, (void (*)(void)) fn, 2, task);
+
+        return 0;
+}
+
+
+static void
+synctask_ctx_leave (struct synctask *task)
+{
 #if defined(__NetBSD__) && defined(_UC_TLSBASE)
         /* Preserve pthread private pointer through swapcontex() */
         task->proc->sched.uc_flags &= ~_UC_TLSBASE;
 #endif
 
-        if (task->state != SYNCTASK_DONE)
-                task->state = SYNCTASK_SUSPEND;
         if (swapcontext (&task->ctx, &task->proc->sched) < 0) {
                 gf_log ("syncop", GF_LOG_ERROR,
                         "swapcontext failed (%s)", strerror (errno));
         }
+}
+
+
+static void
+synctask_ctx_enter (struct synctask *task)
+{
+#if defined(__NetBSD__) && defined(_UC_TLSBASE)
+        /* Preserve pthread private pointer through swapcontex() */
+        task->ctx.uc_flags &= ~_UC_TLSBASE;
+#endif
+
+        if (swapcontext (&task->proc->sched, &task->ctx) < 0) {
+                gf_log ("syncop", GF_LOG_ERROR,
+                        "swapcontext failed (%s)", strerror (errno));
+        }
+}
+
+#endif /* !GF_SYNCTASK_FAST_SWITCH */
+
+
+void
+synctask_yield (struct synctask *task)
+{
+        xlator_t *oldTHIS = THIS;
+
+        if (task->state != SYNCTASK_DONE)
+                task->state = SYNCTASK_SUSPEND;
+
+        synctask_ctx_leave (task);
 
         THIS = oldTHIS;
 }
@@ -313,10 +516,12 @@ synctask_wake (struct synctask *task)
         {
                 task->woken = 1;
 
-                if (task->slept)
+                /* one processor is enough to run it; waking them all for
+                   every task made thousands of waiting tasks expensive */
+                if (task->slept) {
                         __run (task);
-
-		pthread_cond_broadcast (&env->cond);
+                        pthread_cond_signal (&env->cond);
+                }
         }
         pthread_mutex_unlock (&env->mutex);
 }
@@ -346,7 +551,7 @@ synctask_destroy (struct synctask *task)
         if (!task)
                 return;
 
-        FREE (task->stack);
+        synctask_stack_put (task->env, task->stack);
 
         if (task->opframe)
                 STACK_DESTROY (task->opframe->root);
@@ -429,24 +634,15 @@ synctask_create (struct syncenv *env, synctask_fn_t fn, synctask_cbk_t cbk,
         INIT_LIST_HEAD (&newtask->all_tasks);
         INIT_LIST_HEAD (&newtask->waitq);
 
-        if (getcontext (&newtask->ctx) < 0) {
-                gf_log ("syncop", GF_LOG_ERROR,
-                        "getcontext failed (%s)",
-                        strerror (errno));
-                goto err;
-        }
-
-        newtask->stack = CALLOC (1, env->stacksize);
+        newtask->stack = synctask_stack_get (env);
         if (!newtask->stack) {
                 gf_log ("syncop", GF_LOG_ERROR,
                         "out of memory for stack");
                 goto err;
         }
 
-        newtask->ctx.uc_stack.ss_sp   = newtask->stack;
-        newtask->ctx.uc_stack.ss_size = env->stacksize;
-
-        makecontext (&newtask->ctx, (void (*)(void)) synctask_wrap, 2, newtask);
+        if (synctask_ctx_make (newtask, synctask_wrap) != 0)
+                goto err;
 
         newtask->state = SYNCTASK_INIT;
 
@@ -468,7 +664,7 @@ synctask_create (struct syncenv *env, synctask_fn_t fn, synctask_cbk_t cbk,
 	return newtask;
 err:
         if (newtask) {
-                FREE (newtask->stack);
+                synctask_stack_put (env, newtask->stack);
                 if (newtask->opframe)
                         STACK_DESTROY (newtask->opframe->root);
                 FREE (newtask);
@@ -570,15 +766,7 @@ synctask_switchto (struct synctask *task)
         synctask_set (task);
         THIS = task->xl;
 
-#if defined(__NetBSD__) && defined(_UC_TLSBASE)
-        /* Preserve pthread private pointer through swapcontex() */
-        task->ctx.uc_flags &= ~_UC_TLSBASE;
-#endif
-
-        if (swapcontext (&task->proc->sched, &task->ctx) < 0) {
-                gf_log ("syncop", GF_LOG_ERROR,
-                        "swapcontext failed (%s)", strerror (errno));
-        }
+        synctask_ctx_enter (task);
 
         if (task->state == SYNCTASK_DONE) {
                 synctask_done (task);
@@ -660,10 +848,28 @@ unlock:
 }
 
 
+/* Unmaps the stacks kept for reuse; a task that finishes later unmaps
+   its own. The processors are not stopped here. */
 void
 syncenv_destroy (struct syncenv *env)
 {
+        struct list_head *stack = NULL;
+
+        if (!env)
+                return;
 
+        pthread_mutex_lock (&env->stack_lock);
+        {
+                env->stack_max = 0;
+                while (!list_empty (&env->stacks)) {
+                        stack = env->stacks.next;
+                        list_del (stack);
+                        munmap ((char *)stack - env->guardsize,
+                                env->guardsize + env->stacksize);
+                }
+                env->stack_count = 0;
+        }
+        pthread_mutex_unlock (&env->stack_lock);
 }
 
 
@@ -693,9 +899,16 @@ syncenv_new (size_t stacksize, int procmin, int procmax)
         INIT_LIST_HEAD (&newenv->runq);
         INIT_LIST_HEAD (&newenv->waitq);
 
+        pthread_mutex_init (&newenv->stack_lock, NULL);
+        INIT_LIST_HEAD (&newenv->stacks);
+        newenv->stack_max = SYNCENV_STACK_POOL_MAX;
+
         newenv->stacksize    = SYNCENV_DEFAULT_STACKSIZE;
         if (stacksize)
-                newenv->stacksize = stacksize;
+                newenv->stacksize = max (stacksize, SYNCENV_MIN_STACKSIZE);
+        newenv->guardsize = sysconf (_SC_PAGESIZE);
+        newenv->stacksize = (newenv->stacksize + newenv->guardsize - 1) &
+                            ~(newenv->guardsize - 1);
 	newenv->procmin = procmin;
 	newenv->procmax = procmax;
 
@@ -25,6 +25,19 @@
 #define SYNCENV_PROC_MIN 2
 #define SYNCPROC_IDLE_TIME 600
 
+/* Stacks of finished tasks kept for the next ones, per syncenv */
+#define SYNCENV_STACK_POOL_MAX 64
+#define SYNCENV_MIN_STACKSIZE (16 * 1024)
+
+/*
+ * On x86_64 ELF targets synctasks switch with a plain swap of the
+ * callee-saved registers instead of swapcontext (), which also saves
+ * and restores the signal mask with a system call on every switch.
+ */
+#if defined(__x86_64__) && defined(__ELF__)
+#define GF_SYNCTASK_FAST_SWITCH 1
+#endif
+
 /*
  * Flags for syncopctx valid elements
  */
@@ -71,7 +84,11 @@ struct synctask {
         uid_t               uid;
         gid_t               gid;
 
+#ifdef GF_SYNCTASK_FAST_SWITCH
+        void               *sp;  /* saved stack pointer while switched out */
+#else
         ucontext_t          ctx;
+#endif
         struct syncproc    *proc;
 
         pthread_mutex_t     mutex; /* for synchronous spawning of synctask */
@@ -84,7 +101,11 @@ struct synctask {
 
 struct syncproc {
         pthread_t           processor;
+#ifdef GF_SYNCTASK_FAST_SWITCH
+        void               *sched_sp;
+#else
         ucontext_t          sched;
+#endif
         struct syncenv     *env;
         struct synctask    *current;
 };
@@ -105,7 +126,13 @@ struct syncenv {
         pthread_mutex_t     mutex;
         pthread_cond_t      cond;
 
-        size_t              stacksize;
+        size_t              stacksize;   /* usable, without the guard page */
+        size_t              guardsize;
+
+        pthread_mutex_t     stack_lock;
+        struct list_head    stacks;      /* free stacks, for reuse */
+        int                 stack_count;
+        int                 stack_max;   /* 0 once the env is destroyed */
 };
 
 
@@ -19,16 +19,152 @@
 #include "globals.h"
 #include "timespec.h"
 
+#define GF_TIMER_SLOT_MASK      (GF_TIMER_SLOTS - 1)
+#define GF_TIMER_TICK_NS        (GF_TIMER_TICK_MS * 1000000ULL)
+#define GF_TIMER_RANGE          (1ULL << (GF_TIMER_SLOT_BITS * GF_TIMER_LEVELS))
+
+static struct _gf_timer_wheel *
+gf_timer_wheel_of_thread (gf_timer_registry_t *reg)
+{
+        uint64_t id = (uint64_t)(unsigned long) pthread_self ();
+
+        return &reg->wheels[((id * 0x9E3779B97F4A7C15ULL) >> 32) %
+                            GF_TIMER_WHEELS];
+}
+
+
+static void
+__gf_timer_wheel_add (struct _gf_timer_wheel *wheel, gf_timer_t *event)
+{
+        uint64_t expires = 0;
+        uint64_t delta = 0;
+        int      level = 0;
+        int      idx = 0;
+
+        expires = event->expires;
+        if (expires < wheel->now)
+                expires = wheel->now;
+
+        delta = expires - wheel->now;
+        if (delta >= GF_TIMER_RANGE) {
+                /* beyond the reach of the wheels, parked in the last
+                   level until its slot comes up again */
+                delta = GF_TIMER_RANGE - 1;
+                expires = wheel->now + delta;
+        }
+
+        for (level = 0; level < GF_TIMER_LEVELS - 1; level++) {
+                if (delta < (1ULL << (GF_TIMER_SLOT_BITS * (level + 1))))
+                        break;
+        }
+
+        idx = (expires >> (GF_TIMER_SLOT_BITS * level)) & GF_TIMER_SLOT_MASK;
+        list_add_tail (&event->list, &wheel->slots[level][idx]);
+}
+
+
+static int
+__gf_timer_wheel_cascade (struct _gf_timer_wheel *wheel, int level)
+{
+        struct list_head  head;
+        gf_timer_t       *event = NULL;
+        gf_timer_t       *tmp = NULL;
+        int               idx = 0;
+
+        idx = (wheel->now >> (GF_TIMER_SLOT_BITS * level)) &
+                GF_TIMER_SLOT_MASK;
+
+        INIT_LIST_HEAD (&head);
+        list_splice_init (&wheel->slots[level][idx], &head);
+
+        list_for_each_entry_safe (event, tmp, &head, list) {
+                list_del_init (&event->list);
+                __gf_timer_wheel_add (wheel, event);
+        }
+
+        return idx;
+}
+
+
+/* Expires every timer of @wheel due at or before tick @now and moves them
+   to the registry queue. Called with the wheel lock held. */
+static void
+__gf_timer_wheel_advance (gf_timer_registry_t *reg,
+                          struct _gf_timer_wheel *wheel, uint64_t now)
+{
+        struct list_head  fired;
+        gf_timer_t       *event = NULL;
+        int               level = 0;
+        int               idx = 0;
+
+        INIT_LIST_HEAD (&fired);
+
+        while (wheel->now <= now) {
+                if (!wheel->count) {
+                        wheel->now = now + 1;
+                        break;
+                }
+
+                idx = wheel->now & GF_TIMER_SLOT_MASK;
+                if (idx == 0) {
+                        for (level = 1; level < GF_TIMER_LEVELS; level++) {
+                                if (__gf_timer_wheel_cascade (wheel, level))
+                                        break;
+                        }
+                }
+
+                list_for_each_entry (event, &wheel->slots[0][idx], list) {
+                        event->state = GF_TIMER_QUEUED;
+                        wheel->count--;
+                }
+                list_append_init (&wheel->slots[0][idx], &fired);
+
+                wheel->now++;
+        }
+
+        if (list_empty (&fired))
+                return;
+
+        pthread_mutex_lock (&reg->lock);
+        {
+                list_append_init (&fired, &reg->expired);
+        }
+        pthread_mutex_unlock (&reg->lock);
+}
+
+
+/* Earliest tick at which @wheel needs to be looked at again: the first
+   busy level 0 slot, or the next cascade. */
+static uint64_t
+__gf_timer_wheel_next (struct _gf_timer_wheel *wheel)
+{
+        uint64_t tick = 0;
+
+        if (!wheel->count)
+                return UINT64_MAX;
+
+        /* the cascade into this rotation has not been done yet */
+        if ((wheel->now & GF_TIMER_SLOT_MASK) == 0)
+                return wheel->now;
+
+        for (tick = wheel->now; ; tick++) {
+                if (!list_empty (&wheel->slots[0][tick & GF_TIMER_SLOT_MASK]))
+                        return tick;
+                if ((tick & GF_TIMER_SLOT_MASK) == GF_TIMER_SLOT_MASK)
+                        return tick + 1;
+        }
+}
+
+
 gf_timer_t *
 gf_timer_call_after (glusterfs_ctx_t *ctx,
                      struct timespec delta,
                      gf_timer_cbk_t callbk,
                      void *data)
 {
-        gf_timer_registry_t *reg = NULL;
-        gf_timer_t *event = NULL;
-        gf_timer_t *trav = NULL;
-        uint64_t at = 0;
+        gf_timer_registry_t    *reg = NULL;
+        struct _gf_timer_wheel *wheel = NULL;
+        gf_timer_t             *event = NULL;
 
         if (ctx == NULL)
         {
@@ -49,82 +185,224 @@ gf_timer_call_after (glusterfs_ctx_t *ctx,
         }
         timespec_now (&event->at);
         timespec_adjust_delta (&event->at, delta);
-        at = TS (event->at);
+        event->expires = (TS (event->at) + GF_TIMER_TICK_NS - 1) /
+                GF_TIMER_TICK_NS;
         event->callbk = callbk;
         event->data = data;
         event->xl = THIS;
+        event->state = GF_TIMER_ARMED;
+        INIT_LIST_HEAD (&event->list);
+
+        wheel = gf_timer_wheel_of_thread (reg);
+        event->wheel = wheel;
+
+        pthread_mutex_lock (&wheel->lock);
+        {
+                __gf_timer_wheel_add (wheel, event);
+                wheel->count++;
+        }
+        pthread_mutex_unlock (&wheel->lock);
+
         pthread_mutex_lock (&reg->lock);
         {
-                trav = reg->active.prev;
-                while (trav != &reg->active) {
-                        if (TS (trav->at) < at)
-                                break;
-                        trav = trav->prev;
+                if (reg->scanning) {
+                        reg->rescan = 1;
+                } else if (event->expires < reg->next_wake) {
+                        reg->next_wake = event->expires;
+                        pthread_cond_signal (&reg->cond);
                 }
-                event->prev = trav;
-                event->next = event->prev->next;
-                event->prev->next = event;
-                event->next->prev = event;
         }
         pthread_mutex_unlock (&reg->lock);
+
         return event;
 }
 
 int32_t
-gf_timer_call_stale (gf_timer_registry_t *reg,
-                     gf_timer_t *event)
+gf_timer_call_cancel (glusterfs_ctx_t *ctx,
+                      gf_timer_t *event)
 {
-        if (reg == NULL || event == NULL)
+        gf_timer_registry_t    *reg = NULL;
+        struct _gf_timer_wheel *wheel = NULL;
+
+        if (ctx == NULL || event == NULL)
         {
                 gf_log_callingfn ("timer", GF_LOG_ERROR, "invalid argument");
                 return 0;
         }
 
-        event->next->prev = event->prev;
-        event->prev->next = event->next;
-        event->next = &reg->stale;
-        event->prev = event->next->prev;
-        event->next->prev = event;
-        event->prev->next = event;
+        reg = gf_timer_registry_init (ctx);
+        if (!reg) {
+                gf_log ("timer", GF_LOG_ERROR, "!reg");
+                GF_FREE (event);
+                return 0;
+        }
+
+        wheel = event->wheel;
+
+        pthread_mutex_lock (&wheel->lock);
+        {
+                if (event->state == GF_TIMER_ARMED) {
+                        list_del_init (&event->list);
+                        wheel->count--;
+                } else {
+                        pthread_mutex_lock (&reg->lock);
+                        {
+                                if (event->state == GF_TIMER_QUEUED)
+                                        list_del_init (&event->list);
+                        }
+                        pthread_mutex_unlock (&reg->lock);
+                }
+        }
+        pthread_mutex_unlock (&wheel->lock);
 
+        GF_FREE (event);
         return 0;
 }
 
-int32_t
-gf_timer_call_cancel (glusterfs_ctx_t *ctx,
-                      gf_timer_t *event)
+
+/* Runs the callback of the first queued timer, returns 0 if there was
+   none. The event stays allocated until its owner cancels it. */
+static int
+gf_timer_dispatch (gf_timer_registry_t *reg)
 {
-        gf_timer_registry_t *reg = NULL;
+        gf_timer_t     *event = NULL;
+        gf_timer_cbk_t  callbk = NULL;
+        void           *data = NULL;
+        xlator_t       *xl = NULL;
 
-        if (ctx == NULL || event == NULL)
+        pthread_mutex_lock (&reg->lock);
         {
-                gf_log_callingfn ("timer", GF_LOG_ERROR, "invalid argument");
-                return 0;
+                if (!list_empty (&reg->expired)) {
+                        event = list_entry (reg->expired.next, gf_timer_t,
+                                            list);
+                        list_del_init (&event->list);
+                        event->state = GF_TIMER_FIRED;
+                        callbk = event->callbk;
+                        data = event->data;
+                        xl = event->xl;
+                }
         }
+        pthread_mutex_unlock (&reg->lock);
 
-        reg = gf_timer_registry_init (ctx);
-        if (!reg) {
-                gf_log ("timer", GF_LOG_ERROR, "!reg");
-                GF_FREE (event);
+        if (!event)
                 return 0;
+
+        if (xl)
+                THIS = xl;
+        callbk (data);
+
+        return 1;
+}
+
+
+static void *
+gf_timer_dispatcher_proc (void *data)
+{
+        gf_timer_registry_t *reg = data;
+
+        while (1) {
+                pthread_mutex_lock (&reg->lock);
+                {
+                        while (!reg->fin && list_empty (&reg->expired))
+                                pthread_cond_wait (&reg->work_cond,
+                                                   &reg->lock);
+                }
+                pthread_mutex_unlock (&reg->lock);
+
+                if (reg->fin)
+                        break;
+
+                gf_timer_dispatch (reg);
+        }
+
+        return NULL;
+}
+
+
+static void
+gf_timer_wait (gf_timer_registry_t *reg, uint64_t next)
+{
+        struct timespec now = {0, };
+        struct timespec deadline = {0, };
+        int64_t         wait_ns = 0;
+
+        if (next == UINT64_MAX) {
+                pthread_cond_wait (&reg->cond, &reg->lock);
+                return;
+        }
+
+        timespec_now (&now);
+        wait_ns = (int64_t) (next * GF_TIMER_TICK_NS) - TS (now);
+        if (wait_ns <= 0)
+                return;
+
+        /* the condition uses the realtime clock, only the length of the
+           wait is taken from the monotonic one */
+        clock_gettime (CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += wait_ns / GIGA;
+        deadline.tv_nsec += wait_ns % GIGA;
+        if (deadline.tv_nsec >= GIGA) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= GIGA;
         }
 
+        pthread_cond_timedwait (&reg->cond, &reg->lock, &deadline);
+}
+
+
+static void
+gf_timer_registry_destroy (gf_timer_registry_t *reg)
+{
+        struct _gf_timer_wheel *wheel = NULL;
+        gf_timer_t             *event = NULL;
+        gf_timer_t             *tmp = NULL;
+        int                     i = 0;
+        int                     level = 0;
+        int                     idx = 0;
+
         pthread_mutex_lock (&reg->lock);
         {
-                event->next->prev = event->prev;
-                event->prev->next = event->next;
+                pthread_cond_broadcast (&reg->work_cond);
         }
         pthread_mutex_unlock (&reg->lock);
 
-        GF_FREE (event);
-        return 0;
+        for (i = 0; i < reg->nthreads; i++)
+                pthread_join (reg->threads[i], NULL);
+
+        for (i = 0; i < GF_TIMER_WHEELS; i++) {
+                wheel = &reg->wheels[i];
+                for (level = 0; level < GF_TIMER_LEVELS; level++) {
+                        for (idx = 0; idx < GF_TIMER_SLOTS; idx++) {
+                                list_for_each_entry_safe (event, tmp,
+                                        &wheel->slots[level][idx], list) {
+                                        list_del (&event->list);
+                                        GF_FREE (event);
+                                }
+                        }
+                }
+                pthread_mutex_destroy (&wheel->lock);
+        }
+
+        list_for_each_entry_safe (event, tmp, &reg->expired, list) {
+                list_del (&event->list);
+                GF_FREE (event);
+        }
+
+        pthread_cond_destroy (&reg->cond);
+        pthread_cond_destroy (&reg->work_cond);
+        pthread_mutex_destroy (&reg->lock);
 }
 
+
 void *
 gf_timer_proc (void *ctx)
 {
         gf_timer_registry_t *reg = NULL;
-        const struct timespec sleepts = {.tv_sec = 1, .tv_nsec = 0, };
+        struct timespec      now_ts = {0, };
+        uint64_t             now = 0;
+        uint64_t             next = 0;
+        uint64_t             wheel_next = 0;
+        int                  i = 0;
 
         if (ctx == NULL)
         {
@@ -139,49 +417,51 @@ gf_timer_proc (void *ctx)
         }
 
         while (!reg->fin) {
-                uint64_t now;
-                struct timespec now_ts;
-                gf_timer_t *event = NULL;
+                pthread_mutex_lock (&reg->lock);
+                {
+                        reg->scanning = 1;
+                        reg->rescan = 0;
+                }
+                pthread_mutex_unlock (&reg->lock);
 
                 timespec_now (&now_ts);
-                now = TS (now_ts);
-                while (1) {
-                        uint64_t at;
-                        char need_cbk = 0;
+                now = TS (now_ts) / GF_TIMER_TICK_NS;
+                next = UINT64_MAX;
 
-                        pthread_mutex_lock (&reg->lock);
+                for (i = 0; i < GF_TIMER_WHEELS; i++) {
+                        pthread_mutex_lock (&reg->wheels[i].lock);
                         {
-                                event = reg->active.next;
-                                at = TS (event->at);
-                                if (event != &reg->active && now >= at) {
-                                        need_cbk = 1;
-                                        gf_timer_call_stale (reg, event);
-                                }
+                                __gf_timer_wheel_advance (reg, &reg->wheels[i],
+                                                          now);
+                                wheel_next = __gf_timer_wheel_next
+                                        (&reg->wheels[i]);
                         }
-                        pthread_mutex_unlock (&reg->lock);
-                        if (event->xl)
-                                THIS = event->xl;
-                        if (need_cbk)
-                                event->callbk  (event->data);
+                        pthread_mutex_unlock (&reg->wheels[i].lock);
 
-                        else
-                                break;
+                        if (wheel_next < next)
+                                next = wheel_next;
                 }
-                nanosleep (&sleepts, NULL);
-        }
 
-        pthread_mutex_lock (&reg->lock);
-        {
-                while (reg->active.next != &reg->active) {
-                        gf_timer_call_cancel (ctx, reg->active.next);
+                if (!reg->nthreads) {
+                        while (gf_timer_dispatch (reg))
+                                ;
                 }
 
-                while (reg->stale.next != &reg->stale) {
-                        gf_timer_call_cancel (ctx, reg->stale.next);
+                pthread_mutex_lock (&reg->lock);
+                {
+                        reg->scanning = 0;
+                        if (!list_empty (&reg->expired))
+                                pthread_cond_broadcast (&reg->work_cond);
+
+                        if (!reg->rescan && !reg->fin) {
+                                reg->next_wake = next;
+                                gf_timer_wait (reg, next);
+                        }
                 }
+                pthread_mutex_unlock (&reg->lock);
         }
-        pthread_mutex_unlock (&reg->lock);
-        pthread_mutex_destroy (&reg->lock);
+
+        gf_timer_registry_destroy (reg);
         GF_FREE (((glusterfs_ctx_t *)ctx)->timer);
 
         return NULL;
@@ -190,6 +470,10 @@ gf_timer_proc (void *ctx)
 gf_timer_registry_t *
 gf_timer_registry_init (glusterfs_ctx_t *ctx)
 {
+        int i = 0;
+        int level = 0;
+        int idx = 0;
+
         if (ctx == NULL) {
                 gf_log_callingfn ("timer", GF_LOG_ERROR, "invalid argument");
                 return NULL;
@@ -197,19 +481,40 @@ gf_timer_registry_init (glusterfs_ctx_t *ctx)
 
         if (!ctx->timer) {
                 gf_timer_registry_t *reg = NULL;
+                struct timespec      now = {0, };
 
                 reg = GF_CALLOC (1, sizeof (*reg),
                                  gf_common_mt_gf_timer_registry_t);
                 if (!reg)
                         goto out;
 
+                timespec_now (&now);
+
                 pthread_mutex_init (&reg->lock, NULL);
-                reg->active.next = &reg->active;
-                reg->active.prev = &reg->active;
-                reg->stale.next = &reg->stale;
-                reg->stale.prev = &reg->stale;
+                pthread_cond_init (&reg->cond, NULL);
+                pthread_cond_init (&reg->work_cond, NULL);
+                INIT_LIST_HEAD (&reg->expired);
+                reg->next_wake = UINT64_MAX;
+
+                for (i = 0; i < GF_TIMER_WHEELS; i++) {
+                        pthread_mutex_init (&reg->wheels[i].lock, NULL);
+                        reg->wheels[i].now = TS (now) / GF_TIMER_TICK_NS;
+                        for (level = 0; level < GF_TIMER_LEVELS; level++)
+                                for (idx = 0; idx < GF_TIMER_SLOTS; idx++)
+                                        INIT_LIST_HEAD
+                                          (&reg->wheels[i].slots[level][idx]);
+                }
 
                 ctx->timer = reg;
+
+                for (i = 0; i < ctx->cmd_args.timer_threads &&
+                             i < GF_TIMER_MAX_THREADS; i++) {
+                        if (gf_thread_create (&reg->threads[i], NULL,
+                                              gf_timer_dispatcher_proc, reg))
+                                break;
+                }
+                reg->nthreads = i;
+
                 gf_thread_create (&reg->th, NULL, gf_timer_proc, ctx);
         }
 out:
@@ -23,20 +23,69 @@
 
 typedef void (*gf_timer_cbk_t) (void *);
 
+/* Timers live in hierarchical timing wheels: GF_TIMER_LEVELS levels of
+ * GF_TIMER_SLOTS slots each, level 0 slots being one tick wide and each
+ * level above covering a whole rotation of the level below. Arming and
+ * cancelling a timer is O(1), entries of an upper level slot are cascaded
+ * down as the wheel turns. Timers further away than the wheels reach are
+ * parked in the last level and re-placed when that slot comes up.
+ *
+ * There are GF_TIMER_WHEELS wheels per registry, each with its own lock,
+ * and a thread arms its timers on the wheel picked by its thread id, so
+ * that threads arming timers concurrently do not contend on one lock.
+ */
+#define GF_TIMER_TICK_MS        10
+#define GF_TIMER_SLOT_BITS      6
+#define GF_TIMER_SLOTS          (1 << GF_TIMER_SLOT_BITS)
+#define GF_TIMER_LEVELS         5
+#define GF_TIMER_WHEELS         8
+#define GF_TIMER_MAX_THREADS    16
+
+typedef enum {
+        GF_TIMER_ARMED,         /* in a wheel slot */
+        GF_TIMER_QUEUED,        /* expired, waiting to be dispatched */
+        GF_TIMER_FIRED,         /* callback called (or being called) */
+} gf_timer_state_t;
+
+struct _gf_timer_wheel;
+
 struct _gf_timer {
-        struct _gf_timer *next, *prev;
-        struct timespec    at;
-        gf_timer_cbk_t    callbk;
-        void             *data;
-        xlator_t         *xl;
+        struct list_head        list;
+        struct timespec         at;
+        uint64_t                expires;        /* in ticks */
+        gf_timer_cbk_t          callbk;
+        void                   *data;
+        xlator_t               *xl;
+        struct _gf_timer_wheel *wheel;
+        gf_timer_state_t        state;
+};
+
+struct _gf_timer_wheel {
+        pthread_mutex_t         lock;
+        uint64_t                now;            /* next tick to expire */
+        uint64_t                count;
+        struct list_head        slots[GF_TIMER_LEVELS][GF_TIMER_SLOTS];
 };
 
+/* Expired timers are queued on the registry and their callbacks run,
+ * in expiry order, by the timer thread itself, or by a pool of
+ * dispatcher threads when the process was started with timer threads
+ * (--timer-threads). With dispatcher threads, callbacks of different
+ * timers may run concurrently.
+ */
 struct _gf_timer_registry {
-        pthread_t        th;
-        char             fin;
-        struct _gf_timer stale;
-        struct _gf_timer active;
-        pthread_mutex_t  lock;
+        pthread_t               th;
+        char                    fin;
+        pthread_mutex_t         lock;
+        pthread_cond_t          cond;           /* wakes the timer thread */
+        pthread_cond_t          work_cond;      /* wakes the dispatchers */
+        uint64_t                next_wake;      /* in ticks */
+        char                    scanning;
+        char                    rescan;
+        struct list_head        expired;
+        int                     nthreads;
+        pthread_t               threads[GF_TIMER_MAX_THREADS];
+        struct _gf_timer_wheel  wheels[GF_TIMER_WHEELS];
 };
 
 typedef struct _gf_timer gf_timer_t;
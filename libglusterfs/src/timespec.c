@@ -35,16 +35,20 @@ void timespec_now (struct timespec *ts)
         uint64_t time = mach_absolute_time();
         static double scaling = 0.0;
 
-        if (mach_timebase_info(&gf_timebase) != KERN_SUCCESS) {
-                gf_timebase.numer = 1;
-                gf_timebase.denom = 1;
-        }
-        if (gf_timebase.denom == 0) {
-                gf_timebase.numer = 1;
-                gf_timebase.denom = 1;
-        }
+        /* the timebase does not change, ask for it once */
+        if (scaling == 0.0) {
+                if (mach_timebase_info(&gf_timebase) != KERN_SUCCESS) {
+                        gf_timebase.numer = 1;
+                        gf_timebase.denom = 1;
+                }
+                if (gf_timebase.denom == 0) {
+                        gf_timebase.numer = 1;
+                        gf_timebase.denom = 1;
+                }
 
-        scaling = (double) gf_timebase.numer / (double) gf_timebase.denom;
+                scaling = (double) gf_timebase.numer /
+                          (double) gf_timebase.denom;
+        }
         time *= scaling;
 
         ts->tv_sec = (time * NANO);
@@ -59,7 +63,26 @@ void timespec_now (struct timespec *ts)
 
 void timespec_adjust_delta (struct timespec *ts, struct timespec delta)
 {
-        ts->tv_nsec = ((ts->tv_nsec + delta.tv_nsec) % 1000000000);
-        ts->tv_sec += ((ts->tv_nsec + delta.tv_nsec) / 1000000000);
-        ts->tv_sec += delta.tv_sec;
+        ts->tv_nsec += delta.tv_nsec;
+        ts->tv_sec += delta.tv_sec + (ts->tv_nsec / 1000000000);
+        ts->tv_nsec = ts->tv_nsec % 1000000000;
+}
+
+/* The wall clock time at which the monotonic clock read @ts, for
+   displaying timestamps taken with timespec_now () */
+void timespec_to_wallclock (struct timespec *ts, struct timeval *tv)
+{
+        struct timespec now = {0, };
+        int64_t         age = 0;
+
+        timespec_now (&now);
+        gettimeofday (tv, NULL);
+
+        age = (TS (now) - TS ((*ts))) / 1000;
+        tv->tv_sec -= age / 1000000;
+        tv->tv_usec -= age % 1000000;
+        if (tv->tv_usec < 0) {
+                tv->tv_sec--;
+                tv->tv_usec += 1000000;
+        }
 }
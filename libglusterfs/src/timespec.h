@@ -20,5 +20,6 @@
 
 void timespec_now (struct timespec *ts);
 void timespec_adjust_delta (struct timespec *ts, struct timespec delta);
+void timespec_to_wallclock (struct timespec *ts, struct timeval *tv);
 
 #endif /*  __INCLUDE_TIMESPEC_H__ */
@@ -22,3 +22,13 @@ xlator_t **__glusterfs_this_location ()
 {
     return ((xlator_t **)(uintptr_t)mock());
 }
+
+int gf_proc_dump_add_section (char *key, ...)
+{
+    return 0;
+}
+
+int gf_proc_dump_write (char *key, char *value, ...)
+{
+    return 0;
+}
@@ -54,6 +54,10 @@ helper_xlator_init(uint32_t num_types)
     xl->mem_acct.num_types = num_types;
     xl->mem_acct.rec = test_calloc(num_types, sizeof(struct mem_acct_rec));
     assert_non_null(xl->mem_acct.rec);
+    xl->mem_acct.num_shards = 1;
+    xl->mem_acct.shard_stride = num_types;
+    xl->mem_acct.shards = test_calloc(num_types, sizeof(struct mem_acct_shard));
+    assert_non_null(xl->mem_acct.shards);
 
     xl->ctx = test_calloc(1, sizeof(glusterfs_ctx_t));
     assert_non_null(xl->ctx);
@@ -80,6 +84,7 @@ helper_xlator_destroy(xlator_t *xl)
     }
 
     free(xl->mem_acct.rec);
+    free(xl->mem_acct.shards);
     free(xl->ctx);
     free(xl);
     return 0;
@@ -183,6 +188,7 @@ test_gf_mem_set_acct_info_memory(void **state)
 
     //Check values
     assert_ptr_equal(typestr, xl->mem_acct.rec[type].typestr);
+    gf_mem_acct_fold(xl, type);
     assert_int_equal(xl->mem_acct.rec[type].size, size);
     assert_int_equal(xl->mem_acct.rec[type].num_allocs, 1);
     assert_int_equal(xl->mem_acct.rec[type].total_allocs, 1);
@@ -228,6 +234,7 @@ test_gf_calloc_default_calloc(void **state)
     memset(mem, 0x5A, size);
 
     // Check xl did not change
+    gf_mem_acct_fold(xl, type);
     assert_int_equal(xl->mem_acct.rec[type].size, 0);
     assert_int_equal(xl->mem_acct.rec[type].num_allocs, 0);
     assert_int_equal(xl->mem_acct.rec[type].total_allocs, 0);
@@ -262,6 +269,7 @@ test_gf_calloc_mem_acct_enabled(void **state)
     memset(mem, 0x5A, size);
 
     // Check xl values
+    gf_mem_acct_fold(xl, type);
     assert_int_equal(xl->mem_acct.rec[type].size, size);
     assert_int_equal(xl->mem_acct.rec[type].num_allocs, 1);
     assert_int_equal(xl->mem_acct.rec[type].total_allocs, 1);
@@ -295,6 +303,7 @@ test_gf_malloc_default_malloc(void **state)
     memset(mem, 0x5A, size);
 
     // Check xl did not change
+    gf_mem_acct_fold(xl, type);
     assert_int_equal(xl->mem_acct.rec[type].size, 0);
     assert_int_equal(xl->mem_acct.rec[type].num_allocs, 0);
     assert_int_equal(xl->mem_acct.rec[type].total_allocs, 0);
@@ -329,6 +338,7 @@ test_gf_malloc_mem_acct_enabled(void **state)
     memset(mem, 0x5A, size);
 
     // Check xl values
+    gf_mem_acct_fold(xl, type);
     assert_int_equal(xl->mem_acct.rec[type].size, size);
     assert_int_equal(xl->mem_acct.rec[type].num_allocs, 1);
     assert_int_equal(xl->mem_acct.rec[type].total_allocs, 1);
@@ -367,6 +377,7 @@ test_gf_realloc_default_realloc(void **state)
     memset(mem, 0x5A, size);
 
     // Check xl did not change
+    gf_mem_acct_fold(xl, type);
     assert_int_equal(xl->mem_acct.rec[type].size, 0);
     assert_int_equal(xl->mem_acct.rec[type].num_allocs, 0);
     assert_int_equal(xl->mem_acct.rec[type].total_allocs, 0);
@@ -412,6 +423,7 @@ test_gf_realloc_mem_acct_enabled(void **state)
     // not to the realloc + the malloc.
     // Is this a bug?
     //
+    gf_mem_acct_fold(xl, type);
     assert_int_equal(xl->mem_acct.rec[type].size, size+1024);
     assert_int_equal(xl->mem_acct.rec[type].num_allocs, 2);
     assert_int_equal(xl->mem_acct.rec[type].total_allocs, 2);
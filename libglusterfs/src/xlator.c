@@ -82,6 +82,7 @@ fill_defaults (xlator_t *xl)
 	SET_DEFAULT_FOP (fallocate);
 	SET_DEFAULT_FOP (discard);
         SET_DEFAULT_FOP (zerofill);
+        SET_DEFAULT_FOP (compound);
 
         SET_DEFAULT_FOP (getspec);
 
@@ -498,6 +499,7 @@ xlator_mem_acct_init (xlator_t *xl, int num_types)
 {
         int             i = 0;
         int             ret = 0;
+        long            nshards = 0;
 
         if (!xl)
                 return -1;
@@ -513,6 +515,24 @@ xlator_mem_acct_init (xlator_t *xl, int num_types)
                 return -1;
         }
 
+        /* one shard per cpu; the rows are padded apart so that no two
+           shards share a cache line */
+        nshards = sysconf (_SC_NPROCESSORS_ONLN);
+        if (nshards < 1)
+                nshards = 1;
+        if (nshards > GF_MEM_ACCT_MAX_SHARDS)
+                nshards = GF_MEM_ACCT_MAX_SHARDS;
+
+        xl->mem_acct.shard_stride = num_types + 3;
+        xl->mem_acct.shards = CALLOC (nshards * xl->mem_acct.shard_stride,
+                                      sizeof (struct mem_acct_shard));
+        if (!xl->mem_acct.shards) {
+                FREE (xl->mem_acct.rec);
+                xl->mem_acct.rec = NULL;
+                return -1;
+        }
+        xl->mem_acct.num_shards = nshards;
+
         for (i = 0; i < num_types; i++) {
                 ret = LOCK_INIT(&(xl->mem_acct.rec[i].lock));
                 if (ret) {
@@ -86,6 +86,40 @@ struct _loc {
 };
 
 
+/* Arguments of a compound fop: an ordered list of fops which
+ * protocol/client sends to a brick in a single round trip. The members are
+ * carried out in order. Only FXATTROP and FINODELK can be members, for the
+ * post-op and unlock of an AFR transaction. See compound-fop-utils.h.
+ */
+typedef struct {
+        glusterfs_fop_t     fop;
+        fd_t               *fd;
+        char               *volume;
+        int32_t             cmd;
+        struct gf_flock     flock;
+        gf_xattrop_flags_t  optype;
+        dict_t             *xattr;
+        dict_t             *xdata;
+} compound_fop_args_t;
+
+typedef struct {
+        int                  count;
+        compound_fop_args_t *fops;
+} compound_args_t;
+
+typedef struct {
+        int32_t             op_ret;
+        int32_t             op_errno;
+        dict_t             *xattr;
+        dict_t             *xdata;
+} compound_fop_cbk_args_t;
+
+typedef struct {
+        int                      count;
+        compound_fop_cbk_args_t *fops;
+} compound_args_cbk_t;
+
+
 typedef int32_t (*fop_getspec_cbk_t) (call_frame_t *frame,
                                       void *cookie,
                                       xlator_t *this,
@@ -443,6 +477,14 @@ typedef int32_t (*fop_zerofill_cbk_t) (call_frame_t *frame,
                                       struct iatt *preop_stbuf,
                                       struct iatt *postop_stbuf, dict_t *xdata);
 
+typedef int32_t (*fop_compound_cbk_t) (call_frame_t *frame,
+                                       void *cookie,
+                                       xlator_t *this,
+                                       int32_t op_ret,
+                                       int32_t op_errno,
+                                       compound_args_cbk_t *args_cbk,
+                                       dict_t *xdata);
+
 typedef int32_t (*fop_lookup_t) (call_frame_t *frame,
                                  xlator_t *this,
                                  loc_t *loc,
@@ -681,6 +723,11 @@ typedef int32_t (*fop_zerofill_t) (call_frame_t *frame,
                                   off_t len,
                                   dict_t *xdata);
 
+typedef int32_t (*fop_compound_t) (call_frame_t *frame,
+                                   xlator_t *this,
+                                   compound_args_t *args,
+                                   dict_t *xdata);
+
 struct xlator_fops {
         fop_lookup_t         lookup;
         fop_stat_t           stat;
@@ -727,6 +774,7 @@ struct xlator_fops {
 	fop_fallocate_t	     fallocate;
 	fop_discard_t	     discard;
         fop_zerofill_t       zerofill;
+        fop_compound_t       compound;
 
         /* these entries are used for a typechecking hack in STACK_WIND _only_ */
         fop_lookup_cbk_t         lookup_cbk;
@@ -774,6 +822,7 @@ struct xlator_fops {
 	fop_fallocate_cbk_t	 fallocate_cbk;
 	fop_discard_cbk_t	 discard_cbk;
         fop_zerofill_cbk_t       zerofill_cbk;
+        fop_compound_cbk_t       compound_cbk;
 };
 
 typedef int32_t (*cbk_forget_t) (xlator_t *this,
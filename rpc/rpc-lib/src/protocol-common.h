@@ -59,6 +59,7 @@ enum gf_fop_procnum {
 	GFS3_OP_FALLOCATE,
 	GFS3_OP_DISCARD,
         GFS3_OP_ZEROFILL,
+        GFS3_OP_COMPOUND,
         GFS3_OP_MAXVALUE,
 } ;
 
@@ -55,6 +55,7 @@ __saved_frames_get_timedout (struct saved_frames *frames, uint32_t timeout,
 		if ((tmp->saved_at.tv_sec + timeout) < current->tv_sec) {
 			bailout_frame = tmp;
 			list_del_init (&bailout_frame->list);
+			list_del_init (&bailout_frame->hash);
 			frames->count--;
 		}
 	}
@@ -78,6 +79,75 @@ _is_lock_fop (struct saved_frame *sframe)
                 (fop == GFS3_OP_FENTRYLK));
 }
 
+#define SAVED_FRAMES_HASH_MIN   64
+#define SAVED_FRAMES_HASH_MAX   (1 << 20)
+
+static inline struct list_head *
+__saved_frames_bucket (struct saved_frames *frames, uint32_t xid)
+{
+        /* xids are handed out sequentially, their low bits spread the
+           frames evenly */
+        return &frames->hash[xid & (frames->hash_size - 1)];
+}
+
+
+/* Doubles the hash once it holds more than 2 frames per bucket. If the
+   bigger table cannot be allocated the current one is kept, lookups just
+   get slower. */
+static void
+__saved_frames_hash_grow (struct saved_frames *frames)
+{
+        struct list_head   *old = NULL;
+        uint32_t            old_size = 0;
+        struct saved_frame *trav = NULL;
+        struct saved_frame *tmp = NULL;
+        uint32_t            i = 0;
+
+        if (frames->count <= 2 * frames->hash_size ||
+            frames->hash_size >= SAVED_FRAMES_HASH_MAX)
+                return;
+
+        old = frames->hash;
+        old_size = frames->hash_size;
+
+        frames->hash = GF_CALLOC (old_size * 2, sizeof (*frames->hash),
+                                  gf_common_mt_rpcclnt_savedframe_t);
+        if (!frames->hash) {
+                frames->hash = old;
+                return;
+        }
+        frames->hash_size = old_size * 2;
+
+        for (i = 0; i < frames->hash_size; i++)
+                INIT_LIST_HEAD (&frames->hash[i]);
+
+        for (i = 0; i < old_size; i++) {
+                list_for_each_entry_safe (trav, tmp, &old[i], hash) {
+                        list_move_tail (&trav->hash,
+                                        __saved_frames_bucket (frames,
+                                                        trav->rpcreq->xid));
+                }
+        }
+
+        GF_FREE (old);
+}
+
+
+static struct saved_frame *
+__saved_frames_lookup (struct saved_frames *frames, int64_t callid)
+{
+	struct saved_frame *tmp = NULL;
+
+        list_for_each_entry (tmp, __saved_frames_bucket (frames, callid),
+                             hash) {
+		if (tmp->rpcreq->xid == callid)
+                        return tmp;
+        }
+
+        return NULL;
+}
+
+
 struct saved_frame *
 __saved_frames_put (struct saved_frames *frames, void *frame,
                     struct rpc_req *rpcreq)
@@ -92,6 +162,7 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
 
         memset (saved_frame, 0, sizeof (*saved_frame));
 	INIT_LIST_HEAD (&saved_frame->list);
+	INIT_LIST_HEAD (&saved_frame->hash);
 
 	saved_frame->capital_this = THIS;
 	saved_frame->frame        = frame;
@@ -103,8 +174,13 @@ __saved_frames_put (struct saved_frames *frames, void *frame,
         else
                 list_add_tail (&saved_frame->list, &frames->sf.list);
 
+        list_add_tail (&saved_frame->hash,
+                       __saved_frames_bucket (frames, rpcreq->xid));
+
 	frames->count++;
 
+        __saved_frames_hash_grow (frames);
+
 out:
 	return saved_frame;
 }
@@ -250,6 +326,7 @@ struct saved_frames *
 saved_frames_new (void)
 {
 	struct saved_frames *saved_frames = NULL;
+        uint32_t             i = 0;
 
 	saved_frames = GF_CALLOC (1, sizeof (*saved_frames),
                                   gf_common_mt_rpcclnt_savedframe_t);
@@ -260,6 +337,18 @@ saved_frames_new (void)
 	INIT_LIST_HEAD (&saved_frames->sf.list);
 	INIT_LIST_HEAD (&saved_frames->lk_sf.list);
 
+        saved_frames->hash = GF_CALLOC (SAVED_FRAMES_HASH_MIN,
+                                        sizeof (*saved_frames->hash),
+                                        gf_common_mt_rpcclnt_savedframe_t);
+        if (!saved_frames->hash) {
+                GF_FREE (saved_frames);
+                return NULL;
+        }
+        saved_frames->hash_size = SAVED_FRAMES_HASH_MIN;
+
+        for (i = 0; i < saved_frames->hash_size; i++)
+                INIT_LIST_HEAD (&saved_frames->hash[i]);
+
 	return saved_frames;
 }
 
@@ -276,21 +365,11 @@ __saved_frame_copy (struct saved_frames *frames, int64_t callid,
                 goto out;
         }
 
-	list_for_each_entry (tmp, &frames->sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			*saved_frame = *tmp;
-                        ret = 0;
-			goto out;
-		}
-	}
-
-	list_for_each_entry (tmp, &frames->lk_sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			*saved_frame = *tmp;
-                        ret = 0;
-			goto out;
-		}
-	}
+        tmp = __saved_frames_lookup (frames, callid);
+        if (tmp) {
+                *saved_frame = *tmp;
+                ret = 0;
+        }
 
 out:
 	return ret;
@@ -301,28 +380,12 @@ struct saved_frame *
 __saved_frame_get (struct saved_frames *frames, int64_t callid)
 {
 	struct saved_frame *saved_frame = NULL;
-	struct saved_frame *tmp = NULL;
 
-	list_for_each_entry (tmp, &frames->sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			list_del_init (&tmp->list);
-			frames->count--;
-			saved_frame = tmp;
-			goto out;
-		}
-	}
-
-	list_for_each_entry (tmp, &frames->lk_sf.list, list) {
-		if (tmp->rpcreq->xid == callid) {
-			list_del_init (&tmp->list);
-			frames->count--;
-			saved_frame = tmp;
-			goto out;
-		}
-	}
-
-out:
+        saved_frame = __saved_frames_lookup (frames, callid);
 	if (saved_frame) {
+                list_del_init (&saved_frame->list);
+                list_del_init (&saved_frame->hash);
+                frames->count--;
                 THIS  = saved_frame->capital_this;
         }
 
@@ -369,6 +432,7 @@ saved_frames_unwind (struct saved_frames *saved_frames)
                                        trav->rpcreq->conn->rpc_clnt->reqpool);
 
 		list_del_init (&trav->list);
+		list_del_init (&trav->hash);
                 mem_put (trav);
 	}
 }
@@ -382,6 +446,7 @@ saved_frames_destroy (struct saved_frames *frames)
 
 	saved_frames_unwind (frames);
 
+        GF_FREE (frames->hash);
 	GF_FREE (frames);
 }
 
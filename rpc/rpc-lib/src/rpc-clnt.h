@@ -50,6 +50,7 @@ struct saved_frame {
 			struct saved_frame *frame_prev;
 		};
 	};
+        struct list_head         hash;  /* in saved_frames->hash, by xid */
         void                    *capital_this;
 	void                    *frame;
 	struct timeval           saved_at;
@@ -57,10 +58,16 @@ struct saved_frame {
         rpc_transport_rsp_t      rsp;
 };
 
+/* sf holds the frames in the order they were sent, which, all frames
+   having the same timeout, is the order in which they time out. Frames of
+   lock fops, which do not time out, are in lk_sf. Both kinds are also
+   hashed by xid so that a reply finds its frame in constant time. */
 struct saved_frames {
 	int64_t            count;
 	struct saved_frame sf;
 	struct saved_frame lk_sf;
+        struct list_head  *hash;
+        uint32_t           hash_size;   /* a power of 2 */
 };
 
 
@@ -26,66 +26,132 @@
 #include <netinet/in.h>
 #include <unistd.h>
 
+/**
+ * rpcsvc_drc_hash - hash of an op, picks its shard and bucket
+ *
+ * @param client - the drc client the op belongs to
+ * @param xid - xid of the op
+ * @return the hash
+ */
+static uint32_t
+rpcsvc_drc_hash (drc_client_t *client, uint32_t xid)
+{
+        uint64_t key = (uint64_t)(unsigned long)client ^ xid;
+
+        key *= 0x9e3779b97f4a7c15ULL;
+        return (uint32_t)(key >> 32);
+}
+
+static drc_shard_t *
+rpcsvc_drc_shard (rpcsvc_drc_globals_t *drc, uint32_t hash)
+{
+        return &drc->shards[hash % DRC_SHARD_COUNT];
+}
+
+static struct list_head *
+rpcsvc_drc_bucket (rpcsvc_drc_globals_t *drc, drc_shard_t *shard,
+                   uint32_t hash)
+{
+        return &shard->buckets[(hash / DRC_SHARD_COUNT) & drc->bucket_mask];
+}
+
 /**
  * rpcsvc_drc_op_destroy - Destroys the cached reply
  *
  * @param drc - the main drc structure
  * @param reply - the cached reply to destroy
- * @return NULL if reply is destroyed, reply otherwise
+ * @return void
  */
-static drc_cached_op_t *
+static void
 rpcsvc_drc_op_destroy (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
 {
         GF_ASSERT (drc);
         GF_ASSERT (reply);
 
-        if (reply->state == DRC_OP_IN_TRANSIT)
-                return reply;
-
-        iobref_unref (reply->msg.iobref);
-        if (reply->msg.rpchdr)
+        if (reply->msg.iobref)
+                iobref_unref (reply->msg.iobref);
+        if (reply->msg.rpchdr && reply->msg.rpchdr != reply->iov)
                 GF_FREE (reply->msg.rpchdr);
-        if (reply->msg.proghdr)
-                GF_FREE (reply->msg.proghdr);
-        if (reply->msg.progpayload)
-                GF_FREE (reply->msg.progpayload);
-
-        list_del (&reply->global_list);
-        reply->client->op_count--;
-        drc->op_count--;
-        mem_put (reply);
-        reply = NULL;
 
-        return reply;
+        /* last access to the client, see rpcsvc_drc_client_unref () */
+        __sync_sub_and_fetch (&reply->client->op_count, 1);
+        mem_put (reply);
 }
 
 /**
- * rpcsvc_drc_op_rb_unref - This function is used in rb tree cleanup only
+ * rpcsvc_drc_op_unref - unref the cached reply, and destroy it on last unref
  *
+ * @param drc - the main drc structure
  * @param reply - the cached reply to unref
+ * @return void
+ */
+void
+rpcsvc_drc_op_unref (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
+{
+        GF_ASSERT (reply);
+
+        if (!__sync_sub_and_fetch (&reply->ref, 1))
+                rpcsvc_drc_op_destroy (drc, reply);
+}
+
+/**
+ * __rpcsvc_drc_op_unhash - remove an op from its shard, the ref of the cache
+ *                          passes on to the caller. Called with the shard
+ *                          lock held.
+ *
  * @param drc - the main drc structure
+ * @param shard - the shard of the op
+ * @param reply - the op to remove
  * @return void
  */
 static void
-rpcsvc_drc_rb_op_destroy (void *reply, void *drc)
+__rpcsvc_drc_op_unhash (rpcsvc_drc_globals_t *drc, drc_shard_t *shard,
+                        drc_cached_op_t *reply)
 {
-        rpcsvc_drc_op_destroy (drc, (drc_cached_op_t *)reply);
+        list_del_init (&reply->hash_list);
+        list_del_init (&reply->clock_list);
+        shard->op_count--;
+
+        __sync_sub_and_fetch (&drc->op_count, 1);
+        __sync_sub_and_fetch (&drc->memory_used, reply->size);
 }
 
 /**
  * rpcsvc_remove_drc_client - Cleanup the drc client
  *
+ * @param drc - the main drc structure
  * @param client - the drc client to be removed
  * @return void
  */
 static void
-rpcsvc_remove_drc_client (drc_client_t *client)
+rpcsvc_remove_drc_client (rpcsvc_drc_globals_t *drc, drc_client_t *client)
 {
-        rb_destroy (client->rbtree, rpcsvc_drc_rb_op_destroy);
         list_del (&client->client_list);
+        drc->client_count--;
         GF_FREE (client);
 }
 
+/**
+ * rpcsvc_reap_drc_clients - free the clients which have neither a transport
+ *                           nor cached ops left. Called with the drc lock
+ *                           held.
+ *
+ * @param drc - the main drc structure
+ * @return void
+ */
+static void
+rpcsvc_reap_drc_clients (rpcsvc_drc_globals_t *drc)
+{
+        drc_client_t    *client = NULL;
+        drc_client_t    *tmp    = NULL;
+
+        list_for_each_entry_safe (client, tmp, &drc->clients_head,
+                                  client_list) {
+                if (!client->ref && !client->op_count)
+                        rpcsvc_remove_drc_client (drc, client);
+        }
+}
+
 /**
  * rpcsvc_client_lookup - Given a sockaddr_storage, find the client if it exists
  *
@@ -115,65 +181,28 @@ rpcsvc_client_lookup (rpcsvc_drc_globals_t *drc,
 }
 
 /**
- * drc_compare_reqs - Used by rbtree to determine if incoming req matches with
- *                    an existing node(cached reply) in rbtree
- *
- * @param item - pointer to the incoming req
- * @param rb_node_data - pointer to an rbtree node (cached reply)
- * @param param - drc pointer - unused here, but used in *op_destroy
- * @return 0 if req matches reply, else (req->xid - reply->xid)
- */
-int
-drc_compare_reqs (const void *item, const void *rb_node_data, void *param)
-{
-        int               ret      = -1;
-        drc_cached_op_t  *req      = NULL;
-        drc_cached_op_t  *reply    = NULL;
-
-        GF_ASSERT (item);
-        GF_ASSERT (rb_node_data);
-        GF_ASSERT (param);
-
-        req = (drc_cached_op_t *)item;
-        reply = (drc_cached_op_t *)rb_node_data;
-
-        ret = req->xid - reply->xid;
-        if (ret != 0)
-                return ret;
-
-        if (req->prognum == reply->prognum &&
-            req->procnum == reply->procnum &&
-            req->progversion == reply->progversion)
-                return 0;
-
-        return 1;
-}
-
-/**
- * drc_init_client_cache - initialize a drc client and its rb tree
+ * drc_compare_reqs - Determine if incoming req matches with a cached op
  *
- * @param drc - the main drc structure
- * @param client - the drc client to be initialized
- * @return 0 on success, -1 on failure
+ * @param reply - the cached op
+ * @param client - the drc client of the req
+ * @param req - the incoming req
+ * @return 1 if req matches reply, 0 otherwise
  */
 static int
-drc_init_client_cache (rpcsvc_drc_globals_t *drc, drc_client_t *client)
+drc_compare_reqs (drc_cached_op_t *reply, drc_client_t *client,
+                  rpcsvc_request_t *req)
 {
-        GF_ASSERT (drc);
-        GF_ASSERT (client);
-
-        client->rbtree = rb_create (drc_compare_reqs, drc, NULL);
-        if (!client->rbtree) {
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "rb tree creation failed");
-                return -1;
-        }
-
-        return 0;
+        return (reply->xid == req->xid &&
+                reply->client == client &&
+                reply->prognum == req->prognum &&
+                reply->procnum == req->procnum &&
+                reply->progversion == req->progver);
 }
 
 /**
  * rpcsvc_get_drc_client - find the drc client with given sockaddr, else
- *                         allocate and initialize a new drc client
+ *                         allocate and initialize a new drc client. Called
+ *                         with the drc lock held.
  *
  * @param drc - the main drc structure
  * @param sockaddr - network address of client
@@ -203,13 +232,6 @@ rpcsvc_get_drc_client (rpcsvc_drc_globals_t *drc,
         client->op_count = 0;
         INIT_LIST_HEAD (&client->client_list);
 
-        if (drc_init_client_cache (drc, client)) {
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG,
-                        "initialization of drc client failed");
-                GF_FREE (client);
-                client = NULL;
-                goto out;
-        }
         drc->client_count++;
 
         list_add (&client->client_list, &drc->clients_head);
@@ -247,7 +269,7 @@ rpcsvc_need_drc (rpcsvc_request_t *req)
 }
 
 /**
- * rpcsvc_drc_client_ref - ref the drc client
+ * rpcsvc_drc_client_ref - ref the drc client. Called with the drc lock held.
  *
  * @param client - the drc client to ref
  * @return client
@@ -261,12 +283,18 @@ rpcsvc_drc_client_ref (drc_client_t *client)
 }
 
 /**
- * rpcsvc_drc_client_unref - unref the drc client, and destroy
- *                           the client on last unref
+ * rpcsvc_drc_client_unref - unref the drc client, and destroy the client on
+ *                           last unref if it has no cached ops left. Called
+ *                           with the drc lock held.
+ *
+ * A client only gains ops through a transport holding a ref, so a client
+ * seen here without either cannot come back to life, except through
+ * rpcsvc_get_drc_client () which also runs under the drc lock. Clients
+ * whose last op goes away later are freed by rpcsvc_reap_drc_clients ().
  *
  * @param drc - the main drc structure
  * @param client - the drc client to unref
- * @return NULL if it is the last unref, client otherwise
+ * @return NULL if the client is destroyed, client otherwise
  */
 static drc_client_t *
 rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
@@ -275,9 +303,8 @@ rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
         GF_ASSERT (client->ref);
 
         client->ref--;
-        if (!client->ref) {
-                drc->client_count--;
-                rpcsvc_remove_drc_client (client);
+        if (!client->ref && !client->op_count) {
+                rpcsvc_remove_drc_client (drc, client);
                 client = NULL;
         }
 
@@ -285,42 +312,207 @@ rpcsvc_drc_client_unref (rpcsvc_drc_globals_t *drc, drc_client_t *client)
 }
 
 /**
- * rpcsvc_drc_lookup - lookup a request to see if it is already cached
+ * rpcsvc_drc_over_limit - check the cache against its size limits
+ *
+ * @param drc - the main drc structure
+ * @param watermark - check against the level eviction brings the cache down
+ *                    to, rather than the limits themselves
+ * @return _gf_true if the cache is over the limits
+ */
+static gf_boolean_t
+rpcsvc_drc_over_limit (rpcsvc_drc_globals_t *drc, gf_boolean_t watermark)
+{
+        uint64_t        ops   = drc->global_cache_size;
+        uint64_t        bytes = drc->memory_limit;
+
+        if (watermark) {
+                ops -= ops / drc->lru_factor;
+                bytes -= bytes / drc->lru_factor;
+        }
+
+        return (drc->op_count >= ops || drc->memory_used > bytes);
+}
+
+/**
+ * rpcsvc_drc_reclaim - evict cached ops once the cache is over its limits
+ *
+ * The clock hand of every shard is the head of its ring. An op under the
+ * hand which was hit since the last pass, or is still in transit, goes
+ * back to the tail, any other op is evicted. The shards are visited in
+ * turn, each giving up to 1/lru_factor of its ops, until the cache is
+ * below the watermark. Only one thread reclaims at a time, and only one
+ * shard lock is held at a time.
+ *
+ * @param drc - the main drc structure
+ * @return void
+ */
+static void
+rpcsvc_drc_reclaim (rpcsvc_drc_globals_t *drc)
+{
+        uint32_t            i           = 0;
+        uint32_t            quota       = 0;
+        uint32_t            scan        = 0;
+        drc_shard_t        *shard       = NULL;
+        drc_cached_op_t    *reply       = NULL;
+        drc_cached_op_t    *tmp         = NULL;
+        struct list_head    victims;
+
+        GF_ASSERT (drc);
+
+        if (!rpcsvc_drc_over_limit (drc, _gf_false))
+                return;
+
+        if (!__sync_bool_compare_and_swap (&drc->reclaiming, 0, 1))
+                return;
+
+        for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                if (!rpcsvc_drc_over_limit (drc, _gf_true))
+                        break;
+
+                shard = &drc->shards[drc->clock_shard++ % DRC_SHARD_COUNT];
+                INIT_LIST_HEAD (&victims);
+
+                LOCK (&shard->lock);
+                {
+                        quota = shard->op_count / drc->lru_factor + 1;
+                        scan = shard->op_count;
+
+                        while (quota && scan--) {
+                                reply = list_entry (shard->clock_head.next,
+                                                    drc_cached_op_t,
+                                                    clock_list);
+
+                                if (reply->state == DRC_OP_IN_TRANSIT ||
+                                    reply->referenced) {
+                                        reply->referenced = _gf_false;
+                                        list_move_tail (&reply->clock_list,
+                                                        &shard->clock_head);
+                                        continue;
+                                }
+
+                                __rpcsvc_drc_op_unhash (drc, shard, reply);
+                                list_add_tail (&reply->clock_list, &victims);
+                                shard->evictions++;
+                                quota--;
+                        }
+                }
+                UNLOCK (&shard->lock);
+
+                list_for_each_entry_safe (reply, tmp, &victims, clock_list) {
+                        list_del_init (&reply->clock_list);
+                        rpcsvc_drc_op_unref (drc, reply);
+                }
+        }
+
+        __sync_lock_release (&drc->reclaiming);
+}
+
+/**
+ * rpcsvc_drc_lookup - lookup a request to see if it is already cached, and
+ *                     cache it as in transit if it is not
  *
  * @param req - incoming request
- * @return cached reply of req if found, NULL otherwise
+ * @param state - state of the cached reply, if one is found
+ * @return cached reply of req if found, NULL otherwise. A cached reply
+ *         is returned with a ref, which rpcsvc_send_cached_reply () or
+ *         rpcsvc_drc_op_unref () drops.
  */
 drc_cached_op_t *
-rpcsvc_drc_lookup (rpcsvc_request_t *req)
+rpcsvc_drc_lookup (rpcsvc_request_t *req, drc_op_state_t *state)
 {
+        rpcsvc_drc_globals_t   *drc    = NULL;
         drc_client_t           *client = NULL;
         drc_cached_op_t        *reply  = NULL;
-        drc_cached_op_t        new = {
-                .xid            = req->xid,
-                .prognum        = req->prognum,
-                .progversion    = req->progver,
-                .procnum        = req->procnum,
-        };
+        drc_cached_op_t        *tmp    = NULL;
+        drc_cached_op_t        *new    = NULL;
+        drc_shard_t            *shard  = NULL;
+        struct list_head       *bucket = NULL;
+        uint32_t                hash   = 0;
 
         GF_ASSERT (req);
+        GF_ASSERT (state);
+
+        drc = req->svc->drc;
 
-        if (!req->trans->drc_client) {
-                client = rpcsvc_get_drc_client (req->svc->drc,
+        client = req->trans->drc_client;
+        if (!client) {
+                LOCK (&drc->lock);
+                {
+                        client = req->trans->drc_client;
+                        if (!client) {
+                                client = rpcsvc_get_drc_client (drc,
                                                 &req->trans->peerinfo.sockaddr);
+                                if (client)
+                                        req->trans->drc_client
+                                                = rpcsvc_drc_client_ref (client);
+                        }
+                }
+                UNLOCK (&drc->lock);
+
                 if (!client)
                         goto out;
-
-                req->trans->drc_client
-                        = rpcsvc_drc_client_ref (client);
         }
 
-        client = req->trans->drc_client;
+        hash = rpcsvc_drc_hash (client, req->xid);
+        shard = rpcsvc_drc_shard (drc, hash);
+        bucket = rpcsvc_drc_bucket (drc, shard, hash);
 
-        if (client->op_count == 0)
-                goto out;
+        LOCK (&shard->lock);
+        {
+                shard->lookups++;
+
+                list_for_each_entry (tmp, bucket, hash_list) {
+                        if (drc_compare_reqs (tmp, client, req)) {
+                                reply = tmp;
+                                break;
+                        }
+                }
+
+                if (reply) {
+                        if (reply->state == DRC_OP_CACHED) {
+                                reply->referenced = _gf_true;
+                                shard->cache_hits++;
+                        } else {
+                                shard->intransit_hits++;
+                        }
 
-        reply = rb_find (client->rbtree, &new);
+                        *state = reply->state;
+                        __sync_add_and_fetch (&reply->ref, 1);
+                        goto unlock;
+                }
 
+                /* fresh request, cache it as in-transit */
+                new = mem_get0 (drc->mempool);
+                if (!new)
+                        goto unlock;
+
+                new->client = client;
+                new->xid = req->xid;
+                new->prognum = req->prognum;
+                new->progversion = req->progver;
+                new->procnum = req->procnum;
+                new->hash = hash;
+                new->state = DRC_OP_IN_TRANSIT;
+                new->size = sizeof (*new);
+                /* the ref of the cache */
+                new->ref = 1;
+                INIT_LIST_HEAD (&new->hash_list);
+                INIT_LIST_HEAD (&new->clock_list);
+
+                list_add (&new->hash_list, bucket);
+                list_add_tail (&new->clock_list, &shard->clock_head);
+                shard->op_count++;
+                __sync_add_and_fetch (&client->op_count, 1);
+                __sync_add_and_fetch (&drc->op_count, 1);
+                __sync_add_and_fetch (&drc->memory_used, new->size);
+
+                req->reply = new;
+        }
+unlock:
+        UNLOCK (&shard->lock);
+
+        if (new)
+                rpcsvc_drc_reclaim (drc);
  out:
         return reply;
 }
@@ -329,7 +521,7 @@ rpcsvc_drc_lookup (rpcsvc_request_t *req)
  * rpcsvc_send_cached_reply - send the cached reply for the incoming request
  *
  * @param req - incoming request (which is a duplicate in this case)
- * @param reply - the cached reply for req
+ * @param reply - the cached reply for req, its ref is dropped
  * @return 0 on successful reply submission, -1 or other non-zero value otherwise
  */
 int
@@ -343,20 +535,72 @@ rpcsvc_send_cached_reply (rpcsvc_request_t *req, drc_cached_op_t *reply)
         gf_log (GF_RPCSVC, GF_LOG_DEBUG, "sending cached reply: xid: %d, "
                 "client: %s", req->xid, req->trans->peerinfo.identifier);
 
-        rpcsvc_drc_client_ref (reply->client);
         ret = rpcsvc_transport_submit (req->trans,
                      reply->msg.rpchdr, reply->msg.rpchdrcount,
                      reply->msg.proghdr, reply->msg.proghdrcount,
                      reply->msg.progpayload, reply->msg.progpayloadcount,
                      reply->msg.iobref, req->trans_private);
-        rpcsvc_drc_client_unref (req->svc->drc, reply->client);
+        rpcsvc_drc_op_unref (req->svc->drc, reply);
+
+        return ret;
+}
+
+/**
+ * rpcsvc_drc_compact_reply - copy a reply into a single iobuf of its size
+ *
+ * Replies are usually serialized into a default sized iobuf, and keeping a
+ * reference on it pins far more memory than the reply takes. Small replies
+ * are copied out instead.
+ *
+ * @param svc - pointer to rpcsvc_t structure of the rpc
+ * @param reply - the op to hold the copy
+ * @param vector - the iovecs of the reply
+ * @param count - no. of iovecs
+ * @param msglen - length of the reply
+ * @return 0 on success, -1 on failure
+ */
+static int
+rpcsvc_drc_compact_reply (rpcsvc_t *svc, drc_cached_op_t *reply,
+                          struct iovec *vector, int count, size_t msglen)
+{
+        struct iobuf    *iob    = NULL;
+        struct iobref   *iobref = NULL;
+        int              ret    = -1;
+
+        iob = iobuf_get2 (svc->ctx->iobuf_pool, msglen);
+        if (!iob)
+                goto out;
+
+        iobref = iobref_new ();
+        if (!iobref)
+                goto out;
+
+        ret = iobref_add (iobref, iob);
+        if (ret) {
+                iobref_unref (iobref);
+                goto out;
+        }
+
+        iov_unload (iobuf_ptr (iob), vector, count);
 
+        reply->iov[0].iov_base = iobuf_ptr (iob);
+        reply->iov[0].iov_len = msglen;
+        reply->msg.rpchdr = reply->iov;
+        reply->msg.rpchdrcount = 1;
+        reply->msg.iobref = iobref;
+ out:
+        if (iob)
+                iobuf_unref (iob);
         return ret;
 }
 
 /**
  * rpcsvc_cache_reply - cache the reply for the processed request 'req'
  *
+ * The reply is kept by reference: the op takes a ref on the iobref of the
+ * reply and points its iovecs into it. Small replies in large buffers
+ * are compacted by rpcsvc_drc_compact_reply ().
+ *
  * @param req - processed request
  * @param iobref - iobref structure of the reply
  * @param rpchdr - rpc header of the reply
@@ -374,157 +618,84 @@ rpcsvc_cache_reply (rpcsvc_request_t *req, struct iobref *iobref,
                     struct iovec *payload, int payloadcount)
 {
         int                       ret              = -1;
+        int                       count            = 0;
+        size_t                    msglen           = 0;
+        size_t                    pinned           = 0;
+        struct iovec             *iov              = NULL;
         drc_cached_op_t          *reply            = NULL;
+        drc_shard_t              *shard            = NULL;
+        rpcsvc_drc_globals_t     *drc              = NULL;
 
         GF_ASSERT (req);
         GF_ASSERT (req->reply);
 
+        drc = req->svc->drc;
         reply = req->reply;
-
-        reply->state = DRC_OP_CACHED;
-
-        reply->msg.iobref = iobref_ref (iobref);
-
-        reply->msg.rpchdrcount = rpchdrcount;
-        reply->msg.rpchdr = iov_dup (rpchdr, rpchdrcount);
-
-        reply->msg.proghdrcount = proghdrcount;
-        reply->msg.proghdr = iov_dup (proghdr, proghdrcount);
-
-        reply->msg.progpayloadcount = payloadcount;
-        if (payloadcount)
-                reply->msg.progpayload = iov_dup (payload, payloadcount);
-
-        //        rpcsvc_drc_client_unref (req->svc->drc, req->trans->drc_client);
-        //        rpcsvc_drc_op_unref (req->svc->drc, reply);
-        ret = 0;
-
-        return ret;
-}
-
-/**
- * rpcsvc_vacate_drc_entries - free up some percentage of drc cache
- *                             based on the lru factor
- *
- * @param drc - the main drc structure
- * @return void
- */
-static void
-rpcsvc_vacate_drc_entries (rpcsvc_drc_globals_t *drc)
-{
-        uint32_t            i           = 0;
-        uint32_t            n           = 0;
-        drc_cached_op_t    *reply       = NULL;
-        drc_cached_op_t    *tmp         = NULL;
-        drc_client_t       *client      = NULL;
-
-        GF_ASSERT (drc);
-
-        n = drc->global_cache_size / drc->lru_factor;
-
-        list_for_each_entry_safe_reverse (reply, tmp, &drc->cache_head, global_list) {
-                /* Don't delete ops that are in transit */
-                if (reply->state == DRC_OP_IN_TRANSIT)
-                        continue;
-
-                client = reply->client;
-
-                rb_delete (client->rbtree, reply);
-
-                rpcsvc_drc_op_destroy (drc, reply);
-                rpcsvc_drc_client_unref (drc, client);
-                i++;
-                if (i >= n)
-                        break;
+        req->reply = NULL;
+
+        count = rpchdrcount + proghdrcount + payloadcount;
+        if (count <= DRC_INLINE_IOVS) {
+                iov = reply->iov;
+        } else {
+                iov = GF_CALLOC (count, sizeof (*iov), gf_common_mt_iovec);
+                if (!iov)
+                        goto out;
         }
-}
-
-/**
- * rpcsvc_add_op_to_cache - insert the cached op into the client rbtree and drc list
- *
- * @param drc - the main drc structure
- * @param reply - the op to be inserted
- * @return 0 on success, -1 on failure
- */
-static int
-rpcsvc_add_op_to_cache (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply)
-{
-        drc_client_t        *client         = NULL;
-        drc_cached_op_t    **tmp_reply      = NULL;
-
-        GF_ASSERT (drc);
-        GF_ASSERT (reply);
-
-        client = reply->client;
-
-        /* cache is full, free up some space */
-        if (drc->op_count >= drc->global_cache_size)
-                rpcsvc_vacate_drc_entries (drc);
 
-        tmp_reply = (drc_cached_op_t **)rb_probe (client->rbtree, reply);
-        if (*tmp_reply != reply) {
-                /* should never happen */
-                gf_log (GF_RPCSVC, GF_LOG_ERROR,
-                        "DRC failed to detect duplicates");
-                return -1;
-        } else if (*tmp_reply == NULL) {
-                /* mem alloc failed */
-                return -1;
+        memcpy (iov, rpchdr, rpchdrcount * sizeof (*iov));
+        memcpy (iov + rpchdrcount, proghdr, proghdrcount * sizeof (*iov));
+        if (payloadcount)
+                memcpy (iov + rpchdrcount + proghdrcount, payload,
+                        payloadcount * sizeof (*iov));
+
+        msglen = iov_length (iov, count);
+        pinned = iobref_size (iobref);
+
+        if (pinned > msglen * DRC_COMPACT_RATIO) {
+                ret = rpcsvc_drc_compact_reply (req->svc, reply, iov, count,
+                                                msglen);
+                if (iov != reply->iov)
+                        GF_FREE (iov);
+                if (ret)
+                        goto out;
+                pinned = iobref_size (reply->msg.iobref);
+        } else {
+                reply->msg.iobref = iobref_ref (iobref);
+                reply->msg.rpchdr = iov;
+                reply->msg.rpchdrcount = rpchdrcount;
+                reply->msg.proghdr = iov + rpchdrcount;
+                reply->msg.proghdrcount = proghdrcount;
+                reply->msg.progpayload = payloadcount ?
+                        iov + rpchdrcount + proghdrcount : NULL;
+                reply->msg.progpayloadcount = payloadcount;
         }
 
-        client->op_count++;
-        list_add (&reply->global_list, &drc->cache_head);
-        drc->op_count++;
-
-        return 0;
-}
-
-/**
- * rpcsvc_cache_request - cache the in-transition incoming request
- *
- * @param req - incoming request
- * @return 0 on success, -1 on failure
- */
-int
-rpcsvc_cache_request (rpcsvc_request_t *req)
-{
-        int                        ret            = -1;
-        drc_client_t              *client         = NULL;
-        drc_cached_op_t           *reply          = NULL;
-        rpcsvc_drc_globals_t      *drc            = NULL;
-
-        GF_ASSERT (req);
-
-        drc = req->svc->drc;
+        ret = 0;
+ out:
+        shard = rpcsvc_drc_shard (drc, reply->hash);
 
-        client = req->trans->drc_client;
-        if (!client) {
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "drc client is NULL");
-                goto out;
+        LOCK (&shard->lock);
+        {
+                if (ret) {
+                        /* an op left in transit would never be evicted */
+                        __rpcsvc_drc_op_unhash (drc, shard, reply);
+                } else {
+                        reply->size += pinned;
+                        __sync_add_and_fetch (&drc->memory_used, pinned);
+                        reply->state = DRC_OP_CACHED;
+                }
         }
+        UNLOCK (&shard->lock);
 
-        reply = mem_get0 (drc->mempool);
-        if (!reply)
-                goto out;
-
-        reply->client = rpcsvc_drc_client_ref (client);
-        reply->xid = req->xid;
-        reply->prognum = req->prognum;
-        reply->progversion = req->progver;
-        reply->procnum = req->procnum;
-        reply->state = DRC_OP_IN_TRANSIT;
-        req->reply = reply;
-        INIT_LIST_HEAD (&reply->global_list);
-
-        ret = rpcsvc_add_op_to_cache (drc, reply);
         if (ret) {
-                req->reply = NULL;
-                rpcsvc_drc_op_destroy (drc, reply);
-                rpcsvc_drc_client_unref (drc, client);
-                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "Failed to add op to drc cache");
+                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "failed to cache reply: "
+                        "xid: %d", reply->xid);
+                rpcsvc_drc_op_unref (drc, reply);
+                return ret;
         }
 
- out:
+        rpcsvc_drc_reclaim (drc);
+
         return ret;
 }
 
@@ -542,6 +713,11 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         char                     key[GF_DUMP_MAX_BUF_LEN]  = {0};
         drc_client_t            *client                    = NULL;
         char                     ip[INET6_ADDRSTRLEN]      = {0};
+        uint64_t                 lookups                   = 0;
+        uint64_t                 cache_hits                = 0;
+        uint64_t                 intransit_hits            = 0;
+        uint64_t                 evictions                 = 0;
+        uint64_t                 inserts                   = 0;
 
         if (!drc || drc->status == DRC_UNINITIATED) {
                 gf_log (GF_RPCSVC, GF_LOG_DEBUG, "DRC is "
@@ -554,6 +730,16 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         if (TRY_LOCK (&drc->lock))
                 return -1;
 
+        /* the counters are read without the shard locks, they are
+         * statistics */
+        for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                lookups += drc->shards[i].lookups;
+                cache_hits += drc->shards[i].cache_hits;
+                intransit_hits += drc->shards[i].intransit_hits;
+                evictions += drc->shards[i].evictions;
+        }
+        inserts = lookups - cache_hits - intransit_hits;
+
         gf_proc_dump_build_key (key, "drc", "type");
         gf_proc_dump_write (key, "%d", drc->type);
 
@@ -566,15 +752,45 @@ rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc)
         gf_proc_dump_build_key (key, "drc", "max_cache_size");
         gf_proc_dump_write (key, "%d", drc->global_cache_size);
 
+        gf_proc_dump_build_key (key, "drc", "current_memory");
+        gf_proc_dump_write (key, "%"PRIu64, drc->memory_used);
+
+        gf_proc_dump_build_key (key, "drc", "max_memory");
+        gf_proc_dump_write (key, "%"PRIu64, drc->memory_limit);
+
         gf_proc_dump_build_key (key, "drc", "lru_factor");
         gf_proc_dump_write (key, "%d", drc->lru_factor);
 
+        gf_proc_dump_build_key (key, "drc", "shard_count");
+        gf_proc_dump_write (key, "%d", DRC_SHARD_COUNT);
+
+        gf_proc_dump_build_key (key, "drc", "lookup_count");
+        gf_proc_dump_write (key, "%"PRIu64, lookups);
+
         gf_proc_dump_build_key (key, "drc", "duplicate_request_count");
-        gf_proc_dump_write (key, "%d", drc->cache_hits);
+        gf_proc_dump_write (key, "%"PRIu64, cache_hits);
 
         gf_proc_dump_build_key (key, "drc", "in_transit_duplicate_requests");
-        gf_proc_dump_write (key, "%d", drc->intransit_hits);
+        gf_proc_dump_write (key, "%"PRIu64, intransit_hits);
+
+        gf_proc_dump_build_key (key, "drc", "eviction_count");
+        gf_proc_dump_write (key, "%"PRIu64, evictions);
+
+        /* hit and drop rates are of all lookups, the eviction rate is of
+         * the ops which got cached */
+        gf_proc_dump_build_key (key, "drc", "hit_rate");
+        gf_proc_dump_write (key, "%.2f%%", lookups ?
+                            100.0 * cache_hits / lookups : 0.0);
 
+        gf_proc_dump_build_key (key, "drc", "in_transit_drop_rate");
+        gf_proc_dump_write (key, "%.2f%%", lookups ?
+                            100.0 * intransit_hits / lookups : 0.0);
+
+        gf_proc_dump_build_key (key, "drc", "eviction_rate");
+        gf_proc_dump_write (key, "%.2f%%", inserts ?
+                            100.0 * evictions / inserts : 0.0);
+
+        i = 0;
         list_for_each_entry (client, &drc->clients_head, client_list) {
                 gf_proc_dump_build_key (key, "client", "%d.ip-address", i);
                 memset (ip, 0, INET6_ADDRSTRLEN);
@@ -635,19 +851,21 @@ rpcsvc_drc_notify (rpcsvc_t *svc, void *xl,
         LOCK (&drc->lock);
         {
                 trans = (rpc_transport_t *)data;
-                client = rpcsvc_get_drc_client (drc, &trans->peerinfo.sockaddr);
-                if (!client)
-                        goto unlock;
 
                 switch (event) {
                 case RPCSVC_EVENT_ACCEPT:
+                        client = rpcsvc_get_drc_client (drc,
+                                                &trans->peerinfo.sockaddr);
+                        if (!client)
+                                break;
                         trans->drc_client = rpcsvc_drc_client_ref (client);
                         ret = 0;
                         break;
 
                 case RPCSVC_EVENT_DISCONNECT:
                         ret = 0;
-                        if (list_empty (&drc->clients_head))
+                        client = trans->drc_client;
+                        if (!client)
                                 break;
                         /* should be the last unref */
                         trans->drc_client = NULL;
@@ -657,12 +875,35 @@ rpcsvc_drc_notify (rpcsvc_t *svc, void *xl,
                 default:
                         break;
                 }
+
+                rpcsvc_reap_drc_clients (drc);
         }
-unlock:
         UNLOCK (&drc->lock);
         return ret;
 }
 
+/**
+ * rpcsvc_drc_memory_limit - the memory limit set in the options
+ *
+ * @param options - the options dictionary which configures drc
+ * @return the limit in bytes
+ */
+static uint64_t
+rpcsvc_drc_memory_limit (dict_t *options)
+{
+        char            *str   = NULL;
+        uint64_t         limit = 0;
+
+        if (dict_get_str (options, "nfs.drc-memory-limit", &str) ||
+            gf_string2bytesize_uint64 (str, &limit) || !limit) {
+                gf_log (GF_RPCSVC, GF_LOG_DEBUG, "drc memory limit not set."
+                        " Continuing with default");
+                limit = DRC_DEFAULT_MEMORY_LIMIT;
+        }
+
+        return limit;
+}
+
 /**
  * rpcsvc_drc_init - Initialize the duplicate request cache service
  *
@@ -677,6 +918,9 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
         uint32_t                    drc_type       = 0;
         uint32_t                    drc_size       = 0;
         uint32_t                    drc_factor     = 0;
+        uint32_t                    buckets        = 0;
+        uint32_t                    i              = 0;
+        uint32_t                    j              = 0;
         rpcsvc_drc_globals_t       *drc            = NULL;
 
         GF_ASSERT (svc);
@@ -727,6 +971,9 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
 
         drc->global_cache_size = drc_size;
 
+        /* Set the memory limit (bytes of cached ops and pinned replies) */
+        drc->memory_limit = rpcsvc_drc_memory_limit (options);
+
         /* Mempool for cached ops */
         drc->mempool = mem_pool_new (drc_cached_op_t, drc->global_cache_size);
         if (!drc->mempool) {
@@ -738,7 +985,7 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
 
         /* What percent of cache to be evicted whenever it fills up */
         ret = dict_get_uint32 (options, "nfs.drc-lru-factor", &drc_factor);
-        if (ret) {
+        if (ret || !drc_factor) {
                 gf_log (GF_RPCSVC, GF_LOG_DEBUG, "drc lru factor not set."
                         " Continuing with policy default");
                 drc_factor = DRC_DEFAULT_LRU_FACTOR;
@@ -747,7 +994,28 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
         drc->lru_factor = (drc_lru_factor_t) drc_factor;
 
         INIT_LIST_HEAD (&drc->clients_head);
-        INIT_LIST_HEAD (&drc->cache_head);
+
+        /* Hash buckets of the shards, about one per cached op */
+        buckets = 16;
+        while (buckets * DRC_SHARD_COUNT < drc->global_cache_size)
+                buckets <<= 1;
+        drc->bucket_mask = buckets - 1;
+
+        for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                LOCK_INIT (&drc->shards[i].lock);
+                INIT_LIST_HEAD (&drc->shards[i].clock_head);
+
+                drc->shards[i].buckets = GF_CALLOC (buckets,
+                                                    sizeof (struct list_head),
+                                                    gf_common_mt_drc_buckets_t);
+                if (!drc->shards[i].buckets) {
+                        ret = -1;
+                        goto out;
+                }
+
+                for (j = 0; j < buckets; j++)
+                        INIT_LIST_HEAD (&drc->shards[i].buckets[j]);
+        }
 
         ret = rpcsvc_register_notify (svc, rpcsvc_drc_notify, THIS);
         if (ret) {
@@ -765,6 +1033,10 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
                         mem_pool_destroy (drc->mempool);
                         drc->mempool = NULL;
                 }
+                for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                        GF_FREE (drc->shards[i].buckets);
+                        LOCK_DESTROY (&drc->shards[i].lock);
+                }
                 GF_FREE (drc);
                 svc->drc = NULL;
         }
@@ -774,7 +1046,13 @@ rpcsvc_drc_init (rpcsvc_t *svc, dict_t *options)
 int
 rpcsvc_drc_deinit (rpcsvc_t *svc)
 {
-        rpcsvc_drc_globals_t *drc  = NULL;
+        rpcsvc_drc_globals_t *drc    = NULL;
+        drc_shard_t          *shard  = NULL;
+        drc_cached_op_t      *reply  = NULL;
+        drc_cached_op_t      *tmp    = NULL;
+        drc_client_t         *client = NULL;
+        drc_client_t         *ctmp   = NULL;
+        int                   i      = 0;
 
         if (!svc)
                 return (-1);
@@ -785,6 +1063,30 @@ rpcsvc_drc_deinit (rpcsvc_t *svc)
 
         LOCK (&drc->lock);
         (void) rpcsvc_unregister_notify (svc, rpcsvc_drc_notify, THIS);
+
+        for (i = 0; i < DRC_SHARD_COUNT; i++) {
+                shard = &drc->shards[i];
+
+                LOCK (&shard->lock);
+                {
+                        list_for_each_entry_safe (reply, tmp,
+                                                  &shard->clock_head,
+                                                  clock_list) {
+                                __rpcsvc_drc_op_unhash (drc, shard, reply);
+                                rpcsvc_drc_op_destroy (drc, reply);
+                        }
+                }
+                UNLOCK (&shard->lock);
+
+                GF_FREE (shard->buckets);
+                LOCK_DESTROY (&shard->lock);
+        }
+
+        list_for_each_entry_safe (client, ctmp, &drc->clients_head,
+                                  client_list) {
+                rpcsvc_remove_drc_client (drc, client);
+        }
+
         if (drc->mempool) {
                 mem_pool_destroy (drc->mempool);
                 drc->mempool = NULL;
@@ -826,7 +1128,8 @@ rpcsvc_drc_reconfigure (rpcsvc_t *svc, dict_t *options)
          * If DRC is reconfigured,
          *     case 1: DRC is "ON"
          *         sub-case 1: drc-size remains same
-         *              ACTION: Nothing to do.
+         *              ACTION: Take the memory limit, which does
+         *                      not need a new cache.
          *         sub-case 2: drc-size just changed
          *              ACTION: rpcsvc_drc_deinit() followed by
          *                      rpcsvc_drc_init().
@@ -848,8 +1151,11 @@ rpcsvc_drc_reconfigure (rpcsvc_t *svc, dict_t *options)
                         drc_size = DRC_DEFAULT_CACHE_SIZE;
 
                 /* case 1: sub-case 1*/
-                if (drc->global_cache_size == drc_size)
+                if (drc->global_cache_size == drc_size) {
+                        drc->memory_limit = rpcsvc_drc_memory_limit (options);
+                        rpcsvc_drc_reclaim (drc);
                         return (0);
+                }
 
                 /* case 1: sub-case 2*/
                 (void) rpcsvc_drc_deinit (svc);
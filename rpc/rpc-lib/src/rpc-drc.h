@@ -20,15 +20,21 @@
 #include "rpcsvc.h"
 #include "locking.h"
 #include "dict.h"
-#include "rb.h"
+#include "list.h"
+
+/* the cache is split in DRC_SHARD_COUNT independently locked hash tables,
+ * an op lands in the shard picked by the hash of its client and xid */
+#define DRC_SHARD_COUNT                64
+/* iovecs of a cached reply which are kept in the op itself */
+#define DRC_INLINE_IOVS                4
 
 /* per-client cache structure */
 struct drc_client {
+        /* refs held by the transports of the client */
         uint32_t                   ref;
         union gf_sock_union        sock_union;
-        /* pointers to the cache */
-        struct rb_table           *rbtree;
-        /* no. of ops currently cached */
+        /* no. of ops currently cached, the client is freed only once both
+         * this and ref drop to zero */
         uint32_t                   op_count;
         struct list_head           client_list;
 };
@@ -39,13 +45,34 @@ struct drc_cached_op {
         int                            prognum;
         int                            progversion;
         int                            procnum;
+        uint32_t                       hash;
+        /* set on a duplicate, gives the op a second pass of the clock */
+        gf_boolean_t                   referenced;
+        /* bytes accounted against the memory limit */
+        size_t                         size;
         rpc_transport_msg_t            msg;
+        struct iovec                   iov[DRC_INLINE_IOVS];
         drc_client_t                  *client;
-        struct list_head               client_list;
-        struct list_head               global_list;
+        /* hash chain of the shard */
+        struct list_head               hash_list;
+        /* clock ring of the shard */
+        struct list_head               clock_list;
         int32_t                        ref;
 };
 
+struct drc_shard {
+        gf_lock_t                 lock;
+        struct list_head         *buckets;
+        uint32_t                  op_count;
+        /* ops are appended at the tail, the clock hand is the head */
+        struct list_head          clock_head;
+        uint64_t                  lookups;
+        uint64_t                  cache_hits;
+        uint64_t                  intransit_hits;
+        uint64_t                  evictions;
+};
+typedef struct drc_shard drc_shard_t;
+
 /* global drc definitions */
 enum drc_status {
         DRC_UNINITIATED,
@@ -54,21 +81,22 @@ enum drc_status {
 typedef enum drc_status drc_status_t;
 
 struct drc_globals {
-        /* allocator must be the first member since
-         * it is used so in gf_libavl_allocator
-         */
-        struct libavl_allocator   allocator;
         drc_type_t                type;
-        /* configurable size parameter */
+        /* configurable size parameters */
         uint32_t                  global_cache_size;
+        uint64_t                  memory_limit;
         drc_lru_factor_t          lru_factor;
+        /* protects the client list */
         gf_lock_t                 lock;
         drc_status_t              status;
+        /* updated atomically */
         uint32_t                  op_count;
-        uint64_t                  cache_hits;
-        uint64_t                  intransit_hits;
+        uint64_t                  memory_used;
+        uint32_t                  reclaiming;
+        uint32_t                  clock_shard;
+        uint32_t                  bucket_mask;
         struct mem_pool          *mempool;
-        struct list_head          cache_head;
+        drc_shard_t               shards[DRC_SHARD_COUNT];
         uint32_t                  client_count;
         struct list_head          clients_head;
 };
@@ -77,7 +105,10 @@ int
 rpcsvc_need_drc (rpcsvc_request_t *req);
 
 drc_cached_op_t *
-rpcsvc_drc_lookup (rpcsvc_request_t *req);
+rpcsvc_drc_lookup (rpcsvc_request_t *req, drc_op_state_t *state);
+
+void
+rpcsvc_drc_op_unref (rpcsvc_drc_globals_t *drc, drc_cached_op_t *reply);
 
 int
 rpcsvc_send_cached_reply (rpcsvc_request_t *req, drc_cached_op_t *reply);
@@ -88,9 +119,6 @@ rpcsvc_cache_reply (rpcsvc_request_t *req, struct iobref *iobref,
                     struct iovec *proghdr, int proghdrcount,
                     struct iovec *payload, int payloadcount);
 
-int
-rpcsvc_cache_request (rpcsvc_request_t *req);
-
 int32_t
 rpcsvc_drc_priv (rpcsvc_drc_globals_t *drc);
 
@@ -193,6 +193,15 @@ struct rpc_transport {
         int32_t                    refcount;
 
         int32_t                    outstanding_rpc_count;
+        int32_t                    outstanding_rpc_limit; /* adaptive */
+        int32_t                    queued_rpc_count;
+        struct list_head           sched_queue;
+        struct list_head           sched_list;
+        int32_t                    sched_deficit;
+        uint32_t                   sched_epoch;
+        gf_boolean_t               throttled;
+        int64_t                    throttle_start;
+        uint64_t                   throttle_ns;
 
         glusterfs_ctx_t           *ctx;
         dict_t                    *options;
@@ -210,6 +219,10 @@ struct rpc_transport {
 
         uint64_t                   total_bytes_read;
         uint64_t                   total_bytes_write;
+        uint64_t                   total_msgs_write;
+        uint64_t                   total_write_calls;
+        uint64_t                   total_msgs_read;
+        uint64_t                   total_read_calls;
 
         struct list_head           list;
         int                        bind_insecure;
@@ -77,6 +77,23 @@ typedef struct rpcsvc_state {
 	/* per-client limit of outstanding rpc requests */
         int                     outstanding_rpc_limit;
         gf_boolean_t            addr_namelookup;
+
+        /* Adaptive admission control, enabled by a non-zero
+         * rpc.queue-target-latency. Requests beyond the window are queued
+         * per client and dispatched round robin (DRR) across clients.
+         */
+        int64_t                 queue_target;   /* ns, 0 if disabled */
+        pthread_mutex_t         sched_lock;
+        struct list_head        sched_active;   /* clients with queued rpcs */
+        int                     sched_inflight;
+        int                     sched_window;
+        int64_t                 sched_min_latency;
+        int64_t                 sched_interval_start;
+        gf_boolean_t            sched_congested;
+        uint32_t                sched_epoch;
+        pthread_cond_t          sched_cond;
+        pthread_t               sched_thread;   /* runs the queues */
+        gf_boolean_t            sched_started;
 } rpcsvc_t;
 
 /* DRC START */
@@ -122,6 +139,9 @@ typedef enum drc_policy drc_policy_t;
 #define DRC_DEFAULT_TYPE               DRC_TYPE_IN_MEMORY
 #define DRC_DEFAULT_CACHE_SIZE         0x20000
 #define DRC_DEFAULT_LRU_FACTOR         DRC_LRU_25_PC
+#define DRC_DEFAULT_MEMORY_LIMIT       (64 * GF_UNIT_MB)
+/* replies pinning more than this many times their size are copied out */
+#define DRC_COMPACT_RATIO              4
 
 /* DRC END */
 
@@ -30,6 +30,7 @@
 #include "syncop.h"
 #include "rpc-drc.h"
 #include "protocol-common.h"
+#include "timespec.h"
 
 #include <errno.h>
 #include <pthread.h>
@@ -176,37 +177,162 @@ rpcsvc_can_outstanding_req_be_ignored (rpcsvc_request_t *req)
         return _gf_false;
 }
 
+static inline int64_t
+rpcsvc_sched_now (void)
+{
+        struct timespec ts = {0, };
+
+        timespec_now (&ts);
+        return TS (ts);
+}
+
+/* The outstanding-rpc limit in force for a client: the adaptive one when
+ * the admission control has lowered it, rpc.outstanding-rpc-limit otherwise.
+ */
+static inline int
+rpcsvc_transport_limit (rpcsvc_t *svc, rpc_transport_t *trans)
+{
+        int limit = svc->outstanding_rpc_limit;
+
+        if (limit && svc->queue_target && trans->outstanding_rpc_limit &&
+            trans->outstanding_rpc_limit < limit)
+                limit = trans->outstanding_rpc_limit;
+
+        return limit;
+}
+
 int
 rpcsvc_request_outstanding (rpcsvc_request_t *req, int delta)
 {
-        int ret = 0;
-        int old_count = 0;
-        int new_count = 0;
-        int limit = 0;
+        rpc_transport_t *trans = NULL;
+        int64_t          now   = 0;
+        int              ret   = 0;
+        int              limit = 0;
+        int              count = 0;
 
         if (rpcsvc_can_outstanding_req_be_ignored (req))
                 return 0;
 
-        pthread_mutex_lock (&req->trans->lock);
+        trans = req->trans;
+        limit = rpcsvc_transport_limit (req->svc, trans);
+
+        pthread_mutex_lock (&trans->lock);
         {
-                limit = req->svc->outstanding_rpc_limit;
-                if (!limit)
-                        goto unlock;
+                trans->outstanding_rpc_count += delta;
+                count = trans->outstanding_rpc_count;
+
+                if (limit && !trans->throttled && count > limit) {
+                        ret = rpc_transport_throttle (trans, _gf_true);
+                        if (!ret) {
+                                trans->throttled = _gf_true;
+                                trans->throttle_start = rpcsvc_sched_now ();
+                        }
+                } else if (trans->throttled && (!limit || count <= limit)) {
+                        ret = rpc_transport_throttle (trans, _gf_false);
+                        if (!ret) {
+                                now = rpcsvc_sched_now ();
+                                trans->throttled = _gf_false;
+                                trans->throttle_ns += now -
+                                                      trans->throttle_start;
+                        }
+                }
+        }
+        pthread_mutex_unlock (&trans->lock);
 
-                old_count = req->trans->outstanding_rpc_count;
-                req->trans->outstanding_rpc_count += delta;
-                new_count = req->trans->outstanding_rpc_count;
+        return ret;
+}
 
-                if (old_count <= limit && new_count > limit)
-                        ret = rpc_transport_throttle (req->trans, _gf_true);
 
-                if (old_count > limit && new_count <= limit)
-                        ret = rpc_transport_throttle (req->trans, _gf_false);
-        }
-unlock:
-        pthread_mutex_unlock (&req->trans->lock);
+/* Admission control.
+ *
+ * With rpc.queue-target-latency set, at most sched_window requests are
+ * handed to the actors at a time. The window follows the service latency
+ * the way CoDel follows the sojourn time: if even the fastest request of a
+ * 100ms interval took longer than the target, the interval was congested and
+ * the window shrinks by a quarter, otherwise it grows by a step. Requests
+ * beyond the window wait on a queue of their client, and the queues are
+ * served by deficit round robin, so that a client streaming large writes
+ * gets the same share as one sending small metadata calls. Once per interval
+ * a client with a standing queue in a congested interval has its
+ * outstanding-rpc limit halved, which throttles reads on its connection and
+ * pushes the backlog back into the network; the limit grows back by a step
+ * per interval otherwise.
+ */
+static void
+__rpcsvc_sched_interval (rpcsvc_t *svc, int64_t now)
+{
+        svc->sched_congested = (svc->sched_min_latency > svc->queue_target);
 
-        return ret;
+        if (svc->sched_congested)
+                svc->sched_window = max (svc->sched_window * 3 / 4,
+                                         RPCSVC_SCHED_MIN_WINDOW);
+        else
+                svc->sched_window = min (svc->sched_window +
+                                         RPCSVC_SCHED_WINDOW_INC,
+                                         RPCSVC_SCHED_MAX_WINDOW);
+
+        svc->sched_min_latency = 0;
+        svc->sched_interval_start = now;
+        svc->sched_epoch++;
+}
+
+static void
+__rpcsvc_sched_adapt (rpcsvc_t *svc, rpc_transport_t *trans)
+{
+        int limit = svc->outstanding_rpc_limit;
+
+        if (!limit || trans->sched_epoch == svc->sched_epoch)
+                return;
+
+        trans->sched_epoch = svc->sched_epoch;
+        if (trans->outstanding_rpc_limit)
+                limit = min (trans->outstanding_rpc_limit, limit);
+
+        if (svc->sched_congested &&
+            trans->queued_rpc_count >= RPCSVC_SCHED_HEAVY)
+                limit = max (limit / 2, RPCSVC_SCHED_MIN_LIMIT);
+        else
+                limit = min (limit + RPCSVC_SCHED_LIMIT_INC,
+                             svc->outstanding_rpc_limit);
+
+        trans->outstanding_rpc_limit = limit;
+}
+
+/* A request which went through the admission control has completed. The
+ * freed slot is handed to the scheduler thread; this runs from the reply
+ * path, which must not go on to run another actor.
+ */
+static void
+rpcsvc_sched_complete (rpcsvc_request_t *req)
+{
+        rpcsvc_t     *svc     = req->svc;
+        int64_t       now     = 0;
+        int64_t       latency = 0;
+
+        if (!req->sched_ts)
+                return;
+
+        now = rpcsvc_sched_now ();
+        latency = now - req->sched_ts;
+
+        pthread_mutex_lock (&svc->sched_lock);
+        {
+                svc->sched_inflight--;
+
+                if (!svc->sched_min_latency ||
+                    latency < svc->sched_min_latency)
+                        svc->sched_min_latency = latency;
+
+                if (now - svc->sched_interval_start >= RPCSVC_SCHED_INTERVAL)
+                        __rpcsvc_sched_interval (svc, now);
+
+                __rpcsvc_sched_adapt (svc, req->trans);
+
+                if (!list_empty (&svc->sched_active) &&
+                    svc->sched_inflight < svc->sched_window)
+                        pthread_cond_signal (&svc->sched_cond);
+        }
+        pthread_mutex_unlock (&svc->sched_lock);
 }
 
 
@@ -339,6 +465,9 @@ rpcsvc_accept (rpcsvc_t *svc, rpc_transport_t *listen_trans,
                 goto out;
         }
 
+        INIT_LIST_HEAD (&new_trans->sched_queue);
+        INIT_LIST_HEAD (&new_trans->sched_list);
+
         rpcsvc_program_notify (listener, RPCSVC_EVENT_ACCEPT, new_trans);
         ret = 0;
 out:
@@ -365,8 +494,10 @@ rpcsvc_request_destroy (rpcsvc_request_t *req)
            to the client. It is time to decrement the
            outstanding request counter by 1.
         */
-        if (req->prognum) //Only for initialized requests
+        if (req->prognum) { //Only for initialized requests
+                rpcsvc_sched_complete (req);
                 rpcsvc_request_outstanding (req, -1);
+        }
 
         rpc_transport_unref (req->trans);
 
@@ -412,7 +543,9 @@ rpcsvc_request_init (rpcsvc_t *svc, rpc_transport_t *trans,
         req->trans_private = msg->private;
 
         INIT_LIST_HEAD (&req->txlist);
+        INIT_LIST_HEAD (&req->sched_list);
         req->payloadsize = 0;
+        req->sched_ts = 0;
 
         /* By this time, the data bytes for the auth scheme would have already
          * been copied into the required sections of the req structure,
@@ -553,6 +686,173 @@ rpcsvc_check_and_reply_error (int ret, call_frame_t *frame, void *opaque)
         return 0;
 }
 
+static int
+rpcsvc_request_dispatch (rpcsvc_t *svc, rpcsvc_request_t *req,
+                         rpcsvc_actor actor_fn)
+{
+        int ret = -1;
+
+        /* Before going to xlator code, set the THIS properly */
+        THIS = svc->mydata;
+
+        if (req->synctask)
+                ret = synctask_new (THIS->ctx->env, (synctask_fn_t) actor_fn,
+                                    rpcsvc_check_and_reply_error, NULL, req);
+        else
+                ret = actor_fn (req);
+
+        return ret;
+}
+
+
+/* Picks the next request by deficit round robin over the clients with
+ * queued requests. Called with svc->sched_lock held.
+ */
+static rpcsvc_request_t *
+__rpcsvc_sched_pick (rpcsvc_t *svc)
+{
+        rpc_transport_t  *trans = NULL;
+        rpcsvc_request_t *req   = NULL;
+
+        while (!list_empty (&svc->sched_active)) {
+                trans = list_entry (svc->sched_active.next, rpc_transport_t,
+                                    sched_list);
+                req = list_entry (trans->sched_queue.next, rpcsvc_request_t,
+                                  sched_list);
+
+                if (trans->sched_deficit < req->sched_cost) {
+                        trans->sched_deficit += RPCSVC_SCHED_QUANTUM;
+                        list_move_tail (&trans->sched_list,
+                                        &svc->sched_active);
+                        continue;
+                }
+
+                trans->sched_deficit -= req->sched_cost;
+                trans->queued_rpc_count--;
+                list_del_init (&req->sched_list);
+
+                if (list_empty (&trans->sched_queue)) {
+                        list_del_init (&trans->sched_list);
+                        trans->sched_deficit = 0;
+                }
+
+                return req;
+        }
+
+        return NULL;
+}
+
+
+/* The scheduler thread. Dispatches queued requests while the window allows
+ * and sleeps until a completion, a newly queued request or a change of
+ * rpc.queue-target-latency makes room again. Actors of queued requests so
+ * never run nested under the reply of another request.
+ */
+static void *
+rpcsvc_sched_worker (void *data)
+{
+        rpcsvc_t         *svc = data;
+        rpcsvc_request_t *req = NULL;
+        int               ret = 0;
+
+        for (;;) {
+                pthread_mutex_lock (&svc->sched_lock);
+                {
+                        for (;;) {
+                                req = NULL;
+                                if (!svc->queue_target ||
+                                    svc->sched_inflight < svc->sched_window)
+                                        req = __rpcsvc_sched_pick (svc);
+                                if (req)
+                                        break;
+                                pthread_cond_wait (&svc->sched_cond,
+                                                   &svc->sched_lock);
+                        }
+
+                        svc->sched_inflight++;
+                        req->sched_ts = rpcsvc_sched_now ();
+                }
+                pthread_mutex_unlock (&svc->sched_lock);
+
+                ret = rpcsvc_request_dispatch (svc, req, req->sched_actor);
+                rpcsvc_check_and_reply_error (ret, NULL, req);
+        }
+
+        return NULL;
+}
+
+
+/* Admits @req or queues it behind the other requests of its client.
+ * Returns 1 if the request was queued, in which case it is dispatched
+ * later by the scheduler thread.
+ */
+static int
+rpcsvc_sched_submit (rpcsvc_t *svc, rpcsvc_request_t *req,
+                     rpcsvc_actor actor_fn, rpc_transport_pollin_t *msg)
+{
+        rpc_transport_t *trans  = req->trans;
+        int              queued = 0;
+
+        pthread_mutex_lock (&svc->sched_lock);
+        {
+                if (list_empty (&svc->sched_active) &&
+                    svc->sched_inflight < svc->sched_window) {
+                        svc->sched_inflight++;
+                        req->sched_ts = rpcsvc_sched_now ();
+                        goto unlock;
+                }
+
+                req->sched_actor = actor_fn;
+                req->sched_cost = 1 + (iov_length (req->msg, req->count) >>
+                                       RPCSVC_SCHED_COST_SHIFT);
+                if (msg->hdr_iobuf && !req->hdr_iobuf)
+                        req->hdr_iobuf = iobuf_ref (msg->hdr_iobuf);
+
+                list_add_tail (&req->sched_list, &trans->sched_queue);
+                if (trans->queued_rpc_count++ == 0)
+                        list_add_tail (&trans->sched_list,
+                                       &svc->sched_active);
+                queued = 1;
+
+                if (svc->sched_inflight < svc->sched_window)
+                        pthread_cond_signal (&svc->sched_cond);
+        }
+unlock:
+        pthread_mutex_unlock (&svc->sched_lock);
+
+        return queued;
+}
+
+
+/* Drops the requests a disconnected client still has queued. */
+static void
+rpcsvc_sched_drop (rpcsvc_t *svc, rpc_transport_t *trans)
+{
+        struct list_head  dropped;
+        rpcsvc_request_t *req = NULL;
+        rpcsvc_request_t *tmp = NULL;
+
+        if (!trans->sched_queue.next)
+                return;
+
+        INIT_LIST_HEAD (&dropped);
+
+        pthread_mutex_lock (&svc->sched_lock);
+        {
+                list_splice_init (&trans->sched_queue, &dropped);
+                list_del_init (&trans->sched_list);
+                trans->queued_rpc_count = 0;
+                trans->sched_deficit = 0;
+        }
+        pthread_mutex_unlock (&svc->sched_lock);
+
+        list_for_each_entry_safe (req, tmp, &dropped, sched_list) {
+                list_del_init (&req->sched_list);
+                rpcsvc_request_destroy (req);
+        }
+}
+
+
 int
 rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                         rpc_transport_pollin_t *msg)
@@ -565,7 +865,7 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
         gf_boolean_t            is_unix        = _gf_false;
         gf_boolean_t            unprivileged   = _gf_false;
         drc_cached_op_t        *reply          = NULL;
-        rpcsvc_drc_globals_t   *drc            = NULL;
+        drc_op_state_t          state          = DRC_OP_IN_TRANSIT;
 
         if (!trans || !svc)
                 return -1;
@@ -619,39 +919,26 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                         return -1;
         }
 
-        /* DRC */
+        /* DRC, a fresh request gets cached as in-transit by the lookup */
         if (rpcsvc_need_drc (req)) {
-                drc = req->svc->drc;
+                reply = rpcsvc_drc_lookup (req, &state);
 
-                LOCK (&drc->lock);
-                {
-                        reply = rpcsvc_drc_lookup (req);
-
-                        /* retransmission of completed request, send cached reply */
-                        if (reply && reply->state == DRC_OP_CACHED) {
-                                gf_log (GF_RPCSVC, GF_LOG_INFO, "duplicate request:"
-                                        " XID: 0x%x", req->xid);
-                                ret = rpcsvc_send_cached_reply (req, reply);
-                                drc->cache_hits++;
-                                UNLOCK (&drc->lock);
-                                goto out;
-
-                        } /* retransmitted request, original op in transit, drop it */
-                        else if (reply && reply->state == DRC_OP_IN_TRANSIT) {
-                                gf_log (GF_RPCSVC, GF_LOG_INFO, "op in transit,"
-                                        " discarding. XID: 0x%x", req->xid);
-                                ret = 0;
-                                drc->intransit_hits++;
-                                rpcsvc_request_destroy (req);
-                                UNLOCK (&drc->lock);
-                                goto out;
-
-                        } /* fresh request, cache it as in-transit and proceed */
-                        else {
-                                ret = rpcsvc_cache_request (req);
-                        }
+                /* retransmission of completed request, send cached reply */
+                if (reply && state == DRC_OP_CACHED) {
+                        gf_log (GF_RPCSVC, GF_LOG_INFO, "duplicate request:"
+                                " XID: 0x%x", req->xid);
+                        ret = rpcsvc_send_cached_reply (req, reply);
+                        goto out;
+
+                } /* retransmitted request, original op in transit, drop it */
+                else if (reply) {
+                        gf_log (GF_RPCSVC, GF_LOG_INFO, "op in transit,"
+                                " discarding. XID: 0x%x", req->xid);
+                        ret = 0;
+                        rpcsvc_drc_op_unref (req->svc->drc, reply);
+                        rpcsvc_request_destroy (req);
+                        goto out;
                 }
-                UNLOCK (&drc->lock);
         }
 
         if (req->rpc_err == SUCCESS) {
@@ -670,17 +957,19 @@ rpcsvc_handle_rpc_call (rpcsvc_t *svc, rpc_transport_t *trans,
                         goto err_reply;
                 }
 
-                if (req->synctask) {
-                        if (msg->hdr_iobuf)
-                                req->hdr_iobuf = iobuf_ref (msg->hdr_iobuf);
+                if (req->synctask && msg->hdr_iobuf)
+                        req->hdr_iobuf = iobuf_ref (msg->hdr_iobuf);
 
-                        ret = synctask_new (THIS->ctx->env,
-                                            (synctask_fn_t) actor_fn,
-                                            rpcsvc_check_and_reply_error, NULL,
-                                            req);
-                } else {
-                        ret = actor_fn (req);
+                /* lock requests are not held back, see
+                 * rpcsvc_can_outstanding_req_be_ignored() */
+                if (svc->queue_target &&
+                    !rpcsvc_can_outstanding_req_be_ignored (req) &&
+                    rpcsvc_sched_submit (svc, req, actor_fn, msg)) {
+                        ret = 0;
+                        goto out;
                 }
+
+                ret = rpcsvc_request_dispatch (svc, req, actor_fn);
         }
 
 err_reply:
@@ -706,6 +995,9 @@ rpcsvc_handle_disconnect (rpcsvc_t *svc, rpc_transport_t *trans)
         event = (trans->listener == NULL) ? RPCSVC_EVENT_LISTENER_DEAD
                 : RPCSVC_EVENT_DISCONNECT;
 
+        if (event == RPCSVC_EVENT_DISCONNECT)
+                rpcsvc_sched_drop (svc, trans);
+
         pthread_mutex_lock (&svc->rpclock);
         {
                 if (!svc->notify_count)
@@ -1190,7 +1482,6 @@ rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec *proghdr,
         size_t                  msglen     = 0;
         size_t                  hdrlen     = 0;
         char                    new_iobref = 0;
-        rpcsvc_drc_globals_t   *drc        = NULL;
 
         if ((!req) || (!req->trans))
                 return -1;
@@ -1226,15 +1517,10 @@ rpcsvc_submit_generic (rpcsvc_request_t *req, struct iovec *proghdr,
         iobref_add (iobref, replyiob);
 
         /* cache the request in the duplicate request cache for appropriate ops */
-        if ((req->reply) && (rpcsvc_need_drc (req))) {
-                drc = req->svc->drc;
-
-                LOCK (&drc->lock);
+        if ((req->reply) && (rpcsvc_need_drc (req)))
                 ret = rpcsvc_cache_reply (req, iobref, &recordhdr, 1,
                                           proghdr, hdrcount,
                                           payload, payloadcount);
-                UNLOCK (&drc->lock);
-        }
 
         ret = rpcsvc_transport_submit (trans, &recordhdr, 1, proghdr, hdrcount,
                                        payload, payloadcount, iobref,
@@ -2147,6 +2433,53 @@ rpcsvc_set_outstanding_rpc_limit (rpcsvc_t *svc, dict_t *options, int defvalue)
         return (0);
 }
 
+/*
+ * Configure() the rpc.queue-target-latency param, in milliseconds. 0, the
+ * default, disables the admission control.
+ */
+int
+rpcsvc_set_queue_target (rpcsvc_t *svc, dict_t *options)
+{
+        int32_t      target = 0;
+        static char *key    = "rpc.queue-target-latency";
+
+        if ((!svc) || (!options))
+                return (-1);
+
+        if (dict_get_int32 (options, key, &target) < 0)
+                target = 0;
+
+        if (target < 0)
+                return (-1);
+
+        if (target && !svc->sched_started) {
+                if (gf_thread_create (&svc->sched_thread, NULL,
+                                      rpcsvc_sched_worker, svc) != 0) {
+                        gf_log (GF_RPCSVC, GF_LOG_ERROR,
+                                "could not start the scheduler thread");
+                        return (-1);
+                }
+                svc->sched_started = _gf_true;
+        }
+
+        if (svc->queue_target != target * 1000000LL) {
+                pthread_mutex_lock (&svc->sched_lock);
+                {
+                        svc->queue_target = target * 1000000LL;
+                        svc->sched_interval_start = rpcsvc_sched_now ();
+                        svc->sched_min_latency = 0;
+                        /* queued requests drain if it was disabled */
+                        pthread_cond_signal (&svc->sched_cond);
+                }
+                pthread_mutex_unlock (&svc->sched_lock);
+
+                gf_log (GF_RPCSVC, GF_LOG_INFO,
+                        "Configured %s with value %d", key, target);
+        }
+
+        return (0);
+}
+
 /* The global RPC service initializer.
  */
 rpcsvc_t *
@@ -2164,6 +2497,10 @@ rpcsvc_init (xlator_t *xl, glusterfs_ctx_t *ctx, dict_t *options,
                 return NULL;
 
         pthread_mutex_init (&svc->rpclock, NULL);
+        pthread_mutex_init (&svc->sched_lock, NULL);
+        pthread_cond_init (&svc->sched_cond, NULL);
+        INIT_LIST_HEAD (&svc->sched_active);
+        svc->sched_window = RPCSVC_SCHED_MAX_WINDOW;
         INIT_LIST_HEAD (&svc->authschemes);
         INIT_LIST_HEAD (&svc->notify);
         INIT_LIST_HEAD (&svc->listeners);
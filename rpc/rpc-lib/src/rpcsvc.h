@@ -43,6 +43,17 @@
 #define RPCSVC_MAX_OUTSTANDING_RPC_LIMIT 65536
 #define RPCSVC_MIN_OUTSTANDING_RPC_LIMIT 0 /* No limit i.e. Unlimited */
 
+/* Adaptive admission control (rpc.queue-target-latency) */
+#define RPCSVC_SCHED_INTERVAL   (100 * 1000000LL) /* 100ms */
+#define RPCSVC_SCHED_MAX_WINDOW 1024
+#define RPCSVC_SCHED_MIN_WINDOW 16
+#define RPCSVC_SCHED_WINDOW_INC 16
+#define RPCSVC_SCHED_MIN_LIMIT  8
+#define RPCSVC_SCHED_LIMIT_INC  8
+#define RPCSVC_SCHED_HEAVY      4  /* queued rpcs making a client "heavy" */
+#define RPCSVC_SCHED_QUANTUM    32 /* DRR quantum, in cost units */
+#define RPCSVC_SCHED_COST_SHIFT 12 /* a cost unit per 4KB of payload */
+
 #define GF_RPCSVC       "rpc-service"
 #define RPCSVC_THREAD_STACK_SIZE ((size_t)(1024 * GF_UNIT_KB))
 
@@ -254,6 +265,12 @@ struct rpcsvc_request {
 
         /* pointer to cached reply for use in DRC */
         drc_cached_op_t         *reply;
+
+        /* state of a request held back by the admission control */
+        struct list_head        sched_list;
+        int                   (*sched_actor) (rpcsvc_request_t *req);
+        int                     sched_cost;
+        int64_t                 sched_ts;
 };
 
 #define rpcsvc_request_program(req) ((rpcsvc_program_t *)((req)->prog))
@@ -601,6 +618,8 @@ rpcsvc_set_root_squash (rpcsvc_t *svc, dict_t *options);
 int
 rpcsvc_set_outstanding_rpc_limit (rpcsvc_t *svc, dict_t *options, int defvalue);
 int
+rpcsvc_set_queue_target (rpcsvc_t *svc, dict_t *options);
+int
 rpcsvc_auth_array (rpcsvc_t *svc, char *volname, int *autharr, int arrlen);
 rpcsvc_vector_sizer
 rpcsvc_get_program_vector_sizer (rpcsvc_t *svc, uint32_t prognum,
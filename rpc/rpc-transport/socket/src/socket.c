@@ -36,6 +36,19 @@
 #include <netinet/tcp.h>
 #include <rpc/xdr.h>
 #include <sys/ioctl.h>
+#ifdef GF_LINUX_HOST_OS
+#include <linux/errqueue.h>
+#endif
+
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && \
+    defined(SO_EE_ORIGIN_ZEROCOPY)
+#define GF_SOCKET_HAVE_ZEROCOPY 1
+#endif
+
+#if defined(SSL_OP_ENABLE_KTLS)
+#define GF_SOCKET_HAVE_KTLS 1
+#endif
+
 #define GF_LOG_ERRNO(errno) ((errno == ENOTCONN) ? GF_LOG_DEBUG : GF_LOG_ERROR)
 #define SA(ptr) ((struct sockaddr *)ptr)
 
@@ -44,6 +57,8 @@
 #define SSL_PRIVATE_KEY_OPT "transport.socket.ssl-private-key"
 #define SSL_CA_LIST_OPT     "transport.socket.ssl-ca-list"
 #define OWN_THREAD_OPT      "transport.socket.own-thread"
+#define SSL_KTLS_OPT        "transport.socket.ssl-ktls"
+#define SSL_SESSION_CACHE_OPT "transport.socket.ssl-session-cache"
 
 /* TBD: do automake substitutions etc. (ick) to set these. */
 #if !defined(DEFAULT_CERT_PATH)
@@ -246,6 +261,54 @@ out:
 #define ssl_read_one(t,b,l)  ssl_do((t),(b),(l),(SSL_trinary_func *)SSL_read)
 #define ssl_write_one(t,b,l) ssl_do((t),(b),(l),(SSL_trinary_func *)SSL_write)
 
+/* Whether @b is the same address and port as the peer of @this. */
+static gf_boolean_t
+socket_same_peer (rpc_transport_t *this, struct sockaddr_storage *b)
+{
+        struct sockaddr     *sa = SA (&this->peerinfo.sockaddr);
+        struct sockaddr_in  *a4 = NULL;
+        struct sockaddr_in  *b4 = NULL;
+        struct sockaddr_in6 *a6 = NULL;
+        struct sockaddr_in6 *b6 = NULL;
+
+        if (sa->sa_family != b->ss_family)
+                return _gf_false;
+
+        switch (sa->sa_family) {
+        case AF_INET:
+                a4 = (struct sockaddr_in *)sa;
+                b4 = (struct sockaddr_in *)b;
+                return a4->sin_port == b4->sin_port &&
+                        a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+        case AF_INET6:
+                a6 = (struct sockaddr_in6 *)sa;
+                b6 = (struct sockaddr_in6 *)b;
+                return a6->sin6_port == b6->sin6_port &&
+                        a6->sin6_scope_id == b6->sin6_scope_id &&
+                        !memcmp (&a6->sin6_addr, &b6->sin6_addr,
+                                 sizeof (a6->sin6_addr));
+        default:
+                return _gf_false;
+        }
+}
+
+/*
+ * With SSL_OP_ENABLE_KTLS, OpenSSL hands the keys to the kernel at the end
+ * of the handshake when the kernel supports the cipher. When it does so in
+ * both directions the connection is left to plain readv and writev, which
+ * neither block nor need the own thread: see socket_ktls_handoff.
+ */
+static gf_boolean_t
+ssl_ktls_active (socket_private_t *priv)
+{
+#ifdef GF_SOCKET_HAVE_KTLS
+        return BIO_get_ktls_send (SSL_get_wbio (priv->ssl_ssl)) &&
+                BIO_get_ktls_recv (SSL_get_rbio (priv->ssl_ssl));
+#else
+        return _gf_false;
+#endif
+}
+
 static char *
 ssl_setup_connection (rpc_transport_t *this, int server)
 {
@@ -271,6 +334,16 @@ ssl_setup_connection (rpc_transport_t *this, int server)
 	}
 	SSL_set_bio(priv->ssl_ssl,priv->ssl_sbio,priv->ssl_sbio);
 
+	/*
+	 * Offer the session of the last connection to the same server; if
+	 * it takes it back, the key exchange and certificate checks of a
+	 * full handshake are skipped.
+	 */
+	if (!server && priv->ssl_session &&
+	    socket_same_peer (this, &priv->ssl_session_peer)) {
+		SSL_set_session(priv->ssl_ssl,priv->ssl_session);
+	}
+
 	if (server) {
 		ret = ssl_accept_one(this);
 	}
@@ -297,6 +370,20 @@ ssl_setup_connection (rpc_transport_t *this, int server)
 		NID_commonName, peer_CN, sizeof(peer_CN)-1);
 	peer_CN[sizeof(peer_CN)-1] = '\0';
 	gf_log(this->name,GF_LOG_INFO,"peer CN = %s", peer_CN);
+
+	if (!server && priv->ssl_session_cache) {
+		if (priv->ssl_session) {
+			SSL_SESSION_free(priv->ssl_session);
+		}
+		priv->ssl_session = SSL_get1_session(priv->ssl_ssl);
+		memcpy (&priv->ssl_session_peer, &this->peerinfo.sockaddr,
+			sizeof (priv->ssl_session_peer));
+	}
+
+	priv->ktls = ssl_ktls_active (priv);
+	gf_log(this->name,GF_LOG_INFO,"%s session, records done by %s",
+	       SSL_session_reused(priv->ssl_ssl) ? "resumed" : "new",
+	       priv->ktls ? "the kernel" : "SSL");
         return gf_strdup(peer_CN);
 
 	/* Error paths. */
@@ -319,6 +406,7 @@ ssl_teardown_connection (socket_private_t *priv)
         SSL_free(priv->ssl_ssl);
         priv->ssl_ssl = NULL;
         priv->use_ssl = _gf_false;
+        priv->ktls = _gf_false;
 }
 
 
@@ -332,7 +420,8 @@ __socket_ssl_readv (rpc_transport_t *this, struct iovec *opvector, int opcount)
 	priv = this->private;
 	sock = priv->sock;
 
-	if (priv->use_ssl) {
+        this->total_read_calls++;
+	if (priv->use_ssl && !priv->ktls) {
 		ret = ssl_read_one (this, opvector->iov_base, opvector->iov_len);
 	} else {
 		ret = readv (sock, opvector, IOV_MIN(opcount));
@@ -425,6 +514,65 @@ out:
 	return ret;
 }
 
+/*
+ * Batch-read mode: instead of one read per record header and fragment
+ * piece, read whatever the socket has into priv->rcvbuf and serve the
+ * state machine from there, so that a run of small records costs one
+ * read. Large reads bypass the buffer while it is empty, which keeps
+ * vectored payloads landing directly in their own iobufs.
+ */
+static ssize_t
+__socket_buffered_read (rpc_transport_t *this, struct iovec *opvector,
+                        int opcount)
+{
+        socket_private_t *priv = NULL;
+        size_t            req_len = 0;
+        ssize_t           ret = -1;
+
+        priv = this->private;
+        req_len = iov_length (opvector, opcount);
+
+        if (priv->rcvbuf_start == priv->rcvbuf_end) {
+                priv->rcvbuf_start = priv->rcvbuf_end = 0;
+
+                this->total_read_calls++;
+                if (req_len >= GF_SOCKET_RCVBUF_DIRECT)
+                        return readv (priv->sock, opvector, IOV_MIN(opcount));
+
+                ret = read (priv->sock, priv->rcvbuf, GF_SOCKET_RCVBUF_SIZE);
+                if (ret <= 0)
+                        return ret;
+
+                priv->rcvbuf_end = ret;
+        }
+
+        ret = iov_load (opvector, opcount, &priv->rcvbuf[priv->rcvbuf_start],
+                        min (req_len, priv->rcvbuf_end - priv->rcvbuf_start));
+        priv->rcvbuf_start += ret;
+
+        return ret;
+}
+
+
+static int
+socket_rcvbuf_alloc (socket_private_t *priv)
+{
+        priv->rcvbuf = GF_MALLOC (GF_SOCKET_RCVBUF_SIZE, gf_common_mt_char);
+        if (!priv->rcvbuf)
+                return -1;
+
+        priv->rcvbuf_start = priv->rcvbuf_end = 0;
+        return 0;
+}
+
+
+static gf_boolean_t
+socket_rcvbuf_pending (socket_private_t *priv)
+{
+        return (priv->rcvbuf_start != priv->rcvbuf_end);
+}
+
+
 static gf_boolean_t
 __does_socket_rwv_error_need_logging (socket_private_t *priv, int write)
 {
@@ -439,6 +587,217 @@ __does_socket_rwv_error_need_logging (socket_private_t *priv, int write)
         return _gf_true;
 }
 
+static void
+__socket_ioq_entry_free (struct ioq *entry);
+
+/*
+ * Zero-copy send: large writes go out with MSG_ZEROCOPY, and the kernel
+ * reports on the error queue of the socket when it is done with the pages
+ * of each such send. ioq entries completed while sends are outstanding
+ * are parked on priv->zc_pending, holding their iobrefs, until then.
+ */
+static ssize_t
+__socket_sendv (rpc_transport_t *this, struct iovec *vector, int count)
+{
+        socket_private_t *priv = NULL;
+#ifdef GF_SOCKET_HAVE_ZEROCOPY
+        struct msghdr     msg = {0, };
+        ssize_t           ret = -1;
+#endif
+
+        priv = this->private;
+
+#ifdef GF_SOCKET_HAVE_ZEROCOPY
+        if (priv->zc_active && priv->zerocopy &&
+            iov_length (vector, IOV_MIN(count)) >= GF_SOCKET_ZEROCOPY_MIN) {
+                msg.msg_iov = vector;
+                msg.msg_iovlen = IOV_MIN(count);
+
+                ret = sendmsg (priv->sock, &msg, MSG_ZEROCOPY);
+                if (ret > 0)
+                        priv->zc_sent++;
+                if (ret != -1 || errno != ENOBUFS)
+                        return ret;
+
+                /* out of memory to pin pages with, copy this one */
+        }
+#endif
+
+        return writev (priv->sock, vector, IOV_MIN(count));
+}
+
+
+static void
+__socket_zerocopy_enable (rpc_transport_t *this, int family)
+{
+        socket_private_t *priv = NULL;
+#ifdef GF_SOCKET_HAVE_ZEROCOPY
+        int               on = 1;
+#endif
+
+        priv = this->private;
+        priv->zc_active = _gf_false;
+
+        if (!priv->zerocopy || family == AF_UNIX || priv->use_ssl ||
+            priv->own_thread)
+                return;
+
+#ifdef GF_SOCKET_HAVE_ZEROCOPY
+        if (setsockopt (priv->sock, SOL_SOCKET, SO_ZEROCOPY,
+                        &on, sizeof (on)) == 0) {
+                priv->zc_active = _gf_true;
+                return;
+        }
+
+        gf_log (this->name, GF_LOG_WARNING,
+                "zero-copy send not available on socket %d (%s)",
+                priv->sock, strerror (errno));
+#else
+        gf_log (this->name, GF_LOG_WARNING,
+                "zero-copy send is not supported on this platform");
+#endif
+}
+
+
+static gf_boolean_t
+__socket_zerocopy_busy (socket_private_t *priv)
+{
+        return (priv->zc_active && priv->zc_sent != priv->zc_completed);
+}
+
+
+static void
+__socket_zerocopy_release (socket_private_t *priv)
+{
+        struct ioq *entry = NULL;
+
+        while (!list_empty (&priv->zc_pending)) {
+                entry = list_entry (priv->zc_pending.next, struct ioq, list);
+                if ((int32_t)(entry->zc_seq - priv->zc_completed) > 0)
+                        break;
+
+                __socket_ioq_entry_free (entry);
+        }
+}
+
+
+/* Returns the number of completion notifications read; @others is
+ * set to the number of error queue entries that were anything else. */
+static int
+__socket_zerocopy_reap (rpc_transport_t *this, int *others)
+{
+        int                       reaped = 0;
+#ifdef GF_SOCKET_HAVE_ZEROCOPY
+        socket_private_t         *priv = NULL;
+        char                      control[128];
+        struct msghdr             msg = {0, };
+        struct cmsghdr           *cmsg = NULL;
+        struct sock_extended_err *serr = NULL;
+        gf_boolean_t              zc = _gf_false;
+
+        priv = this->private;
+        *others = 0;
+
+        for (;;) {
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof (control);
+
+                if (recvmsg (priv->sock, &msg,
+                             MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+                        break;
+
+                zc = _gf_false;
+
+                for (cmsg = CMSG_FIRSTHDR (&msg); cmsg;
+                     cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+                        if (!((cmsg->cmsg_level == SOL_IP &&
+                               cmsg->cmsg_type == IP_RECVERR) ||
+                              (cmsg->cmsg_level == SOL_IPV6 &&
+                               cmsg->cmsg_type == IPV6_RECVERR)))
+                                continue;
+
+                        serr = (struct sock_extended_err *) CMSG_DATA (cmsg);
+                        if (serr->ee_errno != 0 ||
+                            serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                                continue;
+
+                        /* [ee_info, ee_data] were sent with MSG_ZEROCOPY;
+                         * TCP reports them in order */
+                        priv->zc_completed = serr->ee_data + 1;
+                        if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                                priv->zc_copied += serr->ee_data -
+                                                   serr->ee_info + 1;
+                        reaped++;
+                        zc = _gf_true;
+                }
+
+                /* an ICMP or local error queued next to the completions */
+                if (!zc)
+                        (*others)++;
+        }
+
+        if (!reaped)
+                goto out;
+
+        __socket_zerocopy_release (priv);
+
+        /* the kernel had to copy anyway (loopback, no scatter-gather on
+         * the device): stop paying for the notifications */
+        if (priv->zerocopy && priv->zc_completed >= 64 &&
+            priv->zc_copied == priv->zc_completed) {
+                gf_log (this->name, GF_LOG_INFO, "zero-copy sends on %s are "
+                        "being copied, disabling them",
+                        this->peerinfo.identifier);
+                priv->zerocopy = _gf_false;
+        }
+out:
+#endif
+        return reaped;
+}
+
+
+/* Returns 1 if the error queue held nothing but zero-copy completions
+ * and there is no pending socket error, so that the POLLERR which
+ * signalled them can be ignored. */
+static int
+socket_zerocopy_reap (rpc_transport_t *this)
+{
+        socket_private_t *priv = NULL;
+        int               reaped = 0;
+        int               others = 0;
+        int               error = 0;
+        socklen_t         len = sizeof (error);
+        int               ret = 0;
+
+        priv = this->private;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                if (priv->sock == -1)
+                        goto unlock;
+
+                reaped = __socket_zerocopy_reap (this, &others);
+                if (!reaped || others)
+                        goto unlock;
+
+                if (getsockopt (priv->sock, SOL_SOCKET, SO_ERROR, &error,
+                                &len) == -1 || error != 0) {
+                        gf_log (this->name, GF_LOG_DEBUG, "error on %s "
+                                "along with zero-copy completions: %s",
+                                this->peerinfo.identifier,
+                                strerror (error ? error : errno));
+                        goto unlock;
+                }
+
+                ret = 1;
+        }
+unlock:
+        pthread_mutex_unlock (&priv->lock);
+
+        return ret;
+}
+
+
 /*
  * return value:
  *   0 = success (completed)
@@ -480,12 +839,13 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
                         continue;
                 }
                 if (write) {
-			if (priv->use_ssl) {
+                        this->total_write_calls++;
+			if (priv->use_ssl && !priv->ktls) {
 				ret = ssl_write_one(this,
 					opvector->iov_base, opvector->iov_len);
 			}
 			else {
-				ret = writev (sock, opvector, IOV_MIN(opcount));
+				ret = __socket_sendv (this, opvector, opcount);
 			}
 
                         if (ret == 0 || (ret == -1 && errno == EAGAIN)) {
@@ -494,7 +854,12 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
                         }
                         this->total_bytes_write += ret;
                 } else {
-			ret = __socket_cached_read (this, opvector, opcount);
+                        if (priv->rcvbuf && (!priv->use_ssl || priv->ktls))
+                                ret = __socket_buffered_read (this, opvector,
+                                                              opcount);
+                        else
+                                ret = __socket_cached_read (this, opvector,
+                                                            opcount);
 
 			if (ret == 0) {
 				gf_log(this->name,GF_LOG_DEBUG,"EOF on socket");
@@ -853,10 +1218,24 @@ __socket_reset (rpc_transport_t *this)
         GF_FREE (priv->incoming.request_info);
 
         memset (&priv->incoming, 0, sizeof (priv->incoming));
+        priv->rcvbuf_start = priv->rcvbuf_end = 0;
 
         event_unregister (this->ctx->event_pool, priv->sock, priv->idx);
 
+        if (!list_empty (&priv->zc_pending)) {
+                /* reset rather than let the kernel send pages which are
+                 * about to be reused */
+                struct linger linger = {1, 0};
+
+                setsockopt (priv->sock, SOL_SOCKET, SO_LINGER,
+                            &linger, sizeof (linger));
+        }
+
         close (priv->sock);
+
+        priv->zc_completed = priv->zc_sent;
+        __socket_zerocopy_release (priv);
+        priv->zc_active = _gf_false;
         priv->sock = -1;
         priv->idx = -1;
         priv->connected = -1;
@@ -971,6 +1350,20 @@ out:
 }
 
 
+/* Frees @entry, or parks it until the kernel is done with its pages. */
+static void
+__socket_ioq_entry_retire (socket_private_t *priv, struct ioq *entry)
+{
+        if (__socket_zerocopy_busy (priv)) {
+                entry->zc_seq = priv->zc_sent;
+                list_move_tail (&entry->list, &priv->zc_pending);
+                return;
+        }
+
+        __socket_ioq_entry_free (entry);
+}
+
+
 static void
 __socket_ioq_flush (rpc_transport_t *this)
 {
@@ -984,7 +1377,7 @@ __socket_ioq_flush (rpc_transport_t *this)
 
         while (!list_empty (&priv->ioq)) {
                 entry = priv->ioq_next;
-                __socket_ioq_entry_free (entry);
+                __socket_ioq_entry_retire (priv, entry);
         }
 
 out:
@@ -992,12 +1385,34 @@ out:
 }
 
 
+static void
+__socket_ioq_entry_done (rpc_transport_t *this, struct ioq *entry, int direct)
+{
+	socket_private_t *priv = NULL;
+	char              a_byte = 0;
+
+        priv = this->private;
+
+        __socket_ioq_entry_retire (priv, entry);
+        this->total_msgs_write++;
+        if (priv->own_thread) {
+                /*
+                 * The pipe should only remain readable if there are
+                 * more entries after this, so drain the byte
+                 * representing this entry.
+                 */
+                if (!direct && read(priv->pipe[0],&a_byte,1) < 1) {
+                        gf_log(this->name,GF_LOG_WARNING,
+                               "read error on pipe");
+                }
+        }
+}
+
+
 static int
 __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry, int direct)
 {
         int               ret = -1;
-	socket_private_t *priv = NULL;
-	char              a_byte = 0;
 
         ret = __socket_writev (this, entry->pending_vector,
                                entry->pending_count,
@@ -1007,19 +1422,92 @@ __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry, int direct)
         if (ret == 0) {
                 /* current entry was completely written */
                 GF_ASSERT (entry->pending_count == 0);
-                __socket_ioq_entry_free (entry);
-		priv = this->private;
-		if (priv->own_thread) {
-			/*
-			 * The pipe should only remain readable if there are
-			 * more entries after this, so drain the byte
-			 * representing this entry.
-			 */
-			if (!direct && read(priv->pipe[0],&a_byte,1) < 1) {
-				gf_log(this->name,GF_LOG_WARNING,
-				       "read error on pipe");
-			}
-		}
+                __socket_ioq_entry_done (this, entry, direct);
+        }
+
+        return ret;
+}
+
+
+/* Consumes @bytes from the front of the pending vector of @entry and
+ * returns what is left of @bytes once the entry is exhausted.
+ */
+static size_t
+__socket_ioq_entry_advance (struct ioq *entry, size_t bytes)
+{
+        while (bytes && entry->pending_count) {
+                if (bytes < entry->pending_vector[0].iov_len) {
+                        entry->pending_vector[0].iov_base += bytes;
+                        entry->pending_vector[0].iov_len -= bytes;
+                        return 0;
+                }
+
+                bytes -= entry->pending_vector[0].iov_len;
+                entry->pending_vector++;
+                entry->pending_count--;
+        }
+
+        while (entry->pending_count && !entry->pending_vector[0].iov_len) {
+                entry->pending_vector++;
+                entry->pending_count--;
+        }
+
+        return bytes;
+}
+
+
+/*
+ * Writes as much of the ioq as fits in GF_SOCKET_WRITEV_MAX_IOV vectors and
+ * GF_SOCKET_WRITEV_MAX_BYTES bytes with one writev, instead of one writev per
+ * message. A message is always gathered whole unless it is the first one,
+ * so that an oversized message still goes out.
+ */
+static int
+__socket_ioq_churn_coalesced (rpc_transport_t *this)
+{
+        socket_private_t *priv = NULL;
+        struct ioq       *entry = NULL;
+        struct ioq       *tmp = NULL;
+        struct iovec      vector[GF_SOCKET_WRITEV_MAX_IOV];
+        int               count = 0;
+        size_t            size = 0;
+        size_t            entry_size = 0;
+        size_t            written = 0;
+        int               ret = 0;
+
+        priv = this->private;
+
+        while (!list_empty (&priv->ioq)) {
+                count = 0;
+                size = 0;
+
+                list_for_each_entry (entry, &priv->ioq, list) {
+                        entry_size = iov_length (entry->pending_vector,
+                                                 entry->pending_count);
+                        if (count && (count + entry->pending_count >
+                                      GF_SOCKET_WRITEV_MAX_IOV ||
+                                      size + entry_size >
+                                      GF_SOCKET_WRITEV_MAX_BYTES))
+                                break;
+
+                        memcpy (&vector[count], entry->pending_vector,
+                                entry->pending_count * sizeof (*vector));
+                        count += entry->pending_count;
+                        size += entry_size;
+                }
+
+                ret = __socket_rwv (this, vector, count, NULL, NULL,
+                                    &written, 1);
+
+                list_for_each_entry_safe (entry, tmp, &priv->ioq, list) {
+                        written = __socket_ioq_entry_advance (entry, written);
+                        if (entry->pending_count)
+                                break;
+                        __socket_ioq_entry_done (this, entry, 0);
+                }
+
+                if (ret != 0)
+                        break;
         }
 
         return ret;
@@ -1038,14 +1526,18 @@ __socket_ioq_churn (rpc_transport_t *this)
 
         priv = this->private;
 
-        while (!list_empty (&priv->ioq)) {
-                /* pick next entry */
-                entry = priv->ioq_next;
+        if (priv->write_coalesce && (!priv->use_ssl || priv->ktls)) {
+                ret = __socket_ioq_churn_coalesced (this);
+        } else {
+                while (!list_empty (&priv->ioq)) {
+                        /* pick next entry */
+                        entry = priv->ioq_next;
 
-                ret = __socket_ioq_churn_entry (this, entry, 0);
+                        ret = __socket_ioq_churn_entry (this, entry, 0);
 
-                if (ret != 0)
-                        break;
+                        if (ret != 0)
+                                break;
+                }
         }
 
         if (!priv->own_thread && list_empty (&priv->ioq)) {
@@ -1059,6 +1551,133 @@ out:
 }
 
 
+/*
+ * Corking: while an event thread runs socket_event_handler, messages
+ * submitted from that thread to transports in write-coalesce mode are only
+ * queued, and the queues are written out with __socket_ioq_churn when the
+ * handler returns. Replies and requests produced by the same event then
+ * leave in as few writev calls as possible.
+ */
+struct socket_cork {
+        int              depth;
+        int              count;
+        rpc_transport_t *trans[GF_SOCKET_MAX_CORKED];
+};
+
+static pthread_key_t  socket_cork_key;
+static pthread_once_t socket_cork_once = PTHREAD_ONCE_INIT;
+
+static void
+socket_cork_key_init (void)
+{
+        pthread_key_create (&socket_cork_key, free);
+}
+
+
+static struct socket_cork *
+socket_cork_get (void)
+{
+        struct socket_cork *cork = NULL;
+
+        pthread_once (&socket_cork_once, socket_cork_key_init);
+
+        cork = pthread_getspecific (socket_cork_key);
+        if (!cork) {
+                cork = CALLOC (1, sizeof (*cork));
+                if (!cork)
+                        return NULL;
+                if (pthread_setspecific (socket_cork_key, cork) != 0) {
+                        FREE (cork);
+                        return NULL;
+                }
+        }
+
+        return cork;
+}
+
+
+/* Called with priv->lock held. Returns 1 if writes to @this are deferred
+ * to the end of the current event handler.
+ */
+static int
+__socket_cork (rpc_transport_t *this)
+{
+        socket_private_t   *priv = NULL;
+        struct socket_cork *cork = NULL;
+
+        priv = this->private;
+
+        if (priv->corked)
+                return 1;
+
+        if (!priv->write_coalesce || (priv->use_ssl && !priv->ktls) ||
+            priv->own_thread)
+                return 0;
+
+        cork = pthread_getspecific (socket_cork_key);
+        if (!cork || !cork->depth || cork->count == GF_SOCKET_MAX_CORKED)
+                return 0;
+
+        cork->trans[cork->count++] = rpc_transport_ref (this);
+        priv->corked = 1;
+
+        return 1;
+}
+
+
+static void
+socket_uncork (rpc_transport_t *this)
+{
+        socket_private_t *priv = NULL;
+        int               ret = 0;
+
+        priv = this->private;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                priv->corked = 0;
+
+                if (priv->connected == 1 && !list_empty (&priv->ioq)) {
+                        ret = __socket_ioq_churn (this);
+
+                        if (ret == -1) {
+                                __socket_disconnect (this);
+                        } else if (ret > 0) {
+                                /* continue writing on POLLOUT */
+                                priv->idx = event_select_on (
+                                                this->ctx->event_pool,
+                                                priv->sock, priv->idx, -1, 1);
+                        }
+                }
+        }
+        pthread_mutex_unlock (&priv->lock);
+}
+
+
+static void
+socket_cork_begin (struct socket_cork *cork)
+{
+        if (cork)
+                cork->depth++;
+}
+
+
+static void
+socket_cork_end (struct socket_cork *cork)
+{
+        rpc_transport_t *trans = NULL;
+
+        if (!cork || --cork->depth)
+                return;
+
+        while (cork->count) {
+                trans = cork->trans[--cork->count];
+                socket_uncork (trans);
+                rpc_transport_unref (trans);
+        }
+}
+
+
 static int
 socket_event_poll_err (rpc_transport_t *this)
 {
@@ -2086,6 +2705,7 @@ __socket_proto_state_machine (rpc_transport_t *this,
         }
 
         if (in->record_state == SP_STATE_COMPLETE) {
+                this->total_msgs_read++;
                 in->record_state = SP_STATE_NADA;
                 __socket_reset_priv (priv);
         }
@@ -2221,9 +2841,10 @@ static int
 socket_event_handler (int fd, int idx, void *data,
                       int poll_in, int poll_out, int poll_err)
 {
-        rpc_transport_t  *this = NULL;
-        socket_private_t *priv = NULL;
-	int               ret = -1;
+        rpc_transport_t    *this = NULL;
+        socket_private_t   *priv = NULL;
+        struct socket_cork *cork = NULL;
+	int                 ret = -1;
 
         this = data;
         GF_VALIDATE_OR_GOTO ("socket", this, out);
@@ -2233,12 +2854,19 @@ socket_event_handler (int fd, int idx, void *data,
         THIS = this->xl;
         priv = this->private;
 
+        cork = socket_cork_get ();
+        socket_cork_begin (cork);
+
         pthread_mutex_lock (&priv->lock);
         {
                 priv->idx = idx;
         }
         pthread_mutex_unlock (&priv->lock);
 
+        /* completions of zero-copy sends are signalled as errors */
+        if (poll_err && priv->zc_active && socket_zerocopy_reap (this))
+                poll_err = 0;
+
 	ret = (priv->connected == 1) ? 0 : socket_connect_finish(this);
 
         if (!ret && poll_out) {
@@ -2246,7 +2874,13 @@ socket_event_handler (int fd, int idx, void *data,
         }
 
         if (!ret && poll_in) {
-                ret = socket_event_poll_in (this);
+                /* Records already pulled into the receive buffer will not
+                 * be signalled by poll again, so handle them all here; a
+                 * throttle takes effect at the next read from the socket.
+                 */
+                do {
+                        ret = socket_event_poll_in (this);
+                } while (!ret && socket_rcvbuf_pending (priv));
         }
 
         if ((ret < 0) || poll_err) {
@@ -2257,11 +2891,65 @@ socket_event_handler (int fd, int idx, void *data,
                 rpc_transport_unref (this);
 	}
 
+        socket_cork_end (cork);
+
 out:
 	return ret;
 }
 
 
+/*
+ * The handshake is done by the own thread, where it may block, and with the
+ * keys in the kernel the connection is left to the event threads from then
+ * on. Requests queued meanwhile are written once the socket is writable.
+ */
+static int
+socket_ktls_handoff (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+        glusterfs_ctx_t  *ctx = this->ctx;
+        int               ret = -1;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                /* disconnected while in the handshake */
+                if (priv->ot_state == OT_PLEASE_DIE || priv->sock == -1)
+                        goto unlock;
+
+                priv->own_thread = _gf_false;
+                priv->ot_state = OT_IDLE;
+                close (priv->pipe[0]);
+                close (priv->pipe[1]);
+                priv->pipe[0] = priv->pipe[1] = -1;
+
+                priv->idx = event_register (ctx->event_pool, priv->sock,
+                                            socket_event_handler, this, 1,
+                                            !priv->connected ||
+                                            !list_empty (&priv->ioq));
+                if (priv->idx == -1) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "failed to register the socket with event");
+                        goto unlock;
+                }
+                ret = 0;
+        }
+unlock:
+        pthread_mutex_unlock (&priv->lock);
+
+        if (ret)
+                return ret;
+
+        gf_log (this->name, GF_LOG_DEBUG, "%s handed to the event threads",
+                this->peerinfo.identifier);
+
+        /* clients notify from socket_connect_finish on the first event */
+        if (priv->connected)
+                rpc_transport_notify (this->listener, RPC_TRANSPORT_ACCEPT,
+                                      this);
+        return 0;
+}
+
+
 static void *
 socket_poller (void *ctx)
 {
@@ -2300,6 +2988,12 @@ socket_poller (void *ctx)
                 }
         }
 
+        if (priv->ktls_handoff && priv->ktls) {
+                if (socket_ktls_handoff (this) == 0)
+                        return NULL;
+                goto err;
+        }
+
         if (priv->connected == 0) {
 		THIS = this->xl;
                 ret = socket_connect_finish (this);
@@ -2592,6 +3286,17 @@ socket_server_event_handler (int fd, int idx, void *data,
 
 			new_priv->sock = new_sock;
 			new_priv->own_thread = priv->own_thread;
+                        new_priv->ktls_handoff = priv->ktls_handoff;
+                        new_priv->write_coalesce = priv->write_coalesce;
+                        new_priv->zerocopy = priv->zerocopy;
+                        __socket_zerocopy_enable (new_trans,
+                                                  new_sockaddr.ss_family);
+                        if (priv->rcvbuf && socket_rcvbuf_alloc (new_priv)) {
+                                close (new_sock);
+                                GF_FREE (new_trans->name);
+                                GF_FREE (new_trans);
+                                goto unlock;
+                        }
 
                         new_priv->ssl_ctx = priv->ssl_ctx;
 			if (new_priv->use_ssl && !new_priv->own_thread) {
@@ -2661,7 +3366,7 @@ socket_server_event_handler (int fd, int idx, void *data,
                                 goto unlock;
                         }
 
-                        if (!priv->own_thread) {
+                        if (!new_priv->own_thread) {
                                 ret = rpc_transport_notify (this,
                                         RPC_TRANSPORT_ACCEPT, new_trans);
                         }
@@ -2781,6 +3486,12 @@ socket_connect (rpc_transport_t *this, int port)
                         "connecting %p, state=%u gen=%u sock=%d", this,
                         priv->ot_state, priv->ot_gen, priv->sock);
 
+                /* The last connection may have been handed to the event
+                 * threads; the handshake of this one is done by its own
+                 * thread again. */
+                if (priv->ktls_handoff)
+                        priv->own_thread = _gf_true;
+
                 ret = socket_client_get_remote_sockaddr (this, &sock_union.sa,
                                                      &sockaddr_len, &sa_family);
                 if (ret == -1) {
@@ -2859,6 +3570,8 @@ socket_connect (rpc_transport_t *this, int port)
                                         strerror (errno));
                 }
 
+                __socket_zerocopy_enable (this, sa_family);
+
                 SA (&this->myinfo.sockaddr)->sa_family =
                         SA (&this->peerinfo.sockaddr)->sa_family;
 
@@ -3211,7 +3924,7 @@ socket_submit_request (rpc_transport_t *this, rpc_transport_req_t *req)
                 if (!entry)
                         goto unlock;
 
-                if (list_empty (&priv->ioq)) {
+                if (list_empty (&priv->ioq) && !__socket_cork (this)) {
                         ret = __socket_ioq_churn_entry (this, entry, 1);
 
                         if (ret == 0) {
@@ -3285,7 +3998,7 @@ socket_submit_reply (rpc_transport_t *this, rpc_transport_reply_t *reply)
                 if (!entry)
                         goto unlock;
 
-                if (list_empty (&priv->ioq)) {
+                if (list_empty (&priv->ioq) && !__socket_cork (this)) {
                         ret = __socket_ioq_churn_entry (this, entry, 1);
 
                         if (ret == 0) {
@@ -3530,6 +4243,7 @@ socket_init (rpc_transport_t *this)
 	int               session_id = 0;
         int32_t           cert_depth = 1;
         char             *cipher_list = "HIGH:-SSLv2";
+        gf_boolean_t      batch_read = _gf_false;
         int               ret;
 
         if (this->private) {
@@ -3553,6 +4267,7 @@ socket_init (rpc_transport_t *this)
         priv->bio = 0;
         priv->windowsize = GF_DEFAULT_SOCKET_WINDOW_SIZE;
         INIT_LIST_HEAD (&priv->ioq);
+        INIT_LIST_HEAD (&priv->zc_pending);
 
         /* All the below section needs 'this->options' to be present */
         if (!this->options)
@@ -3596,6 +4311,44 @@ socket_init (rpc_transport_t *this)
                 }
         }
 
+        optstr = NULL;
+        if (dict_get_str (this->options, "transport.socket.write-coalesce",
+                          &optstr) == 0) {
+                if (gf_string2boolean (optstr, &tmp_bool) == -1) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "'transport.socket.write-coalesce' takes only "
+                                "boolean options, not taking any action");
+                        tmp_bool = 0;
+                }
+                priv->write_coalesce = tmp_bool;
+                gf_log (this->name, GF_LOG_DEBUG, "write coalescing %s",
+                        tmp_bool ? "enabled" : "disabled");
+        }
+
+        optstr = NULL;
+        if (dict_get_str (this->options, "transport.socket.batch-read",
+                          &optstr) == 0) {
+                if (gf_string2boolean (optstr, &tmp_bool) == -1) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "'transport.socket.batch-read' takes only "
+                                "boolean options, not taking any action");
+                        tmp_bool = 0;
+                }
+                batch_read = tmp_bool;
+        }
+
+        optstr = NULL;
+        if (dict_get_str (this->options, "transport.socket.zerocopy-send",
+                          &optstr) == 0) {
+                if (gf_string2boolean (optstr, &tmp_bool) == -1) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "'transport.socket.zerocopy-send' takes only "
+                                "boolean options, not taking any action");
+                        tmp_bool = 0;
+                }
+                priv->zerocopy = tmp_bool;
+        }
+
         optstr = NULL;
         if (dict_get_str (this->options, "tcp-window-size",
                           &optstr) == 0) {
@@ -3705,6 +4458,30 @@ socket_init (rpc_transport_t *this)
 	}
         priv->ssl_ca_list = gf_strdup(priv->ssl_ca_list);
 
+	if (dict_get_str(this->options,SSL_KTLS_OPT,&optstr) == 0) {
+                if (gf_string2boolean (optstr, &priv->ssl_ktls) != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+				"invalid value given for ssl-ktls boolean");
+		}
+#ifndef GF_SOCKET_HAVE_KTLS
+                if (priv->ssl_ktls) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "%s: kTLS not supported by this OpenSSL "
+                                "(ignored)", SSL_KTLS_OPT);
+                        priv->ssl_ktls = _gf_false;
+                }
+#endif
+	}
+
+	if (dict_get_str(this->options,SSL_SESSION_CACHE_OPT,&optstr) == 0) {
+                if (gf_string2boolean (optstr,
+                                       &priv->ssl_session_cache) != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+				"invalid value given for ssl-session-cache "
+                                "boolean");
+		}
+	}
+
         gf_log(this->name, priv->ssl_enabled ? GF_LOG_INFO: GF_LOG_DEBUG,
                "SSL support on the I/O path is %s",
                priv->ssl_enabled ? "ENABLED" : "NOT enabled");
@@ -3717,13 +4494,21 @@ socket_init (rpc_transport_t *this)
          */
         priv->use_ssl = priv->ssl_enabled;
 
+        /*
+         * SSL_read and SSL_write block, hence the own thread. With kTLS the
+         * own thread still does the handshake, which blocks as well, and
+         * hands the connection to the event threads if the kernel took
+         * the keys.
+         */
 	priv->own_thread = priv->use_ssl;
+        priv->ktls_handoff = priv->use_ssl && priv->ssl_ktls;
 	if (dict_get_str(this->options,OWN_THREAD_OPT,&optstr) == 0) {
                 gf_log (this->name, GF_LOG_INFO, "OWN_THREAD_OPT found");
                 if (gf_string2boolean (optstr, &priv->own_thread) != 0) {
                         gf_log (this->name, GF_LOG_WARNING,
 				"invalid value given for own-thread boolean");
 		}
+                priv->ktls_handoff = _gf_false;
 	}
 	gf_log(this->name, priv->own_thread ? GF_LOG_INFO: GF_LOG_DEBUG,
                "using %s polling thread",
@@ -3741,7 +4526,12 @@ socket_init (rpc_transport_t *this)
 	if (priv->ssl_enabled || priv->mgmt_ssl) {
 		SSL_library_init();
 		SSL_load_error_strings();
-		priv->ssl_meth = (SSL_METHOD *)TLSv1_method();
+                if (priv->ssl_ktls) {
+                        /* kTLS needs TLS 1.2 at least */
+                        priv->ssl_meth = (SSL_METHOD *)SSLv23_method();
+                } else {
+                        priv->ssl_meth = (SSL_METHOD *)TLSv1_method();
+                }
 		priv->ssl_ctx = SSL_CTX_new(priv->ssl_meth);
 
                 if (SSL_CTX_set_cipher_list(priv->ssl_ctx, cipher_list) == 0) {
@@ -3782,10 +4572,44 @@ socket_init (rpc_transport_t *this)
 					       sizeof(priv->ssl_session_id));
 
 		SSL_CTX_set_verify(priv->ssl_ctx,SSL_VERIFY_PEER,0);
+
+                /*
+                 * With the session cache, clients keep the session of a
+                 * connection to offer it on the next one (q.v.
+                 * ssl_setup_connection), and servers take it back from a
+                 * session ticket or their own cache. Without, servers
+                 * hand out no tickets and keep no sessions.
+                 */
+                if (!priv->ssl_session_cache) {
+                        SSL_CTX_set_options(priv->ssl_ctx, SSL_OP_NO_TICKET);
+                        SSL_CTX_set_session_cache_mode(priv->ssl_ctx,
+                                                       SSL_SESS_CACHE_OFF);
+                }
+
+#ifdef GF_SOCKET_HAVE_KTLS
+                /*
+                 * The kernel then only sees application data: there must
+                 * be no renegotiation, nor the post-handshake messages of
+                 * TLS 1.3, which OpenSSL does not do kTLS receive for
+                 * anyway.
+                 */
+                if (priv->ssl_ktls) {
+                        SSL_CTX_set_options(priv->ssl_ctx,
+                                            SSL_OP_NO_SSLv2 |
+                                            SSL_OP_NO_SSLv3 |
+                                            SSL_OP_NO_TLSv1_3 |
+                                            SSL_OP_NO_RENEGOTIATION |
+                                            SSL_OP_ENABLE_KTLS);
+                }
+#endif
 	}
 
         if (priv->own_thread) {
                 priv->ot_state = OT_IDLE;
+        } else if (batch_read) {
+                if (socket_rcvbuf_alloc (priv))
+                        goto err;
+                gf_log (this->name, GF_LOG_DEBUG, "batch-read enabled");
         }
 
 out:
@@ -3829,6 +4653,10 @@ fini (rpc_transport_t *this)
                         "transport %p destroyed", this);
 
                 pthread_mutex_destroy (&priv->lock);
+                GF_FREE (priv->rcvbuf);
+                if (priv->ssl_session) {
+                        SSL_SESSION_free (priv->ssl_session);
+                }
 		if (priv->ssl_private_key) {
 			GF_FREE(priv->ssl_private_key);
 		}
@@ -3915,6 +4743,30 @@ struct volume_options options[] = {
         { .key   = {"transport.socket.read-fail-log"},
           .type  = GF_OPTION_TYPE_BOOL
         },
+        { .key   = {"transport.socket.zerocopy-send"},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Send writes of 32KB or more with MSG_ZEROCOPY, "
+                         "so that READ replies and WRITE payloads are not "
+                         "copied into the socket buffer. Only TCP "
+                         "connections without SSL use it."
+        },
+        { .key   = {"transport.socket.batch-read"},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Read all the data available on a connection into "
+                         "a 64KB buffer and parse as many RPC records out of "
+                         "it as it holds, instead of reading every record "
+                         "header and fragment separately."
+        },
+        { .key   = {"transport.socket.write-coalesce"},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Write the queued messages of a connection with "
+                         "one writev where possible, and hold back the "
+                         "messages an event thread sends while handling an "
+                         "event until the handler returns."
+        },
         { .key   = {SSL_ENABLED_OPT},
           .type  = GF_OPTION_TYPE_BOOL
         },
@@ -3930,6 +4782,24 @@ struct volume_options options[] = {
 	{ .key   = {OWN_THREAD_OPT},
 	  .type  = GF_OPTION_TYPE_BOOL
 	},
+        { .key   = {SSL_KTLS_OPT},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Have the kernel encrypt and decrypt the TLS "
+                         "records once OpenSSL has done the handshake in "
+                         "the own thread of the connection, which then "
+                         "hands it to the event threads like plain ones. "
+                         "Needs TLS 1.2, an AES-GCM cipher and the kernel "
+                         "tls module; connections without keep their own "
+                         "thread as before."
+        },
+        { .key   = {SSL_SESSION_CACHE_OPT},
+          .type  = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Resume the TLS session of the previous connection "
+                         "to the same server on reconnect, instead of doing "
+                         "a full handshake."
+        },
         { .key = {"ssl-cert-depth"},
           .type = GF_OPTION_TYPE_INT,
           .description = "Maximum certificate-chain depth.  If zero, the "
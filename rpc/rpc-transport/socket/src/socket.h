@@ -47,6 +47,26 @@
 #define GF_MIN_SOCKET_WINDOW_SIZE       (0)
 #define GF_USE_DEFAULT_KEEPALIVE        (-1)
 
+/* Budgets for one coalesced writev over several queued messages, and the
+ * number of transports one event thread may hold corked at a time.
+ */
+#define GF_SOCKET_WRITEV_MAX_IOV        (256)
+#define GF_SOCKET_WRITEV_MAX_BYTES      (1 * GF_UNIT_MB)
+#define GF_SOCKET_MAX_CORKED            (64)
+
+/* Size of the receive buffer of a connection in batch-read mode. Reads of
+ * at least GF_SOCKET_RCVBUF_DIRECT bytes go straight to the caller's
+ * vector when the buffer is empty, so that bulk payloads are not copied.
+ */
+#define GF_SOCKET_RCVBUF_SIZE           (64 * GF_UNIT_KB)
+#define GF_SOCKET_RCVBUF_DIRECT         (GF_SOCKET_RCVBUF_SIZE / 4)
+
+/* Writes of at least this many bytes are sent with MSG_ZEROCOPY when
+ * zero-copy send is enabled; below it the copy is cheaper than the page
+ * pinning and the completion notification.
+ */
+#define GF_SOCKET_ZEROCOPY_MIN          (32 * GF_UNIT_KB)
+
 typedef enum {
         SP_STATE_NADA = 0,
         SP_STATE_COMPLETE,
@@ -106,6 +126,8 @@ struct ioq {
         struct iovec      *pending_vector;
         int                pending_count;
         struct iobref     *iobref;
+        char               zerocopy;  /* sent (partly) with MSG_ZEROCOPY */
+        uint32_t           zc_seq;    /* zero-copy sends to wait for */
 };
 
 typedef struct {
@@ -235,6 +257,27 @@ typedef struct {
         ot_state_t             ot_state;
         uint32_t               ot_gen;
         gf_boolean_t           is_server;
+        gf_boolean_t           write_coalesce;
+        gf_boolean_t           corked;
+        char                  *rcvbuf;
+        size_t                 rcvbuf_start;
+        size_t                 rcvbuf_end;
+        gf_boolean_t           zerocopy;        /* configured */
+        gf_boolean_t           zc_active;       /* SO_ZEROCOPY is set */
+        uint32_t               zc_sent;         /* MSG_ZEROCOPY sends */
+        uint32_t               zc_completed;    /* ... reported done */
+        uint64_t               zc_copied;       /* done, but copied */
+        struct list_head       zc_pending;      /* ioq entries whose pages
+                                                   the kernel still uses */
+        gf_boolean_t           ssl_ktls;        /* configured */
+        gf_boolean_t           ktls;            /* the kernel does the TLS
+                                                   records of this
+                                                   connection */
+        gf_boolean_t           ktls_handoff;    /* own thread only until
+                                                   the handshake is done */
+        gf_boolean_t           ssl_session_cache;
+        SSL_SESSION           *ssl_session;     /* client side, to resume */
+        struct sockaddr_storage ssl_session_peer; /* it was made with */
 } socket_private_t;
 
 
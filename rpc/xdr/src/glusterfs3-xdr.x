@@ -615,6 +615,44 @@ struct gfs3_fstat_req {
         opaque   xdata<>;
 }  ;
 
+enum gfs3_compound_op {
+        GFS3_COMPOUND_FXATTROP = 1,
+        GFS3_COMPOUND_FINODELK
+};
+
+ struct gfs3_compound_lk_rsp {
+        int    op_ret;
+        int    op_errno;
+        opaque   xdata<>;
+}  ;
+
+union gfs3_compound_req_member switch (gfs3_compound_op op) {
+        case GFS3_COMPOUND_FXATTROP:
+                gfs3_fxattrop_req fxattrop_req;
+        case GFS3_COMPOUND_FINODELK:
+                gfs3_finodelk_req finodelk_req;
+};
+
+union gfs3_compound_rsp_member switch (gfs3_compound_op op) {
+        case GFS3_COMPOUND_FXATTROP:
+                gfs3_fxattrop_rsp fxattrop_rsp;
+        case GFS3_COMPOUND_FINODELK:
+                gfs3_compound_lk_rsp finodelk_rsp;
+};
+
+/* The members are carried out in order. */
+ struct gfs3_compound_req {
+        gfs3_compound_req_member members<>;
+        opaque   xdata<>;
+}  ;
+
+ struct gfs3_compound_rsp {
+        int    op_ret;
+        int    op_errno;
+        gfs3_compound_rsp_member members<>;
+        opaque   xdata<>;
+}  ;
+
 
  struct gfs3_rchecksum_req {
         quad_t   fd;
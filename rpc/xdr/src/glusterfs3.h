@@ -78,6 +78,28 @@
                 }                                       \
         } while (0)
 
+/* Like GF_PROTOCOL_DICT_UNSERIALIZE, for an xdata which an xdrf_to_ ()
+ * decoder left in a message received into the iobufs of @iobref: its large
+ * values are borrowed from there. */
+#define GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED(xl,to,buff,len,iobref,ret,   \
+                                              ope,labl) do {                \
+                if (!len)                                               \
+                        break;                                          \
+                to = dict_new();                                        \
+                GF_VALIDATE_OR_GOTO (xl->name, to, labl);               \
+                                                                        \
+                ret = xdr_to_dict (iobref, buff, len, &to);             \
+                if (ret < 0) {                                          \
+                        gf_log (xl->name, GF_LOG_WARNING,               \
+                                "failed to unserialize dictionary (%s)", \
+                                (#to));                                 \
+                                                                        \
+                        ope = EINVAL;                                   \
+                        goto labl;                                      \
+                }                                                       \
+                                                                        \
+        } while (0)
+
 static inline uint32_t
 gf_flags_from_flags (uint32_t flags)
 {
@@ -267,4 +289,32 @@ gf_stat_from_iatt (struct gf_iatt *gf_stat, struct iatt *iatt)
 	gf_stat->ia_ctime_nsec = iatt->ia_ctime_nsec ;
 }
 
+
+static inline gfs3_compound_op
+gf_compound_op_from_fop (glusterfs_fop_t fop)
+{
+        switch (fop) {
+        case GF_FOP_FXATTROP:
+                return GFS3_COMPOUND_FXATTROP;
+        case GF_FOP_FINODELK:
+                return GFS3_COMPOUND_FINODELK;
+        default:
+                return 0;
+        }
+}
+
+
+static inline glusterfs_fop_t
+gf_compound_op_to_fop (gfs3_compound_op op)
+{
+        switch (op) {
+        case GFS3_COMPOUND_FXATTROP:
+                return GF_FOP_FXATTROP;
+        case GFS3_COMPOUND_FINODELK:
+                return GF_FOP_FINODELK;
+        default:
+                return GF_FOP_NULL;
+        }
+}
+
 #endif /* !_GLUSTERFS3_H */
@@ -0,0 +1,226 @@
+/*
+  Copyright (c) 2015 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+/* Primitives of the specialized XDR encoders and decoders that
+ * build-aux/xdrfastgen generates for the hot types of a .x file. They work
+ * on the structures rpcgen defines and produce and accept the same bytes as
+ * the rpcgen routines, without going through an XDR stream.
+ *
+ * Decoding differs from rpcgen in where the variable length fields end up:
+ * opaque<> fields point into the buffer being decoded, and strings and the
+ * entries of lists are placed in an arena the caller provides, on its stack
+ * or in an iobuf. Nothing is allocated, so nothing is to be freed, but the
+ * decoded structure lives only as long as the buffer and the arena.
+ */
+
+#ifndef _XDR_FAST_H
+#define _XDR_FAST_H
+
+#include <string.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include <rpc/types.h>
+#include <rpc/xdr.h>
+
+#include "compat.h"
+
+#define XDRF_UNIT               4
+#define XDRF_ROUND_UP(len)      (((len) + XDRF_UNIT - 1) & ~(XDRF_UNIT - 1))
+
+typedef struct xdrf {
+        char   *base;
+        char   *pos;
+        char   *end;
+        char   *arena;          /* strings and list entries, on decode */
+        char   *arena_end;
+} xdrf_t;
+
+typedef size_t (*xdrf_sizeof_t) (void *objp);
+typedef int (*xdrf_encode_t) (xdrf_t *x, void *objp);
+typedef int (*xdrf_decode_t) (xdrf_t *x, void *objp);
+
+/* the encoder standing in for an rpcgen routine */
+struct xdrf_proc {
+        xdrproc_t       proc;
+        xdrf_sizeof_t   size;
+        xdrf_encode_t   encode;
+};
+
+#define XDRF_PROC(type) { (xdrproc_t) xdr_##type,                       \
+                          (xdrf_sizeof_t) xdrf_sizeof_##type,           \
+                          (xdrf_encode_t) xdrf_encode_##type }
+
+static inline void
+xdrf_init (xdrf_t *x, void *buf, size_t len, void *arena, size_t arena_len)
+{
+        x->base      = buf;
+        x->pos       = buf;
+        x->end       = x->pos + len;
+        x->arena     = arena;
+        x->arena_end = arena ? x->arena + arena_len : NULL;
+}
+
+static inline size_t
+xdrf_length (xdrf_t *x)
+{
+        return x->pos - x->base;
+}
+
+static inline int
+xdrf_has (xdrf_t *x, size_t len)
+{
+        return (size_t)(x->end - x->pos) >= len;
+}
+
+static inline void *
+xdrf_alloc (xdrf_t *x, size_t size)
+{
+        char *ptr = x->arena;
+
+        size = (size + 7) & ~(size_t)7;
+        if (!ptr || (size_t)(x->arena_end - ptr) < size)
+                return NULL;
+
+        x->arena += size;
+        return ptr;
+}
+
+static inline void
+xdrf_put_u32 (xdrf_t *x, uint32_t val)
+{
+        val = htonl (val);
+        memcpy (x->pos, &val, sizeof (val));
+        x->pos += sizeof (val);
+}
+
+static inline uint32_t
+xdrf_get_u32 (xdrf_t *x)
+{
+        uint32_t val = 0;
+
+        memcpy (&val, x->pos, sizeof (val));
+        x->pos += sizeof (val);
+        return ntohl (val);
+}
+
+static inline void
+xdrf_put_u64 (xdrf_t *x, uint64_t val)
+{
+        xdrf_put_u32 (x, val >> 32);
+        xdrf_put_u32 (x, val & 0xffffffff);
+}
+
+static inline uint64_t
+xdrf_get_u64 (xdrf_t *x)
+{
+        uint64_t val = 0;
+
+        val = (uint64_t)xdrf_get_u32 (x) << 32;
+        return val | xdrf_get_u32 (x);
+}
+
+/* opaque, with its padding */
+static inline void
+xdrf_put_opaque (xdrf_t *x, const char *buf, u_int len)
+{
+        u_int pad = XDRF_ROUND_UP (len) - len;
+
+        if (len)
+                memcpy (x->pos, buf, len);
+        x->pos += len;
+
+        if (pad) {
+                memset (x->pos, 0, pad);
+                x->pos += pad;
+        }
+}
+
+static inline void
+xdrf_get_opaque (xdrf_t *x, char *buf, u_int len)
+{
+        memcpy (buf, x->pos, len);
+        x->pos += XDRF_ROUND_UP (len);
+}
+
+static inline int
+xdrf_put_bytes (xdrf_t *x, const char *buf, u_int len, u_int max)
+{
+        if (len > max)
+                return -1;
+
+        xdrf_put_u32 (x, len);
+        xdrf_put_opaque (x, buf, len);
+
+        return 0;
+}
+
+static inline size_t
+xdrf_sizeof_string (const char *str)
+{
+        return XDRF_UNIT + (str ? XDRF_ROUND_UP (strlen (str)) : 0);
+}
+
+static inline int
+xdrf_put_string (xdrf_t *x, const char *str, u_int max)
+{
+        if (!str)
+                return -1;
+
+        return xdrf_put_bytes (x, str, strlen (str), max);
+}
+
+/* opaque<>, borrowed from the buffer being decoded */
+static inline int
+xdrf_get_bytes (xdrf_t *x, char **val, u_int *lenp, u_int max)
+{
+        u_int len = 0;
+
+        if (!xdrf_has (x, XDRF_UNIT))
+                return -1;
+
+        len = xdrf_get_u32 (x);
+        if (len > max || !xdrf_has (x, XDRF_ROUND_UP ((size_t)len)))
+                return -1;
+
+        *lenp = len;
+        *val = len ? x->pos : NULL;
+        x->pos += XDRF_ROUND_UP (len);
+
+        return 0;
+}
+
+/* string<>, copied to the arena to be NUL terminated */
+static inline int
+xdrf_get_string (xdrf_t *x, char **str, u_int max)
+{
+        u_int  len = 0;
+        char  *dst = NULL;
+
+        if (!xdrf_has (x, XDRF_UNIT))
+                return -1;
+
+        len = xdrf_get_u32 (x);
+        if (len > max || !xdrf_has (x, XDRF_ROUND_UP ((size_t)len)))
+                return -1;
+
+        dst = xdrf_alloc (x, (size_t)len + 1);
+        if (!dst)
+                return -1;
+
+        memcpy (dst, x->pos, len);
+        dst[len] = '\0';
+        *str = dst;
+        x->pos += XDRF_ROUND_UP (len);
+
+        return 0;
+}
+
+#endif /* !_XDR_FAST_H */
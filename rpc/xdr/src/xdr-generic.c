@@ -9,18 +9,53 @@
 */
 
 
+#include <string.h>
+#include <arpa/inet.h>
+
 #include "xdr-generic.h"
+#include "glusterfs3-xdr-fast.h"
+#include "rpc-common-xdr-fast.h"
+
+/* the types with a generated encoder, used in place of the rpcgen one */
+static struct xdrf_proc xdrf_procs[] = {
+        XDRF_GLUSTERFS3_XDR_PROCS,
+        XDRF_RPC_COMMON_XDR_PROCS,
+        { NULL, NULL, NULL }
+};
+
+static struct xdrf_proc *
+xdrf_proc_lookup (xdrproc_t proc)
+{
+        struct xdrf_proc *fp = NULL;
+
+        for (fp = xdrf_procs; fp->proc; fp++) {
+                if (fp->proc == proc)
+                        return fp;
+        }
 
+        return NULL;
+}
 
 ssize_t
 xdr_serialize_generic (struct iovec outmsg, void *res, xdrproc_t proc)
 {
-        ssize_t ret = -1;
-        XDR     xdr;
+        ssize_t           ret = -1;
+        XDR               xdr;
+        xdrf_t            x;
+        struct xdrf_proc *fp  = NULL;
 
         if ((!outmsg.iov_base) || (!res) || (!proc))
                 return -1;
 
+        fp = xdrf_proc_lookup (proc);
+        if (fp) {
+                xdrf_init (&x, outmsg.iov_base, outmsg.iov_len, NULL, 0);
+                if (fp->encode (&x, res))
+                        return -1;
+
+                return xdrf_length (&x);
+        }
+
         xdrmem_create (&xdr, outmsg.iov_base, (unsigned int)outmsg.iov_len,
                        XDR_ENCODE);
 
@@ -123,3 +158,96 @@ xdr_vector_round_up (struct iovec *vec, int vcount, uint32_t count)
 
         vec[vcount-1].iov_len += round_count;
 }
+
+
+/*
+ * The opaque xdata<> dict is the last field of every request and reply of
+ * the GlusterFS fop program. On the way out it can therefore be serialized
+ * straight into the outgoing buffer after the rest of the message, and on
+ * the way in it can be found in place at the end of the received one.
+ */
+
+#define XDR_ROUND_UP(len) (((len) + XDR_BYTES_PER_UNIT - 1) &            \
+                           ~(XDR_BYTES_PER_UNIT - 1))
+
+ssize_t
+xdr_sizeof_xdata (xdrproc_t proc, void *res, dict_t *xdata)
+{
+        ssize_t           size = 0;
+        int               len  = 0;
+        struct xdrf_proc *fp   = NULL;
+
+        fp = xdrf_proc_lookup (proc);
+        if (fp)
+                size = fp->size (res);
+        else
+                size = xdr_sizeof (proc, res);
+
+        if (xdata) {
+                len = dict_serialized_length (xdata);
+                if (len < 0)
+                        return -1;
+                size += XDR_ROUND_UP (len);
+        }
+
+        return size;
+}
+
+
+/* @res must have been filled in with an empty xdata; its encoding then
+ * ends with a zero length word, which is replaced by the length of @xdata,
+ * serialized directly after it. The result is byte for byte what encoding
+ * @res with the serialized dict as its xdata would produce. */
+ssize_t
+xdr_serialize_generic_xdata (struct iovec outmsg, void *res, xdrproc_t proc,
+                             dict_t *xdata)
+{
+        ssize_t   ret     = -1;
+        int32_t   len     = 0;
+        uint32_t  netlen  = 0;
+        char     *base    = outmsg.iov_base;
+
+        ret = xdr_serialize_generic (outmsg, res, proc);
+        if (ret < 0 || !xdata)
+                return ret;
+
+        if (ret < XDR_BYTES_PER_UNIT)
+                return -1;
+
+        memcpy (&netlen, base + ret - XDR_BYTES_PER_UNIT, sizeof (netlen));
+        if (netlen != 0)
+                return -1;
+
+        len = dict_serialize_into (xdata, base + ret, outmsg.iov_len - ret);
+        if (len < 0)
+                return -1;
+
+        if (ret + XDR_ROUND_UP (len) > outmsg.iov_len)
+                return -1;
+
+        netlen = htonl (len);
+        memcpy (base + ret - XDR_BYTES_PER_UNIT, &netlen, sizeof (netlen));
+
+        memset (base + ret + len, 0, XDR_ROUND_UP (len) - len);
+
+        return ret + XDR_ROUND_UP (len);
+}
+
+
+/* @buf is the xdata of a message, which the xdrf_to_ () decoders leave in
+ * place. When it lies in one of the iobufs of @iobref, the dict borrows its
+ * large values from there instead of copying them; an xdata that rpcgen
+ * decoded into a buffer of its own is copied as before. */
+int
+xdr_to_dict (struct iobref *iobref, char *buf, u_int len, dict_t **fill)
+{
+        struct iobuf *iobuf = NULL;
+
+        if (iobref && buf)
+                iobuf = iobref_find (iobref, buf, len);
+
+        if (iobuf)
+                return dict_unserialize_borrowed (buf, len, fill, iobuf);
+
+        return dict_unserialize (buf, len, fill);
+}
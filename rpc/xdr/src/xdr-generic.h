@@ -16,6 +16,8 @@
 #include <rpc/xdr.h>
 
 #include "compat.h"
+#include "dict.h"
+#include "iobuf.h"
 
 #define xdr_decoded_remaining_addr(xdr)        ((&xdr)->x_private)
 #define xdr_decoded_remaining_len(xdr)         ((&xdr)->x_handy)
@@ -72,4 +74,14 @@ xdr_length_round_up (size_t len, size_t bufsize);
 void
 xdr_vector_round_up (struct iovec *vec, int vcount, uint32_t count);
 
+ssize_t
+xdr_sizeof_xdata (xdrproc_t proc, void *res, dict_t *xdata);
+
+ssize_t
+xdr_serialize_generic_xdata (struct iovec outmsg, void *res, xdrproc_t proc,
+                             dict_t *xdata);
+
+int
+xdr_to_dict (struct iobref *iobref, char *buf, u_int len, dict_t **fill);
+
 #endif /* !_XDR_GENERIC_H */
@@ -0,0 +1,29 @@
+#!/bin/bash
+
+#Checks that writes through a replica with the post-op and unlock sent as a
+#compound fop leave no pending changelog behind on the bricks
+. $(dirname $0)/../../include.rc
+. $(dirname $0)/../../volume.rc
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 replica 2 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 cluster.use-compound-fops on
+TEST $CLI volume set $V0 cluster.eager-lock off
+TEST $CLI volume start $V0
+
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0;
+TEST dd if=/dev/urandom of=$M0/file count=16 bs=128k
+file_md5sum=$(md5sum $M0/file | awk '{print $1}')
+TEST setfattr -n user.test -v value $M0/file
+
+EXPECT "0x000000000000000000000000" afr_get_changelog_xattr $B0/${V0}0/file trusted.afr.$V0-client-1
+EXPECT "0x000000000000000000000000" afr_get_changelog_xattr $B0/${V0}1/file trusted.afr.$V0-client-0
+
+TEST umount $M0
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0;
+EXPECT "$file_md5sum" echo $(md5sum $M0/file | awk '{print $1}')
+
+cleanup;
@@ -0,0 +1,84 @@
+#!/bin/bash
+
+#Runs I/O over several connections per brick, and across a brick restart
+#which takes all the connections of a client down
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#Number of connections the brick of a volume has from its clients
+function brick_client_count {
+        local vol=$1
+        local brick=$2
+        $CLI volume status $vol $brick clients | grep -i 'Clients connected' | sed -e 's/[^0-9]*\(.*\)/\1/g'
+}
+
+#Number of extra connections of a client xlator of the mount that are set up
+function client_ready_stripes {
+        local vol=$1
+        local client=$2
+        local fpath=$(generate_mount_statedump $vol)
+        awk -v sect="[xlator.protocol.client.$vol-client-$client.priv]" '
+                /^\[/ { in_sect = ($0 == sect); next }
+                in_sect && /^stripe\.[0-9]+\.state=3$/ { n++ }
+                END { print n + 0 }' $fpath
+        rm -f $fpath
+}
+
+function client_connected_status {
+        local vol=$1
+        local client=$2
+        local fpath=$(generate_mount_statedump $vol)
+        awk -v sect="[xlator.protocol.client.$vol-client-$client.priv]" '
+                /^\[/ { in_sect = ($0 == sect); next }
+                in_sect && /^connected=/ { split ($0, kv, "="); print kv[2] }' $fpath
+        rm -f $fpath
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 nfs.disable on
+TEST $CLI volume set $V0 client.connection-count 4
+TEST $CLI volume start $V0
+
+EXPECT "0" brick_client_count $V0 $H0:$B0/${V0}0
+
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0;
+
+#The mount is the only client, with one main and three extra connections
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "3" client_ready_stripes $V0 0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "3" client_ready_stripes $V0 1
+EXPECT "4" brick_client_count $V0 $H0:$B0/${V0}0
+EXPECT "4" brick_client_count $V0 $H0:$B0/${V0}1
+
+for i in {1..8}; do
+        TEST dd if=/dev/urandom of=$M0/file$i bs=128k count=32
+done
+md5sums=$(echo $(md5sum $M0/file* | awk '{print $1}'))
+EXPECT "$md5sums" echo $(cat $M0/file* > /dev/null; md5sum $M0/file* | awk '{print $1}')
+
+exec 5<>$M0/file1
+TEST flock -x 5
+
+TEST $CLI volume stop $V0
+EXPECT "0" online_brick_count
+TEST $CLI volume start $V0
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "2" online_brick_count
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "1" client_connected_status $V0 0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "1" client_connected_status $V0 1
+
+#The extra connections attach again after the main one
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "3" client_ready_stripes $V0 0
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "3" client_ready_stripes $V0 1
+EXPECT "4" brick_client_count $V0 $H0:$B0/${V0}0
+EXPECT "4" brick_client_count $V0 $H0:$B0/${V0}1
+
+TEST dd if=/dev/zero of=$M0/after bs=128k count=32
+EXPECT "4194304" stat -c %s $M0/after
+EXPECT "$md5sums" echo $(md5sum $M0/file* | awk '{print $1}')
+
+exec 5>&-
+TEST umount $M0
+cleanup;
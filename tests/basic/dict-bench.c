@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Microbenchmark for dict_t: for dicts of increasing size, built the way
+ * xdata is (xattr-like keys, mostly integer values), measures the cost of
+ * building the dict, of looking up present and absent keys, and of a
+ * serialize/unserialize round trip. Run it against builds with and without
+ * a dict change to compare the two; dict-bench.t only checks that it runs
+ * to the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "dict.h"
+
+#define MAX_KEYS        64
+#define ROUNDS          20000
+
+static char keys[MAX_KEYS][64];
+
+static double
+elapsed_ns (struct timespec *start)
+{
+        struct timespec end;
+
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        return (end.tv_sec - start->tv_sec) * 1e9 +
+                (end.tv_nsec - start->tv_nsec);
+}
+
+static dict_t *
+build_dict (int nkeys)
+{
+        dict_t *dict = NULL;
+        int     i = 0;
+        int     ret = 0;
+
+        dict = dict_new ();
+        if (!dict)
+                return NULL;
+
+        for (i = 0; i < nkeys; i++) {
+                if (i % 4 == 3)
+                        ret = dict_set_str (dict, keys[i], "trusted.glusterfs");
+                else
+                        ret = dict_set_int32 (dict, keys[i], i);
+                if (ret) {
+                        dict_unref (dict);
+                        return NULL;
+                }
+        }
+
+        return dict;
+}
+
+static void
+bench (int nkeys)
+{
+        struct timespec  start;
+        dict_t          *dict = NULL;
+        dict_t          *copy = NULL;
+        char            *buf = NULL;
+        u_int            len = 0;
+        double           set_ns = 0;
+        double           get_ns = 0;
+        double           miss_ns = 0;
+        double           ser_ns = 0;
+        double           unser_ns = 0;
+        int32_t          val = 0;
+        int              i = 0;
+        int              j = 0;
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ROUNDS; i++)
+                dict_unref (build_dict (nkeys));
+        set_ns = elapsed_ns (&start) / ((double)ROUNDS * nkeys);
+
+        dict = build_dict (nkeys);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ROUNDS; i++)
+                for (j = 0; j < nkeys; j++)
+                        if (dict_get_int32 (dict, keys[j], &val) ||
+                            val != j) {
+                                if (j % 4 != 3)
+                                        printf ("lookup of %s failed\n",
+                                                keys[j]);
+                        }
+        get_ns = elapsed_ns (&start) / ((double)ROUNDS * nkeys);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ROUNDS; i++)
+                for (j = 0; j < nkeys; j++)
+                        dict_get (dict, "trusted.glusterfs.not-there");
+        miss_ns = elapsed_ns (&start) / ((double)ROUNDS * nkeys);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ROUNDS; i++) {
+                dict_allocate_and_serialize (dict, &buf, &len);
+                GF_FREE (buf);
+        }
+        ser_ns = elapsed_ns (&start) / ROUNDS;
+
+        dict_allocate_and_serialize (dict, &buf, &len);
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ROUNDS; i++) {
+                copy = dict_new ();
+                dict_unserialize (buf, len, &copy);
+                dict_unref (copy);
+        }
+        unser_ns = elapsed_ns (&start) / ROUNDS;
+        GF_FREE (buf);
+
+        dict_unref (dict);
+
+        printf ("%4d %10.1f %10.1f %10.1f %12.1f %12.1f\n", nkeys,
+                set_ns, get_ns, miss_ns, ser_ns, unser_ns);
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        int              sizes[] = {1, 4, 8, 16, 24, 32, 64};
+        int              i = 0;
+        int              ret = -1;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx)
+                return -1;
+
+        ret = glusterfs_globals_init (ctx);
+        if (ret)
+                return ret;
+
+        THIS->ctx = ctx;
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        INIT_LIST_HEAD (&ctx->mempool_list);
+        ctx->dict_pool = mem_pool_new (dict_t, 64);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 1024);
+        ctx->dict_data_pool = mem_pool_new (data_t, 1024);
+        if (!ctx->dict_pool || !ctx->dict_pair_pool || !ctx->dict_data_pool)
+                return -1;
+
+        for (i = 0; i < MAX_KEYS; i++)
+                snprintf (keys[i], sizeof (keys[i]),
+                          "trusted.afr.patchy-client-%d", i);
+
+        printf ("keys  set ns/key  get ns/key  miss ns/op  serialize ns"
+                "  unserial. ns\n");
+        for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+                bench (sizes[i]);
+
+        return 0;
+}
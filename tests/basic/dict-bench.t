@@ -0,0 +1,20 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+## Builds against the headers of the source tree, runs once; the numbers
+## are for comparing two builds by hand
+TOP=$(dirname $0)/../..
+TEST build_tester $(dirname $0)/dict-bench.c \
+        -I$TOP -I$TOP/libglusterfs/src -I$TOP/contrib/uuid \
+        -DHAVE_CONFIG_H -D_FILE_OFFSET_BITS=64 -D_GNU_SOURCE \
+        -DGF_LINUX_HOST_OS \
+        -lglusterfs -lpthread
+
+TEST $(dirname $0)/dict-bench
+
+TEST rm -f $(dirname $0)/dict-bench
+
+cleanup;
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Microbenchmark for the event registry: registers NFDS fds with the
+ * event pool, unregisters them all, and then churns registrations in a
+ * random order, as happens in a reconnect storm. The cost of each
+ * operation should not depend on the number of registered fds.
+ *
+ * Without root it cannot raise RLIMIT_NOFILE and runs with fewer fds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "event.h"
+
+#define NFDS            100000
+#define CHURN_ROUNDS    (NFDS * 4)
+
+static int fds[NFDS];
+static int idxs[NFDS];
+
+static int
+dummy_handler (int fd, int idx, void *data,
+               int poll_in, int poll_out, int poll_err)
+{
+        return 0;
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+        struct timespec end;
+
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        return (end.tv_sec - start->tv_sec) * 1e9 +
+                (end.tv_nsec - start->tv_nsec);
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t   *ctx = NULL;
+        struct event_pool *event_pool = NULL;
+        struct rlimit      lim = {0, };
+        struct timespec    start;
+        int                nfds = NFDS;
+        int                i = 0;
+        int                j = 0;
+        int                ret = -1;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx)
+                return -1;
+
+        ret = glusterfs_globals_init (ctx);
+        if (ret)
+                return ret;
+
+        THIS->ctx = ctx;
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        lim.rlim_cur = lim.rlim_max = NFDS + 64;
+        if (setrlimit (RLIMIT_NOFILE, &lim) != 0) {
+                getrlimit (RLIMIT_NOFILE, &lim);
+                nfds = lim.rlim_cur - 64;
+                printf ("could not raise RLIMIT_NOFILE, using %d fds\n", nfds);
+        }
+
+        event_pool = event_pool_new (16384, 1);
+        if (!event_pool)
+                return -1;
+
+        for (i = 0; i < nfds; i++) {
+                fds[i] = eventfd (0, 0);
+                if (fds[i] == -1) {
+                        perror ("eventfd");
+                        return -1;
+                }
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < nfds; i++)
+                idxs[i] = event_register (event_pool, fds[i], dummy_handler,
+                                          NULL, 1, 0);
+        printf ("register:   %8.1f ns/op\n", elapsed_ns (&start) / nfds);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < nfds; i++)
+                event_select_on (event_pool, fds[i], idxs[i], 1, 1);
+        printf ("select_on:  %8.1f ns/op\n", elapsed_ns (&start) / nfds);
+
+        /* unregister in the order of registration, the worst case for a
+         * registry which compacts on removal */
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < nfds; i++)
+                event_unregister (event_pool, fds[i], idxs[i]);
+        printf ("unregister: %8.1f ns/op\n", elapsed_ns (&start) / nfds);
+
+        for (i = 0; i < nfds; i++)
+                idxs[i] = event_register (event_pool, fds[i], dummy_handler,
+                                          NULL, 1, 0);
+
+        srandom (42);
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < CHURN_ROUNDS; i++) {
+                j = random () % nfds;
+                event_unregister (event_pool, fds[j], idxs[j]);
+                idxs[j] = event_register (event_pool, fds[j], dummy_handler,
+                                          NULL, 1, 0);
+        }
+        printf ("churn:      %8.1f ns/op (unregister + register)\n",
+                elapsed_ns (&start) / CHURN_ROUNDS);
+
+        for (i = 0; i < nfds; i++) {
+                event_unregister (event_pool, fds[i], idxs[i]);
+                close (fds[i]);
+        }
+
+        return 0;
+}
@@ -0,0 +1,98 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+function iot_dump_value {
+        local fpath=$(generate_brick_statedump $V0 $H0 $B0/${V0}0)
+        grep "^$1=" $fpath | head -1 | cut -f 2- -d'='
+        rm -f $fpath
+}
+
+#Fops the io-threads of the brick ran for the mounts of the normal and of
+#the self-heal class, from the same statedump
+function iot_executed_by_class {
+        local fpath=$(generate_brick_statedump $V0 $H0 $B0/${V0}0)
+        grep "^client\[[0-9]*\]=uid=" $fpath | grep -v "uid=internal," | \
+                awk -F, '{ split ($5, e, "="); n[$2] += e[2] }
+                         END { print n["class=normal"] + 0,
+                                     n["class=self-heal"] + 0 }'
+        rm -f $fpath
+}
+
+function iot_client_count {
+        local fpath=$(generate_brick_statedump $V0 $H0 $B0/${V0}0)
+        grep -c "^client\[[0-9]*\]=uid=" $fpath
+        rm -f $fpath
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume set $V0 performance.iot-client-fairness on
+TEST $CLI volume set $V0 performance.iot-rebalance-weight 1
+TEST $CLI volume start $V0
+
+TEST glusterfs -s $H0 --volfile-id=$V0 $M0
+TEST glusterfs -s $H0 --volfile-id=$V0 $M1
+
+for i in $(seq 1 100); do
+        echo $i > $M0/file-$i
+        cat $M1/file-$i > /dev/null
+done
+EXPECT "100" echo $(ls $M1 | wc -l)
+
+EXPECT "1" iot_dump_value client_fairness
+EXPECT "1" iot_dump_value "client_weight\[rebalance\]"
+## The builtin queues of internal callers and one per mount
+TEST [ $(iot_client_count) -ge 6 ]
+
+## Weights change in place
+TEST $CLI volume set $V0 performance.iot-client-weight 16
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "16" iot_dump_value "client_weight\[normal\]"
+
+## With a single worker and both mounts flooding it, the mount of the
+## heavier class gets most of the fops run, and the other is not starved
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M1
+TEST glusterfs -s $H0 --volfile-id=$V0 --client-pid=-6 $M1
+TEST $CLI volume set $V0 performance.io-thread-count 1
+TEST $CLI volume set $V0 performance.enable-least-priority off
+TEST $CLI volume set $V0 performance.iot-client-weight 1
+TEST $CLI volume set $V0 performance.iot-self-heal-weight 8
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "8" iot_dump_value "client_weight\[self-heal\]"
+
+flooders=""
+for i in $(seq 1 16); do
+        dd if=/dev/zero of=$M0/flood-$i bs=4k count=100000 oflag=sync \
+           2>/dev/null &
+        flooders="$flooders $!"
+        dd if=/dev/zero of=$M1/heal-$i bs=4k count=100000 oflag=sync \
+           2>/dev/null &
+        flooders="$flooders $!"
+done
+sleep 2
+
+read normal_start heal_start <<< "$(iot_executed_by_class)"
+sleep 2
+read normal_end heal_end <<< "$(iot_executed_by_class)"
+kill $flooders
+wait
+
+normal_run=$((normal_end - normal_start))
+heal_run=$((heal_end - heal_start))
+TEST [ $normal_run -gt 0 ]
+TEST [ $heal_run -ge $((normal_run * 2)) ]
+TEST rm -f $M0/flood-* $M0/heal-*
+
+## Turned off, the fops go through the worker queues again
+TEST $CLI volume set $V0 performance.iot-client-fairness off
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "0" iot_dump_value client_fairness
+TEST rm -f $M0/file-*
+EXPECT "0" echo $(ls $M1 | wc -l)
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M1
+cleanup;
@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Microbenchmark for the io-threads scheduler: producer threads, standing
+ * in for the epoll threads of a brick, keep a number of stat fops in flight
+ * through performance/io-threads to a child that answers them at once, so
+ * that nearly all of the time goes to queueing stubs and waking workers.
+ * The same load is then run through a copy of the previous scheduler, a
+ * single mutex and condition over four priority lists, for comparison.
+ *
+ * io-threads is loaded from the installed xlator directory. An argument,
+ * if given, is passed to it as the cpu-affinity option.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <semaphore.h>
+#include <sys/resource.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "stack.h"
+#include "call-stub.h"
+#include "defaults.h"
+
+#define FOPS_PER_PRODUCER       200000
+#define INFLIGHT                64
+#define MAX_PRODUCERS           16
+#define WORKERS                 16
+
+struct producer {
+        pthread_t        thread;
+        sem_t            slots;
+        xlator_t        *target;
+};
+
+static glusterfs_ctx_t  *ctx;
+static xlator_t          top;
+static xlator_t          sink;
+static xlator_t          legacy;
+static xlator_t         *iot;
+static struct producer   producers[MAX_PRODUCERS];
+
+/* the child answers every stat at once */
+static int
+sink_stat (call_frame_t *frame, xlator_t *this, loc_t *loc, dict_t *xdata)
+{
+        struct iatt buf = {0, };
+
+        STACK_UNWIND_STRICT (stat, frame, 0, 0, &buf, NULL);
+        return 0;
+}
+
+static struct xlator_fops sink_fops = {
+        .stat = sink_stat,
+};
+
+static struct xlator_cbks sink_cbks;
+
+/* the previous scheduler, one queue for all the workers */
+static struct {
+        pthread_mutex_t  mutex;
+        pthread_cond_t   cond;
+        struct list_head reqs[4];
+        int              queue_size;
+        int              sleep_count;
+} lg;
+
+static void *
+legacy_worker (void *data)
+{
+        call_stub_t *stub = NULL;
+        int          i = 0;
+
+        THIS = &legacy;
+        for (;;) {
+                pthread_mutex_lock (&lg.mutex);
+                {
+                        while (lg.queue_size == 0) {
+                                lg.sleep_count++;
+                                pthread_cond_wait (&lg.cond, &lg.mutex);
+                                lg.sleep_count--;
+                        }
+
+                        for (i = 0; i < 4; i++) {
+                                if (!list_empty (&lg.reqs[i]))
+                                        break;
+                        }
+                        stub = list_entry (lg.reqs[i].next, call_stub_t,
+                                           list);
+                        list_del_init (&stub->list);
+                        lg.queue_size--;
+                }
+                pthread_mutex_unlock (&lg.mutex);
+
+                call_resume (stub);
+        }
+
+        return NULL;
+}
+
+static int
+legacy_stat (call_frame_t *frame, xlator_t *this, loc_t *loc, dict_t *xdata)
+{
+        call_stub_t *stub = NULL;
+
+        stub = fop_stat_stub (frame, default_stat_resume, loc, xdata);
+        if (!stub) {
+                STACK_UNWIND_STRICT (stat, frame, -1, ENOMEM, NULL, NULL);
+                return 0;
+        }
+
+        pthread_mutex_lock (&lg.mutex);
+        {
+                list_add_tail (&stub->list, &lg.reqs[0]);
+                lg.queue_size++;
+                pthread_cond_signal (&lg.cond);
+        }
+        pthread_mutex_unlock (&lg.mutex);
+
+        return 0;
+}
+
+static struct xlator_fops legacy_fops = {
+        .stat = legacy_stat,
+};
+
+static int
+bench_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                int32_t op_ret, int32_t op_errno, struct iatt *buf,
+                dict_t *xdata)
+{
+        struct producer *producer = cookie;
+
+        STACK_DESTROY (frame->root);
+        sem_post (&producer->slots);
+        return 0;
+}
+
+static void *
+produce (void *data)
+{
+        struct producer *producer = data;
+        call_frame_t    *frame = NULL;
+        loc_t            loc = {0, };
+        int              i = 0;
+
+        THIS = &top;
+        loc.path = "/bench";
+
+        for (i = 0; i < FOPS_PER_PRODUCER; i++) {
+                sem_wait (&producer->slots);
+
+                frame = create_frame (&top, ctx->pool);
+                if (!frame)
+                        break;
+
+                STACK_WIND_COOKIE (frame, bench_stat_cbk, producer,
+                                   producer->target,
+                                   producer->target->fops->stat, &loc, NULL);
+        }
+
+        /* wait for the last answers */
+        for (i = 0; i < INFLIGHT; i++)
+                sem_wait (&producer->slots);
+
+        return NULL;
+}
+
+static void
+bench (const char *name, xlator_t *target, int nproducers)
+{
+        struct timespec start;
+        struct timespec end;
+        struct rusage   before;
+        struct rusage   after;
+        double          secs = 0;
+        double          fops = 0;
+        int             i = 0;
+
+        getrusage (RUSAGE_SELF, &before);
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < nproducers; i++) {
+                sem_init (&producers[i].slots, 0, INFLIGHT);
+                producers[i].target = target;
+                pthread_create (&producers[i].thread, NULL, produce,
+                                &producers[i]);
+        }
+        for (i = 0; i < nproducers; i++) {
+                pthread_join (producers[i].thread, NULL);
+                sem_destroy (&producers[i].slots);
+        }
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        getrusage (RUSAGE_SELF, &after);
+
+        secs = (end.tv_sec - start.tv_sec) +
+                (end.tv_nsec - start.tv_nsec) / 1e9;
+        fops = (double) nproducers * FOPS_PER_PRODUCER;
+        /* every wakeup of a sleeping thread is a switch of the sleeper */
+        printf ("%-10s %2d producers: %9.0f fops/s, %5.2f context switches "
+                "per fop\n", name, nproducers, fops / secs,
+                (after.ru_nvcsw - before.ru_nvcsw) / fops);
+}
+
+static xlator_list_t *
+child_list (xlator_t *child)
+{
+        xlator_list_t *list = NULL;
+
+        list = calloc (1, sizeof (*list));
+        if (list)
+                list->xlator = child;
+        return list;
+}
+
+static void
+xlator_setup (xlator_t *xl, char *name, char *type)
+{
+        xl->name = name;
+        xl->type = type;
+        xl->ctx = ctx;
+        INIT_LIST_HEAD (&xl->volume_options);
+        xlator_mem_acct_init (xl, gf_common_mt_end + 1);
+}
+
+int
+main (int argc, char *argv[])
+{
+        pthread_t   thread;
+        char        count[16];
+        int         nproducers[] = {1, 4, 16};
+        int         i = 0;
+        int         ret = -1;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx)
+                return -1;
+
+        ret = glusterfs_globals_init (ctx);
+        if (ret)
+                return ret;
+
+        THIS->ctx = ctx;
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        ctx->pool = calloc (1, sizeof (call_pool_t));
+        if (!ctx->pool)
+                return -1;
+        INIT_LIST_HEAD (&ctx->pool->all_frames);
+        LOCK_INIT (&ctx->pool->lock);
+        ctx->pool->frame_mem_pool = mem_pool_new (call_frame_t, 4096);
+        ctx->pool->stack_mem_pool = mem_pool_new (call_stack_t, 1024);
+        ctx->stub_mem_pool = mem_pool_new (call_stub_t, 1024);
+        ctx->dict_pool = mem_pool_new (dict_t, 1024);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 1024);
+        ctx->dict_data_pool = mem_pool_new (data_t, 1024);
+
+        xlator_setup (&top, "bench", "bench/top");
+        xlator_setup (&sink, "bench-sink", "bench/sink");
+        sink.fops = &sink_fops;
+        sink.cbks = &sink_cbks;
+
+        xlator_setup (&legacy, "bench-legacy", "bench/legacy");
+        legacy.fops = &legacy_fops;
+        legacy.children = child_list (&sink);
+
+        iot = calloc (1, sizeof (*iot));
+        if (!iot)
+                return -1;
+        iot->name = "bench-io-threads";
+        iot->ctx = ctx;
+        INIT_LIST_HEAD (&iot->volume_options);
+        if (xlator_set_type (iot, "performance/io-threads")) {
+                printf ("cannot load performance/io-threads\n");
+                return -1;
+        }
+        iot->children = child_list (&sink);
+        iot->options = dict_new ();
+        if (!iot->options)
+                return -1;
+        snprintf (count, sizeof (count), "%d", WORKERS);
+        if (dict_set_str (iot->options, "thread-count", count) ||
+            dict_set_str (iot->options, "high-prio-threads", count) ||
+            (argc > 1 &&
+             dict_set_str (iot->options, "cpu-affinity", argv[1]))) {
+                printf ("cannot set the io-threads options\n");
+                return -1;
+        }
+        if (xlator_init (iot)) {
+                printf ("cannot init performance/io-threads\n");
+                return -1;
+        }
+
+        pthread_mutex_init (&lg.mutex, NULL);
+        pthread_cond_init (&lg.cond, NULL);
+        for (i = 0; i < 4; i++)
+                INIT_LIST_HEAD (&lg.reqs[i]);
+        for (i = 0; i < WORKERS; i++)
+                pthread_create (&thread, NULL, legacy_worker, NULL);
+
+        printf ("%d workers, %d stat fops in flight per producer\n",
+                WORKERS, INFLIGHT);
+        for (i = 0; i < sizeof (nproducers) / sizeof (nproducers[0]); i++) {
+                bench ("legacy", &legacy, nproducers[i]);
+                bench ("io-threads", iot, nproducers[i]);
+        }
+
+        return 0;
+}
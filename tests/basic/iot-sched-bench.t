@@ -0,0 +1,19 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+## io-threads comes from the installed xlator directory
+TOP=$(dirname $0)/../..
+TEST build_tester $(dirname $0)/iot-sched-bench.c \
+        -I$TOP -I$TOP/libglusterfs/src -I$TOP/contrib/uuid \
+        -DHAVE_CONFIG_H -D_FILE_OFFSET_BITS=64 -D_GNU_SOURCE \
+        -DGF_LINUX_HOST_OS \
+        -lglusterfs -lpthread
+
+TEST $(dirname $0)/iot-sched-bench
+
+TEST rm -f $(dirname $0)/iot-sched-bench
+
+cleanup;
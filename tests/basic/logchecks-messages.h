@@ -41,7 +41,7 @@
  */
 
 #define GLFS_COMP_BASE          1000
-#define GLFS_NUM_MESSAGES       19
+#define GLFS_NUM_MESSAGES       22
 #define GLFS_MSGID_END          (GLFS_COMP_BASE + GLFS_NUM_MESSAGES + 1)
 /* Messaged with message IDs */
 #define glfs_msg_start_x GLFS_COMP_BASE, "Invalid: Start of messages"
@@ -78,6 +78,12 @@
                                 " only critical and above"
 #define logchecks_msg_19 (GLFS_COMP_BASE + 19), "Pre init message, not to be" \
                                 " seen in logs"
+#define logchecks_msg_20 (GLFS_COMP_BASE + 20), "Test 10: Asynchronous" \
+                                " logging, through the flusher thread"
+#define logchecks_msg_21 (GLFS_COMP_BASE + 21), "Informational: Overhead:" \
+                                " message %d of thread %d"
+#define logchecks_msg_22 (GLFS_COMP_BASE + 22), "Informational: Overhead:" \
+                                " repeated message"
 /*------------*/
 #define glfs_msg_end_x GLFS_MSGID_END, "Invalid: End of messages"
 
@@ -10,9 +10,11 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "glusterfs.h"
 #include "globals.h"
+#include "xlator.h"
 #include "logging.h"
 
 #include "logchecks-messages.h"
@@ -23,6 +25,9 @@ glusterfs_ctx_t   *ctx = NULL;
 #define TEST_FILENAME           "/tmp/logchecks.log"
 #define GF_LOG_CONTROL_FILE     "/etc/glusterfs/logger.conf"
 
+#define OVERHEAD_CALLS          20000
+#define OVERHEAD_THREADS        4
+
 int
 go_log_vargs(gf_loglevel_t level, const char *fmt, ...)
 {
@@ -99,6 +104,65 @@ go_log (void)
         return 0;
 }
 
+static void *
+go_log_unique (void *data)
+{
+        int i = 0;
+
+        THIS->ctx = ctx;
+        for (i = 0; i < OVERHEAD_CALLS; i++)
+                gf_msg ("logchecks", GF_LOG_INFO, 0, logchecks_msg_21, i,
+                        (int)(long) data);
+
+        return NULL;
+}
+
+static void *
+go_log_repeated (void *data)
+{
+        int i = 0;
+
+        THIS->ctx = ctx;
+        for (i = 0; i < OVERHEAD_CALLS; i++)
+                gf_msg ("logchecks", GF_LOG_INFO, 0, logchecks_msg_22);
+
+        return NULL;
+}
+
+static void
+go_log_overhead_run (const char *name, void *(*fn) (void *), int nthreads)
+{
+        pthread_t        threads[OVERHEAD_THREADS];
+        struct timespec  start = {0, };
+        struct timespec  end = {0, };
+        long             i = 0;
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < nthreads; i++)
+                pthread_create (&threads[i], NULL, fn, (void *) i);
+        for (i = 0; i < nthreads; i++)
+                pthread_join (threads[i], NULL);
+        clock_gettime (CLOCK_MONOTONIC, &end);
+
+        printf ("%-8s %d thread(s): %8.1f ns/call\n", name, nthreads,
+                ((end.tv_sec - start.tv_sec) * 1e9 +
+                 (end.tv_nsec - start.tv_nsec)) / OVERHEAD_CALLS);
+}
+
+/* Measures what a gf_msg call costs the caller, for distinct messages and
+ * for repeated ones (which the log_buf suppresses) */
+int
+go_log_overhead (const char *mode)
+{
+        printf ("Per-call overhead, %s logging:\n", mode);
+        go_log_overhead_run ("unique", go_log_unique, 1);
+        go_log_overhead_run ("repeated", go_log_repeated, 1);
+        go_log_overhead_run ("unique", go_log_unique, OVERHEAD_THREADS);
+        go_log_overhead_run ("repeated", go_log_repeated, OVERHEAD_THREADS);
+
+        return 0;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -121,6 +185,13 @@ main (int argc, char *argv[])
         gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_19);
 
         THIS->ctx = ctx;
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        ctx->logbuf_pool = mem_pool_new (log_buf_t, 256);
+        if (!ctx->logbuf_pool) {
+                printf ("Error creating the log_buf pool\n");
+                return -1;
+        }
 
         /* TEST 1: messages before initializing the log, goes to stderr
          * and syslog based on criticality */
@@ -167,10 +238,25 @@ main (int argc, char *argv[])
         go_log ();
         gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_11);
 
-        /* Reset to run with syslog */
         gf_log_set_logformat (gf_logformat_withmsgid);
         gf_log_set_loglevel (GF_LOG_INFO);
 
+        /* TEST 10: Asynchronous logging, same messages as in TEST 2, and
+         * the overhead of a call before and after */
+        go_log_overhead ("synchronous");
+        gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_11);
+        ret = gf_log_enable_async (ctx);
+        if (ret != 0) {
+                printf ("Error from gf_log_enable_async\n");
+                return -1;
+        }
+        gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_20);
+        go_log ();
+        gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_11);
+        go_log_overhead ("asynchronous");
+        gf_log_flush ();
+        gf_log_disable_async (ctx);
+
         /* Run tests with logger changed to syslog */
         /* TEST 7: No more gluster logs */
         gf_msg ("logchecks", GF_LOG_ALERT, 0, logchecks_msg_11);
@@ -195,7 +281,6 @@ main (int argc, char *argv[])
 
         // TODO: signal crash prints, but not yet feasible here
         // TODO: Graph printing
-        // TODO: Multi threaded logging
 
         /* Close out the logging */
         gf_log_fini (ctx);
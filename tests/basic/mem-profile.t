@@ -0,0 +1,37 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+function mem_profile_value {
+        local fpath=$(generate_mount_statedump $V0)
+        grep -A1 "^\[$1\]" $fpath | grep "^$2=" | head -1 | cut -f 2 -d'='
+        rm -f $fpath
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume start $V0
+
+## Sample every allocation of the client
+TEST glusterfs --mem-profile-rate=1 -s $H0 --volfile-id=$V0 $M0
+
+for i in $(seq 1 100); do
+        echo $i > $M0/file-$i
+done
+EXPECT "100" echo $(ls $M0 | wc -l)
+
+EXPECT "1" mem_profile_value mem-profile sample_rate
+TEST [ $(mem_profile_value mem-profile.suspect\\[0\\] xlator | wc -c) -gt 1 ]
+
+## The counters folded from the shards still show up per type
+fpath=$(generate_mount_statedump $V0)
+TEST grep -q "usage-type gf_common_mt_inode_ctx memusage" $fpath
+rm -f $fpath
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $M0
+cleanup;
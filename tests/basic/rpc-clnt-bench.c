@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Microbenchmark for the outstanding-call table of rpc-clnt: keeps a
+ * given number of calls in flight and measures saving the frame of a new
+ * call and finding the frame of a reply, with replies coming back in a
+ * random order, as they do from a brick with several io-threads. The
+ * cost should not depend on the number of calls in flight.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "rpc-clnt.h"
+
+#define MAX_INFLIGHT    4096
+#define ROUNDS          1000000
+
+/* not in rpc-clnt.h */
+struct saved_frames *saved_frames_new (void);
+void saved_frames_destroy (struct saved_frames *frames);
+struct saved_frame *__saved_frames_put (struct saved_frames *frames,
+                                        void *frame, struct rpc_req *rpcreq);
+struct saved_frame *__saved_frame_get (struct saved_frames *frames,
+                                       int64_t callid);
+
+static struct rpc_clnt  clnt;
+static rpc_clnt_prog_t  prog = {
+        .progname = "bench",
+        .prognum  = 1,
+        .progver  = 1,
+};
+static struct rpc_req   reqs[MAX_INFLIGHT];
+
+static double
+elapsed_ns (struct timespec *start)
+{
+        struct timespec end;
+
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        return (end.tv_sec - start->tv_sec) * 1e9 +
+                (end.tv_nsec - start->tv_nsec);
+}
+
+static void
+bench (int inflight)
+{
+        struct saved_frames *frames = NULL;
+        struct saved_frame  *sframe = NULL;
+        struct timespec      start;
+        uint32_t             xid = 0;
+        int                  i = 0;
+        int                  j = 0;
+
+        frames = saved_frames_new ();
+        if (!frames)
+                return;
+
+        for (i = 0; i < inflight; i++) {
+                reqs[i].xid = ++xid;
+                __saved_frames_put (frames, &reqs[i], &reqs[i]);
+        }
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < ROUNDS; i++) {
+                /* a reply to any of the calls in flight */
+                j = random () % inflight;
+                sframe = __saved_frame_get (frames, reqs[j].xid);
+                if (!sframe || sframe->frame != &reqs[j]) {
+                        printf ("frame of xid %u not found\n", reqs[j].xid);
+                        return;
+                }
+                mem_put (sframe);
+
+                /* and a new call takes its place */
+                reqs[j].xid = ++xid;
+                __saved_frames_put (frames, &reqs[j], &reqs[j]);
+        }
+        printf ("%5d in flight: %8.1f ns per reply + call\n", inflight,
+                elapsed_ns (&start) / ROUNDS);
+
+        for (i = 0; i < inflight; i++)
+                mem_put (__saved_frame_get (frames, reqs[i].xid));
+        saved_frames_destroy (frames);
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        int              depths[] = {1, 16, 128, 1024, 4096};
+        int              i = 0;
+        int              ret = -1;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx)
+                return -1;
+
+        ret = glusterfs_globals_init (ctx);
+        if (ret)
+                return ret;
+
+        THIS->ctx = ctx;
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        clnt.saved_frames_pool = mem_pool_new (struct saved_frame,
+                                               MAX_INFLIGHT + 1);
+        if (!clnt.saved_frames_pool)
+                return -1;
+        clnt.conn.rpc_clnt = &clnt;
+
+        for (i = 0; i < MAX_INFLIGHT; i++) {
+                reqs[i].conn = &clnt.conn;
+                reqs[i].prog = &prog;
+        }
+
+        srandom (42);
+        for (i = 0; i < sizeof (depths) / sizeof (depths[0]); i++)
+                bench (depths[i]);
+
+        return 0;
+}
@@ -0,0 +1,76 @@
+#!/bin/bash
+
+#Runs parallel writers against a brick with the admission control on, and
+#checks what the brick reports about the clients it holds back
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#Sums the field of the client lines in the server section of the statedump
+function brick_client_field {
+        local field=$1
+        local fpath=$(generate_brick_statedump $V0 $H0 $B0/${V0}0)
+        grep "^client\.[0-9]*=" $fpath | tr ' ' '\n' | \
+                awk -F= -v f=$field '$1 == f { n++; s += $2 }
+                                     END { if (n) print s; else print "none" }'
+        rm -f $fpath
+}
+
+function brick_client_count {
+        $CLI volume status $V0 $H0:$B0/${V0}0 clients | \
+                grep -i 'Clients connected' | sed -e 's/[^0-9]*\(.*\)/\1/g'
+}
+
+function status_client_columns {
+        $CLI volume status $V0 $H0:$B0/${V0}0 clients | \
+                grep -c "QueueDepth *ThrottleMs"
+}
+
+#QueueDepth of the connections of the mount, all of them summed up
+function status_queue_depth {
+        $CLI volume status $V0 $H0:$B0/${V0}0 clients | \
+                awk '/^[0-9a-zA-Z.:-]+:[0-9]+ / { s += $4 } END { print s + 0 }'
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume set $V0 nfs.disable on
+TEST $CLI volume set $V0 server.queue-target-latency 1
+TEST $CLI volume set $V0 server.outstanding-rpc-limit 16
+TEST $CLI volume start $V0
+
+TEST $GFS --volfile-id=/$V0 --volfile-server=$H0 $M0;
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "1" brick_client_count
+
+#Keep more requests in flight than the window admits
+for i in {1..8}; do
+        dd if=/dev/zero of=$M0/file$i bs=4k count=4096 oflag=sync \
+           2>/dev/null &
+done
+
+TEST [ "$(brick_client_field outstanding)" != "none" ]
+TEST [ "$(brick_client_field queued)" != "none" ]
+TEST [ "$(brick_client_field limit)" != "none" ]
+EXPECT "1" status_client_columns
+
+wait
+for i in {1..8}; do
+        EXPECT "16777216" stat -c %s $M0/file$i
+done
+
+#Nothing is held back once the writers are done
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "0" brick_client_field queued
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "0" brick_client_field outstanding
+TEST [ "$(brick_client_field limit)" -gt 0 ]
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "0" status_queue_depth
+
+#Turned off, the queued requests drain and new ones go straight through
+TEST $CLI volume set $V0 server.queue-target-latency 0
+TEST dd if=/dev/zero of=$M0/after bs=128k count=32
+EXPECT "4194304" stat -c %s $M0/after
+EXPECT "0" brick_client_field queued
+
+TEST umount $M0
+cleanup;
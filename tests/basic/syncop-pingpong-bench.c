@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Microbenchmark for synctasks.
+ *
+ * ping-pong: tasks issue syncop_stat to a child that answers at once,
+ * so that every syncop is a switch out of the task to its processor and
+ * a switch back, with the run queue in between.
+ *
+ * spawn: creates many tasks that all park until they are woken, to see
+ * what tens of thousands of concurrent tasks cost in time and memory.
+ *
+ * swapcontext: a bare swapcontext () round trip, for reference.
+ *
+ * Takes the stack size of the synctasks in KB as an optional argument.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "stack.h"
+#include "syncop.h"
+
+#define SYNCOPS_PER_RUN         1000000
+#define SPAWN_TASKS             20000
+#define SWAPS                   1000000
+
+static glusterfs_ctx_t  *ctx;
+static xlator_t          top;
+static xlator_t          sink;
+
+static pthread_mutex_t   lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    cond = PTHREAD_COND_INITIALIZER;
+static int               running;
+static struct synctask **parked;
+static int               nparked;
+
+/* the child answers every stat at once */
+static int
+sink_stat (call_frame_t *frame, xlator_t *this, loc_t *loc, dict_t *xdata)
+{
+        struct iatt buf = {0, };
+
+        STACK_UNWIND_STRICT (stat, frame, 0, 0, &buf, NULL);
+        return 0;
+}
+
+static struct xlator_fops sink_fops = {
+        .stat = sink_stat,
+};
+
+static struct xlator_cbks sink_cbks;
+
+static double
+now (void)
+{
+        struct timespec ts;
+
+        clock_gettime (CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long
+rss_kb (void)
+{
+        char  line[128];
+        long  kb = 0;
+        FILE *fp = NULL;
+
+        fp = fopen ("/proc/self/status", "r");
+        if (!fp)
+                return 0;
+        while (fgets (line, sizeof (line), fp)) {
+                if (sscanf (line, "VmRSS: %ld", &kb) == 1)
+                        break;
+        }
+        fclose (fp);
+        return kb;
+}
+
+static int
+task_done (int ret, call_frame_t *frame, void *opaque)
+{
+        pthread_mutex_lock (&lock);
+        {
+                if (--running == 0)
+                        pthread_cond_signal (&cond);
+        }
+        pthread_mutex_unlock (&lock);
+        return 0;
+}
+
+static void
+wait_tasks (void)
+{
+        pthread_mutex_lock (&lock);
+        {
+                while (running)
+                        pthread_cond_wait (&cond, &lock);
+        }
+        pthread_mutex_unlock (&lock);
+}
+
+static int
+pingpong_task (void *opaque)
+{
+        struct iatt  buf = {0, };
+        loc_t        loc = {0, };
+        long         count = (long) opaque;
+        long         i = 0;
+
+        loc.path = "/bench";
+        for (i = 0; i < count; i++)
+                syncop_stat (&sink, &loc, &buf);
+
+        return 0;
+}
+
+static void
+pingpong (int ntasks)
+{
+        double start = 0;
+        double secs = 0;
+        int    i = 0;
+
+        running = ntasks;
+        start = now ();
+        for (i = 0; i < ntasks; i++)
+                synctask_new (ctx->env, pingpong_task, task_done, NULL,
+                              (void *)(long)(SYNCOPS_PER_RUN / ntasks));
+        wait_tasks ();
+        secs = now () - start;
+
+        printf ("ping-pong   %5d tasks: %9.0f syncops/s, %6.0f ns per "
+                "syncop\n", ntasks, SYNCOPS_PER_RUN / secs,
+                secs * 1e9 / SYNCOPS_PER_RUN);
+}
+
+static int
+parked_task (void *opaque)
+{
+        struct synctask *task = synctask_get ();
+
+        pthread_mutex_lock (&lock);
+        {
+                parked[nparked++] = task;
+        }
+        pthread_mutex_unlock (&lock);
+
+        /* a wake that came first makes this return at once */
+        synctask_yield (task);
+        return 0;
+}
+
+static void
+spawn (int ntasks)
+{
+        double start = 0;
+        double created = 0;
+        long   rss = 0;
+        int    i = 0;
+
+        parked = calloc (ntasks, sizeof (*parked));
+        if (!parked)
+                return;
+
+        rss = rss_kb ();
+        running = ntasks;
+        nparked = 0;
+        start = now ();
+        for (i = 0; i < ntasks; i++) {
+                if (synctask_new (ctx->env, parked_task, task_done, NULL,
+                                  NULL) != 0) {
+                        printf ("spawn: task %d failed\n", i);
+                        exit (1);
+                }
+        }
+
+        for (;;) {
+                pthread_mutex_lock (&lock);
+                i = nparked;
+                pthread_mutex_unlock (&lock);
+                if (i == ntasks)
+                        break;
+                usleep (1000);
+        }
+        created = now ();
+        rss = rss_kb () - rss;
+
+        for (i = 0; i < ntasks; i++)
+                synctask_wake (parked[i]);
+        wait_tasks ();
+
+        printf ("spawn       %5d tasks: %6.2f us per task to park, %5.1f KB "
+                "rss per parked task, %6.2f us per task to finish\n", ntasks,
+                (created - start) * 1e6 / ntasks, (double) rss / ntasks,
+                (now () - created) * 1e6 / ntasks);
+        free (parked);
+}
+
+static ucontext_t  main_uc;
+static ucontext_t  coro_uc;
+
+static void
+coro (void)
+{
+        for (;;)
+                swapcontext (&coro_uc, &main_uc);
+}
+
+static void
+swaps (void)
+{
+        static char stack[64 * 1024];
+        double      start = 0;
+        int         i = 0;
+
+        getcontext (&coro_uc);
+        coro_uc.uc_stack.ss_sp = stack;
+        coro_uc.uc_stack.ss_size = sizeof (stack);
+        makecontext (&coro_uc, coro, 0);
+
+        start = now ();
+        for (i = 0; i < SWAPS; i++)
+                swapcontext (&main_uc, &coro_uc);
+
+        printf ("swapcontext round trip: %6.0f ns\n",
+                (now () - start) * 1e9 / SWAPS);
+}
+
+static void
+xlator_setup (xlator_t *xl, char *name, char *type)
+{
+        xl->name = name;
+        xl->type = type;
+        xl->ctx = ctx;
+        INIT_LIST_HEAD (&xl->volume_options);
+        xlator_mem_acct_init (xl, gf_common_mt_end + 1);
+}
+
+int
+main (int argc, char *argv[])
+{
+        int         ntasks[] = {1, 16, 256};
+        size_t      stacksize = 0;
+        int         i = 0;
+        int         ret = -1;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx)
+                return -1;
+
+        ret = glusterfs_globals_init (ctx);
+        if (ret)
+                return ret;
+
+        THIS->ctx = ctx;
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        ctx->pool = calloc (1, sizeof (call_pool_t));
+        if (!ctx->pool)
+                return -1;
+        INIT_LIST_HEAD (&ctx->pool->all_frames);
+        LOCK_INIT (&ctx->pool->lock);
+        ctx->pool->frame_mem_pool = mem_pool_new (call_frame_t, 4096);
+        ctx->pool->stack_mem_pool = mem_pool_new (call_stack_t, 1024);
+        ctx->dict_pool = mem_pool_new (dict_t, 1024);
+        ctx->dict_pair_pool = mem_pool_new (data_pair_t, 1024);
+        ctx->dict_data_pool = mem_pool_new (data_t, 1024);
+
+        xlator_setup (&top, "bench", "bench/top");
+        xlator_setup (&sink, "bench-sink", "bench/sink");
+        sink.fops = &sink_fops;
+        sink.cbks = &sink_cbks;
+        THIS = &top;
+
+        /* the stack size in KB, the default otherwise */
+        if (argc > 1)
+                stacksize = strtoul (argv[1], NULL, 0) * 1024;
+
+        ctx->env = syncenv_new (stacksize, 0, 0);
+        if (!ctx->env)
+                return -1;
+
+        swaps ();
+        for (i = 0; i < sizeof (ntasks) / sizeof (ntasks[0]); i++)
+                pingpong (ntasks[i]);
+        spawn (SPAWN_TASKS);
+
+        return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+TOP=$(dirname $0)/../..
+TEST build_tester $(dirname $0)/syncop-pingpong-bench.c \
+        -I$TOP -I$TOP/libglusterfs/src -I$TOP/contrib/uuid \
+        -DHAVE_CONFIG_H -D_FILE_OFFSET_BITS=64 -D_GNU_SOURCE \
+        -DGF_LINUX_HOST_OS \
+        -lglusterfs -lpthread
+
+## With the default stack size, then with 16KB stacks
+TEST $(dirname $0)/syncop-pingpong-bench
+TEST $(dirname $0)/syncop-pingpong-bench 16
+
+TEST rm -f $(dirname $0)/syncop-pingpong-bench
+
+cleanup;
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2014 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Microbenchmark for the timer registry: arms NTIMERS timers with random
+ * delays, as the per-fd and per-connection timers of a busy brick are,
+ * measures arming and cancelling, and then lets a fraction of them fire and
+ * reports how late the callbacks ran. The cost of arming and cancelling
+ * should not depend on the number of armed timers. An argument sets the
+ * number of dispatcher threads the callbacks run on.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "xlator.h"
+#include "timer.h"
+#include "timespec.h"
+
+#define NTIMERS         100000
+#define NFIRE           1000
+
+struct bench_timer {
+        gf_timer_t      *timer;
+        struct timespec  due;
+        int64_t          late_ns;
+};
+
+static struct bench_timer timers[NTIMERS];
+static int                fired;
+
+static void
+bench_timer_cbk (void *data)
+{
+        struct bench_timer *bt = data;
+        struct timespec     now;
+
+        timespec_now (&now);
+        bt->late_ns = TS (now) - TS (bt->due);
+        __sync_fetch_and_add (&fired, 1);
+}
+
+static double
+elapsed_ns (struct timespec *start)
+{
+        struct timespec end;
+
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        return (end.tv_sec - start->tv_sec) * 1e9 +
+                (end.tv_nsec - start->tv_nsec);
+}
+
+static void
+arm (glusterfs_ctx_t *ctx, struct bench_timer *bt, long delay_ms)
+{
+        struct timespec delta = {delay_ms / 1000, (delay_ms % 1000) * 1000000};
+
+        timespec_now (&bt->due);
+        timespec_adjust_delta (&bt->due, delta);
+        bt->timer = gf_timer_call_after (ctx, delta, bench_timer_cbk, bt);
+}
+
+int
+main (int argc, char *argv[])
+{
+        glusterfs_ctx_t *ctx = NULL;
+        struct timespec  start;
+        int64_t          max_late = 0;
+        double           sum_late = 0;
+        int              i = 0;
+        int              ret = -1;
+
+        ctx = glusterfs_ctx_new ();
+        if (!ctx)
+                return -1;
+
+        ret = glusterfs_globals_init (ctx);
+        if (ret)
+                return ret;
+
+        THIS->ctx = ctx;
+        xlator_mem_acct_init (THIS, gf_common_mt_end + 1);
+
+        if (argc > 1)
+                ctx->cmd_args.timer_threads = atoi (argv[1]);
+
+        srandom (42);
+
+        /* far enough away not to fire while being measured */
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < NTIMERS; i++)
+                arm (ctx, &timers[i], 60000 + random () % 600000);
+        printf ("arm:    %8.1f ns/op (%d timers)\n",
+                elapsed_ns (&start) / NTIMERS, NTIMERS);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < NTIMERS; i++)
+                gf_timer_call_cancel (ctx, timers[i].timer);
+        printf ("cancel: %8.1f ns/op\n", elapsed_ns (&start) / NTIMERS);
+
+        for (i = 0; i < NTIMERS; i++) {
+                if (i < NFIRE)
+                        arm (ctx, &timers[i], random () % 2000);
+                else
+                        arm (ctx, &timers[i], 60000 + random () % 600000);
+        }
+
+        while (fired < NFIRE)
+                usleep (100000);
+
+        for (i = 0; i < NFIRE; i++) {
+                sum_late += timers[i].late_ns;
+                if (timers[i].late_ns > max_late)
+                        max_late = timers[i].late_ns;
+        }
+        printf ("late:   %8.1f ms avg, %.1f ms max (%d timers fired)\n",
+                sum_late / NFIRE / 1e6, max_late / 1e6, NFIRE);
+
+        for (i = 0; i < NTIMERS; i++)
+                gf_timer_call_cancel (ctx, timers[i].timer);
+
+        return 0;
+}
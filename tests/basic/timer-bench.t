@@ -0,0 +1,20 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+TOP=$(dirname $0)/../..
+TEST build_tester $(dirname $0)/timer-bench.c \
+        -I$TOP -I$TOP/libglusterfs/src -I$TOP/contrib/uuid \
+        -DHAVE_CONFIG_H -D_FILE_OFFSET_BITS=64 -D_GNU_SOURCE \
+        -DGF_LINUX_HOST_OS \
+        -lglusterfs -lpthread
+
+## Callbacks run by the timer thread, then by four dispatcher threads
+TEST $(dirname $0)/timer-bench
+TEST $(dirname $0)/timer-bench 4
+
+TEST rm -f $(dirname $0)/timer-bench
+
+cleanup;
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2015 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Microbenchmark of the generated XDR routines against the rpcgen ones:
+ * encodes and decodes a write request, a read reply and a lookup request
+ * with a small xdata, and a readdirp reply of NENTRIES entries, NLOOPS
+ * times each way, and reports the cost of a message and the throughput.
+ * The rpcgen decode frees what it allocated, as the fops do.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "glusterfs3-xdr.h"
+#include "glusterfs3-xdr-fast.h"
+
+#define NLOOPS          1000000
+#define NENTRIES        64
+#define BUFSIZE         65536
+
+static char buf[BUFSIZE];
+static char arena[2 * BUFSIZE + 64];
+static char xdata[48];
+
+static gfs3_write_req    write_req;
+static gfs3_read_rsp     read_rsp;
+static gfs3_lookup_req   lookup_req;
+static gfs3_readdirp_rsp readdirp_rsp;
+static gfs3_dirplist     entries[NENTRIES];
+static char              names[NENTRIES][32];
+
+typedef void (*rpcgen_free_t) (void *objp);
+
+typedef union {
+        gfs3_write_req    write_req;
+        gfs3_read_rsp     read_rsp;
+        gfs3_lookup_req   lookup_req;
+        gfs3_readdirp_rsp readdirp_rsp;
+} bench_msg_t;
+
+static double
+elapsed_ns (struct timespec *start)
+{
+        struct timespec end;
+
+        clock_gettime (CLOCK_MONOTONIC, &end);
+        return (end.tv_sec - start->tv_sec) * 1e9 +
+                (end.tv_nsec - start->tv_nsec);
+}
+
+static void
+report (const char *name, const char *how, double ns, size_t len, int loops)
+{
+        printf ("%-18s %-7s %8.1f ns/msg %8.1f MB/s\n", name, how,
+                ns / loops, (double)len * loops / ns * 1e3);
+}
+
+static void
+free_write_req (void *objp)
+{
+        gfs3_write_req *req = objp;
+
+        free (req->xdata.xdata_val);
+}
+
+static void
+free_read_rsp (void *objp)
+{
+        gfs3_read_rsp *rsp = objp;
+
+        free (rsp->xdata.xdata_val);
+}
+
+static void
+free_lookup_req (void *objp)
+{
+        gfs3_lookup_req *req = objp;
+
+        free (req->bname);
+        free (req->xdata.xdata_val);
+}
+
+static void
+free_readdirp_rsp (void *objp)
+{
+        gfs3_readdirp_rsp *rsp  = objp;
+        gfs3_dirplist     *trav = NULL;
+        gfs3_dirplist     *next = NULL;
+
+        for (trav = rsp->reply; trav; trav = next) {
+                next = trav->nextentry;
+                free (trav->dict.dict_val);
+                free (trav->name);
+                free (trav);
+        }
+        free (rsp->xdata.xdata_val);
+}
+
+static void
+bench (const char *name, void *objp, size_t objsize, xdrproc_t proc,
+       xdrf_encode_t encode, xdrf_decode_t decode, rpcgen_free_t rfree,
+       int loops)
+{
+        struct timespec start;
+        XDR             xdr;
+        xdrf_t          x;
+        bench_msg_t     dec;
+        size_t          len = 0;
+        int             i   = 0;
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < loops; i++) {
+                xdrmem_create (&xdr, buf, BUFSIZE, XDR_ENCODE);
+                if (!proc (&xdr, objp))
+                        exit (1);
+        }
+        len = xdr_getpos (&xdr);
+        report (name, "rpcgen", elapsed_ns (&start), len, loops);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < loops; i++) {
+                xdrf_init (&x, buf, BUFSIZE, NULL, 0);
+                if (encode (&x, objp))
+                        exit (1);
+        }
+        report ("", "fast", elapsed_ns (&start), len, loops);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < loops; i++) {
+                memset (&dec, 0, objsize);
+                xdrmem_create (&xdr, buf, len, XDR_DECODE);
+                if (!proc (&xdr, &dec))
+                        exit (1);
+                rfree (&dec);
+        }
+        report ("", "rpcgen", elapsed_ns (&start), len, loops);
+
+        clock_gettime (CLOCK_MONOTONIC, &start);
+        for (i = 0; i < loops; i++) {
+                xdrf_init (&x, buf, len, arena, sizeof (arena));
+                if (decode (&x, &dec))
+                        exit (1);
+        }
+        report ("", "fast", elapsed_ns (&start), len, loops);
+}
+
+int
+main (int argc, char *argv[])
+{
+        int i = 0;
+
+        memset (xdata, 'x', sizeof (xdata));
+
+        write_req.size = 131072;
+        write_req.xdata.xdata_len = sizeof (xdata);
+        write_req.xdata.xdata_val = xdata;
+
+        read_rsp.op_ret = 131072;
+        read_rsp.size   = 131072;
+        read_rsp.xdata.xdata_len = sizeof (xdata);
+        read_rsp.xdata.xdata_val = xdata;
+
+        lookup_req.bname = "a-file-name.txt";
+        lookup_req.xdata.xdata_len = sizeof (xdata);
+        lookup_req.xdata.xdata_val = xdata;
+
+        for (i = 0; i < NENTRIES; i++) {
+                snprintf (names[i], sizeof (names[i]), "file-%d", i);
+                entries[i].name = names[i];
+                entries[i].nextentry = (i + 1 < NENTRIES) ? &entries[i + 1]
+                                                          : NULL;
+        }
+        readdirp_rsp.op_ret = NENTRIES;
+        readdirp_rsp.reply  = entries;
+
+        printf ("%-18s %-7s\n", "encode / decode", "");
+
+        bench ("gfs3_write_req", &write_req, sizeof (write_req),
+               (xdrproc_t)xdr_gfs3_write_req,
+               (xdrf_encode_t)xdrf_encode_gfs3_write_req,
+               (xdrf_decode_t)xdrf_decode_gfs3_write_req,
+               free_write_req, NLOOPS);
+        bench ("gfs3_read_rsp", &read_rsp, sizeof (read_rsp),
+               (xdrproc_t)xdr_gfs3_read_rsp,
+               (xdrf_encode_t)xdrf_encode_gfs3_read_rsp,
+               (xdrf_decode_t)xdrf_decode_gfs3_read_rsp,
+               free_read_rsp, NLOOPS);
+        bench ("gfs3_lookup_req", &lookup_req, sizeof (lookup_req),
+               (xdrproc_t)xdr_gfs3_lookup_req,
+               (xdrf_encode_t)xdrf_encode_gfs3_lookup_req,
+               (xdrf_decode_t)xdrf_decode_gfs3_lookup_req,
+               free_lookup_req, NLOOPS);
+        bench ("gfs3_readdirp_rsp", &readdirp_rsp, sizeof (readdirp_rsp),
+               (xdrproc_t)xdr_gfs3_readdirp_rsp,
+               (xdrf_encode_t)xdrf_encode_gfs3_readdirp_rsp,
+               (xdrf_decode_t)xdrf_decode_gfs3_readdirp_rsp,
+               free_readdirp_rsp, NLOOPS / NENTRIES);
+
+        return 0;
+}
@@ -0,0 +1,20 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+cleanup;
+
+## Same flags as xdr-fast.t, the generated headers are in the source tree
+TOP=$(dirname $0)/../..
+TEST build_tester $(dirname $0)/xdr-fast-bench.c \
+        -I$TOP -I$TOP/libglusterfs/src -I$TOP/contrib/uuid \
+        -I$TOP/rpc/rpc-lib/src -I$TOP/rpc/xdr/src \
+        -DHAVE_CONFIG_H -D_FILE_OFFSET_BITS=64 -D_GNU_SOURCE \
+        -DGF_LINUX_HOST_OS \
+        -lgfxdr -lglusterfs
+
+TEST $(dirname $0)/xdr-fast-bench
+
+TEST rm -f $(dirname $0)/xdr-fast-bench
+
+cleanup;
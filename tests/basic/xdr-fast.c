@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2015 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+/* Checks the encoders and decoders of glusterfs3-xdr-fast.h against the
+ * rpcgen routines: every message is encoded both ways and has to come out
+ * byte for byte the same, the rpcgen bytes have to decode to the original
+ * message, and every truncation of them has to be refused. Exits non zero
+ * on the first mismatch.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glusterfs3-xdr.h"
+#include "glusterfs3-xdr-fast.h"
+#include "xdr-generic.h"
+
+#define BUFSIZE         65536
+#define NENTRIES        37
+
+static char rpcgen_buf[BUFSIZE];
+static char fast_buf[BUFSIZE];
+static char arena[4 * BUFSIZE];
+static char xdata[64];
+
+#define CHECK(cond) do {                                                \
+                if (!(cond)) {                                          \
+                        fprintf (stderr, "%s:%d: %s failed\n",          \
+                                 __FILE__, __LINE__, #cond);            \
+                        exit (1);                                       \
+                }                                                       \
+        } while (0)
+
+static void
+fill (char *buf, size_t len, int seed)
+{
+        size_t i = 0;
+
+        for (i = 0; i < len; i++)
+                buf[i] = (char)(seed * 31 + i * 7);
+}
+
+static void
+fill_iatt (gf_iatt *stat, int seed)
+{
+        fill (stat->ia_gfid, 16, seed);
+        stat->ia_ino     = 0x0102030405060708ULL * seed;
+        stat->ia_dev     = 0xfffffffffffffff0ULL - seed;
+        stat->mode       = 0100644 + seed;
+        stat->ia_nlink   = seed;
+        stat->ia_uid     = 1000 + seed;
+        stat->ia_gid     = 0xffffffff - seed;
+        stat->ia_rdev    = seed;
+        stat->ia_size    = 1ULL << (seed % 64);
+        stat->ia_blksize = 4096;
+        stat->ia_blocks  = 8 * seed;
+        stat->ia_atime   = 1400000000 + seed;
+        stat->ia_atime_nsec = seed;
+        stat->ia_mtime   = 1400000001 + seed;
+        stat->ia_mtime_nsec = 999999999 - seed;
+        stat->ia_ctime   = 1400000002 + seed;
+        stat->ia_ctime_nsec = 3 * seed;
+}
+
+static size_t
+encode_rpcgen (xdrproc_t proc, void *objp)
+{
+        XDR xdr;
+
+        xdrmem_create (&xdr, rpcgen_buf, BUFSIZE, XDR_ENCODE);
+        CHECK (proc (&xdr, objp));
+
+        return xdr_getpos (&xdr);
+}
+
+/* @objp has to encode to the same bytes both ways, and @encode has to
+ * refuse any buffer too short for them */
+static size_t
+check_encode (xdrproc_t proc, xdrf_encode_t encode, xdrf_sizeof_t size,
+              void *objp)
+{
+        size_t       len = 0;
+        size_t       i   = 0;
+        xdrf_t       x;
+        struct iovec out = {fast_buf, BUFSIZE};
+
+        len = encode_rpcgen (proc, objp);
+        CHECK (size (objp) == len);
+
+        memset (fast_buf, 0xaa, sizeof (fast_buf));
+        xdrf_init (&x, fast_buf, BUFSIZE, NULL, 0);
+        CHECK (encode (&x, objp) == 0);
+        CHECK (xdrf_length (&x) == len);
+        CHECK (memcmp (rpcgen_buf, fast_buf, len) == 0);
+
+        /* and through the generic entry points, which dispatch to it */
+        memset (fast_buf, 0xaa, sizeof (fast_buf));
+        CHECK (xdr_serialize_generic (out, objp, proc) == len);
+        CHECK (memcmp (rpcgen_buf, fast_buf, len) == 0);
+        CHECK (xdr_sizeof_xdata (proc, objp, NULL) == len);
+
+        /* not enough room is an error, never an overflow */
+        for (i = 0; i < len; i += 4) {
+                xdrf_init (&x, fast_buf, i, NULL, 0);
+                CHECK (encode (&x, objp) != 0);
+        }
+
+        return len;
+}
+
+static void
+check_xdata (char *val, u_int len, u_int orig_len)
+{
+        CHECK (len == orig_len);
+        if (len)
+                CHECK (memcmp (val, xdata, len) == 0);
+        else
+                CHECK (val == NULL);
+}
+
+static void
+test_write_req (u_int xdata_len)
+{
+        gfs3_write_req req = {{0,},};
+        gfs3_write_req dec = {{0,},};
+        size_t         len = 0;
+        size_t         i   = 0;
+        struct iovec   msg = {rpcgen_buf, 0};
+
+        fill (req.gfid, 16, xdata_len);
+        req.fd     = 0x8000000000000001ULL;
+        req.offset = 131072ULL * xdata_len;
+        req.size   = 131072;
+        req.flag   = 0x1234;
+        req.xdata.xdata_len = xdata_len;
+        req.xdata.xdata_val = xdata_len ? xdata : NULL;
+
+        len = check_encode ((xdrproc_t)xdr_gfs3_write_req,
+                            (xdrf_encode_t)xdrf_encode_gfs3_write_req,
+                            (xdrf_sizeof_t)xdrf_sizeof_gfs3_write_req, &req);
+
+        msg.iov_len = len;
+        CHECK (xdrf_to_gfs3_write_req (msg, &dec, NULL, 0) == len);
+        CHECK (memcmp (dec.gfid, req.gfid, 16) == 0);
+        CHECK (dec.fd == req.fd && dec.offset == req.offset);
+        CHECK (dec.size == req.size && dec.flag == req.flag);
+        check_xdata (dec.xdata.xdata_val, dec.xdata.xdata_len, xdata_len);
+
+        /* the payload follows the header in the same buffer */
+        msg.iov_len = len + 4096;
+        CHECK (xdrf_to_gfs3_write_req (msg, &dec, NULL, 0) == len);
+
+        for (i = 0; i < len; i++) {
+                msg.iov_len = i;
+                CHECK (xdrf_to_gfs3_write_req (msg, &dec, NULL, 0) < 0);
+        }
+}
+
+static void
+test_read_rsp (u_int xdata_len)
+{
+        gfs3_read_rsp rsp = {0,};
+        gfs3_read_rsp dec = {0,};
+        size_t        len = 0;
+        size_t        i   = 0;
+        struct iovec  msg = {rpcgen_buf, 0};
+
+        rsp.op_ret   = xdata_len ? 131072 : -1;
+        rsp.op_errno = xdata_len ? 0 : 107;
+        fill_iatt (&rsp.stat, xdata_len + 1);
+        rsp.size     = 131072;
+        rsp.xdata.xdata_len = xdata_len;
+        rsp.xdata.xdata_val = xdata_len ? xdata : NULL;
+
+        len = check_encode ((xdrproc_t)xdr_gfs3_read_rsp,
+                            (xdrf_encode_t)xdrf_encode_gfs3_read_rsp,
+                            (xdrf_sizeof_t)xdrf_sizeof_gfs3_read_rsp, &rsp);
+
+        msg.iov_len = len;
+        CHECK (xdrf_to_gfs3_read_rsp (msg, &dec, NULL, 0) == len);
+        CHECK (dec.op_ret == rsp.op_ret && dec.op_errno == rsp.op_errno);
+        CHECK (memcmp (&dec.stat, &rsp.stat, sizeof (rsp.stat)) == 0);
+        CHECK (dec.size == rsp.size);
+        check_xdata (dec.xdata.xdata_val, dec.xdata.xdata_len, xdata_len);
+
+        for (i = 0; i < len; i++) {
+                msg.iov_len = i;
+                CHECK (xdrf_to_gfs3_read_rsp (msg, &dec, NULL, 0) < 0);
+        }
+}
+
+static void
+test_lookup_req (const char *bname, u_int xdata_len)
+{
+        gfs3_lookup_req req = {{0,},};
+        gfs3_lookup_req dec = {{0,},};
+        size_t          len = 0;
+        size_t          i   = 0;
+        struct iovec    msg = {rpcgen_buf, 0};
+
+        fill (req.gfid, 16, 1);
+        fill (req.pargfid, 16, 2);
+        req.flags = 0x80000000;
+        req.bname = (char *)bname;
+        req.xdata.xdata_len = xdata_len;
+        req.xdata.xdata_val = xdata_len ? xdata : NULL;
+
+        len = check_encode ((xdrproc_t)xdr_gfs3_lookup_req,
+                            (xdrf_encode_t)xdrf_encode_gfs3_lookup_req,
+                            (xdrf_sizeof_t)xdrf_sizeof_gfs3_lookup_req, &req);
+
+        msg.iov_len = len;
+        CHECK (xdrf_to_gfs3_lookup_req (msg, &dec, arena, sizeof (arena))
+               == len);
+        CHECK (memcmp (dec.gfid, req.gfid, 16) == 0);
+        CHECK (memcmp (dec.pargfid, req.pargfid, 16) == 0);
+        CHECK (dec.flags == req.flags);
+        CHECK (strcmp (dec.bname, bname) == 0);
+        check_xdata (dec.xdata.xdata_val, dec.xdata.xdata_len, xdata_len);
+
+        /* the name needs an arena */
+        CHECK (xdrf_to_gfs3_lookup_req (msg, &dec, NULL, 0) < 0);
+        CHECK (xdrf_to_gfs3_lookup_req (msg, &dec, arena, strlen (bname))
+               < 0);
+
+        for (i = 0; i < len; i++) {
+                msg.iov_len = i;
+                CHECK (xdrf_to_gfs3_lookup_req (msg, &dec, arena,
+                                                sizeof (arena)) < 0);
+        }
+}
+
+static void
+test_readdirp_rsp (int count, u_int xdata_len)
+{
+        gfs3_readdirp_rsp  rsp = {0,};
+        gfs3_readdirp_rsp  dec = {0,};
+        gfs3_dirplist      entries[NENTRIES];
+        gfs3_dirplist     *trav = NULL;
+        char               names[NENTRIES][NAME_MAX];
+        size_t             len = 0;
+        size_t             i   = 0;
+        struct iovec       msg = {rpcgen_buf, 0};
+
+        memset (entries, 0, sizeof (entries));
+
+        for (i = 0; i < count; i++) {
+                memset (names[i], 'a' + i % 26, i + 1);
+                names[i][i + 1] = '\0';
+
+                entries[i].d_ino  = i * 1000;
+                entries[i].d_off  = (i + 1) * 0x100000001ULL;
+                entries[i].d_len  = i + 1;
+                entries[i].d_type = i % 12;
+                entries[i].name   = names[i];
+                fill_iatt (&entries[i].stat, i);
+                entries[i].dict.dict_len = i % 3 ? i : 0;
+                entries[i].dict.dict_val = i % 3 ? xdata : NULL;
+                entries[i].nextentry = (i + 1 < count) ? &entries[i + 1]
+                                                       : NULL;
+        }
+
+        rsp.op_ret   = count;
+        rsp.op_errno = 0;
+        rsp.reply    = count ? entries : NULL;
+        rsp.xdata.xdata_len = xdata_len;
+        rsp.xdata.xdata_val = xdata_len ? xdata : NULL;
+
+        len = check_encode ((xdrproc_t)xdr_gfs3_readdirp_rsp,
+                            (xdrf_encode_t)xdrf_encode_gfs3_readdirp_rsp,
+                            (xdrf_sizeof_t)xdrf_sizeof_gfs3_readdirp_rsp,
+                            &rsp);
+
+        /* as large as client3_3_readdirp_cbk makes it */
+        msg.iov_len = len;
+        CHECK (xdrf_to_gfs3_readdirp_rsp (msg, &dec, arena, 2 * len + 64)
+               == len);
+        CHECK (dec.op_ret == rsp.op_ret && dec.op_errno == rsp.op_errno);
+        check_xdata (dec.xdata.xdata_val, dec.xdata.xdata_len, xdata_len);
+
+        for (i = 0, trav = dec.reply; trav; i++, trav = trav->nextentry) {
+                CHECK (i < count);
+                CHECK (trav->d_ino == entries[i].d_ino);
+                CHECK (trav->d_off == entries[i].d_off);
+                CHECK (trav->d_len == entries[i].d_len);
+                CHECK (trav->d_type == entries[i].d_type);
+                CHECK (strcmp (trav->name, entries[i].name) == 0);
+                CHECK (memcmp (&trav->stat, &entries[i].stat,
+                               sizeof (trav->stat)) == 0);
+                check_xdata (trav->dict.dict_val, trav->dict.dict_len,
+                             entries[i].dict.dict_len);
+        }
+        CHECK (i == count);
+
+        for (i = 0; i < len; i++) {
+                msg.iov_len = i;
+                CHECK (xdrf_to_gfs3_readdirp_rsp (msg, &dec, arena,
+                                                  sizeof (arena)) < 0);
+        }
+}
+
+int
+main (int argc, char *argv[])
+{
+        static const char *names[] = {"", "a", "ab", "abc", "abcd", "abcde",
+                                      "a-name-of-some-length.txt", NULL};
+        u_int              i = 0;
+        int                j = 0;
+
+        fill (xdata, sizeof (xdata), 42);
+
+        for (i = 0; i < 10; i++) {
+                test_write_req (i);
+                test_read_rsp (i);
+                for (j = 0; names[j]; j++)
+                        test_lookup_req (names[j], i);
+        }
+        test_write_req (sizeof (xdata));
+        test_read_rsp (sizeof (xdata));
+
+        for (j = 0; j <= NENTRIES; j++)
+                test_readdirp_rsp (j, j % 5);
+
+        return 0;
+}
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../nfs.rc
+. $(dirname $0)/../volume.rc
+
+function drc_counter {
+        local fpath=$(generate_statedump $(get_nfs_pid))
+        grep "^drc.$1=" $fpath | cut -f 2 -d'='
+        rm -f $fpath
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/$V0
+TEST $CLI volume set $V0 nfs.drc on
+## Small enough for a few hundred creates to go past it
+TEST $CLI volume set $V0 nfs.drc-memory-limit 64KB
+TEST $CLI volume start $V0
+EXPECT_WITHIN $NFS_EXPORT_TIMEOUT "1" is_nfs_export_available;
+TEST mount_nfs $H0:/$V0 $N0 nolock
+
+for i in $(seq 1 500); do
+        echo $i > $N0/file-$i
+done
+EXPECT "500" echo $(ls $N0 | wc -l)
+EXPECT "250" cat $N0/file-250
+
+EXPECT "64.0KB" echo $(drc_counter max_memory | awk '{printf "%.1fKB", $1/1024}')
+TEST [ $(drc_counter eviction_count) -gt 0 ]
+TEST [ $(drc_counter current_memory) -le 65536 ]
+
+## The memory limit changes in place, without a new cache
+TEST $CLI volume set $V0 nfs.drc-memory-limit 1MB
+EXPECT_WITHIN $NFS_EXPORT_TIMEOUT "1048576" drc_counter max_memory
+TEST rm -f $N0/file-*
+EXPECT "0" echo $(ls $N0 | wc -l)
+
+EXPECT_WITHIN $UMOUNT_TIMEOUT "Y" force_umount $N0
+cleanup;
@@ -0,0 +1,72 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+file_md5 () {
+	md5sum < $1 2> /dev/null | cut -d' ' -f1
+}
+
+SSL_BASE=/etc/ssl
+SSL_KEY=$SSL_BASE/glusterfs.key
+SSL_CERT=$SSL_BASE/glusterfs.pem
+SSL_CA=$SSL_BASE/glusterfs.ca
+MNT_LOG=`gluster --print-logdir`/ssl-ktls-mnt.log
+
+log_count () {
+	grep -c "$1" $MNT_LOG 2> /dev/null
+}
+
+cleanup;
+rm -f $SSL_BASE/glusterfs.* $MNT_LOG
+mkdir -p $B0/1
+mkdir -p $M0
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST openssl genrsa -out $SSL_KEY 2048
+TEST openssl req -new -x509 -key $SSL_KEY -subj /CN=Anyone -out $SSL_CERT
+ln $SSL_CERT $SSL_CA
+
+TEST $CLI volume create $V0 $H0:$B0/1
+TEST $CLI volume set $V0 server.ssl on
+TEST $CLI volume set $V0 client.ssl on
+TEST $CLI volume set $V0 auth.ssl-allow Anyone
+TEST $CLI volume set $V0 server.ssl-ktls on
+TEST $CLI volume set $V0 client.ssl-ktls on
+TEST $CLI volume set $V0 server.ssl-session-cache on
+TEST $CLI volume set $V0 client.ssl-session-cache on
+TEST $CLI volume set $V0 network.ping-timeout 5
+TEST $CLI volume start $V0
+
+## Connections without kTLS (no tls module) fall back to an own thread, so
+## this has to work either way
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 --log-file=$MNT_LOG $M0
+TEST dd if=/dev/urandom of=$M0/file bs=128k count=64
+md5=$(file_md5 $M0/file)
+EXPECT "0" log_count "resumed session"
+
+## A stopped brick makes the client drop the connection on ping timeout;
+## its reconnect to the same brick offers the session, which is taken back
+brick_pid=$(get_brick_pid $V0 $H0 $B0/1)
+TEST kill -STOP $brick_pid
+EXPECT_WITHIN 20 "1" log_count "has not responded in the last"
+TEST kill -CONT $brick_pid
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "1" log_count "resumed session"
+EXPECT "$md5" file_md5 $M0/file
+
+## The restarted brick does not know the session the client offers, and
+## has to fall back to a full handshake
+TEST kill_brick $V0 $H0 $B0/1
+TEST $CLI volume start $V0 force
+EXPECT_WITHIN $PROCESS_UP_TIMEOUT "1" online_brick_count
+EXPECT_WITHIN $CHILD_UP_TIMEOUT "$md5" file_md5 $M0/file
+
+TEST umount $M0
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+EXPECT "$md5" file_md5 $M0/file
+
+TEST umount $M0
+rm -f $MNT_LOG
+cleanup;
@@ -18,10 +18,6 @@
 #include <signal.h>
 
 
-#define LOCKED_NO       0x0        /* no lock held */
-#define LOCKED_YES      0x1        /* for DATA, METADATA, ENTRY and higher_path */
-#define LOCKED_LOWER    0x2        /* for lower path */
-
 #define AFR_TRACE_INODELK_IN(frame, this, params ...)           \
         do {                                                    \
                 afr_private_t *_priv = this->private;           \
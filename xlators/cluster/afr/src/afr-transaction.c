@@ -15,6 +15,7 @@
 
 #include "afr.h"
 #include "afr-transaction.h"
+#include "compound-fop-utils.h"
 
 #include <signal.h>
 
@@ -561,6 +562,151 @@ afr_handle_quorum (call_frame_t *frame)
         local->op_errno = EROFS;
 }
 
+/* Whether the post-op can be sent along with the unlock which follows it,
+ * in one compound per subvolume: only when every subvolume which gets the
+ * post-op is to be unlocked right after it, and by nothing else.
+ */
+static gf_boolean_t
+afr_changelog_post_op_can_unlock (call_frame_t *frame, xlator_t *this)
+{
+        afr_local_t         *local    = NULL;
+        afr_private_t       *priv     = NULL;
+        afr_internal_lock_t *int_lock = NULL;
+        afr_inodelk_t       *inodelk  = NULL;
+        int                  i        = 0;
+
+        local = frame->local;
+        priv = this->private;
+        int_lock = &local->internal_lock;
+
+        if (!priv->use_compound_fops || !local->fd)
+                return _gf_false;
+
+        if (local->transaction.type != AFR_DATA_TRANSACTION &&
+            local->transaction.type != AFR_METADATA_TRANSACTION)
+                return _gf_false;
+
+        if (local->transaction.resume_stub ||
+            afr_lock_server_count (priv, local->transaction.type) == 0)
+                return _gf_false;
+
+        inodelk = afr_get_inodelk (int_lock, int_lock->domain);
+        if (!inodelk)
+                return _gf_false;
+
+        for (i = 0; i < priv->child_count; i++) {
+                if (local->transaction.eager_lock[i])
+                        return _gf_false;
+                if (!local->transaction.pre_op[i] !=
+                    !(inodelk->locked_nodes[i] & LOCKED_YES))
+                        return _gf_false;
+        }
+
+        return _gf_true;
+}
+
+
+int
+afr_changelog_post_op_unlock_cbk (call_frame_t *frame, void *cookie,
+                                  xlator_t *this, int32_t op_ret,
+                                  int32_t op_errno,
+                                  compound_args_cbk_t *args_cbk,
+                                  dict_t *xdata)
+{
+        afr_local_t         *local      = NULL;
+        afr_internal_lock_t *int_lock   = NULL;
+        afr_inodelk_t       *inodelk    = NULL;
+        int                  child      = (long) cookie;
+        int                  call_count = -1;
+
+        local = frame->local;
+        int_lock = &local->internal_lock;
+        inodelk = afr_get_inodelk (int_lock, int_lock->domain);
+
+        if (op_ret < 0 || !args_cbk || args_cbk->fops[0].op_ret < 0)
+                afr_transaction_fop_failed (frame, this, child);
+
+        /* a lock which the compound did not get to is left to afr_unlock */
+        if (op_ret >= 0 && args_cbk)
+                inodelk->locked_nodes[child] &= LOCKED_NO;
+
+        call_count = afr_frame_return (frame);
+
+        if (call_count == 0) {
+                compound_args_destroy (local->transaction.compound_args);
+                local->transaction.compound_args = NULL;
+
+                int_lock->lock_cbk = local->transaction.done;
+                afr_unlock (frame, this);
+        }
+
+        return 0;
+}
+
+
+int
+afr_changelog_post_op_unlock (call_frame_t *frame, xlator_t *this,
+                              dict_t *xattr)
+{
+        afr_local_t         *local      = NULL;
+        afr_private_t       *priv       = NULL;
+        afr_internal_lock_t *int_lock   = NULL;
+        afr_inodelk_t       *inodelk    = NULL;
+        compound_args_t     *args       = NULL;
+        struct gf_flock      flock      = {0,};
+        int                  call_count = 0;
+        int                  i          = 0;
+
+        local = frame->local;
+        priv = this->private;
+        int_lock = &local->internal_lock;
+        inodelk = afr_get_inodelk (int_lock, int_lock->domain);
+
+        call_count = afr_changelog_call_count (local->transaction.type,
+                                               local->transaction.pre_op,
+                                               priv->child_count);
+        if (call_count == 0) {
+                afr_changelog_post_op_done (frame, this);
+                return 0;
+        }
+
+        flock.l_start = inodelk->flock.l_start;
+        flock.l_len   = inodelk->flock.l_len;
+        flock.l_type  = F_UNLCK;
+
+        args = compound_args_new (2);
+        if (!args ||
+            compound_args_fxattrop (args, 0, local->fd, GF_XATTROP_ADD_ARRAY,
+                                    xattr, NULL) ||
+            compound_args_finodelk (args, 1, int_lock->domain, local->fd,
+                                    F_SETLK, &flock, NULL)) {
+                compound_args_destroy (args);
+                afr_changelog_do (frame, this, xattr,
+                                  afr_changelog_post_op_done);
+                return 0;
+        }
+
+        /* the same arguments serve all the subvolumes */
+        local->transaction.compound_args = args;
+        local->call_count = call_count;
+
+        for (i = 0; i < priv->child_count; i++) {
+                if (!local->transaction.pre_op[i])
+                        continue;
+
+                STACK_WIND_COOKIE (frame, afr_changelog_post_op_unlock_cbk,
+                                   (void *) (long) i, priv->children[i],
+                                   priv->children[i]->fops->compound,
+                                   args, NULL);
+
+                if (!--call_count)
+                        break;
+        }
+
+        return 0;
+}
+
+
 int
 afr_changelog_post_op_now (call_frame_t *frame, xlator_t *this)
 {
@@ -634,7 +780,11 @@ afr_changelog_post_op_now (call_frame_t *frame, xlator_t *this)
 
 	}
 
-	afr_changelog_do (frame, this, xattr, afr_changelog_post_op_done);
+	if (afr_changelog_post_op_can_unlock (frame, this))
+		afr_changelog_post_op_unlock (frame, this, xattr);
+	else
+		afr_changelog_do (frame, this, xattr,
+				  afr_changelog_post_op_done);
 out:
 	if (xattr)
                 dict_unref (xattr);
@@ -194,6 +194,9 @@ reconfigure (xlator_t *this, dict_t *options)
         GF_OPTION_RECONF ("ensure-durability", priv->ensure_durability, options,
                           bool, out);
 
+        GF_OPTION_RECONF ("use-compound-fops", priv->use_compound_fops,
+                          options, bool, out);
+
 	GF_OPTION_RECONF ("self-heal-daemon", priv->shd.enabled, options,
 			  bool, out);
 
@@ -343,6 +346,9 @@ init (xlator_t *this)
         GF_OPTION_INIT ("ensure-durability", priv->ensure_durability, bool,
                         out);
 
+        GF_OPTION_INIT ("use-compound-fops", priv->use_compound_fops, bool,
+                        out);
+
 	GF_OPTION_INIT ("self-heal-daemon", priv->shd.enabled, bool, out);
 
 	GF_OPTION_INIT ("iam-self-heal-daemon", priv->shd.iamshd, bool, out);
@@ -741,6 +747,13 @@ struct volume_options options[] = {
                          "written to the disk",
           .default_value = "on",
         },
+        { .key = {"use-compound-fops"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Send the post-op of a transaction and the unlock "
+                         "which follows it to each brick in one request, "
+                         "instead of one after the other",
+        },
 	{ .key = {"afr-dirty-xattr"},
 	  .type = GF_OPTION_TYPE_STR,
 	  .default_value = AFR_DIRTY_DEFAULT,
@@ -116,6 +116,7 @@ typedef struct _afr_private {
         gf_boolean_t           did_discovery;
         uint64_t               sh_readdir_size;
         gf_boolean_t           ensure_durability;
+        gf_boolean_t           use_compound_fops;
         char                   *sh_domain;
 	char                   *afr_dirty;
 
@@ -134,6 +135,10 @@ typedef enum {
         AFR_ENTRY_RENAME_TRANSACTION,  /* rename */
 } afr_transaction_type;
 
+#define LOCKED_NO       0x0        /* no lock held */
+#define LOCKED_YES      0x1        /* for DATA, METADATA, ENTRY and higher_path */
+#define LOCKED_LOWER    0x2        /* for lower path */
+
 typedef enum {
         AFR_TRANSACTION_LK,
         AFR_SELFHEAL_LK,
@@ -678,6 +683,11 @@ typedef struct _afr_local {
 
 		afr_changelog_resume_t changelog_resume;
 
+		/* @compound_args: post-op and unlock sent together to every
+		   subvolume, when they can be
+		*/
+		compound_args_t *compound_args;
+
                 call_frame_t *main_frame;
 
                 int (*wind) (call_frame_t *frame, xlator_t *this, int subvol);
@@ -156,7 +156,7 @@ inline static int
 is_fop_latency_started (call_frame_t *frame)
 {
         GF_ASSERT (frame);
-        struct timeval epoch = {0,};
+        struct timespec epoch = {0,};
         return memcmp (&frame->begin, &epoch, sizeof (epoch));
 }
 
@@ -166,7 +166,7 @@ is_fop_latency_started (call_frame_t *frame)
                                                                         \
                 conf = this->private;                                   \
                 if (conf && conf->measure_latency) {                    \
-                        gettimeofday (&frame->end, NULL);               \
+                        timespec_now (&frame->end);                     \
                         update_ios_latency (conf, frame, GF_FOP_##op);  \
                 }                                                       \
         } while (0)
@@ -177,7 +177,7 @@ is_fop_latency_started (call_frame_t *frame)
                                                                          \
                 conf = this->private;                                    \
                 if (conf && conf->measure_latency) {                     \
-                        gettimeofday (&frame->begin, NULL);              \
+                        timespec_now (&frame->begin);                    \
                 } else {                                                 \
                         memset (&frame->begin, 0, sizeof (frame->begin));\
                 }                                                        \
@@ -207,7 +207,7 @@ is_fop_latency_started (call_frame_t *frame)
                         if (conf && conf->measure_latency &&                  \
                             conf->count_fop_hits) {                           \
                                 BUMP_FOP(op);                                 \
-                                gettimeofday (&frame->end, NULL);             \
+                                timespec_now (&frame->end);                   \
                                 update_ios_latency (conf, frame, GF_FOP_##op);\
                         }                                                     \
                 }                                                             \
@@ -293,15 +293,14 @@ is_fop_latency_started (call_frame_t *frame)
         do {									\
                 struct ios_conf         *conf = NULL;				\
                 double                   elapsed;				\
-                struct timeval          *begin, *end;				\
+                struct timespec         *begin, *end;				\
                 double                   throughput;				\
                int                      flag = 0;                              \
                                                                                 \
                 begin = &frame->begin;						\
                 end   = &frame->end;						\
                                                                                 \
-                elapsed = (end->tv_sec - begin->tv_sec) * 1e6			\
-                        + (end->tv_usec - begin->tv_usec);			\
+                elapsed = (TS ((*end)) - TS ((*begin))) / 1e3;			\
                 throughput = op_ret / elapsed;					\
                                                                                 \
                 conf = this->private;						\
@@ -1069,13 +1068,12 @@ update_ios_latency (struct ios_conf *conf, call_frame_t *frame,
                     glusterfs_fop_t op)
 {
         double elapsed;
-        struct timeval *begin, *end;
+        struct timespec *begin, *end;
 
         begin = &frame->begin;
         end   = &frame->end;
 
-        elapsed = (end->tv_sec - begin->tv_sec) * 1e6
-                + (end->tv_usec - begin->tv_usec);
+        elapsed = (TS ((*end)) - TS ((*begin))) / 1e3;
 
         update_ios_latency_stats (&conf->cumulative, elapsed, op);
         update_ios_latency_stats (&conf->incremental, elapsed, op);
@@ -28,6 +28,7 @@ frames_file_fill (xlator_t *this, inode_t *file, strfd_t *strfd)
         struct call_pool *pool = NULL;
         call_stack_t *stack = NULL;
         call_frame_t *frame = NULL;
+        struct timeval tv = {0,};
         int i = 0;
         int j = 1;
 
@@ -52,11 +53,14 @@ frames_file_fill (xlator_t *this, inode_t *file, strfd_t *strfd)
                                 strprintf (strfd,
                                                 "\t\t\t\"Xlator\": \"%s\",\n",
                                                 frame->this->name);
-                                if (frame->begin.tv_sec)
+                                if (frame->begin.tv_sec) {
+                                        timespec_to_wallclock (&frame->begin,
+                                                               &tv);
                                         strprintf (strfd,
                                                         "\t\t\t\"Creation_time\": %d.%d,\n",
-                                                        (int)frame->begin.tv_sec,
-                                                        (int)frame->begin.tv_usec);
+                                                        (int)tv.tv_sec,
+                                                        (int)tv.tv_usec);
+                                }
                                 strprintf (strfd, " \t\t\t\"Refcount\": %d,\n",
                                                 frame->ref_count);
                                 if (frame->parent)
@@ -526,6 +526,11 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 1,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "cluster.use-compound-fops",
+          .voltype    = "cluster/replicate",
+          .op_version = GD_OP_VERSION_3_7_0,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
         { .key        = "cluster.quorum-type",
           .voltype    = "cluster/replicate",
           .option     = "quorum-type",
@@ -728,6 +733,36 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .voltype     = "performance/io-threads",
           .op_version  = 2
         },
+        { .key         = "performance.iot-cpu-affinity",
+          .voltype     = "performance/io-threads",
+          .option      = "cpu-affinity",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "performance.iot-client-fairness",
+          .voltype     = "performance/io-threads",
+          .option      = "client-fairness",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "performance.iot-client-weight",
+          .voltype     = "performance/io-threads",
+          .option      = "client-weight",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "performance.iot-rebalance-weight",
+          .voltype     = "performance/io-threads",
+          .option      = "rebalance-weight",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "performance.iot-self-heal-weight",
+          .voltype     = "performance/io-threads",
+          .option      = "self-heal-weight",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "performance.iot-geo-rep-weight",
+          .voltype     = "performance/io-threads",
+          .option      = "geo-rep-weight",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
 
         /* Other perf xlators' options */
         { .key        = "performance.cache-size",
@@ -877,6 +912,12 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .op_version = 2,
           .flags      = OPT_FLAG_CLIENT_OPT
         },
+        { .key        = "client.connection-count",
+          .voltype    = "protocol/client",
+          .option     = "connection-count",
+          .op_version = GD_OP_VERSION_3_7_0,
+          .flags      = OPT_FLAG_CLIENT_OPT
+        },
 
         /* Server xlator options */
         { .key         = "network.tcp-window-size",
@@ -887,6 +928,10 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .voltype     = "protocol/server",
           .op_version  = 1
         },
+        { .key         = "network.inode-hash-size",
+          .voltype     = "protocol/server",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
         { .key         = AUTH_ALLOW_MAP_KEY,
           .voltype     = "protocol/server",
           .option      = "!server-auth",
@@ -936,6 +981,12 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .type        = GLOBAL_DOC,
           .op_version  = 3
         },
+        { .key         = "server.queue-target-latency",
+          .voltype     = "protocol/server",
+          .option      = "rpc.queue-target-latency",
+          .type        = GLOBAL_DOC,
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
         { .key         = "features.lock-heal",
           .voltype     = "protocol/server",
           .option      = "lk-heal",
@@ -948,6 +999,61 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .type        = NO_DOC,
           .op_version  = 1
         },
+        { .key         = "server.write-coalesce",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.write-coalesce",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "client.write-coalesce",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.write-coalesce",
+          .op_version  = GD_OP_VERSION_3_7_0,
+          .flags       = OPT_FLAG_CLIENT_OPT
+        },
+        { .key         = "server.batch-read",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.batch-read",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "client.batch-read",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.batch-read",
+          .op_version  = GD_OP_VERSION_3_7_0,
+          .flags       = OPT_FLAG_CLIENT_OPT
+        },
+        { .key         = "server.zerocopy-send",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.zerocopy-send",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "client.zerocopy-send",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.zerocopy-send",
+          .op_version  = GD_OP_VERSION_3_7_0,
+          .flags       = OPT_FLAG_CLIENT_OPT
+        },
+        { .key         = "server.ssl-ktls",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.ssl-ktls",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "client.ssl-ktls",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.ssl-ktls",
+          .op_version  = GD_OP_VERSION_3_7_0,
+          .flags       = OPT_FLAG_CLIENT_OPT
+        },
+        { .key         = "server.ssl-session-cache",
+          .voltype     = "protocol/server",
+          .option      = "transport.socket.ssl-session-cache",
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
+        { .key         = "client.ssl-session-cache",
+          .voltype     = "protocol/client",
+          .option      = "transport.socket.ssl-session-cache",
+          .op_version  = GD_OP_VERSION_3_7_0,
+          .flags       = OPT_FLAG_CLIENT_OPT
+        },
         { .key         = "server.ssl",
           .voltype     = "protocol/server",
           .option      = "transport.socket.ssl-enabled",
@@ -1514,6 +1620,12 @@ struct volopt_map_entry glusterd_volopt_map[] = {
           .type        = GLOBAL_DOC,
           .op_version  = 3
         },
+        { .key         = "nfs.drc-memory-limit",
+          .voltype     = "nfs/server",
+          .option      = "nfs.drc-memory-limit",
+          .type        = GLOBAL_DOC,
+          .op_version  = GD_OP_VERSION_3_7_0
+        },
         { .key         = "nfs.read-size",
           .voltype     = "nfs/server",
           .option      = "nfs3.read-size",
@@ -1906,5 +1906,12 @@ struct volume_options options[] = {
           .description = "Sets the number of non-idempotent "
                          "requests to cache in drc"
         },
+        { .key  = {"nfs.drc-memory-limit"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .default_value = "64MB",
+          .description = "Sets the memory the drc may take for cached "
+                         "requests and their replies, the least recently "
+                         "retransmitted ones are evicted past it"
+        },
         { .key  = {NULL} },
 };
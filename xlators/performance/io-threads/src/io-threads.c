@@ -28,6 +28,7 @@
 void *iot_worker (void *arg);
 int iot_workers_scale (iot_conf_t *conf);
 int __iot_workers_scale (iot_conf_t *conf);
+static int iot_workers_init (iot_conf_t *conf);
 struct volume_options options[];
 
 #define IOT_FOP(name, frame, this, args ...)                                   \
@@ -52,200 +53,803 @@ struct volume_options options[];
                 }                                                              \
         } while (0)
 
+/* Counts a least priority fop against the rate limit; when the limit is
+   reached it returns true and the time at which the next one may run. */
+static gf_boolean_t
+iot_least_throttled (iot_conf_t *conf, struct timespec *sleep)
+{
+	struct timeval curtv = {0,}, difftv = {0,};
+        gf_boolean_t   throttled = _gf_false;
+
+	pthread_mutex_lock(&conf->throttle.lock);
+	if (!conf->throttle.sample_time.tv_sec) {
+		/* initialize */
+		gettimeofday(&conf->throttle.sample_time, NULL);
+	} else {
+		/*
+		 * Maintain a running count of least priority
+		 * operations that are handled over a particular
+		 * time interval. The count is provided via
+		 * state dump and is used as a measure against
+		 * least priority op throttling.
+		 */
+		gettimeofday(&curtv, NULL);
+		timersub(&curtv, &conf->throttle.sample_time, &difftv);
+		if (difftv.tv_sec >= IOT_LEAST_THROTTLE_DELAY) {
+			conf->throttle.cached_rate =
+				conf->throttle.sample_cnt;
+			conf->throttle.sample_cnt = 0;
+			conf->throttle.sample_time = curtv;
+		}
+
+		/*
+		 * If we're over the configured rate limit,
+		 * provide an absolute time to the caller that
+		 * represents the soonest we're allowed to
+		 * return another least priority request.
+		 */
+		if (conf->throttle.rate_limit &&
+		    conf->throttle.sample_cnt >= conf->throttle.rate_limit) {
+			struct timeval delay;
+			delay.tv_sec = IOT_LEAST_THROTTLE_DELAY;
+			delay.tv_usec = 0;
+
+			timeradd(&conf->throttle.sample_time, &delay, &curtv);
+			TIMEVAL_TO_TIMESPEC(&curtv, sleep);
+
+			throttled = _gf_true;
+			goto unlock;
+		}
+	}
+	conf->throttle.sample_cnt++;
+unlock:
+	pthread_mutex_unlock(&conf->throttle.lock);
+
+        return throttled;
+}
+
+
+/* Takes one of the ac_iot_limit[pri] execution slots, if one is free. */
+static gf_boolean_t
+iot_ac_acquire (iot_conf_t *conf, int pri)
+{
+        int32_t count = 0;
+
+        do {
+                count = conf->ac_iot_count[pri];
+                if (count >= conf->ac_iot_limit[pri])
+                        return _gf_false;
+        } while (!__sync_bool_compare_and_swap (&conf->ac_iot_count[pri],
+                                                count, count + 1));
+
+        return _gf_true;
+}
+
+
+static void
+iot_ac_release (iot_conf_t *conf, int pri)
+{
+        __sync_fetch_and_sub (&conf->ac_iot_count[pri], 1);
+}
+
+
+/* Takes the oldest fop of priority pri off the queue of worker, which the
+   caller has locked. The execution slot is taken only once a fop is
+   there, so a worker that finds nothing never holds one back. */
 call_stub_t *
-__iot_dequeue (iot_conf_t *conf, int *pri, struct timespec *sleep)
+__iot_dequeue (iot_conf_t *conf, struct iot_worker *worker, int pri,
+               struct timespec *sleep)
 {
         call_stub_t  *stub = NULL;
-        int           i = 0;
-	struct timeval curtv = {0,}, difftv = {0,};
+
+        if (list_empty (&worker->reqs[pri]))
+                return NULL;
+
+        if (!iot_ac_acquire (conf, pri))
+                return NULL;
+
+        if (pri == IOT_PRI_LEAST && iot_least_throttled (conf, sleep)) {
+                iot_ac_release (conf, pri);
+                return NULL;
+        }
+
+        stub = list_entry (worker->reqs[pri].next, call_stub_t, list);
+        list_del_init (&stub->list);
+
+        worker->queue_size--;
+        worker->queue_sizes[pri]--;
+        __sync_fetch_and_sub (&conf->queue_size, 1);
+        __sync_fetch_and_sub (&conf->queue_sizes[pri], 1);
+
+        return stub;
+}
+
+
+static iot_client_class_t
+iot_client_class (pid_t pid)
+{
+        switch (pid) {
+        case GF_CLIENT_PID_DEFRAG:
+                return IOT_CLIENT_REBALANCE;
+        case GF_CLIENT_PID_AFR_SELF_HEALD:
+                return IOT_CLIENT_SELF_HEAL;
+        case GF_CLIENT_PID_GSYNCD:
+                return IOT_CLIENT_GEO_REP;
+        default:
+                return IOT_CLIENT_NORMAL;
+        }
+}
+
+
+static const char *
+iot_client_class_name (iot_client_class_t klass)
+{
+        switch (klass) {
+        case IOT_CLIENT_REBALANCE:
+                return "rebalance";
+        case IOT_CLIENT_SELF_HEAL:
+                return "self-heal";
+        case IOT_CLIENT_GEO_REP:
+                return "geo-rep";
+        default:
+                return "normal";
+        }
+}
+
+
+static void
+iot_client_init (struct iot_client *ioc, iot_client_class_t klass)
+{
+        int i = 0;
+
+        INIT_LIST_HEAD (&ioc->clients);
+        for (i = 0; i < IOT_PRI_MAX; i++) {
+                INIT_LIST_HEAD (&ioc->active[i]);
+                INIT_LIST_HEAD (&ioc->reqs[i]);
+        }
+        ioc->klass = klass;
+}
+
+
+static void
+iot_client_unref (iot_conf_t *conf, struct iot_client *ioc)
+{
+        if (ioc->builtin)
+                return;
+
+        if (__sync_sub_and_fetch (&ioc->ref, 1))
+                return;
+
+        pthread_mutex_lock (&conf->clients_lock);
+        {
+                list_del_init (&ioc->clients);
+        }
+        pthread_mutex_unlock (&conf->clients_lock);
+
+        GF_FREE (ioc->uid);
+        GF_FREE (ioc);
+}
+
+
+/* The fair queue of the client the frame comes from, with a reference.
+   Frames without a client_t, from internal callers, share the builtin
+   queue of their class. */
+static struct iot_client *
+iot_client_get (iot_conf_t *conf, call_frame_t *frame)
+{
+        struct iot_client *ioc = NULL;
+        client_t          *client = NULL;
+        iot_client_class_t klass = IOT_CLIENT_NORMAL;
+        void              *tmp = NULL;
+
+        client = frame->root->client;
+        klass = iot_client_class (frame->root->pid);
+        if (!client)
+                return &conf->internal[klass];
+
+        if (client_ctx_get (client, conf->this, &tmp) == 0) {
+                ioc = tmp;
+                __sync_fetch_and_add (&ioc->ref, 1);
+                return ioc;
+        }
+
+        pthread_mutex_lock (&conf->clients_lock);
+        {
+                /* somebody may have raced us to it */
+                if (client_ctx_get (client, conf->this, &tmp) == 0) {
+                        ioc = tmp;
+                        __sync_fetch_and_add (&ioc->ref, 1);
+                        goto unlock;
+                }
+
+                ioc = GF_CALLOC (1, sizeof (*ioc), gf_iot_mt_iot_client_t);
+                if (!ioc)
+                        goto unlock;
+
+                iot_client_init (ioc, klass);
+                if (client->client_uid)
+                        ioc->uid = gf_strdup (client->client_uid);
+
+                if (client_ctx_set (client, conf->this, ioc) != 0) {
+                        GF_FREE (ioc->uid);
+                        GF_FREE (ioc);
+                        ioc = NULL;
+                        goto unlock;
+                }
+
+                /* one for the client_t, one for the caller */
+                ioc->ref = 2;
+                list_add_tail (&ioc->clients, &conf->clients);
+        }
+unlock:
+        pthread_mutex_unlock (&conf->clients_lock);
+
+        if (!ioc)
+                ioc = &conf->internal[klass];
+
+        return ioc;
+}
+
+
+/* Queues req on the client, and the client on the ring of the priority
+   if it had nothing of that priority queued; the ring takes over the
+   reference of the caller then. */
+static void
+iot_fair_enqueue (iot_conf_t *conf, struct iot_client *ioc,
+                  struct iot_fair_req *req, int pri)
+{
+        struct iot_fair_queue *fq = NULL;
+        gf_boolean_t           activated = _gf_false;
+
+        fq = &conf->fair[pri];
+
+        pthread_mutex_lock (&fq->lock);
+        {
+                list_add_tail (&req->list, &ioc->reqs[pri]);
+                ioc->queue_sizes[pri]++;
+                fq->queue_size++;
+
+                if (list_empty (&ioc->active[pri])) {
+                        ioc->credits[pri] = conf->client_weights[ioc->klass];
+                        list_add_tail (&ioc->active[pri], &fq->active);
+                        activated = _gf_true;
+                }
+        }
+        pthread_mutex_unlock (&fq->lock);
+
+        if (!activated)
+                iot_client_unref (conf, ioc);
+}
+
+
+/* Takes the oldest fop of the client whose turn it is in the ring of
+   priority pri. The client keeps its turn until it has used up its
+   weight, then goes to the back of the ring; it leaves the ring when it
+   has nothing more queued. */
+static call_stub_t *
+iot_fair_dequeue (iot_conf_t *conf, int pri, struct timespec *sleep)
+{
+        struct iot_fair_queue *fq = NULL;
+        struct iot_fair_req   *req = NULL;
+        struct iot_client     *ioc = NULL;
+        struct iot_client     *done = NULL;
+        call_stub_t           *stub = NULL;
+        struct timeval         now = {0, };
+        struct timeval         wait = {0, };
+        uint64_t               waited = 0;
+
+        fq = &conf->fair[pri];
+
+        pthread_mutex_lock (&fq->lock);
+        {
+                if (list_empty (&fq->active))
+                        goto unlock;
+
+                if (!iot_ac_acquire (conf, pri))
+                        goto unlock;
+
+                if (pri == IOT_PRI_LEAST && iot_least_throttled (conf, sleep)) {
+                        iot_ac_release (conf, pri);
+                        goto unlock;
+                }
+
+                ioc = list_entry (fq->active.next, struct iot_client,
+                                  active[pri]);
+                req = list_entry (ioc->reqs[pri].next, struct iot_fair_req,
+                                  list);
+                list_del_init (&req->list);
+                ioc->queue_sizes[pri]--;
+                fq->queue_size--;
+
+                gettimeofday (&now, NULL);
+                timersub (&now, &req->queued, &wait);
+                waited = wait.tv_sec * 1000000ULL + wait.tv_usec;
+                ioc->executed[pri]++;
+                ioc->total_wait[pri] += waited;
+                if (waited > ioc->max_wait[pri])
+                        ioc->max_wait[pri] = waited;
+
+                if (list_empty (&ioc->reqs[pri])) {
+                        list_del_init (&ioc->active[pri]);
+                        done = ioc;
+                } else if (--ioc->credits[pri] <= 0) {
+                        ioc->credits[pri] = conf->client_weights[ioc->klass];
+                        list_move_tail (&ioc->active[pri], &fq->active);
+                }
+        }
+unlock:
+        pthread_mutex_unlock (&fq->lock);
+
+        if (req) {
+                stub = req->stub;
+                mem_put (req);
+                __sync_fetch_and_sub (&conf->queue_size, 1);
+                __sync_fetch_and_sub (&conf->queue_sizes[pri], 1);
+        }
+
+        if (done)
+                iot_client_unref (conf, done);
+
+        return stub;
+}
+
+
+/* Finds the next fop for self, the highest priority first: from its own
+   queue, then from the queues of the other workers. */
+call_stub_t *
+iot_dequeue (iot_conf_t *conf, struct iot_worker *self, int *pri,
+             struct timespec *sleep)
+{
+        struct iot_worker *victim = NULL;
+        call_stub_t       *stub = NULL;
+        int                hwm = 0;
+        int                i = 0;
+        int                j = 0;
 
         *pri = -1;
-	sleep->tv_sec = 0;
-	sleep->tv_nsec = 0;
+        sleep->tv_sec = 0;
+        sleep->tv_nsec = 0;
+
         for (i = 0; i < IOT_PRI_MAX; i++) {
-                if (list_empty (&conf->reqs[i]) ||
-                   (conf->ac_iot_count[i] >= conf->ac_iot_limit[i]))
+                /* unlocked hints, the queues are checked under their locks */
+                if (!conf->queue_sizes[i] ||
+                    conf->ac_iot_count[i] >= conf->ac_iot_limit[i])
                         continue;
 
-		if (i == IOT_PRI_LEAST) {
-			pthread_mutex_lock(&conf->throttle.lock);
-			if (!conf->throttle.sample_time.tv_sec) {
-				/* initialize */
-				gettimeofday(&conf->throttle.sample_time, NULL);
-			} else {
-				/*
-				 * Maintain a running count of least priority
-				 * operations that are handled over a particular
-				 * time interval. The count is provided via
-				 * state dump and is used as a measure against
-				 * least priority op throttling.
-				 */
-				gettimeofday(&curtv, NULL);
-				timersub(&curtv, &conf->throttle.sample_time,
-					 &difftv);
-				if (difftv.tv_sec >= IOT_LEAST_THROTTLE_DELAY) {
-					conf->throttle.cached_rate =
-						conf->throttle.sample_cnt;
-					conf->throttle.sample_cnt = 0;
-					conf->throttle.sample_time = curtv;
-				}
-
-				/*
-				 * If we're over the configured rate limit,
-				 * provide an absolute time to the caller that
-				 * represents the soonest we're allowed to
-				 * return another least priority request.
-				 */
-				if (conf->throttle.rate_limit &&
-				    conf->throttle.sample_cnt >=
-						conf->throttle.rate_limit) {
-					struct timeval delay;
-					delay.tv_sec = IOT_LEAST_THROTTLE_DELAY;
-					delay.tv_usec = 0;
-
-					timeradd(&conf->throttle.sample_time,
-						 &delay, &curtv);
-					TIMEVAL_TO_TIMESPEC(&curtv, sleep);
-
-					pthread_mutex_unlock(
-						&conf->throttle.lock);
-					break;
-				}
-			}
-			conf->throttle.sample_cnt++;
-			pthread_mutex_unlock(&conf->throttle.lock);
-		}
+                /* the fair queues are drained even after client-fairness
+                   is turned off */
+                if (conf->fair[i].queue_size) {
+                        stub = iot_fair_dequeue (conf, i, sleep);
+                        if (stub)
+                                goto out;
+                        if (sleep->tv_sec)
+                                continue;
+                }
 
-                stub = list_entry (conf->reqs[i].next, call_stub_t, list);
-                conf->ac_iot_count[i]++;
+                pthread_mutex_lock (&self->lock);
+                {
+                        stub = __iot_dequeue (conf, self, i, sleep);
+                }
+                pthread_mutex_unlock (&self->lock);
+
+                if (stub)
+                        goto out;
+                if (sleep->tv_sec)
+                        continue;
+
+                hwm = conf->worker_hwm;
+                for (j = 1; j < hwm; j++) {
+                        victim = &conf->workers[(self->id + j) % hwm];
+                        if (!victim->queue_sizes[i])
+                                continue;
+
+                        pthread_mutex_lock (&victim->lock);
+                        {
+                                stub = __iot_dequeue (conf, victim, i, sleep);
+                        }
+                        pthread_mutex_unlock (&victim->lock);
+
+                        if (stub) {
+                                self->stolen++;
+                                goto out;
+                        }
+                        if (sleep->tv_sec)
+                                break;
+                }
+        }
+out:
+        if (stub)
                 *pri = i;
-                break;
+        return stub;
+}
+
+
+/* Queues stub on worker, which must still be running; wakes it if it
+   sleeps. */
+static gf_boolean_t
+iot_enqueue (struct iot_worker *worker, call_stub_t *stub, int pri)
+{
+        gf_boolean_t queued = _gf_false;
+
+        pthread_mutex_lock (&worker->lock);
+        {
+                if (!worker->running)
+                        goto unlock;
+
+                list_add_tail (&stub->list, &worker->reqs[pri]);
+                worker->queue_size++;
+                worker->queue_sizes[pri]++;
+                worker->kicks++;
+
+                if (worker->sleeping)
+                        pthread_cond_signal (&worker->cond);
+
+                queued = _gf_true;
+        }
+unlock:
+        pthread_mutex_unlock (&worker->lock);
+
+        return queued;
+}
+
+
+/* The worker slot that runs on the cpu of the caller, -1 without cpu
+   affinity. */
+static int
+iot_local_worker (iot_conf_t *conf)
+{
+#ifdef GF_LINUX_HOST_OS
+        int cpu = 0;
+        int i = 0;
+
+        if (!conf->cpu_affinity)
+                return -1;
+
+        cpu = sched_getcpu ();
+        for (i = 0; i < conf->cpu_count; i++) {
+                if (conf->cpu_ids[i] == cpu)
+                        return i;
+        }
+#endif
+        return -1;
+}
+
+
+/* Takes a sleeping worker off the idle mask, the local one if it sleeps.
+   Whoever clears the bit of a worker owes it a wakeup, and counts it as
+   searching from then on, so that no one else wakes a second worker for
+   the same fop. */
+static struct iot_worker *
+iot_claim_idle_worker (iot_conf_t *conf, int local)
+{
+        uint64_t mask = 0;
+        int      idx = 0;
+
+        mask = conf->idle_mask;
+        while (mask) {
+                if (local >= 0 && (mask & (1ULL << local)))
+                        idx = local;
+                else
+                        idx = __builtin_ffsll (mask) - 1;
+
+                if (__sync_bool_compare_and_swap (&conf->idle_mask, mask,
+                                                  mask & ~(1ULL << idx))) {
+                        __sync_fetch_and_add (&conf->searching, 1);
+                        return &conf->workers[idx];
+                }
+
+                mask = conf->idle_mask;
         }
 
-        if (!stub)
+        return NULL;
+}
+
+
+/* Wakes one sleeping worker to come and steal. */
+static void
+iot_wake_idle_worker (iot_conf_t *conf, int local)
+{
+        struct iot_worker *worker = NULL;
+
+        worker = iot_claim_idle_worker (conf, local);
+        if (!worker)
+                return;
+
+        pthread_mutex_lock (&worker->lock);
+        {
+                worker->kicks++;
+                if (worker->sleeping)
+                        pthread_cond_signal (&worker->cond);
+        }
+        pthread_mutex_unlock (&worker->lock);
+}
+
+
+static struct iot_worker *
+iot_pick_worker (iot_conf_t *conf, int local)
+{
+        struct iot_worker *worker = NULL;
+        int                hwm = 0;
+        int                start = 0;
+        int                i = 0;
+
+        hwm = conf->worker_hwm;
+        if (!hwm)
                 return NULL;
 
-        conf->queue_size--;
-        conf->queue_sizes[*pri]--;
-        list_del_init (&stub->list);
+        if (local >= 0)
+                start = local;
+        else
+                start = __sync_fetch_and_add (&conf->next_worker, 1);
 
-        return stub;
+        /* rather a busy worker than waking one up */
+        for (i = 0; i < hwm; i++) {
+                worker = &conf->workers[(start + i) % hwm];
+                if (worker->running && !worker->sleeping)
+                        return worker;
+        }
+
+        for (i = 0; i < hwm; i++) {
+                worker = &conf->workers[(start + i) % hwm];
+                if (worker->running)
+                        return worker;
+        }
+
+        return NULL;
 }
 
 
-void
-__iot_enqueue (iot_conf_t *conf, call_stub_t *stub, int pri)
+static void
+iot_worker_set_affinity (iot_conf_t *conf, struct iot_worker *worker)
 {
-        if (pri < 0 || pri >= IOT_PRI_MAX)
-                pri = IOT_PRI_MAX-1;
+#ifdef GF_LINUX_HOST_OS
+        cpu_set_t  cpus;
+
+        if (conf->cpu_affinity && conf->cpu_count) {
+                CPU_ZERO (&cpus);
+                CPU_SET (conf->cpu_ids[worker->id % conf->cpu_count], &cpus);
+        } else {
+                cpus = conf->cpus;
+        }
 
-        list_add_tail (&stub->list, &conf->reqs[pri]);
+        pthread_setaffinity_np (pthread_self (), sizeof (cpus), &cpus);
+#endif
+        worker->affine = conf->cpu_affinity;
+}
 
-        conf->queue_size++;
-        conf->queue_sizes[pri]++;
 
-        return;
+/* Lets an idle worker go as long as IOT_MIN_THREADS remain. */
+static gf_boolean_t
+iot_worker_may_exit (iot_conf_t *conf)
+{
+        int32_t count = 0;
+
+        do {
+                count = conf->curr_count;
+                if (count <= IOT_MIN_THREADS)
+                        return _gf_false;
+        } while (!__sync_bool_compare_and_swap (&conf->curr_count, count,
+                                                count - 1));
+
+        return _gf_true;
 }
 
 
+/*
+ * A worker with nothing to run searches every queue, counted in
+ * conf->searching, before it goes to sleep. A fop is queued without
+ * waking anybody while some worker searches: that one will steal it.
+ * A searcher that finds work while others are queued wakes one more
+ * worker, so the workers come up one at a time as long as there is
+ * work for them and are never all woken for one fop.
+ */
 void *
 iot_worker (void *data)
 {
-        iot_conf_t       *conf = NULL;
-        xlator_t         *this = NULL;
-        call_stub_t      *stub = NULL;
-        struct timespec   sleep_till = {0, };
-        int               ret = 0;
-        int               pri = -1;
-        char              timeout = 0;
-        char              bye = 0;
-	struct timespec	  sleep = {0,};
-
-        conf = data;
+        struct iot_worker *self = NULL;
+        iot_conf_t        *conf = NULL;
+        xlator_t          *this = NULL;
+        call_stub_t       *stub = NULL;
+        struct timespec    sleep_till = {0, };
+	struct timespec	   sleep = {0,};
+        uint64_t           bit = 0;
+        uint32_t           kicks = 0;
+        gf_boolean_t       claimed = _gf_false;
+        int                ret = 0;
+        int                pri = -1;
+        char               bye = 0;
+
+        self = data;
+        conf = self->conf;
         this = conf->this;
         THIS = this;
+        bit = 1ULL << self->id;
+
+        iot_worker_set_affinity (conf, self);
 
         for (;;) {
-                sleep_till.tv_sec = time (NULL) + conf->idle_time;
+                if (self->affine != conf->cpu_affinity)
+                        iot_worker_set_affinity (conf, self);
 
-                pthread_mutex_lock (&conf->mutex);
-                {
-                        if (pri != -1) {
-                                conf->ac_iot_count[pri]--;
-                                pri = -1;
+                /* a claim has counted us already */
+                if (!claimed)
+                        __sync_fetch_and_add (&conf->searching, 1);
+                claimed = _gf_false;
+
+                kicks = *(volatile uint32_t *)&self->kicks;
+
+                stub = iot_dequeue (conf, self, &pri, &sleep);
+                if (stub) {
+                        if (!__sync_sub_and_fetch (&conf->searching, 1) &&
+                            conf->queue_size)
+                                iot_wake_idle_worker (conf, -1);
+                } else {
+                        /* advertise as idle, stop searching and look once
+                           more: a fop queued before this is found now, and
+                           whoever queues one after it sees nobody
+                           searching and wakes an idle worker */
+                        __sync_fetch_and_or (&conf->idle_mask, bit);
+                        __sync_fetch_and_sub (&conf->searching, 1);
+
+                        stub = iot_dequeue (conf, self, &pri, &sleep);
+                        if (stub) {
+                                if (!(__sync_fetch_and_and (&conf->idle_mask,
+                                                            ~bit) & bit))
+                                        __sync_fetch_and_sub (&conf->searching,
+                                                              1);
+                                if (!conf->searching && conf->queue_size)
+                                        iot_wake_idle_worker (conf, -1);
                         }
-                        while (conf->queue_size == 0) {
-                                conf->sleep_count++;
+                }
 
-                                ret = pthread_cond_timedwait (&conf->cond,
-                                                              &conf->mutex,
-                                                              &sleep_till);
-                                conf->sleep_count--;
+                if (stub) {
+                        call_resume (stub);
+                        self->executed++;
+                        iot_ac_release (conf, pri);
+                        continue;
+                }
 
-                                if (ret == ETIMEDOUT) {
-                                        timeout = 1;
-                                        break;
-                                }
+                ret = 0;
+                pthread_mutex_lock (&self->lock);
+                {
+                        if (sleep.tv_sec) {
+                                sleep_till = sleep;
+                        } else {
+                                sleep_till.tv_sec = time (NULL) +
+                                                    conf->idle_time;
+                                sleep_till.tv_nsec = 0;
                         }
 
-                        if (timeout) {
-                                if (conf->curr_count > IOT_MIN_THREADS) {
-                                        conf->curr_count--;
-                                        bye = 1;
-                                        gf_log (conf->this->name, GF_LOG_DEBUG,
-                                                "timeout, terminated. conf->curr_count=%d",
-                                                conf->curr_count);
-                                } else {
-                                        timeout = 0;
-                                }
+                        /* nothing was queued here since we last looked,
+                           an enqueue from now on finds us asleep */
+                        if (self->kicks == kicks) {
+                                self->sleeping = _gf_true;
+                                ret = pthread_cond_timedwait (&self->cond,
+                                                              &self->lock,
+                                                              &sleep_till);
+                                self->sleeping = _gf_false;
                         }
 
-                        stub = __iot_dequeue (conf, &pri, &sleep);
-			if (!stub && (sleep.tv_sec || sleep.tv_nsec)) {
-				pthread_cond_timedwait(&conf->cond,
-						       &conf->mutex, &sleep);
-				pthread_mutex_unlock(&conf->mutex);
-				continue;
-			}
-                }
-                pthread_mutex_unlock (&conf->mutex);
+                        claimed = !(__sync_fetch_and_and (&conf->idle_mask,
+                                                          ~bit) & bit);
 
-                if (stub) /* guard against spurious wakeups */
-                        call_resume (stub);
+                        if (ret == ETIMEDOUT && !sleep.tv_sec && !claimed &&
+                            self->queue_size == 0 &&
+                            iot_worker_may_exit (conf)) {
+                                self->running = _gf_false;
+                                bye = 1;
+                        }
+                }
+                pthread_mutex_unlock (&self->lock);
 
-                if (bye)
+                if (bye) {
+                        gf_log (conf->this->name, GF_LOG_DEBUG,
+                                "timeout, terminated. conf->curr_count=%d",
+                                conf->curr_count);
                         break;
-        }
-
-        if (pri != -1) {
-                pthread_mutex_lock (&conf->mutex);
-                {
-                        conf->ac_iot_count[pri]--;
                 }
-                pthread_mutex_unlock (&conf->mutex);
         }
+
         return NULL;
 }
 
 
+/* Queues stub on the fair queue of its client. No worker owns it, so
+   one is woken unless some worker is already searching. */
+static int
+iot_fair_schedule (iot_conf_t *conf, call_stub_t *stub, int pri)
+{
+        struct iot_fair_req *req = NULL;
+        struct iot_client   *ioc = NULL;
+        int                  ret = 0;
+
+        req = mem_get0 (conf->fair_req_pool);
+        if (!req)
+                return -ENOMEM;
+
+        INIT_LIST_HEAD (&req->list);
+        req->stub = stub;
+        gettimeofday (&req->queued, NULL);
+
+        ioc = iot_client_get (conf, stub->frame);
+
+        __sync_fetch_and_add (&conf->queue_size, 1);
+        __sync_fetch_and_add (&conf->queue_sizes[pri], 1);
+
+        iot_fair_enqueue (conf, ioc, req, pri);
+
+        __sync_synchronize ();
+        if (!conf->searching)
+                iot_wake_idle_worker (conf, iot_local_worker (conf));
+
+        if (conf->curr_count < conf->max_count)
+                ret = iot_workers_scale (conf);
+
+        return ret;
+}
+
+
 int
 do_iot_schedule (iot_conf_t *conf, call_stub_t *stub, int pri)
 {
-        int   ret = 0;
+        struct iot_worker *worker = NULL;
+        int                local = -1;
+        int                ret = 0;
 
-        pthread_mutex_lock (&conf->mutex);
-        {
-                __iot_enqueue (conf, stub, pri);
+        if (pri < 0 || pri >= IOT_PRI_MAX)
+                pri = IOT_PRI_MAX-1;
 
-                pthread_cond_signal (&conf->cond);
+        if (conf->client_fairness)
+                return iot_fair_schedule (conf, stub, pri);
 
-                ret = __iot_workers_scale (conf);
+        /* counted before it is visible, so a worker that finds the count
+           at zero really has nothing to look for */
+        __sync_fetch_and_add (&conf->queue_size, 1);
+        __sync_fetch_and_add (&conf->queue_sizes[pri], 1);
+
+        local = iot_local_worker (conf);
+
+        /* nobody is looking for work, hand it to a sleeping worker; a
+           claimed worker cannot exit before it gets the fop */
+        if (!conf->searching) {
+                worker = iot_claim_idle_worker (conf, local);
+                if (worker && iot_enqueue (worker, stub, pri))
+                        goto out;
         }
-        pthread_mutex_unlock (&conf->mutex);
 
+        for (;;) {
+                worker = iot_pick_worker (conf, local);
+                if (!worker) {
+                        ret = iot_workers_scale (conf);
+                        worker = iot_pick_worker (conf, local);
+                        if (!worker) {
+                                __sync_fetch_and_sub (&conf->queue_size, 1);
+                                __sync_fetch_and_sub (&conf->queue_sizes[pri],
+                                                      1);
+                                return -EAGAIN;
+                        }
+                }
+
+                /* it may have exited since it was picked */
+                if (iot_enqueue (worker, stub, pri))
+                        break;
+        }
+
+        /* pairs with the workers leaving the search before their last
+           look: either one of them finds the fop or we see nobody
+           searching */
+        __sync_synchronize ();
+        if (!conf->searching)
+                iot_wake_idle_worker (conf, local);
+
+        /* every worker is busy, start more if the queues call for it */
+        if (conf->curr_count < conf->max_count)
+                ret = iot_workers_scale (conf);
+out:
         return ret;
 }
 
+
 char*
 iot_get_pri_meaning (iot_pri_t pri)
 {
@@ -341,6 +945,7 @@ iot_schedule (call_frame_t *frame, xlator_t *this, call_stub_t *stub)
         case GF_FOP_RELEASE:
         case GF_FOP_RELEASEDIR:
         case GF_FOP_GETSPEC:
+        case GF_FOP_COMPOUND:
         case GF_FOP_MAXVALUE:
                 //fail compilation on missing fop
                 //new fop must choose priority.
@@ -741,13 +1346,10 @@ iot_zerofill(call_frame_t *frame, xlator_t *this, fd_t *fd, off_t offset,
 }
 
 
-int
-__iot_workers_scale (iot_conf_t *conf)
+static int
+iot_workers_wanted (iot_conf_t *conf)
 {
         int       scale = 0;
-        int       diff = 0;
-        pthread_t thread;
-        int       ret = 0;
         int       i = 0;
 
         for (i = 0; i < IOT_PRI_MAX; i++)
@@ -759,22 +1361,57 @@ __iot_workers_scale (iot_conf_t *conf)
         if (scale > conf->max_count)
                 scale = conf->max_count;
 
+        return scale;
+}
+
+
+int
+__iot_workers_scale (iot_conf_t *conf)
+{
+        struct iot_worker *worker = NULL;
+        int                scale = 0;
+        int                diff = 0;
+        pthread_t          thread;
+        int                ret = 0;
+        int                i = 0;
+
+        scale = iot_workers_wanted (conf);
+
         if (conf->curr_count < scale) {
                 diff = scale - conf->curr_count;
         }
 
-        while (diff) {
-                diff --;
+        for (i = 0; diff && i < IOT_MAX_THREADS; i++) {
+                worker = &conf->workers[i];
 
-                ret = gf_thread_create (&thread, &conf->w_attr, iot_worker, conf);
-                if (ret == 0) {
-                        conf->curr_count++;
+                /* the slot is locked across the creation, so that nothing
+                   gets queued on it unless the thread is there */
+                pthread_mutex_lock (&worker->lock);
+                {
+                        if (worker->running)
+                                goto unlock;
+
+                        worker->running = _gf_true;
+                        ret = gf_thread_create (&thread, &conf->w_attr,
+                                                iot_worker, worker);
+                        if (ret != 0) {
+                                worker->running = _gf_false;
+                                goto unlock;
+                        }
+
+                        __sync_fetch_and_add (&conf->curr_count, 1);
+                        if (conf->worker_hwm <= i)
+                                conf->worker_hwm = i + 1;
+                        diff--;
                         gf_log (conf->this->name, GF_LOG_DEBUG,
                                 "scaled threads to %d (queue_size=%d/%d)",
                                 conf->curr_count, conf->queue_size, scale);
-                } else {
-                        break;
                 }
+        unlock:
+                pthread_mutex_unlock (&worker->lock);
+
+                if (ret != 0)
+                        break;
         }
 
         return diff;
@@ -791,6 +1428,11 @@ iot_workers_scale (iot_conf_t *conf)
                 goto out;
         }
 
+        if (conf->curr_count >= iot_workers_wanted (conf)) {
+                ret = 0;
+                goto out;
+        }
+
         pthread_mutex_lock (&conf->mutex);
         {
                 ret = __iot_workers_scale (conf);
@@ -828,6 +1470,71 @@ set_stack_size (iot_conf_t *conf)
 }
 
 
+static int
+iot_workers_init (iot_conf_t *conf)
+{
+        struct iot_worker *worker = NULL;
+        int                i = 0;
+        int                j = 0;
+
+        conf->workers = GF_CALLOC (IOT_MAX_THREADS, sizeof (*conf->workers),
+                                   gf_iot_mt_iot_worker_t);
+        if (!conf->workers)
+                return -1;
+
+        for (i = 0; i < IOT_MAX_THREADS; i++) {
+                worker = &conf->workers[i];
+
+                pthread_mutex_init (&worker->lock, NULL);
+                pthread_cond_init (&worker->cond, NULL);
+                for (j = 0; j < IOT_PRI_MAX; j++)
+                        INIT_LIST_HEAD (&worker->reqs[j]);
+                worker->id = i;
+                worker->conf = conf;
+        }
+
+#ifdef GF_LINUX_HOST_OS
+        /* workers are pinned round robin to the cpus we may run on */
+        CPU_ZERO (&conf->cpus);
+        if (sched_getaffinity (0, sizeof (conf->cpus), &conf->cpus) == 0) {
+                for (i = 0; i < CPU_SETSIZE &&
+                            conf->cpu_count < IOT_MAX_THREADS; i++) {
+                        if (CPU_ISSET (i, &conf->cpus))
+                                conf->cpu_ids[conf->cpu_count++] = i;
+                }
+        }
+#endif
+
+        return 0;
+}
+
+
+static int
+iot_fair_init (iot_conf_t *conf)
+{
+        int i = 0;
+
+        conf->fair_req_pool = mem_pool_new (struct iot_fair_req, 1024);
+        if (!conf->fair_req_pool)
+                return -1;
+
+        for (i = 0; i < IOT_PRI_MAX; i++) {
+                pthread_mutex_init (&conf->fair[i].lock, NULL);
+                INIT_LIST_HEAD (&conf->fair[i].active);
+        }
+
+        pthread_mutex_init (&conf->clients_lock, NULL);
+        INIT_LIST_HEAD (&conf->clients);
+        for (i = 0; i < IOT_CLIENT_CLASS_MAX; i++) {
+                iot_client_init (&conf->internal[i], i);
+                conf->internal[i].builtin = _gf_true;
+                list_add_tail (&conf->internal[i].clients, &conf->clients);
+        }
+
+        return 0;
+}
+
+
 int32_t
 mem_acct_init (xlator_t *this)
 {
@@ -847,11 +1554,54 @@ mem_acct_init (xlator_t *this)
         return ret;
 }
 
+static void
+iot_client_dump (iot_conf_t *conf, struct iot_client *ioc, int idx)
+{
+        char      key[GF_DUMP_MAX_BUF_LEN];
+        uint64_t  executed = 0;
+        uint64_t  total_wait = 0;
+        uint64_t  max_wait = 0;
+        int       queue_size = 0;
+        int       i = 0;
+
+        for (i = 0; i < IOT_PRI_MAX; i++) {
+                queue_size += ioc->queue_sizes[i];
+                executed += ioc->executed[i];
+                total_wait += ioc->total_wait[i];
+                if (ioc->max_wait[i] > max_wait)
+                        max_wait = ioc->max_wait[i];
+        }
+
+        snprintf (key, sizeof (key), "client[%d]", idx);
+        gf_proc_dump_write(key, "uid=%s,class=%s,weight=%d,queue_size=%d"
+                           ",executed=%"PRIu64",avg_wait_usecs=%"PRIu64
+                           ",max_wait_usecs=%"PRIu64,
+                           ioc->uid ? ioc->uid : "internal",
+                           iot_client_class_name (ioc->klass),
+                           conf->client_weights[ioc->klass], queue_size,
+                           executed, executed ? total_wait / executed : 0,
+                           max_wait);
+
+        for (i = 0; i < IOT_PRI_MAX; i++) {
+                if (!ioc->queue_sizes[i] && !ioc->executed[i])
+                        continue;
+
+                snprintf (key, sizeof (key), "client[%d].queue_size[%s]",
+                          idx, iot_get_pri_meaning (i));
+                gf_proc_dump_write(key, "%d", ioc->queue_sizes[i]);
+        }
+}
+
+
 int
 iot_priv_dump (xlator_t *this)
 {
-        iot_conf_t     *conf   =   NULL;
-        char           key_prefix[GF_DUMP_MAX_BUF_LEN];
+        iot_conf_t        *conf   =   NULL;
+        struct iot_worker *worker = NULL;
+        struct iot_client *ioc = NULL;
+        char               key_prefix[GF_DUMP_MAX_BUF_LEN];
+        char               key[GF_DUMP_MAX_BUF_LEN];
+        int                i = 0;
 
         if (!this)
                 return 0;
@@ -867,7 +1617,8 @@ iot_priv_dump (xlator_t *this)
 
         gf_proc_dump_write("maximum_threads_count", "%d", conf->max_count);
         gf_proc_dump_write("current_threads_count", "%d", conf->curr_count);
-        gf_proc_dump_write("sleep_count", "%d", conf->sleep_count);
+        gf_proc_dump_write("sleep_count", "%d",
+                           __builtin_popcountll (conf->idle_mask));
         gf_proc_dump_write("idle_time", "%d", conf->idle_time);
         gf_proc_dump_write("stack_size", "%zd", conf->stack_size);
         gf_proc_dump_write("high_priority_threads", "%d",
@@ -883,6 +1634,40 @@ iot_priv_dump (xlator_t *this)
 			   conf->throttle.cached_rate);
 	gf_proc_dump_write("least rate limit", "%u", conf->throttle.rate_limit);
 
+        gf_proc_dump_write("cpu_affinity", "%d", conf->cpu_affinity);
+        gf_proc_dump_write("queue_size", "%d", conf->queue_size);
+        for (i = 0; i < IOT_PRI_MAX; i++) {
+                snprintf (key, sizeof (key), "queue_size[%s]",
+                          iot_get_pri_meaning (i));
+                gf_proc_dump_write(key, "%d", conf->queue_sizes[i]);
+        }
+
+        for (i = 0; i < conf->worker_hwm; i++) {
+                worker = &conf->workers[i];
+                if (!worker->running)
+                        continue;
+
+                snprintf (key, sizeof (key), "worker[%d]", i);
+                gf_proc_dump_write(key, "queue_size=%d,executed=%"PRIu64
+                                   ",stolen=%"PRIu64, worker->queue_size,
+                                   worker->executed, worker->stolen);
+        }
+
+        gf_proc_dump_write("client_fairness", "%d", conf->client_fairness);
+        for (i = 0; i < IOT_CLIENT_CLASS_MAX; i++) {
+                snprintf (key, sizeof (key), "client_weight[%s]",
+                          iot_client_class_name (i));
+                gf_proc_dump_write(key, "%d", conf->client_weights[i]);
+        }
+
+        i = 0;
+        pthread_mutex_lock (&conf->clients_lock);
+        {
+                list_for_each_entry (ioc, &conf->clients, clients)
+                        iot_client_dump (conf, ioc, i++);
+        }
+        pthread_mutex_unlock (&conf->clients_lock);
+
         return 0;
 }
 
@@ -917,6 +1702,26 @@ reconfigure (xlator_t *this, dict_t *options)
 	GF_OPTION_RECONF("least-rate-limit", conf->throttle.rate_limit, options,
 			 int32, out);
 
+        /* the workers re-pin themselves when they next look for work */
+        GF_OPTION_RECONF ("cpu-affinity", conf->cpu_affinity, options, bool,
+                          out);
+
+        /* fops already queued per client are still served from there */
+        GF_OPTION_RECONF ("client-fairness", conf->client_fairness, options,
+                          bool, out);
+        GF_OPTION_RECONF ("client-weight",
+                          conf->client_weights[IOT_CLIENT_NORMAL], options,
+                          int32, out);
+        GF_OPTION_RECONF ("rebalance-weight",
+                          conf->client_weights[IOT_CLIENT_REBALANCE], options,
+                          int32, out);
+        GF_OPTION_RECONF ("self-heal-weight",
+                          conf->client_weights[IOT_CLIENT_SELF_HEAL], options,
+                          int32, out);
+        GF_OPTION_RECONF ("geo-rep-weight",
+                          conf->client_weights[IOT_CLIENT_GEO_REP], options,
+                          int32, out);
+
 	ret = 0;
 out:
 	return ret;
@@ -928,7 +1733,6 @@ init (xlator_t *this)
 {
         iot_conf_t *conf = NULL;
         int         ret  = -1;
-        int         i    = 0;
 
 	if (!this->children || this->children->next) {
 		gf_log ("io-threads", GF_LOG_ERROR,
@@ -949,12 +1753,6 @@ init (xlator_t *this)
                 goto out;
         }
 
-        if ((ret = pthread_cond_init(&conf->cond, NULL)) != 0) {
-                gf_log (this->name, GF_LOG_ERROR,
-                        "pthread_cond_init failed (%d)", ret);
-                goto out;
-        }
-
         if ((ret = pthread_mutex_init(&conf->mutex, NULL)) != 0) {
                 gf_log (this->name, GF_LOG_ERROR,
                         "pthread_mutex_init failed (%d)", ret);
@@ -989,11 +1787,29 @@ init (xlator_t *this)
                 goto out;
         }
 
+        GF_OPTION_INIT ("cpu-affinity", conf->cpu_affinity, bool, out);
+
+        GF_OPTION_INIT ("client-fairness", conf->client_fairness, bool, out);
+        GF_OPTION_INIT ("client-weight",
+                        conf->client_weights[IOT_CLIENT_NORMAL], int32, out);
+        GF_OPTION_INIT ("rebalance-weight",
+                        conf->client_weights[IOT_CLIENT_REBALANCE], int32,
+                        out);
+        GF_OPTION_INIT ("self-heal-weight",
+                        conf->client_weights[IOT_CLIENT_SELF_HEAL], int32,
+                        out);
+        GF_OPTION_INIT ("geo-rep-weight",
+                        conf->client_weights[IOT_CLIENT_GEO_REP], int32, out);
+
         conf->this = this;
 
-        for (i = 0; i < IOT_PRI_MAX; i++) {
-                INIT_LIST_HEAD (&conf->reqs[i]);
-        }
+        ret = iot_fair_init (conf);
+        if (ret)
+                goto out;
+
+        ret = iot_workers_init (conf);
+        if (ret)
+                goto out;
 
 	ret = iot_workers_scale (conf);
 
@@ -1006,8 +1822,12 @@ init (xlator_t *this)
 	this->private = conf;
         ret = 0;
 out:
-        if (ret)
+        if (ret && conf) {
+                if (conf->fair_req_pool)
+                        mem_pool_destroy (conf->fair_req_pool);
+                GF_FREE (conf->workers);
                 GF_FREE (conf);
+        }
 
 	return ret;
 }
@@ -1016,8 +1836,22 @@ out:
 void
 fini (xlator_t *this)
 {
-	iot_conf_t *conf = this->private;
-
+	iot_conf_t        *conf = this->private;
+        struct iot_client *ioc = NULL;
+        struct iot_client *tmp = NULL;
+
+        if (conf) {
+                list_for_each_entry_safe (ioc, tmp, &conf->clients, clients) {
+                        list_del_init (&ioc->clients);
+                        if (ioc->builtin)
+                                continue;
+                        GF_FREE (ioc->uid);
+                        GF_FREE (ioc);
+                }
+                if (conf->fair_req_pool)
+                        mem_pool_destroy (conf->fair_req_pool);
+                GF_FREE (conf->workers);
+        }
 	GF_FREE (conf);
 
 	this->private = NULL;
@@ -1075,7 +1909,28 @@ struct xlator_fops fops = {
         .zerofill    = iot_zerofill,
 };
 
-struct xlator_cbks cbks;
+/* drops the reference of the client_t; the fair queue goes when the
+   last of its fops has been taken off */
+int
+iot_client_destroy_cbk (xlator_t *this, client_t *client)
+{
+        iot_conf_t *conf = NULL;
+        void       *tmp = NULL;
+
+        conf = this->private;
+        if (!conf)
+                return 0;
+
+        client_ctx_del (client, this, &tmp);
+        if (tmp)
+                iot_client_unref (conf, tmp);
+
+        return 0;
+}
+
+struct xlator_cbks cbks = {
+        .client_destroy = iot_client_destroy_cbk,
+};
 
 struct volume_options options[] = {
 	{ .key  = {"thread-count"},
@@ -1141,6 +1996,50 @@ struct volume_options options[] = {
 	 .description = "Max number of least priority operations to handle "
 			"per-second"
 	},
+        { .key  = {"cpu-affinity"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Pin every worker thread to one cpu, round robin "
+                         "over the cpus the process may run on, and queue "
+                         "fops on the worker of the cpu they come from"
+        },
+        { .key  = {"client-fairness"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Queue fops per client and serve the clients of "
+                         "each priority round robin, so that one client "
+                         "cannot fill the queues and hold up all the others"
+        },
+        { .key  = {"client-weight"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_WEIGHT,
+          .max  = IOT_MAX_WEIGHT,
+          .default_value = "8",
+          .description = "Number of fops of a client served in a row before "
+                         "the next client of the same priority gets its "
+                         "turn, with client-fairness on"
+        },
+        { .key  = {"rebalance-weight"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_WEIGHT,
+          .max  = IOT_MAX_WEIGHT,
+          .default_value = "2",
+          .description = "client-weight of the rebalance process"
+        },
+        { .key  = {"self-heal-weight"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_WEIGHT,
+          .max  = IOT_MAX_WEIGHT,
+          .default_value = "2",
+          .description = "client-weight of the self-heal daemon"
+        },
+        { .key  = {"geo-rep-weight"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = IOT_MIN_WEIGHT,
+          .max  = IOT_MAX_WEIGHT,
+          .default_value = "2",
+          .description = "client-weight of geo-replication"
+        },
 	{ .key  = {NULL},
         },
 };
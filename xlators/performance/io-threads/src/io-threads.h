@@ -29,6 +29,11 @@
 #include "iot-mem-types.h"
 #include <semaphore.h>
 #include "statedump.h"
+#include "client_t.h"
+#include "call-stub.h"
+#ifdef GF_LINUX_HOST_OS
+#include <sched.h>
+#endif
 
 
 struct iot_conf;
@@ -44,6 +49,9 @@ struct iot_conf;
 
 #define IOT_THREAD_STACK_SIZE   ((size_t)(1024*1024))
 
+#define IOT_MIN_WEIGHT          1
+#define IOT_MAX_WEIGHT          1024
+
 
 typedef enum {
         IOT_PRI_HI = 0, /* low latency */
@@ -62,17 +70,90 @@ struct iot_least_throttle {
 	pthread_mutex_t	lock;
 };
 
-struct iot_conf {
-        pthread_mutex_t      mutex;
+/*
+ * Every worker owns a run queue per priority. A fop is queued on a busy
+ * worker, or handed to a sleeping one when no worker is looking for work,
+ * waking only that one. Workers serve their own queue first and steal
+ * from the others when it has nothing runnable, so the priorities and
+ * the per-priority thread limits still hold across all the queues.
+ */
+struct iot_worker {
+        pthread_mutex_t      lock;
         pthread_cond_t       cond;
 
+        struct list_head     reqs[IOT_PRI_MAX];
+        int                  queue_sizes[IOT_PRI_MAX];
+        int                  queue_size;
+        uint32_t             kicks;       /* fops queued here so far */
+
+        gf_boolean_t         running;
+        gf_boolean_t         sleeping;
+        gf_boolean_t         affine;      /* pinned to its cpu */
+        int                  id;
+        struct iot_conf     *conf;
+
+        uint64_t             executed;
+        uint64_t             stolen;
+};
+
+/*
+ * With client-fairness on, fops are queued per client instead of per
+ * worker. Each priority keeps a ring of the clients that have fops of
+ * that priority queued and serves them round robin, as many fops in a
+ * row from one client as its weight, so one busy client cannot keep the
+ * others waiting behind all of its fops. Internal daemons, known by the
+ * pid of their frames, get their own weights.
+ */
+typedef enum {
+        IOT_CLIENT_NORMAL = 0,
+        IOT_CLIENT_REBALANCE,
+        IOT_CLIENT_SELF_HEAL,
+        IOT_CLIENT_GEO_REP,
+        IOT_CLIENT_CLASS_MAX,
+} iot_client_class_t;
+
+struct iot_client {
+        struct list_head     clients;     /* conf->clients */
+        struct list_head     active[IOT_PRI_MAX]; /* conf->fair[pri].active */
+        struct list_head     reqs[IOT_PRI_MAX];
+        int                  queue_sizes[IOT_PRI_MAX];
+        int32_t              credits[IOT_PRI_MAX];
+        iot_client_class_t   klass;
+        char                *uid;
+        int32_t              ref;         /* client_t ctx and active rings */
+        gf_boolean_t         builtin;     /* frames without a client_t */
+
+        /* per priority, under the lock of its fair queue */
+        uint64_t             executed[IOT_PRI_MAX];
+        uint64_t             total_wait[IOT_PRI_MAX]; /* in usecs */
+        uint64_t             max_wait[IOT_PRI_MAX];
+};
+
+struct iot_fair_req {
+        struct list_head     list;
+        call_stub_t         *stub;
+        struct timeval       queued;
+};
+
+struct iot_fair_queue {
+        pthread_mutex_t      lock;
+        struct list_head     active;      /* clients with fops queued */
+        int                  queue_size;
+};
+
+struct iot_conf {
+        pthread_mutex_t      mutex;       /* starting and stopping workers */
+
         int32_t              max_count;   /* configured maximum */
         int32_t              curr_count;  /* actual number of threads running */
-        int32_t              sleep_count;
 
         int32_t              idle_time;   /* in seconds */
 
-        struct list_head     reqs[IOT_PRI_MAX];
+        struct iot_worker   *workers;     /* IOT_MAX_THREADS slots */
+        int32_t              worker_hwm;  /* slots used so far */
+        uint64_t             idle_mask;   /* a bit per sleeping worker */
+        int32_t              searching;   /* workers looking for work */
+        uint32_t             next_worker;
 
         int32_t              ac_iot_limit[IOT_PRI_MAX];
         int32_t              ac_iot_count[IOT_PRI_MAX];
@@ -81,10 +162,25 @@ struct iot_conf {
         pthread_attr_t       w_attr;
         gf_boolean_t         least_priority; /*Enable/Disable least-priority */
 
+        gf_boolean_t         cpu_affinity;
+#ifdef GF_LINUX_HOST_OS
+        cpu_set_t            cpus;        /* the cpus we were started on */
+#endif
+        int                  cpu_ids[IOT_MAX_THREADS];
+        int                  cpu_count;
+
         xlator_t            *this;
         size_t              stack_size;
 
 	struct iot_least_throttle throttle;
+
+        gf_boolean_t         client_fairness;
+        int32_t              client_weights[IOT_CLIENT_CLASS_MAX];
+        struct iot_fair_queue fair[IOT_PRI_MAX];
+        pthread_mutex_t      clients_lock;
+        struct list_head     clients;
+        struct iot_client    internal[IOT_CLIENT_CLASS_MAX];
+        struct mem_pool     *fair_req_pool;
 };
 
 typedef struct iot_conf iot_conf_t;
@@ -471,6 +471,7 @@ updatefn(dict_t *dict, char *key, data_t *value, void *data)
 	struct updatedict *u = data;
 	const char *mdc_key;
 	int i = 0;
+	data_t *cached = NULL;
 
 	for (mdc_key = mdc_keys[i].name; (mdc_key = mdc_keys[i].name); i++) {
 		if (!mdc_keys[i].check)
@@ -505,7 +506,17 @@ updatefn(dict_t *dict, char *key, data_t *value, void *data)
                 if (!strcmp (value->data, ""))
                         continue;
 
-		if (dict_set(u->dict, key, value) < 0) {
+                /* the cache outlives the fop, so it must not hold on to
+                 * the receive buffer a borrowed value points into. */
+                cached = data_unborrow (value);
+                if (!cached) {
+                        u->ret = -1;
+                        return -1;
+                }
+
+		if (dict_set(u->dict, key, cached) < 0) {
+                        if (cached != value)
+                                data_destroy (cached);
 			u->ret = -1;
 			return -1;
 		}
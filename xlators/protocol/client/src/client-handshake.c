@@ -110,7 +110,7 @@ int32_t client3_getspec (call_frame_t *frame, xlator_t *this, void *data)
         ret = client_submit_request (this, &req, frame, conf->handshake,
                                      GF_HNDSK_GETSPEC, client3_getspec_cbk,
                                      NULL, NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gf_getspec_req);
+                                     (xdrproc_t)xdr_gf_getspec_req, NULL);
 
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING,
@@ -234,7 +234,7 @@ client_set_lk_version (xlator_t *this)
                                      GF_HNDSK_SET_LK_VER,
                                      client_set_lk_version_cbk,
                                      NULL, NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gf_set_lk_ver_req);
+                                     (xdrproc_t)xdr_gf_set_lk_ver_req, NULL);
 out:
         GF_FREE (req.uid);
         return ret;
@@ -374,7 +374,8 @@ clnt_release_reopen_fd (xlator_t *this, clnt_fd_ctx_t *fdctx)
                                         GFS3_OP_RELEASE,
                                         clnt_release_reopen_fd_cbk, NULL,
                                         NULL, 0, NULL, 0, NULL,
-                                        (xdrproc_t)xdr_gfs3_releasedir_req);
+                                        (xdrproc_t)xdr_gfs3_releasedir_req,
+                                        NULL);
         return 0;
  out:
         if (ret) {
@@ -579,7 +580,7 @@ _client_reacquire_lock (xlator_t *this, clnt_fd_ctx_t *fdctx)
                                              conf->fops, GFS3_OP_LK,
                                              client_reacquire_lock_cbk,
                                              NULL, NULL, 0, NULL, 0, NULL,
-                                             (xdrproc_t)xdr_gfs3_lk_req);
+                                             (xdrproc_t)xdr_gfs3_lk_req, NULL);
                 if (ret) {
                         gf_log (this->name, GF_LOG_WARNING,
                                 "reacquiring locks failed on file with gfid %s",
@@ -872,7 +873,7 @@ protocol_client_reopendir (clnt_fd_ctx_t *fdctx, xlator_t *this)
                                      GFS3_OP_OPENDIR,
                                      client3_3_reopendir_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_opendir_req);
+                                     (xdrproc_t)xdr_gfs3_opendir_req, NULL);
         if (ret) {
                 gf_log (this->name, GF_LOG_ERROR,
                         "failed to send the re-opendir request");
@@ -936,7 +937,7 @@ protocol_client_reopenfile (clnt_fd_ctx_t *fdctx, xlator_t *this)
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_OPEN, client3_3_reopen_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_open_req);
+                                     (xdrproc_t)xdr_gfs3_open_req, NULL);
         if (ret) {
                 gf_log (this->name, GF_LOG_ERROR,
                         "failed to send the re-open request");
@@ -1172,6 +1173,10 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
 
         gf_log (this->name, GF_LOG_DEBUG, "clnt-lk-version = %d, "
                 "server-lk-version = %d", client_get_lk_ver (conf), lk_ver);
+
+        /* older servers do not know about compound fops */
+        conf->compound_fops = dict_get (reply, "compound-fops") ? _gf_true
+                                                                : _gf_false;
         /* TODO: currently setpeer path is broken */
         /*
         if (process_uuid && req->conn &&
@@ -1222,6 +1227,8 @@ client_setvolume_cbk (struct rpc_req *req, struct iovec *iov, int count, void *m
                 client_notify_parents_child_up (frame->this);
         }
 
+        client_stripes_start (this);
+
 out:
         if (auth_fail) {
                 gf_log (this->name, GF_LOG_INFO, "sending AUTH_FAILED event");
@@ -1259,6 +1266,80 @@ out:
         return ret;
 }
 
+int
+client_stripe_setvolume_cbk (struct rpc_req *req, struct iovec *iov,
+                             int count, void *myframe)
+{
+        call_frame_t         *frame  = NULL;
+        xlator_t             *this   = NULL;
+        clnt_conf_t          *conf   = NULL;
+        struct rpc_clnt      *rpc    = NULL;
+        client_stripe_t      *stripe = NULL;
+        gf_setvolume_rsp      rsp    = {0,};
+        gf_boolean_t          ready  = _gf_false;
+        int                   ret    = 0;
+        int32_t               op_ret = -1;
+
+        frame  = myframe;
+        this   = frame->this;
+        conf   = this->private;
+        rpc    = frame->cookie;
+        stripe = rpc->mydata;
+
+        if (-1 == req->rpc_status) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "received RPC status error on connection %d",
+                        stripe->index);
+                goto out;
+        }
+
+        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_setvolume_rsp);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
+                goto out;
+        }
+
+        if (-1 == rsp.op_ret) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "SETVOLUME on connection %d failed: %s",
+                        stripe->index, strerror (gf_error_to_errno
+                                                 (rsp.op_errno)));
+                goto out;
+        }
+
+        op_ret = 0;
+out:
+        pthread_mutex_lock (&conf->lock);
+        {
+                /* conf->rpc may have gone down meanwhile */
+                if (stripe->state == CLIENT_STRIPE_SETVOLUME) {
+                        if (op_ret == 0) {
+                                stripe->state = CLIENT_STRIPE_READY;
+                                ready = _gf_true;
+                        } else {
+                                stripe->state = CLIENT_STRIPE_CONNECTED;
+                        }
+                }
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        if (ready) {
+                rpc_clnt_set_connected (&rpc->conn);
+                gf_log (this->name, GF_LOG_INFO,
+                        "connection %d attached to the remote volume",
+                        stripe->index);
+        } else if (op_ret && rpc->conn.trans) {
+                /* try again from a fresh connection */
+                rpc_transport_disconnect (rpc->conn.trans);
+        }
+
+        free (rsp.dict.dict_val);
+
+        STACK_DESTROY (frame->root);
+
+        return 0;
+}
+
 int
 client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
 {
@@ -1269,6 +1350,7 @@ client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
         clnt_conf_t      *conf            = NULL;
         dict_t           *options         = NULL;
         char             counter_str[32]  = {0};
+        uint64_t          setvol_count    = 0;
 
         options = this->options;
         conf    = this->private;
@@ -1305,9 +1387,14 @@ client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
          * inode/entry locks
         */
         if (!conf->lk_heal) {
+                /* a stripe joins the client of the last setvolume on
+                 * conf->rpc instead of making a new one */
+                if (rpc == conf->rpc)
+                        setvol_count = conf->setvol_count++;
+                else
+                        setvol_count = conf->setvol_count - 1;
                 snprintf (counter_str, sizeof (counter_str),
-                          "-%"PRIu64, conf->setvol_count);
-                conf->setvol_count++;
+                          "-%"PRIu64, setvol_count);
         }
         ret = gf_asprintf (&process_uuid_xl, "%s-%s-%d%s",
                            this->ctx->process_uuid, this->name,
@@ -1377,10 +1464,14 @@ client_setvolume (xlator_t *this, struct rpc_clnt *rpc)
         if (!fr)
                 goto fail;
 
-        ret = client_submit_request (this, &req, fr, conf->handshake,
-                                     GF_HNDSK_SETVOLUME, client_setvolume_cbk,
-                                     NULL, NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gf_setvolume_req);
+        fr->cookie = rpc;
+        ret = client_submit_request_to (this, rpc, &req, fr, conf->handshake,
+                                        GF_HNDSK_SETVOLUME,
+                                        (rpc == conf->rpc) ?
+                                        client_setvolume_cbk :
+                                        client_stripe_setvolume_cbk,
+                                        NULL, NULL, 0, NULL, 0, NULL,
+                                        (xdrproc_t)xdr_gf_setvolume_req, NULL);
 
 fail:
         GF_FREE (req.dict.dict_val);
@@ -1505,6 +1596,7 @@ client_query_portmap_cbk (struct rpc_req *req, struct iovec *iov, int count, voi
 
         config.remote_port = rsp.port;
         rpc_clnt_reconfig (conf->rpc, &config);
+        conf->brick_port = rsp.port;
 
         conf->skip_notify = 1;
 	conf->quick_reconnect = 1;
@@ -1576,7 +1668,8 @@ client_query_portmap (xlator_t *this, struct rpc_clnt *rpc)
                                      GF_PMAP_PORTBYBRICK,
                                      client_query_portmap_cbk,
                                      NULL, NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_pmap_port_by_brick_req);
+                                     (xdrproc_t)xdr_pmap_port_by_brick_req,
+                                     NULL);
 
 fail:
         return ret;
@@ -1672,7 +1765,7 @@ client_handshake (xlator_t *this, struct rpc_clnt *rpc)
         ret = client_submit_request (this, &req, frame, conf->dump,
                                      GF_DUMP_DUMP, client_dump_version_cbk,
                                      NULL, NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gf_dump_req);
+                                     NULL, (xdrproc_t)xdr_gf_dump_req, NULL);
 
 out:
         return ret;
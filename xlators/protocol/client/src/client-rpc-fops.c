@@ -16,8 +16,11 @@
 #include "client.h"
 #include "rpc-common-xdr.h"
 #include "glusterfs3-xdr.h"
+#include "glusterfs3-xdr-fast.h"
+#include "rpc-common-xdr-fast.h"
 #include "glusterfs3.h"
 #include "compat-errno.h"
+#include "compound-fop-utils.h"
 
 int32_t client3_getspec (call_frame_t *frame, xlator_t *this, void *data);
 rpc_clnt_prog_t clnt3_3_fop_prog;
@@ -28,10 +31,11 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
                            rpc_clnt_prog_t *prog, int procnum,
                            fop_cbk_fn_t cbkfn,
                            struct iovec  *payload, int payloadcnt,
-                           struct iobref *iobref, xdrproc_t xdrproc)
+                           struct iobref *iobref, xdrproc_t xdrproc,
+                           dict_t *xdata)
 {
         int             ret        = 0;
-        clnt_conf_t    *conf       = NULL;
+        struct rpc_clnt *rpc       = NULL;
         struct iovec    iov        = {0, };
         struct iobuf   *iobuf      = NULL;
         int             count      = 0;
@@ -39,10 +43,16 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
         ssize_t         xdr_size   = 0;
         struct rpc_req  rpcreq     = {0, };
 
-        conf = this->private;
+        rpc = client_rpc_pick (this, prog, procnum, frame);
 
         if (req && xdrproc) {
-                xdr_size = xdr_sizeof (xdrproc, req);
+                xdr_size = xdr_sizeof_xdata (xdrproc, req, xdata);
+                if (xdr_size < 0) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "failed to get serialized length of dict");
+                        goto unwind;
+                }
+
                 iobuf = iobuf_get2 (this->ctx->iobuf_pool, xdr_size);
                 if (!iobuf) {
                         goto unwind;
@@ -73,7 +83,7 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
                 iov.iov_len  = iobuf_size (iobuf);
 
                 /* Create the xdr payload */
-                ret = xdr_serialize_generic (iov, req, xdrproc);
+                ret = xdr_serialize_generic_xdata (iov, req, xdrproc, xdata);
                 if (ret == -1) {
                         gf_log_callingfn ("", GF_LOG_WARNING,
                                           "XDR function failed");
@@ -85,7 +95,7 @@ client_submit_vec_request (xlator_t  *this, void *req, call_frame_t  *frame,
         }
 
         /* Send the msg */
-        ret = rpc_clnt_submit (conf->rpc, prog, procnum, cbkfn, &iov, count,
+        ret = rpc_clnt_submit (rpc, prog, procnum, cbkfn, &iov, count,
                                payload, payloadcnt, new_iobref, frame, NULL, 0,
                                NULL, 0, NULL);
         if (ret < 0) {
@@ -142,7 +152,7 @@ client3_3_symlink_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_symlink_rsp);
+        ret = xdrf_to_gfs3_symlink_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -157,9 +167,11 @@ client3_3_symlink_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.postparent, &postparent);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -176,8 +188,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), inode, &stbuf,
                              &preparent, &postparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -213,7 +223,7 @@ client3_3_mknod_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_mknod_rsp);
+        ret = xdrf_to_gfs3_mknod_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -228,9 +238,11 @@ client3_3_mknod_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.postparent, &postparent);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -244,8 +256,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), inode,
                              &stbuf, &preparent, &postparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -279,7 +289,7 @@ client3_3_mkdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_mkdir_rsp);
+        ret = xdrf_to_gfs3_mkdir_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -294,9 +304,11 @@ client3_3_mkdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.postparent, &postparent);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -310,8 +322,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), inode,
                              &stbuf, &preparent, &postparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -418,7 +428,7 @@ client3_3_open_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_open_rsp);
+        ret = xdrf_to_gfs3_open_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -436,9 +446,11 @@ client3_3_open_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 }
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -451,8 +463,6 @@ out:
         CLIENT_STACK_UNWIND (open, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), fd, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -481,7 +491,7 @@ client3_3_stat_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_stat_rsp);
+        ret = xdrf_to_gfs3_stat_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -493,9 +503,11 @@ client3_3_stat_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.stat, &iatt);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -506,8 +518,6 @@ out:
         CLIENT_STACK_UNWIND (stat, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), &iatt, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -524,6 +534,8 @@ client3_3_readlink_cbk (struct rpc_req *req, struct iovec *iov, int count,
         int ret = 0;
         xlator_t *this       = NULL;
         dict_t  *xdata       = NULL;
+        char    *arena       = NULL;
+        size_t   arena_len   = 0;
 
 
         this = THIS;
@@ -535,7 +547,9 @@ client3_3_readlink_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_readlink_rsp);
+        arena_len = iov->iov_len + 16;
+        arena = alloca (arena_len);
+        ret = xdrf_to_gfs3_readlink_rsp (*iov, &rsp, arena, arena_len);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -547,9 +561,11 @@ client3_3_readlink_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.buf, &iatt);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -562,12 +578,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), rsp.path,
                              &iatt, xdata);
 
-        /* This is allocated by the libc while decoding RPC msg */
-        /* Hence no 'GF_FREE', but just 'free' */
-        free (rsp.path);
-
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -596,7 +606,7 @@ client3_3_unlink_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_unlink_rsp);
+        ret = xdrf_to_gfs3_unlink_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -609,9 +619,11 @@ client3_3_unlink_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.postparent, &postparent);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -626,8 +638,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &preparent,
                              &postparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -656,7 +666,7 @@ client3_3_rmdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_rmdir_rsp);
+        ret = xdrf_to_gfs3_rmdir_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -669,9 +679,11 @@ client3_3_rmdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.postparent, &postparent);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -682,8 +694,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &preparent,
                              &postparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -713,7 +723,7 @@ client3_3_truncate_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_truncate_rsp);
+        ret = xdrf_to_gfs3_truncate_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -726,9 +736,11 @@ client3_3_truncate_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.poststat, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -739,8 +751,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -769,7 +779,7 @@ client3_3_statfs_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_statfs_rsp);
+        ret = xdrf_to_gfs3_statfs_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -781,9 +791,11 @@ client3_3_statfs_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_statfs_to_statfs (&rsp.statfs, &statfs);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -793,8 +805,6 @@ out:
         CLIENT_STACK_UNWIND (statfs, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), &statfs, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -827,7 +837,7 @@ client3_3_writev_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_truncate_rsp);
+        ret = xdrf_to_gfs3_write_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -840,9 +850,11 @@ client3_3_writev_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.poststat, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -856,8 +868,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -885,7 +895,7 @@ client3_3_flush_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -901,9 +911,11 @@ client3_3_flush_cbk (struct rpc_req *req, struct iovec *iov, int count,
                         lkowner_utoa (&local->owner), ret);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -914,8 +926,6 @@ out:
         CLIENT_STACK_UNWIND (flush, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -945,7 +955,7 @@ client3_3_fsync_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_truncate_rsp);
+        ret = xdrf_to_gfs3_fsync_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -958,9 +968,11 @@ client3_3_fsync_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.poststat, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -971,8 +983,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1000,7 +1010,7 @@ client3_3_setxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1008,9 +1018,11 @@ client3_3_setxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         op_errno = gf_error_to_errno (rsp.op_errno);
@@ -1022,8 +1034,6 @@ out:
         }
         CLIENT_STACK_UNWIND (setxattr, frame, rsp.op_ret, op_errno, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1055,7 +1065,7 @@ client3_3_getxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_getxattr_rsp);
+        ret = xdrf_to_gfs3_getxattr_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret = -1;
@@ -1071,9 +1081,11 @@ client3_3_getxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                                               op_errno, out);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret, op_errno,
+                                               out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1090,11 +1102,6 @@ out:
 
         CLIENT_STACK_UNWIND (getxattr, frame, rsp.op_ret, op_errno, dict, xdata);
 
-        /* don't use GF_FREE, this memory was allocated by libc */
-        free (rsp.dict.dict_val);
-
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1128,7 +1135,7 @@ client3_3_fgetxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_fgetxattr_rsp);
+        ret = xdrf_to_gfs3_fgetxattr_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret = -1;
@@ -1143,9 +1150,11 @@ client3_3_fgetxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                                               (rsp.dict.dict_len), rsp.op_ret,
                                               op_errno, out);
         }
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret, op_errno,
+                                               out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1160,10 +1169,6 @@ out:
 
         CLIENT_STACK_UNWIND (fgetxattr, frame, rsp.op_ret, op_errno, dict, xdata);
 
-        free (rsp.dict.dict_val);
-
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1193,7 +1198,7 @@ client3_3_removexattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1201,9 +1206,11 @@ client3_3_removexattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1214,8 +1221,6 @@ out:
         CLIENT_STACK_UNWIND (removexattr, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1243,7 +1248,7 @@ client3_3_fremovexattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1251,9 +1256,11 @@ client3_3_fremovexattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1263,8 +1270,6 @@ out:
         CLIENT_STACK_UNWIND (fremovexattr, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1291,7 +1296,7 @@ client3_3_fsyncdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1299,9 +1304,11 @@ client3_3_fsyncdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1311,8 +1318,6 @@ out:
         CLIENT_STACK_UNWIND (fsyncdir, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1339,7 +1344,7 @@ client3_3_access_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1347,9 +1352,11 @@ client3_3_access_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1359,8 +1366,6 @@ out:
         CLIENT_STACK_UNWIND (access, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1390,7 +1395,7 @@ client3_3_ftruncate_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_ftruncate_rsp);
+        ret = xdrf_to_gfs3_ftruncate_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1403,9 +1408,11 @@ client3_3_ftruncate_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.poststat, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1416,8 +1423,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1445,7 +1450,7 @@ client3_3_fstat_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_fstat_rsp);
+        ret = xdrf_to_gfs3_fstat_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1457,9 +1462,11 @@ client3_3_fstat_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.stat, &stat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1469,8 +1476,6 @@ out:
         CLIENT_STACK_UNWIND (fstat, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), &stat,  xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1498,7 +1503,7 @@ client3_3_inodelk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1506,9 +1511,11 @@ client3_3_inodelk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if ((rsp.op_ret == -1) &&
@@ -1519,8 +1526,6 @@ out:
         CLIENT_STACK_UNWIND (inodelk, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1548,7 +1553,7 @@ client3_3_finodelk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1556,9 +1561,11 @@ client3_3_finodelk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if ((rsp.op_ret == -1) &&
@@ -1572,8 +1579,6 @@ out:
         CLIENT_STACK_UNWIND (finodelk, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1600,7 +1605,7 @@ client3_3_entrylk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1608,9 +1613,11 @@ client3_3_entrylk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if ((rsp.op_ret == -1) &&
@@ -1622,8 +1629,6 @@ out:
         CLIENT_STACK_UNWIND (entrylk, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1650,7 +1655,7 @@ client3_3_fentrylk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1658,9 +1663,11 @@ client3_3_fentrylk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if ((rsp.op_ret == -1) &&
@@ -1672,8 +1679,6 @@ out:
         CLIENT_STACK_UNWIND (fentrylk, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1704,7 +1709,7 @@ client3_3_xattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_xattrop_rsp);
+        ret = xdrf_to_gfs3_xattrop_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret = -1;
@@ -1720,9 +1725,11 @@ client3_3_xattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
                                               op_errno, out);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret, op_errno,
+                                               out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1735,10 +1742,6 @@ out:
         CLIENT_STACK_UNWIND (xattrop, frame, rsp.op_ret,
                              gf_error_to_errno (op_errno), dict, xdata);
 
-        free (rsp.dict.dict_val);
-
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1772,7 +1775,7 @@ client3_3_fxattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_fxattrop_rsp);
+        ret = xdrf_to_gfs3_fxattrop_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 rsp.op_ret = -1;
                 op_errno = EINVAL;
@@ -1787,12 +1790,12 @@ client3_3_fxattrop_cbk (struct rpc_req *req, struct iovec *iov, int count,
                                               op_errno, out);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->this, xdata,
-                                      (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), rsp.op_ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, rsp.op_ret,
+                                               op_errno, out);
 out:
-
         if (rsp.op_ret == -1) {
                 gf_log (this->name, GF_LOG_WARNING,
                         "remote operation failed: %s",
@@ -1804,10 +1807,6 @@ out:
         CLIENT_STACK_UNWIND (fxattrop, frame, rsp.op_ret,
                              gf_error_to_errno (op_errno), dict, xdata);
 
-        free (rsp.dict.dict_val);
-
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1837,7 +1836,7 @@ client3_3_fsetxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gf_common_rsp);
+        ret = xdrf_to_gf_common_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1845,9 +1844,11 @@ client3_3_fsetxattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         op_errno = gf_error_to_errno (rsp.op_errno);
@@ -1860,8 +1861,6 @@ out:
 
         CLIENT_STACK_UNWIND (fsetxattr, frame, rsp.op_ret, op_errno, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1890,7 +1889,7 @@ client3_3_fsetattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_fsetattr_rsp);
+        ret = xdrf_to_gfs3_fsetattr_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1903,9 +1902,11 @@ client3_3_fsetattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.statpost, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1916,8 +1917,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -1946,7 +1945,7 @@ client3_3_fallocate_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_fallocate_rsp);
+        ret = xdrf_to_gfs3_fallocate_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -1959,9 +1958,11 @@ client3_3_fallocate_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.statpost, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -1972,8 +1973,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2001,7 +2000,7 @@ client3_3_discard_cbk(struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic(*iov, &rsp, (xdrproc_t) xdr_gfs3_discard_rsp);
+        ret = xdrf_to_gfs3_discard_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2014,9 +2013,11 @@ client3_3_discard_cbk(struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.statpost, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2027,8 +2028,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2056,7 +2055,7 @@ client3_3_zerofill_cbk(struct rpc_req *req, struct iovec *iov, int count,
                 rsp.op_errno = ENOTCONN;
                 goto out;
         }
-        ret = xdr_to_generic(*iov, &rsp, (xdrproc_t) xdr_gfs3_zerofill_rsp);
+        ret = xdrf_to_gfs3_zerofill_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2069,9 +2068,11 @@ client3_3_zerofill_cbk(struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.statpost, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2083,7 +2084,187 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
+        if (xdata)
+                dict_unref (xdata);
+
+        return 0;
+}
+
+static int
+client_compound_dict (xlator_t *this, char *buf, u_int len, dict_t **dict)
+{
+        if (!len)
+                return 0;
+
+        *dict = dict_new ();
+        if (!*dict)
+                return -ENOMEM;
+
+        if (dict_unserialize (buf, len, dict) < 0) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "failed to unserialize dictionary");
+                return -EINVAL;
+        }
+
+        return 0;
+}
+
+
+/* Fills in the result of the member @i of a compound from its part of the
+ * reply. */
+static int
+client_compound_unpack (xlator_t *this, compound_args_cbk_t *args_cbk, int i,
+                        compound_fop_args_t *member,
+                        gfs3_compound_rsp_member *rsp)
+{
+        dict_t        *xattr     = NULL;
+        dict_t        *xdata     = NULL;
+        char          *xattr_val = NULL;
+        u_int          xattr_len = 0;
+        char          *xdata_val = NULL;
+        u_int          xdata_len = 0;
+        int            op_ret    = -1;
+        int            op_errno  = 0;
+        int            ret       = 0;
+
+        if (rsp->op != gf_compound_op_from_fop (member->fop))
+                return -EINVAL;
+
+        switch (rsp->op) {
+        case GFS3_COMPOUND_FXATTROP:
+        {
+                gfs3_fxattrop_rsp *fxattrop_rsp =
+                        &rsp->gfs3_compound_rsp_member_u.fxattrop_rsp;
+
+                op_ret = fxattrop_rsp->op_ret;
+                op_errno = fxattrop_rsp->op_errno;
+                xattr_val = fxattrop_rsp->dict.dict_val;
+                xattr_len = fxattrop_rsp->dict.dict_len;
+                xdata_val = fxattrop_rsp->xdata.xdata_val;
+                xdata_len = fxattrop_rsp->xdata.xdata_len;
+                break;
+        }
+        case GFS3_COMPOUND_FINODELK:
+        {
+                gfs3_compound_lk_rsp *lk_rsp =
+                        &rsp->gfs3_compound_rsp_member_u.finodelk_rsp;
+
+                op_ret = lk_rsp->op_ret;
+                op_errno = lk_rsp->op_errno;
+                xdata_val = lk_rsp->xdata.xdata_val;
+                xdata_len = lk_rsp->xdata.xdata_len;
+                break;
+        }
+        default:
+                return -EINVAL;
+        }
+
+        if (op_ret != -1) {
+                ret = client_compound_dict (this, xattr_val, xattr_len,
+                                            &xattr);
+                if (ret)
+                        goto out;
+        }
+
+        ret = client_compound_dict (this, xdata_val, xdata_len, &xdata);
+        if (ret)
+                goto out;
+
+        compound_args_cbk_set (args_cbk, i, op_ret,
+                               gf_error_to_errno (op_errno), xattr, xdata);
+out:
+        if (xattr)
+                dict_unref (xattr);
+        if (xdata)
+                dict_unref (xdata);
+
+        return ret;
+}
+
+
+int
+client3_3_compound_cbk (struct rpc_req *req, struct iovec *iov, int count,
+                        void *myframe)
+{
+        call_frame_t             *frame    = NULL;
+        clnt_local_t             *local    = NULL;
+        compound_args_t          *args     = NULL;
+        compound_args_cbk_t      *args_cbk = NULL;
+        gfs3_compound_rsp         rsp      = {0,};
+        gfs3_compound_rsp_member *member   = NULL;
+        xlator_t                 *this     = NULL;
+        dict_t                   *xdata    = NULL;
+        int                       ret      = 0;
+        int                       i        = 0;
+
+        this = THIS;
+
+        frame = myframe;
+        local = frame->local;
+        args  = local->compound_args;
+
+        if (-1 == req->rpc_status) {
+                rsp.op_ret   = -1;
+                rsp.op_errno = ENOTCONN;
+                goto out;
+        }
+
+        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_compound_rsp);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
+                rsp.op_ret   = -1;
+                rsp.op_errno = EINVAL;
+                goto out;
+        }
+
+        if (-1 != rsp.op_ret) {
+                if (rsp.members.members_len != args->count) {
+                        gf_log (this->name, GF_LOG_ERROR, "compound reply "
+                                "has %u results for %d fops",
+                                rsp.members.members_len, args->count);
+                        rsp.op_ret   = -1;
+                        rsp.op_errno = EINVAL;
+                        goto out;
+                }
+
+                args_cbk = compound_args_cbk_new (args->count);
+                if (!args_cbk) {
+                        rsp.op_ret   = -1;
+                        rsp.op_errno = ENOMEM;
+                        goto out;
+                }
+
+                for (i = 0; i < args->count; i++) {
+                        member = &rsp.members.members_val[i];
+                        ret = client_compound_unpack (this, args_cbk, i,
+                                                      &args->fops[i], member);
+                        if (ret) {
+                                rsp.op_ret   = -1;
+                                rsp.op_errno = -ret;
+                                goto out;
+                        }
+                }
+        }
+
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
+
+out:
+        if (rsp.op_ret == -1) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "remote operation failed: %s",
+                        strerror (gf_error_to_errno (rsp.op_errno)));
+        }
+        CLIENT_STACK_UNWIND (compound, frame, rsp.op_ret,
+                             gf_error_to_errno (rsp.op_errno),
+                             (rsp.op_ret == -1) ? NULL : args_cbk, xdata);
+
+        compound_args_cbk_destroy (args_cbk);
+
+        xdr_free ((xdrproc_t)xdr_gfs3_compound_rsp, (char *)&rsp);
 
         if (xdata)
                 dict_unref (xdata);
@@ -2114,7 +2295,7 @@ client3_3_setattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_setattr_rsp);
+        ret = xdrf_to_gfs3_setattr_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2127,9 +2308,11 @@ client3_3_setattr_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.statpost, &poststat);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2140,8 +2323,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), &prestat,
                              &poststat, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2177,7 +2358,7 @@ client3_3_create_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_create_rsp);
+        ret = xdrf_to_gfs3_create_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2200,9 +2381,11 @@ client3_3_create_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 }
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2216,8 +2399,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), fd, inode,
                              &stbuf, &preparent, &postparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2246,7 +2427,7 @@ client3_3_rchecksum_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_rchecksum_rsp);
+        ret = xdrf_to_gfs3_rchecksum_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2254,9 +2435,11 @@ client3_3_rchecksum_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2271,12 +2454,8 @@ out:
 
         if (rsp.strong_checksum.strong_checksum_val) {
                 /* This is allocated by the libc while decoding RPC msg */
-                /* Hence no 'GF_FREE', but just 'free' */
-                free (rsp.strong_checksum.strong_checksum_val);
         }
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2306,7 +2485,7 @@ client3_3_lk_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_lk_rsp);
+        ret = xdrf_to_gfs3_lk_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2332,9 +2511,11 @@ client3_3_lk_cbk (struct rpc_req *req, struct iovec *iov, int count,
         }
         */
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if ((rsp.op_ret == -1) &&
@@ -2347,10 +2528,6 @@ out:
         CLIENT_STACK_UNWIND (lk, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), &lock, xdata);
 
-        free (rsp.xdata.xdata_val);
-
-        free (rsp.flock.lk_owner.lk_owner_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2368,6 +2545,7 @@ client3_3_readdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
         gf_dirent_t       entries;
         xlator_t         *this     = NULL;
         dict_t           *xdata    = NULL;
+        struct iobuf     *arena    = NULL;
 
         this = THIS;
 
@@ -2380,7 +2558,17 @@ client3_3_readdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_readdir_rsp);
+        /* As in readdirp, the entries and their names go into an iobuf
+         * and the xdata is left in the reply. */
+        arena = iobuf_get2 (this->ctx->iobuf_pool, 2 * iov->iov_len + 64);
+        if (arena) {
+                ret = xdrf_to_gfs3_readdir_rsp (*iov, &rsp,
+                                                iobuf_ptr (arena),
+                                                iobuf_size (arena));
+        } else {
+                ret = xdr_to_generic (*iov, &rsp,
+                                      (xdrproc_t)xdr_gfs3_readdir_rsp);
+        }
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2393,10 +2581,11 @@ client3_3_readdir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 unserialize_rsp_dirent (&rsp, &entries);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->this, xdata,
-                                      (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), rsp.op_ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, rsp.op_ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2412,12 +2601,15 @@ out:
                 gf_dirent_free (&entries);
         }
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
-        clnt_readdir_rsp_cleanup (&rsp);
+        if (arena) {
+                iobuf_unref (arena);
+        } else {
+                free (rsp.xdata.xdata_val);
+                clnt_readdir_rsp_cleanup (&rsp);
+        }
 
         return 0;
 }
@@ -2434,6 +2626,7 @@ client3_3_readdirp_cbk (struct rpc_req *req, struct iovec *iov, int count,
         gf_dirent_t        entries;
         xlator_t          *this  = NULL;
         dict_t            *xdata = NULL;
+        struct iobuf      *arena = NULL;
 
         this = THIS;
 
@@ -2446,7 +2639,18 @@ client3_3_readdirp_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_readdirp_rsp);
+        /* The entries and their names are decoded into an iobuf, which
+         * twice the size of the reply is always enough for; their dicts
+         * and the xdata are left in the reply. */
+        arena = iobuf_get2 (this->ctx->iobuf_pool, 2 * iov->iov_len + 64);
+        if (arena) {
+                ret = xdrf_to_gfs3_readdirp_rsp (*iov, &rsp,
+                                                 iobuf_ptr (arena),
+                                                 iobuf_size (arena));
+        } else {
+                ret = xdr_to_generic (*iov, &rsp,
+                                      (xdrproc_t)xdr_gfs3_readdirp_rsp);
+        }
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2459,9 +2663,11 @@ client3_3_readdirp_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 unserialize_rsp_direntp (this, local->fd, &rsp, &entries);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2475,12 +2681,16 @@ out:
         if (rsp.op_ret != -1) {
                 gf_dirent_free (&entries);
         }
-        free (rsp.xdata.xdata_val);
 
         if (xdata)
                 dict_unref (xdata);
 
-        clnt_readdirp_rsp_cleanup (&rsp);
+        if (arena) {
+                iobuf_unref (arena);
+        } else {
+                free (rsp.xdata.xdata_val);
+                clnt_readdirp_rsp_cleanup (&rsp);
+        }
 
         return 0;
 }
@@ -2511,7 +2721,7 @@ client3_3_rename_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_rename_rsp);
+        ret = xdrf_to_gfs3_rename_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2529,9 +2739,11 @@ client3_3_rename_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.postnewparent, &postnewparent);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2543,8 +2755,6 @@ out:
                              &stbuf, &preoldparent, &postoldparent,
                              &prenewparent, &postnewparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2580,7 +2790,7 @@ client3_3_link_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_link_rsp);
+        ret = xdrf_to_gfs3_link_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2595,9 +2805,11 @@ client3_3_link_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 gf_stat_to_iatt (&rsp.postparent, &postparent);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2611,8 +2823,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), inode,
                              &stbuf, &preparent, &postparent, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2647,7 +2857,7 @@ client3_3_opendir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_opendir_rsp);
+        ret = xdrf_to_gfs3_opendir_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2665,9 +2875,11 @@ client3_3_opendir_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 }
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 out:
         if (rsp.op_ret == -1) {
@@ -2679,8 +2891,6 @@ out:
         CLIENT_STACK_UNWIND (opendir, frame, rsp.op_ret,
                              gf_error_to_errno (rsp.op_errno), fd, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2715,7 +2925,7 @@ client3_3_lookup_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_lookup_rsp);
+        ret = xdrf_to_gfs3_lookup_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2732,9 +2942,11 @@ client3_3_lookup_cbk (struct rpc_req *req, struct iovec *iov, int count,
         rsp.op_ret = -1;
         gf_stat_to_iatt (&rsp.stat, &stbuf);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), rsp.op_ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, rsp.op_ret,
+                                               op_errno, out);
 
         if ((!uuid_is_null (inode->gfid))
             && (uuid_compare (stbuf.ia_gfid, inode->gfid) != 0)) {
@@ -2772,8 +2984,6 @@ out:
         if (xdata)
                 dict_unref (xdata);
 
-        free (rsp.xdata.xdata_val);
-
         return 0;
 }
 
@@ -2804,7 +3014,8 @@ client3_3_readv_cbk (struct rpc_req *req, struct iovec *iov, int count,
                 goto out;
         }
 
-        ret = xdr_to_generic (*iov, &rsp, (xdrproc_t)xdr_gfs3_read_rsp);
+        /* the xdata is left in the reply, the dict borrows from it */
+        ret = xdrf_to_gfs3_read_rsp (*iov, &rsp, NULL, 0);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR, "XDR decoding failed");
                 rsp.op_ret   = -1;
@@ -2821,9 +3032,11 @@ client3_3_readv_cbk (struct rpc_req *req, struct iovec *iov, int count,
                         vector[0].iov_base = req->rsp[1].iov_base;
                 rspcount = 1;
         }
-        GF_PROTOCOL_DICT_UNSERIALIZE (this, xdata, (rsp.xdata.xdata_val),
-                                      (rsp.xdata.xdata_len), ret,
-                                      rsp.op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (this, xdata,
+                                               (rsp.xdata.xdata_val),
+                                               (rsp.xdata.xdata_len),
+                                               req->rsp_iobref, ret,
+                                               rsp.op_errno, out);
 
 #ifdef GF_TESTING_IO_XDATA
         dict_dump (xdata);
@@ -2842,8 +3055,6 @@ out:
                              gf_error_to_errno (rsp.op_errno), vector, rspcount,
                              &stat, iobref, xdata);
 
-        free (rsp.xdata.xdata_val);
-
         if (xdata)
                 dict_unref (xdata);
 
@@ -2921,7 +3132,8 @@ client_fdctx_destroy (xlator_t *this, clnt_fd_ctx_t *fdctx)
                                        GFS3_OP_RELEASEDIR,
                                        client3_3_releasedir_cbk,
                                        NULL, NULL, 0, NULL, 0, NULL,
-                                       (xdrproc_t)xdr_gfs3_releasedir_req);
+                                       (xdrproc_t)xdr_gfs3_releasedir_req,
+                                       NULL);
         } else {
                 gfs3_release_req  req = {{0,},};
                 req.fd = fdctx->remote_fd;
@@ -2930,7 +3142,7 @@ client_fdctx_destroy (xlator_t *this, clnt_fd_ctx_t *fdctx)
                                        GFS3_OP_RELEASE,
                                        client3_3_release_cbk, NULL,
                                        NULL, 0, NULL, 0, NULL,
-                                       (xdrproc_t)xdr_gfs3_release_req);
+                                       (xdrproc_t)xdr_gfs3_release_req, NULL);
         }
 
         rpc_clnt_unref (conf->rpc);
@@ -3107,10 +3319,6 @@ client3_3_lookup (call_frame_t *frame, xlator_t *this,
                         rsp_iobref = NULL;
                 }
 
-                GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata,
-                                            (&req.xdata.xdata_val),
-                                            req.xdata.xdata_len,
-                                            op_errno, unwind);
         }
 
         if (args->loc->name)
@@ -3122,7 +3330,8 @@ client3_3_lookup (call_frame_t *frame, xlator_t *this,
                                      GFS3_OP_LOOKUP, client3_3_lookup_cbk,
                                      NULL, rsphdr, count,
                                      NULL, 0, local->iobref,
-                                     (xdrproc_t)xdr_gfs3_lookup_req);
+                                     (xdrproc_t)xdr_gfs3_lookup_req,
+                                     args->xdata);
 
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
@@ -3180,13 +3389,10 @@ client3_3_stat (call_frame_t *frame, xlator_t *this,
                                        unwind, op_errno, EINVAL);
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_STAT, client3_3_stat_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_stat_req);
+                                     (xdrproc_t)xdr_gfs3_stat_req, args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3233,14 +3439,12 @@ client3_3_truncate (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_TRUNCATE,
                                      client3_3_truncate_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_truncate_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_truncate_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3281,14 +3485,12 @@ client3_3_ftruncate (call_frame_t *frame, xlator_t *this,
         req.fd     = remote_fd;
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FTRUNCATE,
                                      client3_3_ftruncate_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_ftruncate_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_ftruncate_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3335,14 +3537,12 @@ client3_3_access (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_ACCESS,
                                      client3_3_access_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_access_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_access_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3400,9 +3600,6 @@ client3_3_readlink (call_frame_t *frame, xlator_t *this,
 
         frame->local = local;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         rsp_iobref = iobref_new ();
         if (rsp_iobref == NULL) {
                 goto unwind;
@@ -3428,7 +3625,8 @@ client3_3_readlink (call_frame_t *frame, xlator_t *this,
                                      client3_3_readlink_cbk, NULL,
                                      rsphdr, count, NULL, 0,
                                      local->iobref,
-                                     (xdrproc_t)xdr_gfs3_readlink_req);
+                                     (xdrproc_t)xdr_gfs3_readlink_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3479,14 +3677,12 @@ client3_3_unlink (call_frame_t *frame, xlator_t *this,
         req.bname = (char *)args->loc->name;
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_UNLINK,
                                      client3_3_unlink_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_unlink_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_unlink_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3533,13 +3729,11 @@ client3_3_rmdir (call_frame_t *frame, xlator_t *this,
         req.xflags = args->flags;
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_RMDIR, client3_3_rmdir_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_rmdir_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_rmdir_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3599,13 +3793,11 @@ client3_3_symlink (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_SYMLINK, client3_3_symlink_cbk,
                                      NULL,  NULL, 0, NULL,
-                                     0, NULL, (xdrproc_t)xdr_gfs3_symlink_req);
+                                     0, NULL, (xdrproc_t)xdr_gfs3_symlink_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3664,13 +3856,11 @@ client3_3_rename (call_frame_t *frame, xlator_t *this,
         req.newbname = (char *)args->newloc->name;
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_RENAME, client3_3_rename_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_rename_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_rename_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3740,13 +3930,10 @@ client3_3_link (call_frame_t *frame, xlator_t *this,
         req.newbname = (char *)args->newloc->name;
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_LINK, client3_3_link_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_link_req);
+                                     (xdrproc_t)xdr_gfs3_link_req, args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3807,13 +3994,11 @@ client3_3_mknod (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_MKNOD, client3_3_mknod_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_mknod_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_mknod_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3875,13 +4060,11 @@ client3_3_mkdir (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_MKDIR, client3_3_mkdir_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_mkdir_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_mkdir_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -3945,13 +4128,11 @@ client3_3_create (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_CREATE, client3_3_create_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_create_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_create_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4013,13 +4194,10 @@ client3_3_open (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_OPEN, client3_3_open_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_open_req);
+                                     (xdrproc_t)xdr_gfs3_open_req, args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4106,14 +4284,11 @@ client3_3_readv (call_frame_t *frame, xlator_t *this,
         local->iobref = rsp_iobref;
         rsp_iobref = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_READ, client3_3_readv_cbk, NULL,
                                      NULL, 0, &rsp_vec, 1,
                                      local->iobref,
-                                     (xdrproc_t)xdr_gfs3_read_req);
+                                     (xdrproc_t)xdr_gfs3_read_req, args->xdata);
         if (ret) {
                 //unwind is done in the cbk
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
@@ -4175,14 +4350,12 @@ client3_3_writev (call_frame_t *frame, xlator_t *this, void *data)
                             "testing-the-xdata-value");
 #endif
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_vec_request (this, &req, frame, conf->fops,
                                          GFS3_OP_WRITE, client3_3_writev_cbk,
                                          args->vector, args->count,
                                          args->iobref,
-                                         (xdrproc_t)xdr_gfs3_write_req);
+                                         (xdrproc_t)xdr_gfs3_write_req,
+                                         args->xdata);
         if (ret) {
                 /*
                  * If the lower layers fail to submit a request, they'll also
@@ -4240,13 +4413,11 @@ client3_3_flush (call_frame_t *frame, xlator_t *this,
         req.fd = remote_fd;
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FLUSH, client3_3_flush_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_flush_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_flush_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4289,13 +4460,11 @@ client3_3_fsync (call_frame_t *frame, xlator_t *this,
         req.data = args->flags;
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FSYNC, client3_3_fsync_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_fsync_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_fsync_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
 
@@ -4337,13 +4506,11 @@ client3_3_fstat (call_frame_t *frame, xlator_t *this,
         req.fd = remote_fd;
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FSTAT, client3_3_fstat_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_fstat_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_fstat_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4402,13 +4569,11 @@ client3_3_opendir (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_OPENDIR, client3_3_opendir_cbk,
                                      NULL, NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_opendir_req);
+                                     (xdrproc_t)xdr_gfs3_opendir_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4452,14 +4617,12 @@ client3_3_fsyncdir (call_frame_t *frame, xlator_t *this, void *data)
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FSYNCDIR, client3_3_fsyncdir_cbk,
                                      NULL, NULL, 0,
                                      NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_fsyncdir_req);
+                                     (xdrproc_t)xdr_gfs3_fsyncdir_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4509,13 +4672,11 @@ client3_3_statfs (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_STATFS, client3_3_statfs_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_statfs_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_statfs_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4570,13 +4731,11 @@ client3_3_setxattr (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_SETXATTR, client3_3_setxattr_cbk,
                                      NULL, NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_setxattr_req);
+                                     (xdrproc_t)xdr_gfs3_setxattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4627,13 +4786,11 @@ client3_3_fsetxattr (call_frame_t *frame, xlator_t *this,
                                             op_errno, unwind);
         }
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FSETXATTR, client3_3_fsetxattr_cbk,
                                      NULL, NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_fsetxattr_req);
+                                     (xdrproc_t)xdr_gfs3_fsetxattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4721,15 +4878,13 @@ client3_3_fgetxattr (call_frame_t *frame, xlator_t *this,
         }
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FGETXATTR,
                                      client3_3_fgetxattr_cbk, NULL,
                                      rsphdr, count,
                                      NULL, 0, local->iobref,
-                                     (xdrproc_t)xdr_gfs3_fgetxattr_req);
+                                     (xdrproc_t)xdr_gfs3_fgetxattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4862,15 +5017,13 @@ client3_3_getxattr (call_frame_t *frame, xlator_t *this,
                 }
         }
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_GETXATTR,
                                      client3_3_getxattr_cbk, NULL,
                                      rsphdr, count,
                                      NULL, 0, local->iobref,
-                                     (xdrproc_t)xdr_gfs3_getxattr_req);
+                                     (xdrproc_t)xdr_gfs3_getxattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -4976,15 +5129,13 @@ client3_3_xattrop (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_XATTROP,
                                      client3_3_xattrop_cbk, NULL,
                                      rsphdr, count,
                                      NULL, 0, local->iobref,
-                                     (xdrproc_t)xdr_gfs3_xattrop_req);
+                                     (xdrproc_t)xdr_gfs3_xattrop_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5085,15 +5236,13 @@ client3_3_fxattrop (call_frame_t *frame, xlator_t *this,
                                             op_errno, unwind);
         }
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FXATTROP,
                                      client3_3_fxattrop_cbk, NULL,
                                      rsphdr, count,
                                      NULL, 0, local->iobref,
-                                     (xdrproc_t)xdr_gfs3_fxattrop_req);
+                                     (xdrproc_t)xdr_gfs3_fxattrop_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5150,14 +5299,12 @@ client3_3_removexattr (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_REMOVEXATTR,
                                      client3_3_removexattr_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_removexattr_req);
+                                     (xdrproc_t)xdr_gfs3_removexattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5200,14 +5347,12 @@ client3_3_fremovexattr (call_frame_t *frame, xlator_t *this,
         req.name = (char *)args->name;
         req.fd = remote_fd;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FREMOVEXATTR,
                                      client3_3_fremovexattr_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_fremovexattr_req);
+                                     (xdrproc_t)xdr_gfs3_fremovexattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5282,13 +5427,10 @@ client3_3_lk (call_frame_t *frame, xlator_t *this,
 
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops, GFS3_OP_LK,
                                      client3_3_lk_cbk, NULL,
                                      NULL, 0, NULL, 0, NULL,
-                                     (xdrproc_t)xdr_gfs3_lk_req);
+                                     (xdrproc_t)xdr_gfs3_lk_req, args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5363,14 +5505,12 @@ client3_3_inodelk (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_INODELK,
                                      client3_3_inodelk_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_inodelk_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_inodelk_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5444,14 +5584,12 @@ client3_3_finodelk (call_frame_t *frame, xlator_t *this,
         gf_proto_flock_from_flock (&req.flock, args->flock);
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FINODELK,
                                      client3_3_finodelk_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_finodelk_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_finodelk_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5503,14 +5641,12 @@ client3_3_entrylk (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_ENTRYLK,
                                      client3_3_entrylk_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_entrylk_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_entrylk_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5558,14 +5694,12 @@ client3_3_fentrylk (call_frame_t *frame, xlator_t *this,
         }
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FENTRYLK,
                                      client3_3_fentrylk_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_fentrylk_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_fentrylk_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5605,15 +5739,13 @@ client3_3_rchecksum (call_frame_t *frame, xlator_t *this,
         req.offset = args->offset;
         req.fd     = remote_fd;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_RCHECKSUM,
                                      client3_3_rchecksum_cbk, NULL,
                                      NULL, 0, NULL,
                                      0, NULL,
-                                     (xdrproc_t)xdr_gfs3_rchecksum_req);
+                                     (xdrproc_t)xdr_gfs3_rchecksum_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5702,15 +5834,13 @@ client3_3_readdir (call_frame_t *frame, xlator_t *this,
         local->cmd = remote_fd;
 
         memcpy (req.gfid, args->fd->inode->gfid, 16);
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_READDIR,
                                      client3_3_readdir_cbk, NULL,
                                      rsphdr, count,
                                      NULL, 0, rsp_iobref,
-                                     (xdrproc_t)xdr_gfs3_readdir_req);
+                                     (xdrproc_t)xdr_gfs3_readdir_req,
+                                     args->xdata);
 
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
@@ -5814,15 +5944,13 @@ client3_3_readdirp (call_frame_t *frame, xlator_t *this,
         memcpy (req.gfid, args->fd->inode->gfid, 16);
 
         /* dict itself is 'xdata' here */
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.dict.dict_val),
-                                    req.dict.dict_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_READDIRP,
                                      client3_3_readdirp_cbk, NULL,
                                      rsphdr, count, NULL,
                                      0, rsp_iobref,
-                                     (xdrproc_t)xdr_gfs3_readdirp_req);
+                                     (xdrproc_t)xdr_gfs3_readdirp_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5881,14 +6009,12 @@ client3_3_setattr (call_frame_t *frame, xlator_t *this,
 
         conf = this->private;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_SETATTR,
                                      client3_3_setattr_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_setattr_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_setattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5926,14 +6052,12 @@ client3_3_fsetattr (call_frame_t *frame, xlator_t *this, void *data)
         req.valid = args->valid;
         gf_stat_from_iatt (&req.stbuf, args->stbuf);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FSETATTR,
                                      client3_3_fsetattr_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_fsetattr_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_fsetattr_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -5973,14 +6097,12 @@ client3_3_fallocate(call_frame_t *frame, xlator_t *this, void *data)
 	req.size = args->size;
 	memcpy(req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request (this, &req, frame, conf->fops,
                                      GFS3_OP_FALLOCATE,
                                      client3_3_fallocate_cbk, NULL,
                                      NULL, 0, NULL, 0,
-                                     NULL, (xdrproc_t)xdr_gfs3_fallocate_req);
+                                     NULL, (xdrproc_t)xdr_gfs3_fallocate_req,
+                                     args->xdata);
         if (ret) {
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
         }
@@ -6019,13 +6141,11 @@ client3_3_discard(call_frame_t *frame, xlator_t *this, void *data)
 	req.size = args->size;
 	memcpy(req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request(this, &req, frame, conf->fops,
                                     GFS3_OP_DISCARD, client3_3_discard_cbk,
 				    NULL, NULL, 0, NULL, 0, NULL,
-                                    (xdrproc_t) xdr_gfs3_discard_req);
+                                    (xdrproc_t) xdr_gfs3_discard_req,
+                                    args->xdata);
         if (ret)
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
 
@@ -6065,13 +6185,11 @@ client3_3_zerofill(call_frame_t *frame, xlator_t *this, void *data)
         req.size = args->size;
         memcpy(req.gfid, args->fd->inode->gfid, 16);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, args->xdata, (&req.xdata.xdata_val),
-                                    req.xdata.xdata_len, op_errno, unwind);
-
         ret = client_submit_request(this, &req, frame, conf->fops,
                                     GFS3_OP_ZEROFILL, client3_3_zerofill_cbk,
                                     NULL, NULL, 0, NULL, 0, NULL,
-                                    (xdrproc_t) xdr_gfs3_zerofill_req);
+                                    (xdrproc_t) xdr_gfs3_zerofill_req,
+                                    args->xdata);
         if (ret)
                 gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
 
@@ -6085,6 +6203,220 @@ unwind:
         return 0;
 }
 
+static int
+client_compound_lk_args (compound_fop_args_t *member, unsigned int *gf_cmd,
+                         unsigned int *gf_type)
+{
+        if (member->cmd == F_GETLK || member->cmd == F_GETLK64)
+                *gf_cmd = GF_LK_GETLK;
+        else if (member->cmd == F_SETLK || member->cmd == F_SETLK64)
+                *gf_cmd = GF_LK_SETLK;
+        else if (member->cmd == F_SETLKW || member->cmd == F_SETLKW64)
+                *gf_cmd = GF_LK_SETLKW;
+        else
+                return -EINVAL;
+
+        switch (member->flock.l_type) {
+        case F_RDLCK:
+                *gf_type = GF_LK_F_RDLCK;
+                break;
+        case F_WRLCK:
+                *gf_type = GF_LK_F_WRLCK;
+                break;
+        case F_UNLCK:
+                *gf_type = GF_LK_F_UNLCK;
+                break;
+        }
+
+        return 0;
+}
+
+
+/* Encodes the member of a compound. Returns 1 when the fd of the member has
+ * no usable remote fd yet, in which case the compound is not sent as such.
+ */
+static int
+client_compound_pack (xlator_t *this, gfs3_compound_req_member *req,
+                      compound_fop_args_t *member)
+{
+        int64_t  remote_fd = -1;
+        int      op_errno  = EINVAL;
+
+        req->op = gf_compound_op_from_fop (member->fop);
+        if (!req->op || !member->fd)
+                return -EINVAL;
+
+        if (client_get_remote_fd (this, member->fd, FALLBACK_TO_ANON_FD,
+                                  &remote_fd) < 0 || remote_fd == -1)
+                return 1;
+
+        switch (member->fop) {
+        case GF_FOP_FXATTROP:
+        {
+                gfs3_fxattrop_req *fxattrop_req =
+                        &req->gfs3_compound_req_member_u.fxattrop_req;
+
+                memcpy (fxattrop_req->gfid, member->fd->inode->gfid, 16);
+                fxattrop_req->fd = remote_fd;
+                fxattrop_req->flags = member->optype;
+                GF_PROTOCOL_DICT_SERIALIZE (this, member->xattr,
+                                            (&fxattrop_req->dict.dict_val),
+                                            fxattrop_req->dict.dict_len,
+                                            op_errno, out);
+                GF_PROTOCOL_DICT_SERIALIZE (this, member->xdata,
+                                            (&fxattrop_req->xdata.xdata_val),
+                                            fxattrop_req->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        }
+        case GF_FOP_FINODELK:
+        {
+                gfs3_finodelk_req *finodelk_req =
+                        &req->gfs3_compound_req_member_u.finodelk_req;
+
+                if (client_compound_lk_args (member, &finodelk_req->cmd,
+                                             &finodelk_req->type))
+                        goto out;
+
+                memcpy (finodelk_req->gfid, member->fd->inode->gfid, 16);
+                finodelk_req->fd = remote_fd;
+                finodelk_req->volume = member->volume;
+                gf_proto_flock_from_flock (&finodelk_req->flock,
+                                           &member->flock);
+                GF_PROTOCOL_DICT_SERIALIZE (this, member->xdata,
+                                            (&finodelk_req->xdata.xdata_val),
+                                            finodelk_req->xdata.xdata_len,
+                                            op_errno, out);
+                break;
+        }
+        default:
+                goto out;
+        }
+
+        return 0;
+out:
+        return -op_errno;
+}
+
+
+static void
+client_compound_req_cleanup (gfs3_compound_req *req)
+{
+        gfs3_compound_req_member *member = NULL;
+        void                     *u      = NULL;
+        int                       i      = 0;
+
+        if (!req->members.members_val)
+                return;
+
+        for (i = 0; i < req->members.members_len; i++) {
+                member = &req->members.members_val[i];
+                u = &member->gfs3_compound_req_member_u;
+
+                switch (member->op) {
+                case GFS3_COMPOUND_FXATTROP:
+                        GF_FREE (((gfs3_fxattrop_req *)u)->dict.dict_val);
+                        GF_FREE (((gfs3_fxattrop_req *)u)->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_FINODELK:
+                        GF_FREE (((gfs3_finodelk_req *)u)->xdata.xdata_val);
+                        break;
+                }
+        }
+
+        GF_FREE (req->members.members_val);
+        req->members.members_val = NULL;
+}
+
+
+/* Sends all the members of a compound in one request. When the server does
+ * not take compounds, or an fd of a member is still being reopened, the
+ * members are sent one by one instead.
+ */
+int32_t
+client3_3_compound (call_frame_t *frame, xlator_t *this, void *data)
+{
+        clnt_args_t       *args     = NULL;
+        clnt_conf_t       *conf     = NULL;
+        clnt_local_t      *local    = NULL;
+        compound_args_t   *c_args   = NULL;
+        gfs3_compound_req  req      = {{0,},};
+        int                op_errno = EINVAL;
+        int                ret      = 0;
+        int                i        = 0;
+
+        if (!frame || !this || !data)
+                goto unwind;
+
+        args = data;
+        conf = this->private;
+        c_args = args->compound_args;
+
+        if (!c_args || c_args->count <= 0 ||
+            c_args->count > GF_COMPOUND_MAX_FOPS)
+                goto unwind;
+
+        if (!conf->compound_fops)
+                goto unroll;
+
+        local = mem_get0 (this->local_pool);
+        if (!local) {
+                op_errno = ENOMEM;
+                goto unwind;
+        }
+        frame->local = local;
+        local->compound_args = c_args;
+
+        req.members.members_val = GF_CALLOC (c_args->count,
+                                             sizeof (*req.members.members_val),
+                                             gf_client_mt_compound_req_t);
+        if (!req.members.members_val) {
+                op_errno = ENOMEM;
+                goto unwind;
+        }
+        req.members.members_len = c_args->count;
+
+        for (i = 0; i < c_args->count; i++) {
+                ret = client_compound_pack (this, &req.members.members_val[i],
+                                            &c_args->fops[i]);
+                if (ret > 0)
+                        goto unroll;
+                if (ret < 0) {
+                        op_errno = -ret;
+                        goto unwind;
+                }
+        }
+
+        ret = client_submit_request (this, &req, frame, conf->fops,
+                                     GFS3_OP_COMPOUND,
+                                     client3_3_compound_cbk, NULL,
+                                     NULL, 0, NULL, 0, NULL,
+                                     (xdrproc_t)xdr_gfs3_compound_req,
+                                     args->xdata);
+        if (ret) {
+                gf_log (this->name, GF_LOG_WARNING, "failed to send the fop");
+        }
+
+        client_compound_req_cleanup (&req);
+
+        return 0;
+unroll:
+        client_compound_req_cleanup (&req);
+
+        if (local) {
+                frame->local = NULL;
+                client_local_wipe (local);
+        }
+
+        return compound_fop_unroll (frame, this, c_args, args->xdata);
+unwind:
+        CLIENT_STACK_UNWIND (compound, frame, -1, op_errno, NULL, NULL);
+
+        client_compound_req_cleanup (&req);
+
+        return 0;
+}
+
 /* Table Specific to FOPS */
 
 
@@ -6133,6 +6465,7 @@ rpc_clnt_procedure_t clnt3_3_fop_actors[GF_FOP_MAXVALUE] = {
 	[GF_FOP_FALLOCATE]   = { "FALLOCATE",	client3_3_fallocate },
 	[GF_FOP_DISCARD]     = { "DISCARD",	client3_3_discard },
         [GF_FOP_ZEROFILL]    = { "ZEROFILL",    client3_3_zerofill},
+        [GF_FOP_COMPOUND]    = { "COMPOUND",    client3_3_compound},
         [GF_FOP_RELEASE]     = { "RELEASE",     client3_3_release },
         [GF_FOP_RELEASEDIR]  = { "RELEASEDIR",  client3_3_releasedir },
         [GF_FOP_GETSPEC]     = { "GETSPEC",     client3_getspec },
@@ -6188,6 +6521,7 @@ char *clnt3_3_fop_names[GFS3_OP_MAXVALUE] = {
 	[GFS3_OP_FALLOCATE]   = "FALLOCATE",
 	[GFS3_OP_DISCARD]     = "DISCARD",
         [GFS3_OP_ZEROFILL]    = "ZEROFILL",
+        [GFS3_OP_COMPOUND]    = "COMPOUND",
 
 };
 
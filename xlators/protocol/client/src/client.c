@@ -20,6 +20,7 @@
 #include "glusterfs.h"
 #include "statedump.h"
 #include "compat-errno.h"
+#include "hashfn.h"
 
 #include "xdr-rpc.h"
 #include "glusterfs3.h"
@@ -142,13 +143,87 @@ out:
         return ret;
 }
 
+/* Picks the connection a request goes out on. Only reads and writes are
+ * spread over the stripes: reads round-robin, writes by a hash of the gfid
+ * of their inode. Everything else, locks included, stays on conf->rpc,
+ * whose disconnect the locks and fds of the client are tied to.
+ *
+ * All the writes to a file, through any of its fds, thus go out on one
+ * connection and reach the brick in the order they were sent, as they
+ * would with a single connection. That holds as long as the stripe stays
+ * up: while it is down its writes go to conf->rpc, and the writes still in
+ * flight on either connection when it goes down or comes back up may be
+ * reordered. A read goes out on whichever connection is next and may
+ * overtake a write to the same file that is still in flight.
+ */
+struct rpc_clnt *
+client_rpc_pick (xlator_t *this, rpc_clnt_prog_t *prog, int procnum,
+                 call_frame_t *frame)
+{
+        clnt_conf_t     *conf   = NULL;
+        clnt_local_t    *local  = NULL;
+        client_stripe_t *stripe = NULL;
+        int              idx    = 0;
+
+        conf = this->private;
+
+        if (!conf->stripe_count || prog != conf->fops)
+                return conf->rpc;
+
+        switch (procnum) {
+        case GFS3_OP_READ:
+                idx = __sync_fetch_and_add (&conf->stripe_next, 1) %
+                        (conf->stripe_count + 1);
+                break;
+        case GFS3_OP_WRITE:
+                local = frame->local;
+                if (!local || !local->fd)
+                        return conf->rpc;
+                idx = SuperFastHash ((char *)local->fd->inode->gfid,
+                                     sizeof (uuid_t)) %
+                        (conf->stripe_count + 1);
+                break;
+        default:
+                return conf->rpc;
+        }
+
+        if (idx == 0)
+                return conf->rpc;
+
+        stripe = &conf->stripes[idx - 1];
+        if (stripe->state != CLIENT_STRIPE_READY)
+                return conf->rpc;
+
+        return stripe->rpc;
+}
+
 int
 client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
                        rpc_clnt_prog_t *prog, int procnum, fop_cbk_fn_t cbkfn,
                        struct iobref *iobref,  struct iovec *rsphdr,
                        int rsphdr_count, struct iovec *rsp_payload,
                        int rsp_payload_count, struct iobref *rsp_iobref,
-                       xdrproc_t xdrproc)
+                       xdrproc_t xdrproc, dict_t *xdata)
+{
+        struct rpc_clnt *rpc = NULL;
+
+        if (this && this->private && prog && frame)
+                rpc = client_rpc_pick (this, prog, procnum, frame);
+
+        return client_submit_request_to (this, rpc, req, frame, prog, procnum,
+                                         cbkfn, iobref, rsphdr, rsphdr_count,
+                                         rsp_payload, rsp_payload_count,
+                                         rsp_iobref, xdrproc, xdata);
+}
+
+int
+client_submit_request_to (xlator_t *this, struct rpc_clnt *rpc, void *req,
+                          call_frame_t *frame, rpc_clnt_prog_t *prog,
+                          int procnum, fop_cbk_fn_t cbkfn,
+                          struct iobref *iobref,  struct iovec *rsphdr,
+                          int rsphdr_count, struct iovec *rsp_payload,
+                          int rsp_payload_count, struct iobref *rsp_iobref,
+                          xdrproc_t xdrproc, dict_t *xdata)
 {
         int             ret        = -1;
         clnt_conf_t    *conf       = NULL;
@@ -162,6 +237,7 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
         uint64_t        gid        = 0;
 
         GF_VALIDATE_OR_GOTO ("client", this, out);
+        GF_VALIDATE_OR_GOTO (this->name, rpc, out);
         GF_VALIDATE_OR_GOTO (this->name, prog, out);
         GF_VALIDATE_OR_GOTO (this->name, frame, out);
 
@@ -183,7 +259,13 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
        }
 
         if (req && xdrproc) {
-                xdr_size = xdr_sizeof (xdrproc, req);
+                xdr_size = xdr_sizeof_xdata (xdrproc, req, xdata);
+                if (xdr_size < 0) {
+                        gf_log (this->name, GF_LOG_WARNING,
+                                "failed to get serialized length of dict");
+                        goto out;
+                }
+
                 iobuf = iobuf_get2 (this->ctx->iobuf_pool, xdr_size);
                 if (!iobuf) {
                         goto out;
@@ -213,8 +295,8 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
                 iov.iov_base = iobuf->ptr;
                 iov.iov_len  = iobuf_size (iobuf);
 
-                /* Create the xdr payload */
-                ret = xdr_serialize_generic (iov, req, xdrproc);
+                /* Create the xdr payload, with xdata serialized in place */
+                ret = xdr_serialize_generic_xdata (iov, req, xdrproc, xdata);
                 if (ret == -1) {
                         /* callingfn so that, we can get to know which xdr
                            function was called */
@@ -239,7 +321,7 @@ client_submit_request (xlator_t *this, void *req, call_frame_t *frame,
         }
 
         /* Send the msg */
-        ret = rpc_clnt_submit (conf->rpc, prog, procnum, cbkfn, &iov, count,
+        ret = rpc_clnt_submit (rpc, prog, procnum, cbkfn, &iov, count,
                                NULL, 0, new_iobref, frame, rsphdr, rsphdr_count,
                                rsp_payload, rsp_payload_count, rsp_iobref);
 
@@ -2074,6 +2156,40 @@ out:
 }
 
 
+int32_t
+client_compound (call_frame_t *frame, xlator_t *this, compound_args_t *args,
+                 dict_t *xdata)
+{
+        int          ret              = -1;
+        clnt_conf_t *conf             = NULL;
+        rpc_clnt_procedure_t *proc    = NULL;
+        clnt_args_t  clnt_args        = {0,};
+
+        conf = this->private;
+        if (!conf || !conf->fops)
+                goto out;
+
+        clnt_args.compound_args = args;
+        clnt_args.xdata = xdata;
+
+        proc = &conf->fops->proctable[GF_FOP_COMPOUND];
+        if (!proc) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "rpc procedure not found for %s",
+                        gf_fop_list[GF_FOP_COMPOUND]);
+                goto out;
+        }
+        if (proc->fn)
+                ret = proc->fn (frame, this, &clnt_args);
+out:
+        if (ret)
+                STACK_UNWIND_STRICT (compound, frame, -1, ENOTCONN,
+                                     NULL, NULL);
+
+        return 0;
+}
+
+
 int32_t
 client_getspec (call_frame_t *frame, xlator_t *this, const char *key,
                 int32_t flags)
@@ -2198,6 +2314,8 @@ client_rpc_notify (struct rpc_clnt *rpc, void *mydata, rpc_clnt_event_t event,
                 break;
         }
         case RPC_CLNT_DISCONNECT:
+                client_stripes_stop (this);
+
                 if (!conf->lk_heal)
                         client_mark_fd_bad (this);
                 else
@@ -2263,10 +2381,154 @@ out:
 }
 
 
+int
+client_stripe_notify (struct rpc_clnt *rpc, void *mydata,
+                      rpc_clnt_event_t event, void *data)
+{
+        client_stripe_t *stripe = NULL;
+        xlator_t        *this   = NULL;
+        clnt_conf_t     *conf   = NULL;
+        gf_boolean_t     attach = _gf_false;
+
+        stripe = mydata;
+        this = stripe->this;
+        conf = this->private;
+        if (!conf)
+                goto out;
+
+        switch (event) {
+        case RPC_CLNT_CONNECT:
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "got RPC_CLNT_CONNECT on connection %d",
+                        stripe->index);
+
+                /* attach only to a client conf->rpc has set up, the
+                 * stripe has nothing to share otherwise */
+                pthread_mutex_lock (&conf->lock);
+                {
+                        if (conf->stripes_up) {
+                                stripe->state = CLIENT_STRIPE_SETVOLUME;
+                                attach = _gf_true;
+                        } else {
+                                stripe->state = CLIENT_STRIPE_CONNECTED;
+                        }
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                if (attach)
+                        client_setvolume (this, rpc);
+                break;
+
+        case RPC_CLNT_DISCONNECT:
+                pthread_mutex_lock (&conf->lock);
+                {
+                        if (stripe->state == CLIENT_STRIPE_READY)
+                                gf_log (this->name, GF_LOG_INFO,
+                                        "connection %d disconnected",
+                                        stripe->index);
+                        stripe->state = CLIENT_STRIPE_DOWN;
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                /* unlike conf->rpc, a stripe goes straight to the brick */
+                rpc->conn.config.remote_port = conf->brick_port;
+                break;
+
+        default:
+                gf_log (this->name, GF_LOG_TRACE,
+                        "got some other RPC event %d on connection %d",
+                        event, stripe->index);
+                break;
+        }
+
+out:
+        return 0;
+}
+
+
+/* Called once conf->rpc is attached to the brick: the stripes connect to
+ * the same port and attach to the same client.
+ */
+void
+client_stripes_start (xlator_t *this)
+{
+        clnt_conf_t            *conf   = NULL;
+        client_stripe_t        *stripe = NULL;
+        struct rpc_clnt_config  config = {0, };
+        gf_boolean_t            attach = _gf_false;
+        int                     i      = 0;
+
+        conf = this->private;
+        if (!conf->stripe_count)
+                return;
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                conf->stripes_up = _gf_true;
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        config.remote_port = conf->brick_port;
+
+        for (i = 0; i < conf->stripe_count; i++) {
+                stripe = &conf->stripes[i];
+                attach = _gf_false;
+
+                pthread_mutex_lock (&conf->lock);
+                {
+                        if (stripe->state == CLIENT_STRIPE_CONNECTED) {
+                                stripe->state = CLIENT_STRIPE_SETVOLUME;
+                                attach = _gf_true;
+                        }
+                }
+                pthread_mutex_unlock (&conf->lock);
+
+                if (attach) {
+                        client_setvolume (this, stripe->rpc);
+                } else {
+                        rpc_clnt_reconfig (stripe->rpc, &config);
+                        rpc_clnt_start (stripe->rpc);
+                }
+        }
+}
+
+
+/* Called when conf->rpc disconnects: the server releases the fds and locks
+ * of the client only once all its connections are gone, so the stripes go
+ * down with conf->rpc and attach again after the next handshake.
+ */
+void
+client_stripes_stop (xlator_t *this)
+{
+        clnt_conf_t     *conf   = NULL;
+        client_stripe_t *stripe = NULL;
+        int              i      = 0;
+
+        conf = this->private;
+        if (!conf->stripe_count)
+                return;
+
+        pthread_mutex_lock (&conf->lock);
+        {
+                conf->stripes_up = _gf_false;
+                for (i = 0; i < conf->stripe_count; i++)
+                        conf->stripes[i].state = CLIENT_STRIPE_DOWN;
+        }
+        pthread_mutex_unlock (&conf->lock);
+
+        for (i = 0; i < conf->stripe_count; i++) {
+                stripe = &conf->stripes[i];
+                if (stripe->rpc && stripe->rpc->conn.trans)
+                        rpc_transport_disconnect (stripe->rpc->conn.trans);
+        }
+}
+
+
 int
 notify (xlator_t *this, int32_t event, void *data, ...)
 {
         clnt_conf_t     *conf  = NULL;
+        int              i     = 0;
 
         conf = this->private;
         if (!conf)
@@ -2295,6 +2557,8 @@ notify (xlator_t *this, int32_t event, void *data, ...)
                 pthread_mutex_unlock (&conf->lock);
 
                 rpc_clnt_disable (conf->rpc);
+                for (i = 0; i < conf->stripe_count; i++)
+                        rpc_clnt_disable (conf->stripes[i].rpc);
                 break;
 
         default:
@@ -2344,6 +2608,7 @@ int
 build_client_config (xlator_t *this, clnt_conf_t *conf)
 {
         int                     ret = -1;
+        int32_t                 connection_count = 1;
 
         if (!conf)
                 goto out;
@@ -2368,6 +2633,9 @@ build_client_config (xlator_t *this, clnt_conf_t *conf)
 
         GF_OPTION_INIT ("send-gids", conf->send_gids, bool, out);
 
+        GF_OPTION_INIT ("connection-count", connection_count, int32, out);
+        conf->stripe_count = connection_count - 1;
+
         ret = client_check_remote_host (this, this->options);
         if (ret)
                 goto out;
@@ -2397,6 +2665,26 @@ mem_acct_init (xlator_t *this)
         return ret;
 }
 
+static void
+client_destroy_stripes (clnt_conf_t *conf)
+{
+        int i = 0;
+
+        if (!conf->stripes)
+                return;
+
+        for (i = 0; i < conf->stripe_count; i++) {
+                if (!conf->stripes[i].rpc)
+                        continue;
+
+                rpc_clnt_connection_cleanup (&conf->stripes[i].rpc->conn);
+                rpc_clnt_unref (conf->stripes[i].rpc);
+        }
+
+        GF_FREE (conf->stripes);
+        conf->stripes = NULL;
+}
+
 int
 client_destroy_rpc (xlator_t *this)
 {
@@ -2408,6 +2696,8 @@ client_destroy_rpc (xlator_t *this)
                 goto out;
 
         if (conf->rpc) {
+                client_destroy_stripes (conf);
+
                 /* cleanup the saved-frames before last unref */
                 rpc_clnt_connection_cleanup (&conf->rpc->conn);
 
@@ -2426,6 +2716,61 @@ out:
         return ret;
 }
 
+static int
+client_init_stripes (xlator_t *this)
+{
+        clnt_conf_t     *conf   = NULL;
+        client_stripe_t *stripe = NULL;
+        char            *name   = NULL;
+        int              i      = 0;
+        int              ret    = -1;
+
+        conf = this->private;
+        if (!conf->stripe_count)
+                return 0;
+
+        conf->stripes = GF_CALLOC (conf->stripe_count, sizeof (*stripe),
+                                   gf_client_mt_stripe_t);
+        if (!conf->stripes)
+                goto out;
+
+        for (i = 0; i < conf->stripe_count; i++) {
+                stripe = &conf->stripes[i];
+                stripe->this  = this;
+                stripe->index = i + 1;
+                stripe->state = CLIENT_STRIPE_DOWN;
+
+                ret = gf_asprintf (&name, "%s.%d", this->name, stripe->index);
+                if (ret == -1)
+                        goto out;
+
+                stripe->rpc = rpc_clnt_new (this->options, this->ctx, name, 0);
+                GF_FREE (name);
+                if (!stripe->rpc) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "failed to initialize RPC for connection %d",
+                                stripe->index);
+                        ret = -1;
+                        goto out;
+                }
+
+                rpc_clnt_register_notify (stripe->rpc, client_stripe_notify,
+                                          stripe);
+
+                ret = rpcclnt_cbk_program_register (stripe->rpc,
+                                                    &gluster_cbk_prog, this);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "failed to register callback program");
+                        goto out;
+                }
+        }
+
+        ret = 0;
+out:
+        return ret;
+}
+
 int
 client_init_rpc (xlator_t *this)
 {
@@ -2464,6 +2809,10 @@ client_init_rpc (xlator_t *this)
                 goto out;
         }
 
+        ret = client_init_stripes (this);
+        if (ret)
+                goto out;
+
         ret = 0;
 
         gf_log (this->name, GF_LOG_DEBUG, "client init successful");
@@ -2656,6 +3005,8 @@ fini (xlator_t *this)
         this->private = NULL;
 
         if (conf) {
+                client_destroy_stripes (conf);
+
                 if (conf->rpc) {
                         /* cleanup the saved-frames before last unref */
                         rpc_clnt_connection_cleanup (&conf->rpc->conn);
@@ -2759,6 +3110,11 @@ client_priv_dump (xlator_t *this)
 
         gf_proc_dump_write ("connected", "%d", conf->connected);
 
+        for (i = 0; i < conf->stripe_count; i++) {
+                sprintf (key, "stripe.%d.state", conf->stripes[i].index);
+                gf_proc_dump_write (key, "%d", conf->stripes[i].state);
+        }
+
         if (conf->rpc) {
                 conn = &conf->rpc->conn;
                 gf_proc_dump_write("total_bytes_read", "%"PRIu64,
@@ -2771,6 +3127,14 @@ client_priv_dump (xlator_t *this)
                                     conn->pingcnt);
                 gf_proc_dump_write("msgs_sent", "%"PRIu64,
                                     conn->msgcnt);
+                if (conn->trans->total_msgs_write)
+                        gf_proc_dump_write("write_calls_per_msg", "%.2f",
+                                (double)conn->trans->total_write_calls /
+                                conn->trans->total_msgs_write);
+                if (conn->trans->total_msgs_read)
+                        gf_proc_dump_write("read_calls_per_msg", "%.2f",
+                                (double)conn->trans->total_read_calls /
+                                conn->trans->total_msgs_read);
         }
         pthread_mutex_unlock(&conf->lock);
 
@@ -2846,6 +3210,7 @@ struct xlator_fops fops = {
 	.fallocate   = client_fallocate,
 	.discard     = client_discard,
         .zerofill    = client_zerofill,
+        .compound    = client_compound,
         .getspec     = client_getspec,
 };
 
@@ -2933,5 +3298,14 @@ struct volume_options options[] = {
           .type  = GF_OPTION_TYPE_BOOL,
           .default_value = "on",
         },
+        { .key   = {"connection-count"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = 1,
+          .max   = 16,
+          .default_value = "1",
+          .description = "Number of connections to the brick. Reads are "
+                         "spread over all of them, writes by file; the "
+                         "other operations use the first connection."
+        },
         { .key   = {NULL} },
 };
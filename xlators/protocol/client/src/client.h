@@ -64,6 +64,23 @@ typedef enum {
         } while (0)
 
 
+typedef enum {
+        CLIENT_STRIPE_DOWN,
+        CLIENT_STRIPE_CONNECTED,        /* no setvolume done yet */
+        CLIENT_STRIPE_SETVOLUME,        /* setvolume in flight */
+        CLIENT_STRIPE_READY,
+} client_stripe_state_t;
+
+/* An extra connection to the brick, attached to the same server-side client
+ * as conf->rpc, so that fds and locks are shared by all the connections.
+ */
+typedef struct client_stripe {
+        struct rpc_clnt       *rpc;
+        xlator_t              *this;
+        int                    index;
+        client_stripe_state_t  state;   /* protected by conf->lock */
+} client_stripe_t;
+
 struct clnt_options {
         char *remote_subvolume;
         int   ping_timeout;
@@ -127,6 +144,17 @@ typedef struct clnt_conf {
         uint64_t               setvol_count;
 
         gf_boolean_t           send_gids; /* let the server resolve gids */
+
+        gf_boolean_t           compound_fops; /* the server takes compound
+                                                 fops in one request */
+
+        client_stripe_t       *stripes; /* connections besides conf->rpc */
+        int                    stripe_count;
+        uint32_t               stripe_next; /* round-robin for reads */
+        gf_boolean_t           stripes_up; /* conf->rpc has done setvolume,
+                                              the stripes may attach */
+        int                    brick_port; /* from the portmap query, kept
+                                              for the stripes to reconnect */
 } clnt_conf_t;
 
 typedef struct _client_fd_ctx {
@@ -173,6 +201,7 @@ typedef struct client_local {
         pthread_mutex_t      mutex;
         char                *name;
         gf_boolean_t         attempt_reopen;
+        compound_args_t     *compound_args;
 } clnt_local_t;
 
 typedef struct client_args {
@@ -206,6 +235,7 @@ typedef struct client_args {
 
         mode_t              umask;
         dict_t             *xdata;
+        compound_args_t    *compound_args;
 } clnt_args_t;
 
 typedef ssize_t (*gfs_serialize_t) (struct iovec outmsg, void *args);
@@ -222,7 +252,22 @@ int client_submit_request (xlator_t *this, void *req,
                            struct iobref *iobref,
                            struct iovec *rsphdr, int rsphdr_count,
                            struct iovec *rsp_payload, int rsp_count,
-                           struct iobref *rsp_iobref, xdrproc_t xdrproc);
+                           struct iobref *rsp_iobref, xdrproc_t xdrproc,
+                           dict_t *xdata);
+
+int client_submit_request_to (xlator_t *this, struct rpc_clnt *rpc,
+                              void *req, call_frame_t *frame,
+                              rpc_clnt_prog_t *prog, int procnum,
+                              fop_cbk_fn_t cbk, struct iobref *iobref,
+                              struct iovec *rsphdr, int rsphdr_count,
+                              struct iovec *rsp_payload, int rsp_count,
+                              struct iobref *rsp_iobref, xdrproc_t xdrproc,
+                              dict_t *xdata);
+struct rpc_clnt *client_rpc_pick (xlator_t *this, rpc_clnt_prog_t *prog,
+                                  int procnum, call_frame_t *frame);
+int client_setvolume (xlator_t *this, struct rpc_clnt *rpc);
+void client_stripes_start (xlator_t *this);
+void client_stripes_stop (xlator_t *this);
 
 int unserialize_rsp_dirent (struct gfs3_readdir_rsp *rsp, gf_dirent_t *entries);
 int unserialize_rsp_direntp (xlator_t *this, fd_t *fd,
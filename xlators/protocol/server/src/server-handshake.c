@@ -319,7 +319,7 @@ fail:
                 close (spec_fd);
 
         server_submit_reply (NULL, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_getspec_rsp);
+                             (xdrproc_t)xdr_gf_getspec_rsp, NULL);
 
         return 0;
 }
@@ -625,13 +625,16 @@ server_setvolume (rpcsvc_request_t *req)
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "creating inode table with lru_limit=%"PRId32", "
-                        "xlator=%s", conf->inode_lru_limit,
+                        "hash_size=%"PRId32", xlator=%s",
+                        conf->inode_lru_limit, conf->inode_hash_size,
                         client->bound_xl->name);
 
                 /* TODO: what is this ? */
                 client->bound_xl->itable =
-                        inode_table_new (conf->inode_lru_limit,
-                                         client->bound_xl);
+                        inode_table_new_with_size (conf->inode_lru_limit,
+                                                   client->bound_xl,
+                                                   conf->inode_hash_size,
+                                                   conf->inode_hash_size);
         }
 
         ret = dict_set_str (reply, "process-uuid",
@@ -651,6 +654,11 @@ server_setvolume (rpcsvc_request_t *req)
                 gf_log (this->name, GF_LOG_DEBUG,
                         "failed to set 'transport-ptr'");
 
+        ret = dict_set_int32 (reply, "compound-fops", 1);
+        if (ret)
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "failed to set 'compound-fops'");
+
 fail:
         rsp.dict.dict_len = dict_serialized_length (reply);
         if (rsp.dict.dict_len > UINT_MAX) {
@@ -693,7 +701,7 @@ fail:
                 req->trans->xl_private = NULL;
         }
         server_submit_reply (NULL, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_setvolume_rsp);
+                             (xdrproc_t)xdr_gf_setvolume_rsp, NULL);
 
 
         free (args.dict.dict_val);
@@ -719,7 +727,7 @@ server_ping (rpcsvc_request_t *req)
         rsp.op_ret = 0;
 
         server_submit_reply (NULL, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, NULL);
 
         return 0;
 }
@@ -767,7 +775,7 @@ fail:
         rsp.op_ret   = op_ret;
         rsp.op_errno = op_errno;
         server_submit_reply (NULL, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_set_lk_ver_rsp);
+                             (xdrproc_t)xdr_gf_set_lk_ver_rsp, NULL);
 
         free (args.uid);
 
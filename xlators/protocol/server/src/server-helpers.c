@@ -16,6 +16,7 @@
 #include "server.h"
 #include "server-helpers.h"
 #include "gidcache.h"
+#include "compound-fop-utils.h"
 
 #include <fnmatch.h>
 #include <pwd.h>
@@ -228,6 +229,13 @@ free_state (server_state_t *state)
         server_resolve_wipe (&state->resolve);
         server_resolve_wipe (&state->resolve2);
 
+        compound_args_destroy (state->compound_args);
+        if (state->compound_req) {
+                xdr_free ((xdrproc_t)xdr_gfs3_compound_req,
+                          (char *)state->compound_req);
+                GF_FREE (state->compound_req);
+        }
+
         GF_FREE (state);
 }
 
@@ -515,6 +523,12 @@ server_build_config (xlator_t *this, server_conf_t *conf)
                 conf->inode_lru_limit = 16384;
         }
 
+        ret = dict_get_int32 (this->options, "inode-hash-size",
+                              &conf->inode_hash_size);
+        if (ret < 0) {
+                conf->inode_hash_size = DEFAULT_INODE_HASH_SIZE;
+        }
+
         conf->verify_volfile = 1;
         data = dict_get (this->options, "verify-volfile-checksum");
         if (data) {
@@ -20,8 +20,10 @@
 #include "server-helpers.h"
 #include "rpc-common-xdr.h"
 #include "glusterfs3-xdr.h"
+#include "glusterfs3-xdr-fast.h"
 #include "glusterfs3.h"
 #include "compat-errno.h"
+#include "compound-fop-utils.h"
 
 #include "xdr-nfs3.h"
 
@@ -75,9 +77,6 @@ server_statfs_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         gfs3_statfs_rsp      rsp    = {0,};
         rpcsvc_request_t    *req    = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 gf_log (this->name, GF_LOG_WARNING, "%"PRId64": STATFS (%s)",
                         frame->root->unique, strerror (op_errno));
@@ -92,7 +91,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_statfs_rsp);
+                             (xdrproc_t)xdr_gfs3_statfs_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -132,9 +131,6 @@ server_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         gf_stat_from_iatt (&rsp.postparent, postparent);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 if (state->is_revalidate && op_errno == ENOENT) {
                         if (!__is_root_gfid (state->resolve.gfid)) {
@@ -193,7 +189,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_lookup_rsp);
+                             (xdrproc_t)xdr_gfs3_lookup_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -210,9 +206,6 @@ server_lk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, fop_log_level (GF_FOP_LK, op_errno),
@@ -248,7 +241,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_lk_rsp);
+                             (xdrproc_t)xdr_gfs3_lk_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -264,9 +257,6 @@ server_inodelk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -284,7 +274,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -300,9 +290,6 @@ server_finodelk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -321,7 +308,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -336,9 +323,6 @@ server_entrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -356,7 +340,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -372,9 +356,6 @@ server_fentrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t   *state     = NULL;
         rpcsvc_request_t *req       = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -392,7 +373,7 @@ out:
 
         req   = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -408,9 +389,6 @@ server_access_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -427,7 +405,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -444,9 +422,6 @@ server_rmdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *parent = NULL;
         rpcsvc_request_t    *req    = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret) {
@@ -479,7 +454,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_rmdir_rsp);
+                             (xdrproc_t)xdr_gfs3_rmdir_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -497,9 +472,6 @@ server_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *link_inode = NULL;
         rpcsvc_request_t    *req        = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -526,7 +498,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_mkdir_rsp);
+                             (xdrproc_t)xdr_gfs3_mkdir_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -544,9 +516,6 @@ server_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *link_inode = NULL;
         rpcsvc_request_t    *req        = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -573,7 +542,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_mknod_rsp);
+                             (xdrproc_t)xdr_gfs3_mknod_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -588,9 +557,6 @@ server_fsyncdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -607,7 +573,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -624,9 +590,6 @@ server_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         int                  ret   = 0;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -653,7 +616,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_readdir_rsp);
+                             (xdrproc_t)xdr_gfs3_readdir_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -672,9 +635,6 @@ server_opendir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         gfs3_opendir_rsp     rsp      = {0,};
         uint64_t             fd_no    = 0;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, fop_log_level (GF_FOP_OPENDIR, op_errno),
@@ -701,7 +661,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_opendir_rsp);
+                             (xdrproc_t)xdr_gfs3_opendir_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -716,9 +676,6 @@ server_removexattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -735,7 +692,7 @@ out:
 
         req   = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -750,9 +707,6 @@ server_fremovexattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -769,7 +723,7 @@ out:
 
         req   = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -785,9 +739,6 @@ server_getxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, fop_log_level (GF_FOP_GETXATTR, op_errno),
@@ -807,7 +758,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_getxattr_rsp);
+                             (xdrproc_t)xdr_gfs3_getxattr_rsp, xdata);
 
         GF_FREE (rsp.dict.dict_val);
 
@@ -826,9 +777,6 @@ server_fgetxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, fop_log_level (GF_FOP_FGETXATTR, op_errno),
@@ -849,7 +797,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_fgetxattr_rsp);
+                             (xdrproc_t)xdr_gfs3_fgetxattr_rsp, xdata);
 
         GF_FREE (rsp.dict.dict_val);
 
@@ -884,9 +832,6 @@ server_setxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t *req = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
                 if (op_errno != ENOTSUP)
@@ -906,7 +851,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -940,9 +885,6 @@ server_fsetxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t *req = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret == -1) {
                 state = CALL_STATE (frame);
                 if (op_errno != ENOTSUP) {
@@ -962,7 +904,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -984,9 +926,6 @@ server_rename_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         char         oldpar_str[50]     = {0,};
         char         newpar_str[50]     = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret == -1) {
@@ -1047,7 +986,7 @@ out:
 
         req   = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_rename_rsp);
+                             (xdrproc_t)xdr_gfs3_rename_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1064,9 +1003,6 @@ server_unlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *parent = NULL;
         rpcsvc_request_t    *req    = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret) {
@@ -1101,7 +1037,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_unlink_rsp);
+                             (xdrproc_t)xdr_gfs3_unlink_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1119,9 +1055,6 @@ server_symlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         inode_t             *link_inode = NULL;
         rpcsvc_request_t    *req        = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -1148,7 +1081,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_symlink_rsp);
+                             (xdrproc_t)xdr_gfs3_symlink_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1169,9 +1102,6 @@ server_link_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         char              gfid_str[50]   = {0,};
         char              newpar_str[50] = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret) {
@@ -1200,7 +1130,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_link_rsp);
+                             (xdrproc_t)xdr_gfs3_link_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1216,9 +1146,6 @@ server_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1237,7 +1164,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_truncate_rsp);
+                             (xdrproc_t)xdr_gfs3_truncate_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1253,9 +1180,6 @@ server_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1273,7 +1197,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_fstat_rsp);
+                             (xdrproc_t)xdr_gfs3_fstat_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1289,9 +1213,6 @@ server_ftruncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1310,7 +1231,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_ftruncate_rsp);
+                             (xdrproc_t)xdr_gfs3_ftruncate_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1325,9 +1246,6 @@ server_flush_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, fop_log_level (GF_FOP_FLUSH, op_errno),
@@ -1343,7 +1261,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1359,9 +1277,6 @@ server_fsync_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1380,7 +1295,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_fsync_rsp);
+                             (xdrproc_t)xdr_gfs3_fsync_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1396,9 +1311,6 @@ server_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1417,7 +1329,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_write_rsp);
+                             (xdrproc_t)xdr_gfs3_write_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1445,9 +1357,6 @@ server_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                                        "testing-xdata-value");
         }
 #endif
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1466,7 +1375,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, vector, count, iobref,
-                             (xdrproc_t)xdr_gfs3_read_rsp);
+                             (xdrproc_t)xdr_gfs3_read_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1483,9 +1392,6 @@ server_rchecksum_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         rpcsvc_request_t    *req   = NULL;
         server_state_t      *state = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1506,7 +1412,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_rchecksum_rsp);
+                             (xdrproc_t)xdr_gfs3_rchecksum_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1524,9 +1430,6 @@ server_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         uint64_t             fd_no    = 0;
         gfs3_open_rsp        rsp      = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, fop_log_level (GF_FOP_OPEN, op_errno),
@@ -1554,7 +1457,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_open_rsp);
+                             (xdrproc_t)xdr_gfs3_open_rsp, xdata);
         GF_FREE (rsp.xdata.xdata_val);
 
         return 0;
@@ -1574,9 +1477,6 @@ server_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         uint64_t             fd_no      = 0;
         gfs3_create_rsp      rsp        = {0,};
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         state = CALL_STATE (frame);
 
         if (op_ret < 0) {
@@ -1642,7 +1542,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_create_rsp);
+                             (xdrproc_t)xdr_gfs3_create_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1658,9 +1558,6 @@ server_readlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1683,7 +1580,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_readlink_rsp);
+                             (xdrproc_t)xdr_gfs3_readlink_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1699,9 +1596,6 @@ server_stat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state  = CALL_STATE (frame);
                 gf_log (this->name, fop_log_level (GF_FOP_STAT, op_errno),
@@ -1720,7 +1614,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_stat_rsp);
+                             (xdrproc_t)xdr_gfs3_stat_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1737,9 +1631,6 @@ server_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1759,7 +1650,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_setattr_rsp);
+                             (xdrproc_t)xdr_gfs3_setattr_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1775,9 +1666,6 @@ server_fsetattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state  = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1797,7 +1685,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_fsetattr_rsp);
+                             (xdrproc_t)xdr_gfs3_fsetattr_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1814,9 +1702,6 @@ server_xattrop_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1836,7 +1721,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_xattrop_rsp);
+                             (xdrproc_t)xdr_gfs3_xattrop_rsp, xdata);
 
         GF_FREE (rsp.dict.dict_val);
 
@@ -1855,9 +1740,6 @@ server_fxattrop_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t      *state = NULL;
         rpcsvc_request_t    *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1877,7 +1759,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_fxattrop_rsp);
+                             (xdrproc_t)xdr_gfs3_fxattrop_rsp, xdata);
 
         GF_FREE (rsp.dict.dict_val);
 
@@ -1899,9 +1781,6 @@ server_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         state = CALL_STATE (frame);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret < 0) {
                 state = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1930,7 +1809,7 @@ out:
 
         req = frame->local;
         server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gfs3_readdirp_rsp);
+                             (xdrproc_t)xdr_gfs3_readdirp_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1948,9 +1827,6 @@ server_fallocate_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t    *state = NULL;
         rpcsvc_request_t  *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state  = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -1970,7 +1846,7 @@ out:
 
         req = frame->local;
         server_submit_reply(frame, req, &rsp, NULL, 0, NULL,
-                            (xdrproc_t) xdr_gfs3_fallocate_rsp);
+                            (xdrproc_t) xdr_gfs3_fallocate_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -1986,9 +1862,6 @@ server_discard_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         server_state_t    *state = NULL;
         rpcsvc_request_t  *req   = NULL;
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, &rsp.xdata.xdata_val,
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 state  = CALL_STATE (frame);
                 gf_log (this->name, GF_LOG_INFO,
@@ -2008,7 +1881,7 @@ out:
 
         req = frame->local;
         server_submit_reply(frame, req, &rsp, NULL, 0, NULL,
-                            (xdrproc_t) xdr_gfs3_discard_rsp);
+                            (xdrproc_t) xdr_gfs3_discard_rsp, xdata);
 
         GF_FREE (rsp.xdata.xdata_val);
 
@@ -2027,9 +1900,6 @@ server_zerofill_cbk(call_frame_t *frame, void *cookie, xlator_t *this,
         req = frame->local;
         state  = CALL_STATE (frame);
 
-        GF_PROTOCOL_DICT_SERIALIZE (this, xdata, (&rsp.xdata.xdata_val),
-                                    rsp.xdata.xdata_len, op_errno, out);
-
         if (op_ret) {
                 gf_log (this->name, GF_LOG_INFO,
                         "%"PRId64": ZEROFILL%"PRId64" (%s) ==> (%s)",
@@ -2047,8 +1917,161 @@ out:
         rsp.op_errno  = gf_errno_to_error (op_errno);
 
         server_submit_reply(frame, req, &rsp, NULL, 0, NULL,
-                            (xdrproc_t) xdr_gfs3_zerofill_rsp);
+                            (xdrproc_t) xdr_gfs3_zerofill_rsp, xdata);
+
+        GF_FREE (rsp.xdata.xdata_val);
+
+        return 0;
+}
+
+/* Encodes the result of a member of a compound. */
+static void
+server_compound_pack (gfs3_compound_rsp_member *rsp,
+                      compound_fop_args_t *member,
+                      compound_fop_cbk_args_t *result)
+{
+        void          *u          = NULL;
+        int           *rsp_ret    = NULL;
+        int           *rsp_errno  = NULL;
+        char         **xattr_val  = NULL;
+        u_int         *xattr_len  = NULL;
+        char         **xdata_val  = NULL;
+        u_int         *xdata_len  = NULL;
+        int32_t        op_ret     = result->op_ret;
+        int32_t        op_errno   = result->op_errno;
+
+        rsp->op = gf_compound_op_from_fop (member->fop);
+        u = &rsp->gfs3_compound_rsp_member_u;
+
+        switch (rsp->op) {
+        case GFS3_COMPOUND_FXATTROP:
+        {
+                gfs3_fxattrop_rsp *fxattrop_rsp = u;
+
+                rsp_ret = &fxattrop_rsp->op_ret;
+                rsp_errno = &fxattrop_rsp->op_errno;
+                xattr_val = &fxattrop_rsp->dict.dict_val;
+                xattr_len = &fxattrop_rsp->dict.dict_len;
+                xdata_val = &fxattrop_rsp->xdata.xdata_val;
+                xdata_len = &fxattrop_rsp->xdata.xdata_len;
+                break;
+        }
+        case GFS3_COMPOUND_FINODELK:
+        {
+                gfs3_compound_lk_rsp *lk_rsp = u;
+
+                rsp_ret = &lk_rsp->op_ret;
+                rsp_errno = &lk_rsp->op_errno;
+                xdata_val = &lk_rsp->xdata.xdata_val;
+                xdata_len = &lk_rsp->xdata.xdata_len;
+                break;
+        }
+        default:
+                return;
+        }
+
+        if (op_ret >= 0 && xattr_val && result->xattr &&
+            dict_allocate_and_serialize (result->xattr, xattr_val,
+                                         xattr_len) < 0) {
+                op_ret = -1;
+                op_errno = EINVAL;
+        }
+
+        if (result->xdata)
+                dict_allocate_and_serialize (result->xdata, xdata_val,
+                                             xdata_len);
+
+        *rsp_ret = op_ret;
+        *rsp_errno = gf_errno_to_error (op_errno);
+}
+
+
+static void
+server_compound_rsp_cleanup (gfs3_compound_rsp *rsp)
+{
+        gfs3_compound_rsp_member *member = NULL;
+        void                     *u      = NULL;
+        int                       i      = 0;
+
+        if (!rsp->members.members_val)
+                return;
+
+        for (i = 0; i < rsp->members.members_len; i++) {
+                member = &rsp->members.members_val[i];
+                u = &member->gfs3_compound_rsp_member_u;
+
+                switch (member->op) {
+                case GFS3_COMPOUND_FXATTROP:
+                        GF_FREE (((gfs3_fxattrop_rsp *)u)->dict.dict_val);
+                        GF_FREE (((gfs3_fxattrop_rsp *)u)->xdata.xdata_val);
+                        break;
+                case GFS3_COMPOUND_FINODELK:
+                        GF_FREE (((gfs3_compound_lk_rsp *)u)->xdata.xdata_val);
+                        break;
+                }
+        }
+
+        GF_FREE (rsp->members.members_val);
+        rsp->members.members_val = NULL;
+        rsp->members.members_len = 0;
+}
+
+
+int
+server_compound_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno,
+                     compound_args_cbk_t *args_cbk, dict_t *xdata)
+{
+        gfs3_compound_rsp   rsp           = {0,};
+        server_state_t     *state         = NULL;
+        rpcsvc_request_t   *req           = NULL;
+        compound_args_t    *args          = NULL;
+        int                 i             = 0;
+
+        req = frame->local;
+        state = CALL_STATE (frame);
+        args = state->compound_args;
+
+        if (op_ret < 0) {
+                gf_log (this->name, GF_LOG_INFO,
+                        "%"PRId64": COMPOUND (%s) ==> (%s)",
+                        frame->root->unique,
+                        uuid_utoa (state->resolve.gfid),
+                        strerror (op_errno));
+                goto out;
+        }
+
+        if (!args_cbk || !args || args_cbk->count != args->count) {
+                op_ret = -1;
+                op_errno = EINVAL;
+                goto out;
+        }
+
+        rsp.members.members_val = GF_CALLOC (args->count,
+                                             sizeof (*rsp.members.members_val),
+                                             gf_server_mt_compound_rsp_t);
+        if (!rsp.members.members_val) {
+                op_ret = -1;
+                op_errno = ENOMEM;
+                goto out;
+        }
+        rsp.members.members_len = args->count;
+
+        for (i = 0; i < args->count; i++)
+                server_compound_pack (&rsp.members.members_val[i],
+                                      &args->fops[i], &args_cbk->fops[i]);
+
+out:
+        rsp.op_ret    = op_ret;
+        rsp.op_errno  = gf_errno_to_error (op_errno);
+
+        if (op_ret < 0)
+                server_compound_rsp_cleanup (&rsp);
 
+        server_submit_reply (frame, req, &rsp, NULL, 0, NULL,
+                             (xdrproc_t)xdr_gfs3_compound_rsp, xdata);
+
+        server_compound_rsp_cleanup (&rsp);
         GF_FREE (rsp.xdata.xdata_val);
 
         return 0;
@@ -3102,6 +3125,250 @@ err:
         return 0;
 }
 
+static int
+server_compound_dict (char *buf, u_int len, dict_t **dict)
+{
+        if (!len)
+                return 0;
+
+        *dict = dict_new ();
+        if (!*dict)
+                return -ENOMEM;
+
+        if (dict_unserialize (buf, len, dict) < 0)
+                return -EINVAL;
+
+        return 0;
+}
+
+
+/* the locks xlator tells the lock owners apart by connection, as for
+   the plain inodelk and finodelk */
+static int
+server_compound_set_connection_id (call_frame_t *frame, dict_t **xdata)
+{
+        int ret = 0;
+
+        if (!*xdata)
+                *xdata = dict_new ();
+        if (!*xdata)
+                return -ENOMEM;
+
+        ret = dict_set_str (*xdata, "connection-id",
+                            frame->root->client->client_uid);
+        if (ret) {
+                gf_log (frame->this->name, GF_LOG_WARNING,
+                        "failed to set connection-id of a compound lock");
+                return -ENOMEM;
+        }
+
+        return 0;
+}
+
+
+static int
+server_compound_lk (unsigned int gf_cmd, unsigned int gf_type,
+                    struct gf_proto_flock *proto_flock, int32_t *cmd,
+                    struct gf_flock *flock)
+{
+        switch (gf_cmd) {
+        case GF_LK_GETLK:
+                *cmd = F_GETLK;
+                break;
+        case GF_LK_SETLK:
+                *cmd = F_SETLK;
+                break;
+        case GF_LK_SETLKW:
+                *cmd = F_SETLKW;
+                break;
+        default:
+                return -EINVAL;
+        }
+
+        gf_proto_flock_to_flock (proto_flock, flock);
+
+        switch (gf_type) {
+        case GF_LK_F_RDLCK:
+                flock->l_type = F_RDLCK;
+                break;
+        case GF_LK_F_WRLCK:
+                flock->l_type = F_WRLCK;
+                break;
+        case GF_LK_F_UNLCK:
+                flock->l_type = F_UNLCK;
+                break;
+        }
+
+        return 0;
+}
+
+
+/* Turns the member @i of a compound request, whose inode or fd has just
+ * been resolved, into the arguments of its fop.
+ */
+static int
+server_compound_unpack (call_frame_t *frame, int i)
+{
+        server_state_t           *state  = NULL;
+        compound_args_t          *args   = NULL;
+        gfs3_compound_req_member *member = NULL;
+        dict_t                   *xattr  = NULL;
+        dict_t                   *xdata  = NULL;
+        struct gf_flock           flock  = {0,};
+        int32_t                   cmd    = 0;
+        int                       ret    = -EINVAL;
+
+        state = CALL_STATE (frame);
+        args = state->compound_args;
+        member = &state->compound_req->members.members_val[i];
+
+        switch (member->op) {
+        case GFS3_COMPOUND_FXATTROP:
+        {
+                gfs3_fxattrop_req *req =
+                        &member->gfs3_compound_req_member_u.fxattrop_req;
+
+                ret = server_compound_dict (req->dict.dict_val,
+                                            req->dict.dict_len, &xattr);
+                if (ret)
+                        break;
+
+                ret = server_compound_dict (req->xdata.xdata_val,
+                                            req->xdata.xdata_len, &xdata);
+                if (ret)
+                        break;
+
+                ret = compound_args_fxattrop (args, i, state->fd, req->flags,
+                                              xattr, xdata);
+                break;
+        }
+        case GFS3_COMPOUND_FINODELK:
+        {
+                gfs3_finodelk_req *req =
+                        &member->gfs3_compound_req_member_u.finodelk_req;
+
+                ret = server_compound_lk (req->cmd, req->type, &req->flock,
+                                          &cmd, &flock);
+                if (ret)
+                        break;
+
+                ret = server_compound_dict (req->xdata.xdata_val,
+                                            req->xdata.xdata_len, &xdata);
+                if (ret)
+                        break;
+
+                ret = server_compound_set_connection_id (frame, &xdata);
+                if (ret)
+                        break;
+
+                ret = compound_args_finodelk (args, i, req->volume,
+                                              state->fd, cmd, &flock, xdata);
+                break;
+        }
+        default:
+                break;
+        }
+
+        if (xattr)
+                dict_unref (xattr);
+        if (xdata)
+                dict_unref (xdata);
+
+        if (ret == -1)
+                ret = -ENOMEM;
+
+        return ret;
+}
+
+
+int
+server_compound_resume (call_frame_t *frame, xlator_t *bound_xl);
+
+/* Sets up the resolution of the inode or fd of the member @i of a compound.
+ * The members are resolved one after the other, each reusing the resolver
+ * of the state.
+ */
+static void
+server_compound_resolve (call_frame_t *frame, int i)
+{
+        server_state_t           *state  = NULL;
+        gfs3_compound_req_member *member = NULL;
+        void                     *u      = NULL;
+        int64_t                   fd_no  = -1;
+
+        state = CALL_STATE (frame);
+        member = &state->compound_req->members.members_val[i];
+        u = &member->gfs3_compound_req_member_u;
+
+        if (state->fd) {
+                fd_unref (state->fd);
+                state->fd = NULL;
+        }
+        server_loc_wipe (&state->loc);
+        server_resolve_wipe (&state->resolve);
+        memset (&state->resolve, 0, sizeof (state->resolve));
+
+        state->resolve_now = NULL;
+        state->loc_now = NULL;
+        state->compound_next = i;
+
+        switch (member->op) {
+        case GFS3_COMPOUND_FXATTROP:
+                memcpy (state->resolve.gfid, ((gfs3_fxattrop_req *)u)->gfid,
+                        16);
+                fd_no = ((gfs3_fxattrop_req *)u)->fd;
+                break;
+        case GFS3_COMPOUND_FINODELK:
+                memcpy (state->resolve.gfid, ((gfs3_finodelk_req *)u)->gfid,
+                        16);
+                fd_no = ((gfs3_finodelk_req *)u)->fd;
+                break;
+        default:
+                break;
+        }
+
+        state->resolve.type = RESOLVE_MUST;
+        state->resolve.fd_no = fd_no;
+
+        resolve_and_resume (frame, server_compound_resume);
+}
+
+
+int
+server_compound_resume (call_frame_t *frame, xlator_t *bound_xl)
+{
+        server_state_t *state    = NULL;
+        int             op_errno = 0;
+        int             ret      = 0;
+
+        state = CALL_STATE (frame);
+
+        if (state->resolve.op_ret != 0) {
+                op_errno = state->resolve.op_errno;
+                goto err;
+        }
+
+        ret = server_compound_unpack (frame, state->compound_next);
+        if (ret) {
+                op_errno = -ret;
+                goto err;
+        }
+
+        if (state->compound_next + 1 < state->compound_args->count) {
+                server_compound_resolve (frame, state->compound_next + 1);
+                return 0;
+        }
+
+        STACK_WIND (frame, server_compound_cbk,
+                    bound_xl, bound_xl->fops->compound,
+                    state->compound_args, state->xdata);
+        return 0;
+err:
+        server_compound_cbk (frame, NULL, frame->this, -1, op_errno,
+                             NULL, NULL);
+        return 0;
+}
+
 
 
 /* Fop section */
@@ -3120,7 +3387,7 @@ server3_3_stat (rpcsvc_request_t *req)
 
         /* Initialize args first, then decode */
 
-        ret = xdr_to_generic (req->msg[0], &args, (xdrproc_t)xdr_gfs3_stat_req);
+        ret = xdrf_to_gfs3_stat_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3144,19 +3411,18 @@ server3_3_stat (rpcsvc_request_t *req)
         state->resolve.type  = RESOLVE_MUST;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
 
         ret = 0;
         resolve_and_resume (frame, server_stat_resume);
 
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3176,8 +3442,7 @@ server3_3_setattr (rpcsvc_request_t *req)
         if (!req)
                 return 0;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_setattr_req);
+        ret = xdrf_to_gfs3_setattr_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3205,11 +3470,12 @@ server3_3_setattr (rpcsvc_request_t *req)
         gf_stat_to_iatt (&args.stbuf, &state->stbuf);
         state->valid = args.valid;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_setattr_resume);
@@ -3218,8 +3484,6 @@ out:
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
-        free (args.xdata.xdata_val);
-
         return ret;
 }
 
@@ -3236,8 +3500,7 @@ server3_3_fsetattr (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fsetattr_req);
+        ret = xdrf_to_gfs3_fsetattr_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3264,18 +3527,17 @@ server3_3_fsetattr (rpcsvc_request_t *req)
         gf_stat_to_iatt (&args.stbuf, &state->stbuf);
         state->valid = args.valid;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fsetattr_resume);
 
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3294,8 +3556,7 @@ server3_3_fallocate(rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fallocate_req);
+        ret = xdrf_to_gfs3_fallocate_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3325,18 +3586,17 @@ server3_3_fallocate(rpcsvc_request_t *req)
         state->size = args.size;
         memcpy(state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fallocate_resume);
 
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3356,8 +3616,7 @@ server3_3_discard(rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_discard_req);
+        ret = xdrf_to_gfs3_discard_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3386,18 +3645,17 @@ server3_3_discard(rpcsvc_request_t *req)
         state->size = args.size;
         memcpy(state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_discard_resume);
 
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3417,8 +3675,7 @@ server3_3_zerofill(rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_zerofill_req);
+        ret = xdrf_to_gfs3_zerofill_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 /*failed to decode msg*/;
                 req->rpc_err = GARBAGE_ARGS;
@@ -3447,16 +3704,99 @@ server3_3_zerofill(rpcsvc_request_t *req)
         state->size = args.size;
         memcpy(state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl, state->xdata,
-                                      (args.xdata.xdata_val),
-                                      (args.xdata.xdata_len), ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               (args.xdata.xdata_val),
+                                               (args.xdata.xdata_len),
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_zerofill_resume);
 
 out:
-        free (args.xdata.xdata_val);
+        if (op_errno)
+                req->rpc_err = GARBAGE_ARGS;
+
+        return ret;
+}
+
+int
+server3_3_compound (rpcsvc_request_t *req)
+{
+        server_state_t       *state      = NULL;
+        call_frame_t         *frame      = NULL;
+        gfs3_compound_req    *args       = NULL;
+        gfs3_compound_req    *creq       = NULL;
+        int                   ret        = -1;
+        int                   op_errno   = 0;
+
+        if (!req)
+                return ret;
+
+        args = GF_CALLOC (1, sizeof (*args), gf_server_mt_compound_req_t);
+        if (!args) {
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        ret = xdr_to_generic (req->msg[0], args,
+                              (xdrproc_t)xdr_gfs3_compound_req);
+        if (ret < 0) {
+                /*failed to decode msg*/;
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        if (args->members.members_len == 0 ||
+            args->members.members_len > GF_COMPOUND_MAX_FOPS) {
+                req->rpc_err = GARBAGE_ARGS;
+                ret = -1;
+                goto out;
+        }
+
+        frame = get_frame_from_request (req);
+        if (!frame) {
+                /* something wrong, mostly insufficient memory*/
+                req->rpc_err = GARBAGE_ARGS; /* TODO */
+                ret = -1;
+                goto out;
+        }
+        frame->root->op = GF_FOP_COMPOUND;
+
+        state = CALL_STATE (frame);
+        if (!frame->root->client->bound_xl) {
+                /* auth failure, request on subvolume without setvolume */
+                req->rpc_err = GARBAGE_ARGS;
+                ret = -1;
+                goto out;
+        }
+
+        creq = state->compound_req = args;
+        args = NULL;
+
+        state->compound_args = compound_args_new (creq->members.members_len);
+        if (!state->compound_args) {
+                req->rpc_err = GARBAGE_ARGS;
+                ret = -1;
+                goto out;
+        }
+
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               (creq->xdata.xdata_val),
+                                               (creq->xdata.xdata_len),
+                                               req->iobref, ret,
+                                               op_errno, out);
+
+        ret = 0;
+        server_compound_resolve (frame, 0);
+
+out:
+        if (args) {
+                xdr_free ((xdrproc_t)xdr_gfs3_compound_req, (char *)args);
+                GF_FREE (args);
+        }
 
         if (op_errno)
                 req->rpc_err = GARBAGE_ARGS;
@@ -3476,8 +3816,7 @@ server3_3_readlink (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_readlink_req);
+        ret = xdrf_to_gfs3_readlink_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3504,18 +3843,17 @@ server3_3_readlink (rpcsvc_request_t *req)
 
         state->size  = args.size;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_readlink_resume);
 
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3529,16 +3867,18 @@ server3_3_create (rpcsvc_request_t *req)
         server_state_t  *state    = NULL;
         call_frame_t    *frame    = NULL;
         gfs3_create_req  args     = {{0,},};
+        char            *arena    = NULL;
+        size_t           arena_len = 0;
         int              ret      = -1;
         int              op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.bname = alloca (req->msg[0].iov_len);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_create_req);
+        ret = xdrf_to_gfs3_create_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3573,20 +3913,17 @@ server3_3_create (rpcsvc_request_t *req)
                 state->resolve.type = RESOLVE_DONTCARE;
         }
 
-        /* TODO: can do alloca for xdata field instead of stdalloc */
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_create_resume);
 
 out:
-        /* memory allocated by libc, don't use GF_FREE */
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3606,7 +3943,7 @@ server3_3_open (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args, (xdrproc_t)xdr_gfs3_open_req);
+        ret = xdrf_to_gfs3_open_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3633,11 +3970,12 @@ server3_3_open (rpcsvc_request_t *req)
 
         state->flags = gf_flags_to_flags (args.flags);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_open_resume);
@@ -3645,8 +3983,6 @@ out:
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
-        free (args.xdata.xdata_val);
-
         return ret;
 }
 
@@ -3663,7 +3999,7 @@ server3_3_readv (rpcsvc_request_t *req)
         if (!req)
                 goto out;
 
-        ret = xdr_to_generic (req->msg[0], &args, (xdrproc_t)xdr_gfs3_read_req);
+        ret = xdrf_to_gfs3_read_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3693,18 +4029,16 @@ server3_3_readv (rpcsvc_request_t *req)
 
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_readv_resume);
 out:
-        /* memory allocated by libc, don't use GF_FREE */
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3726,8 +4060,8 @@ server3_3_writev (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        len = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_write_req);
+        /* the xdata is left in the message, the dict borrows from it */
+        len = xdrf_to_gfs3_write_req (req->msg[0], &args, NULL, 0);
         if (len < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3774,11 +4108,12 @@ server3_3_writev (rpcsvc_request_t *req)
                 state->size += state->payload_vector[i].iov_len;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
 #ifdef GF_TESTING_IO_XDATA
         dict_dump (state->xdata);
@@ -3787,8 +4122,6 @@ server3_3_writev (rpcsvc_request_t *req)
         ret = 0;
         resolve_and_resume (frame, server_writev_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -3862,8 +4195,7 @@ server3_3_release (rpcsvc_request_t *req)
         gf_common_rsp     rsp      = {0,};
         int               ret      = -1;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_release_req);
+        ret = xdrf_to_gfs3_release_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3888,7 +4220,7 @@ server3_3_release (rpcsvc_request_t *req)
         gf_fd_put (serv_ctx->fdtable, args.fd);
 
         server_submit_reply (NULL, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, NULL);
 
         ret = 0;
 out:
@@ -3904,8 +4236,7 @@ server3_3_releasedir (rpcsvc_request_t *req)
         gf_common_rsp        rsp      = {0,};
         int                  ret      = -1;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_release_req);
+        ret = xdrf_to_gfs3_releasedir_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3929,7 +4260,7 @@ server3_3_releasedir (rpcsvc_request_t *req)
         gf_fd_put (serv_ctx->fdtable, args.fd);
 
         server_submit_reply (NULL, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, NULL);
 
         ret = 0;
 out:
@@ -3949,8 +4280,7 @@ server3_3_fsync (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fsync_req);
+        ret = xdrf_to_gfs3_fsync_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -3977,17 +4307,16 @@ server3_3_fsync (rpcsvc_request_t *req)
         state->flags         = args.data;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fsync_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4008,8 +4337,7 @@ server3_3_flush (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_flush_req);
+        ret = xdrf_to_gfs3_flush_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4035,17 +4363,16 @@ server3_3_flush (rpcsvc_request_t *req)
         state->resolve.fd_no = args.fd;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_flush_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4066,8 +4393,7 @@ server3_3_ftruncate (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_ftruncate_req);
+        ret = xdrf_to_gfs3_ftruncate_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4094,17 +4420,16 @@ server3_3_ftruncate (rpcsvc_request_t *req)
         state->offset         = args.offset;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_ftruncate_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4124,8 +4449,7 @@ server3_3_fstat (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fstat_req);
+        ret = xdrf_to_gfs3_fstat_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4151,17 +4475,16 @@ server3_3_fstat (rpcsvc_request_t *req)
         state->resolve.fd_no   = args.fd;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fstat_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4181,8 +4504,7 @@ server3_3_truncate (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_truncate_req);
+        ret = xdrf_to_gfs3_truncate_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4208,17 +4530,16 @@ server3_3_truncate (rpcsvc_request_t *req)
         memcpy (state->resolve.gfid, args.gfid, 16);
         state->offset        = args.offset;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_truncate_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4233,16 +4554,18 @@ server3_3_unlink (rpcsvc_request_t *req)
         server_state_t  *state                  = NULL;
         call_frame_t    *frame                  = NULL;
         gfs3_unlink_req  args                   = {{0,},};
+        char            *arena                  = NULL;
+        size_t           arena_len              = 0;
         int              ret                    = -1;
         int              op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.bname = alloca (req->msg[0].iov_len);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_unlink_req);
+        ret = xdrf_to_gfs3_unlink_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4270,17 +4593,16 @@ server3_3_unlink (rpcsvc_request_t *req)
 
         state->flags = args.xflags;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_unlink_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4303,8 +4625,7 @@ server3_3_setxattr (rpcsvc_request_t *req)
 
         args.dict.dict_val = alloca (req->msg[0].iov_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_setxattr_req);
+        ret = xdrf_to_gfs3_setxattr_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4341,19 +4662,18 @@ server3_3_setxattr (rpcsvc_request_t *req)
         /* There can be some commands hidden in key, check and proceed */
         gf_server_check_setxattr_cmd (frame, dict);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_setxattr_resume);
 
         return ret;
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4379,8 +4699,7 @@ server3_3_fsetxattr (rpcsvc_request_t *req)
                 return ret;
 
         args.dict.dict_val = alloca (req->msg[0].iov_len);
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fsetxattr_req);
+        ret = xdrf_to_gfs3_fsetxattr_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4415,19 +4734,18 @@ server3_3_fsetxattr (rpcsvc_request_t *req)
 
         state->dict = dict;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fsetxattr_resume);
 
         return ret;
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4453,8 +4771,7 @@ server3_3_fxattrop (rpcsvc_request_t *req)
                 return ret;
 
         args.dict.dict_val = alloca (req->msg[0].iov_len);
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fxattrop_req);
+        ret = xdrf_to_gfs3_fxattrop_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4489,11 +4806,12 @@ server3_3_fxattrop (rpcsvc_request_t *req)
 
         state->dict = dict;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fxattrop_resume);
@@ -4501,8 +4819,6 @@ server3_3_fxattrop (rpcsvc_request_t *req)
         return ret;
 
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4529,8 +4845,7 @@ server3_3_xattrop (rpcsvc_request_t *req)
 
         args.dict.dict_val = alloca (req->msg[0].iov_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_xattrop_req);
+        ret = xdrf_to_gfs3_xattrop_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4564,19 +4879,18 @@ server3_3_xattrop (rpcsvc_request_t *req)
 
         state->dict = dict;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_xattrop_resume);
 
         return ret;
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4593,16 +4907,18 @@ server3_3_getxattr (rpcsvc_request_t *req)
         server_state_t      *state                 = NULL;
         call_frame_t        *frame                 = NULL;
         gfs3_getxattr_req    args                  = {{0,},};
+        char                *arena                 = NULL;
+        size_t               arena_len             = 0;
         int                  ret                   = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.name = alloca (256);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_getxattr_req);
+        ret = xdrf_to_gfs3_getxattr_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4633,17 +4949,16 @@ server3_3_getxattr (rpcsvc_request_t *req)
                 gf_server_check_getxattr_cmd (frame, state->name);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_getxattr_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4657,15 +4972,18 @@ server3_3_fgetxattr (rpcsvc_request_t *req)
         server_state_t      *state      = NULL;
         call_frame_t        *frame      = NULL;
         gfs3_fgetxattr_req   args       = {{0,},};
+        char                *arena      = NULL;
+        size_t               arena_len  = 0;
         int                  ret        = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.name = alloca (256);
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fgetxattr_req);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
+
+        ret = xdrf_to_gfs3_fgetxattr_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4694,17 +5012,16 @@ server3_3_fgetxattr (rpcsvc_request_t *req)
         if (args.namelen)
                 state->name = gf_strdup (args.name);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fgetxattr_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4719,16 +5036,19 @@ server3_3_removexattr (rpcsvc_request_t *req)
         server_state_t       *state                 = NULL;
         call_frame_t         *frame                 = NULL;
         gfs3_removexattr_req  args                  = {{0,},};
+        char                 *arena                 = NULL;
+        size_t                arena_len             = 0;
         int                   ret                   = -1;
         int                   op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.name = alloca (256);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_removexattr_req);
+        ret = xdrf_to_gfs3_removexattr_req (req->msg[0], &args, arena,
+                                            arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4754,17 +5074,16 @@ server3_3_removexattr (rpcsvc_request_t *req)
         memcpy (state->resolve.gfid, args.gfid, 16);
         state->name           = gf_strdup (args.name);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_removexattr_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4777,16 +5096,19 @@ server3_3_fremovexattr (rpcsvc_request_t *req)
         server_state_t       *state                 = NULL;
         call_frame_t         *frame                 = NULL;
         gfs3_fremovexattr_req  args                  = {{0,},};
+        char                  *arena                 = NULL;
+        size_t                 arena_len             = 0;
         int                   ret                   = -1;
         int                   op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.name = alloca (4096);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fremovexattr_req);
+        ret = xdrf_to_gfs3_fremovexattr_req (req->msg[0], &args, arena,
+                                             arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4813,17 +5135,16 @@ server3_3_fremovexattr (rpcsvc_request_t *req)
         memcpy (state->resolve.gfid, args.gfid, 16);
         state->name           = gf_strdup (args.name);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fremovexattr_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4845,8 +5166,7 @@ server3_3_opendir (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_opendir_req);
+        ret = xdrf_to_gfs3_opendir_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4871,17 +5191,16 @@ server3_3_opendir (rpcsvc_request_t *req)
         state->resolve.type   = RESOLVE_MUST;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_opendir_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -4902,8 +5221,7 @@ server3_3_readdirp (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_readdirp_req);
+        ret = xdrf_to_gfs3_readdirp_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -4942,11 +5260,12 @@ server3_3_readdirp (rpcsvc_request_t *req)
         memcpy (state->resolve.gfid, args.gfid, 16);
 
         /* here, dict itself works as xdata */
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->dict,
-                                      (args.dict.dict_val),
-                                      (args.dict.dict_len), ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->dict,
+                                               (args.dict.dict_val),
+                                               (args.dict.dict_len),
+                                               req->iobref, ret,
+                                               op_errno, out);
 
 
         ret = 0;
@@ -4955,8 +5274,6 @@ out:
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
-        free (args.dict.dict_val);
-
         return ret;
 }
 
@@ -4973,8 +5290,7 @@ server3_3_readdir (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_readdir_req);
+        ret = xdrf_to_gfs3_readdir_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5012,17 +5328,16 @@ server3_3_readdir (rpcsvc_request_t *req)
         state->offset = args.offset;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_readdir_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5041,8 +5356,7 @@ server3_3_fsyncdir (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fsyncdir_req);
+        ret = xdrf_to_gfs3_fsyncdir_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5069,17 +5383,16 @@ server3_3_fsyncdir (rpcsvc_request_t *req)
         state->flags = args.data;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fsyncdir_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5094,16 +5407,18 @@ server3_3_mknod (rpcsvc_request_t *req)
         server_state_t      *state                  = NULL;
         call_frame_t        *frame                  = NULL;
         gfs3_mknod_req       args                   = {{0,},};
+        char                *arena                  = NULL;
+        size_t               arena_len              = 0;
         int                  ret                    = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.bname = alloca (req->msg[0].iov_len);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_mknod_req);
+        ret = xdrf_to_gfs3_mknod_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5133,11 +5448,12 @@ server3_3_mknod (rpcsvc_request_t *req)
         state->dev   = args.dev;
         state->umask = args.umask;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_mknod_resume);
@@ -5146,9 +5462,6 @@ out:
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
-        /* memory allocated by libc, don't use GF_FREE */
-        free (args.xdata.xdata_val);
-
         return ret;
 
 }
@@ -5160,16 +5473,18 @@ server3_3_mkdir (rpcsvc_request_t *req)
         server_state_t      *state                  = NULL;
         call_frame_t        *frame                  = NULL;
         gfs3_mkdir_req       args                   = {{0,},};
+        char                *arena                  = NULL;
+        size_t               arena_len              = 0;
         int                  ret                    = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.bname = alloca (req->msg[0].iov_len);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_mkdir_req);
+        ret = xdrf_to_gfs3_mkdir_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5198,12 +5513,12 @@ server3_3_mkdir (rpcsvc_request_t *req)
         state->mode  = args.mode;
         state->umask = args.umask;
 
-        /* TODO: can do alloca for xdata field instead of stdalloc */
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_mkdir_resume);
@@ -5212,8 +5527,6 @@ out:
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
-        free (args.xdata.xdata_val);
-
         return ret;
 }
 
@@ -5224,16 +5537,18 @@ server3_3_rmdir (rpcsvc_request_t *req)
         server_state_t      *state                  = NULL;
         call_frame_t        *frame                  = NULL;
         gfs3_rmdir_req       args                   = {{0,},};
+        char                *arena                  = NULL;
+        size_t               arena_len              = 0;
         int                  ret                    = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.bname = alloca (req->msg[0].iov_len);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_rmdir_req);
+        ret = xdrf_to_gfs3_rmdir_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5261,17 +5576,16 @@ server3_3_rmdir (rpcsvc_request_t *req)
 
         state->flags = args.xflags;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_rmdir_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5286,6 +5600,8 @@ server3_3_inodelk (rpcsvc_request_t *req)
         server_state_t      *state                 = NULL;
         call_frame_t        *frame                 = NULL;
         gfs3_inodelk_req     args                  = {{0,},};
+        char                *arena                 = NULL;
+        size_t               arena_len             = 0;
         int                  cmd                   = 0;
         int                  ret                   = -1;
         int                  op_errno = 0;
@@ -5293,10 +5609,10 @@ server3_3_inodelk (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        args.volume = alloca (256);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_inodelk_req);
+        ret = xdrf_to_gfs3_inodelk_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5351,19 +5667,16 @@ server3_3_inodelk (rpcsvc_request_t *req)
                 break;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_inodelk_resume);
 out:
-        free (args.xdata.xdata_val);
-
-        free (args.flock.lk_owner.lk_owner_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5376,15 +5689,18 @@ server3_3_finodelk (rpcsvc_request_t *req)
         server_state_t      *state        = NULL;
         call_frame_t        *frame        = NULL;
         gfs3_finodelk_req    args         = {{0,},};
+        char                *arena        = NULL;
+        size_t               arena_len    = 0;
         int                  ret          = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.volume = alloca (256);
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_finodelk_req);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
+
+        ret = xdrf_to_gfs3_finodelk_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5440,19 +5756,16 @@ server3_3_finodelk (rpcsvc_request_t *req)
                 break;
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_finodelk_resume);
 out:
-        free (args.xdata.xdata_val);
-
-        free (args.flock.lk_owner.lk_owner_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5466,17 +5779,18 @@ server3_3_entrylk (rpcsvc_request_t *req)
         server_state_t      *state                 = NULL;
         call_frame_t        *frame                 = NULL;
         gfs3_entrylk_req     args                  = {{0,},};
+        char                *arena                 = NULL;
+        size_t               arena_len             = 0;
         int                  ret                   = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.volume = alloca (256);
-        args.name   = alloca (256);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_entrylk_req);
+        ret = xdrf_to_gfs3_entrylk_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5508,17 +5822,16 @@ server3_3_entrylk (rpcsvc_request_t *req)
         state->cmd            = args.cmd;
         state->type           = args.type;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_entrylk_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5531,17 +5844,18 @@ server3_3_fentrylk (rpcsvc_request_t *req)
         server_state_t      *state        = NULL;
         call_frame_t        *frame        = NULL;
         gfs3_fentrylk_req    args         = {{0,},};
+        char                *arena        = NULL;
+        size_t               arena_len    = 0;
         int                  ret          = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.name   = alloca (256);
-        args.volume = alloca (256);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_fentrylk_req);
+        ret = xdrf_to_gfs3_fentrylk_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5573,17 +5887,16 @@ server3_3_fentrylk (rpcsvc_request_t *req)
                 state->name = gf_strdup (args.name);
         state->volume = gf_strdup (args.volume);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_fentrylk_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5602,8 +5915,7 @@ server3_3_access (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_access_req);
+        ret = xdrf_to_gfs3_access_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5629,17 +5941,16 @@ server3_3_access (rpcsvc_request_t *req)
         memcpy (state->resolve.gfid, args.gfid, 16);
         state->mask          = args.mask;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_access_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5654,17 +5965,18 @@ server3_3_symlink (rpcsvc_request_t *req)
         server_state_t      *state                 = NULL;
         call_frame_t        *frame                 = NULL;
         gfs3_symlink_req     args                  = {{0,},};
+        char                *arena                 = NULL;
+        size_t               arena_len             = 0;
         int                  ret                   = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.bname    = alloca (req->msg[0].iov_len);
-        args.linkname = alloca (4096);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_symlink_req);
+        ret = xdrf_to_gfs3_symlink_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5692,11 +6004,12 @@ server3_3_symlink (rpcsvc_request_t *req)
         state->name           = gf_strdup (args.linkname);
         state->umask          = args.umask;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_symlink_resume);
@@ -5705,9 +6018,6 @@ out:
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
-        /* memory allocated by libc, don't use GF_FREE */
-        free (args.xdata.xdata_val);
-
         return ret;
 }
 
@@ -5719,15 +6029,18 @@ server3_3_link (rpcsvc_request_t *req)
         server_state_t      *state                     = NULL;
         call_frame_t        *frame                     = NULL;
         gfs3_link_req        args                      = {{0,},};
+        char                *arena                     = NULL;
+        size_t               arena_len                 = 0;
         int                  ret                       = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.newbname = alloca (req->msg[0].iov_len);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args, (xdrproc_t)xdr_gfs3_link_req);
+        ret = xdrf_to_gfs3_link_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5756,17 +6069,16 @@ server3_3_link (rpcsvc_request_t *req)
         state->resolve2.bname  = gf_strdup (args.newbname);
         memcpy (state->resolve2.pargfid, args.newgfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_link_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5780,17 +6092,18 @@ server3_3_rename (rpcsvc_request_t *req)
         server_state_t      *state                     = NULL;
         call_frame_t        *frame                     = NULL;
         gfs3_rename_req      args                      = {{0,},};
+        char                *arena                     = NULL;
+        size_t               arena_len                 = 0;
         int                  ret                       = -1;
         int                  op_errno = 0;
 
         if (!req)
                 return ret;
 
-        args.oldbname = alloca (req->msg[0].iov_len);
-        args.newbname = alloca (req->msg[0].iov_len);
+        arena_len = req->msg[0].iov_len + 16;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_rename_req);
+        ret = xdrf_to_gfs3_rename_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5820,17 +6133,16 @@ server3_3_rename (rpcsvc_request_t *req)
         state->resolve2.bname = gf_strdup (args.newbname);
         memcpy (state->resolve2.pargfid, args.newgfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_rename_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5849,7 +6161,7 @@ server3_3_lk (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args, (xdrproc_t)xdr_gfs3_lk_req);
+        ret = xdrf_to_gfs3_lk_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5923,19 +6235,16 @@ server3_3_lk (rpcsvc_request_t *req)
         }
 
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_lk_resume);
 out:
-        free (args.xdata.xdata_val);
-
-        free (args.flock.lk_owner.lk_owner_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -5955,8 +6264,7 @@ server3_3_rchecksum (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_rchecksum_req);
+        ret = xdrf_to_gfs3_rchecksum_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -5983,17 +6291,16 @@ server3_3_rchecksum (rpcsvc_request_t *req)
         state->offset        = args.offset;
         state->size          = args.len;
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_rchecksum_resume);
 out:
-        free (args.xdata.xdata_val);
-
         if (op_errno)
                 SERVER_REQ_SET_ERROR (req, ret);
 
@@ -6009,7 +6316,7 @@ server_null (rpcsvc_request_t *req)
         rsp.op_ret = 0;
 
         server_submit_reply (NULL, req, &rsp, NULL, 0, NULL,
-                             (xdrproc_t)xdr_gf_common_rsp);
+                             (xdrproc_t)xdr_gf_common_rsp, NULL);
 
         return 0;
 }
@@ -6017,19 +6324,21 @@ server_null (rpcsvc_request_t *req)
 int
 server3_3_lookup (rpcsvc_request_t *req)
 {
-        call_frame_t        *frame    = NULL;
-        server_state_t      *state    = NULL;
-        gfs3_lookup_req      args     = {{0,},};
-        int                  ret      = -1;
-        int                  op_errno = 0;
+        call_frame_t        *frame     = NULL;
+        server_state_t      *state     = NULL;
+        gfs3_lookup_req      args      = {{0,},};
+        char                *arena     = NULL;
+        size_t               arena_len = 0;
+        int                  ret       = -1;
+        int                  op_errno  = 0;
 
         GF_VALIDATE_OR_GOTO ("server", req, err);
 
-        args.bname           = alloca (req->msg[0].iov_len);
-        args.xdata.xdata_val = alloca (req->msg[0].iov_len);
+        /* bname is copied to the stack, the xdata is left in the message */
+        arena_len = req->msg[0].iov_len + 8;
+        arena     = alloca (arena_len);
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_lookup_req);
+        ret = xdrf_to_gfs3_lookup_req (req->msg[0], &args, arena, arena_len);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -6064,11 +6373,12 @@ server3_3_lookup (rpcsvc_request_t *req)
                 memcpy (state->resolve.gfid, args.gfid, 16);
         }
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_lookup_resume);
@@ -6095,8 +6405,7 @@ server3_3_statfs (rpcsvc_request_t *req)
         if (!req)
                 return ret;
 
-        ret = xdr_to_generic (req->msg[0], &args,
-                              (xdrproc_t)xdr_gfs3_statfs_req);
+        ret = xdrf_to_gfs3_statfs_req (req->msg[0], &args, NULL, 0);
         if (ret < 0) {
                 //failed to decode msg;
                 SERVER_REQ_SET_ERROR (req, ret);
@@ -6121,11 +6430,12 @@ server3_3_statfs (rpcsvc_request_t *req)
         state->resolve.type   = RESOLVE_MUST;
         memcpy (state->resolve.gfid, args.gfid, 16);
 
-        GF_PROTOCOL_DICT_UNSERIALIZE (frame->root->client->bound_xl,
-                                      state->xdata,
-                                      args.xdata.xdata_val,
-                                      args.xdata.xdata_len, ret,
-                                      op_errno, out);
+        GF_PROTOCOL_DICT_UNSERIALIZE_BORROWED (frame->root->client->bound_xl,
+                                               state->xdata,
+                                               args.xdata.xdata_val,
+                                               args.xdata.xdata_len,
+                                               req->iobref, ret,
+                                               op_errno, out);
 
         ret = 0;
         resolve_and_resume (frame, server_statfs_resume);
@@ -6185,6 +6495,7 @@ rpcsvc_actor_t glusterfs3_3_fop_actors[GLUSTER_FOP_PROCCNT] = {
         [GFS3_OP_FALLOCATE]    = {"FALLOCATE",    GFS3_OP_FALLOCATE,    server3_3_fallocate,    NULL, 0, DRC_NA},
         [GFS3_OP_DISCARD]      = {"DISCARD",      GFS3_OP_DISCARD,      server3_3_discard,      NULL, 0, DRC_NA},
         [GFS3_OP_ZEROFILL]    =  {"ZEROFILL",     GFS3_OP_ZEROFILL,     server3_3_zerofill,     NULL, 0, DRC_NA},
+        [GFS3_OP_COMPOUND]    =  {"COMPOUND",     GFS3_OP_COMPOUND,     server3_3_compound,     NULL, 0, DRC_NA},
 };
 
 
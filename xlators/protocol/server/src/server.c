@@ -82,7 +82,7 @@ out:
 
 struct iobuf *
 gfs_serialize_reply (rpcsvc_request_t *req, void *arg, struct iovec *outmsg,
-                     xdrproc_t xdrproc)
+                     xdrproc_t xdrproc, dict_t *xdata)
 {
         struct iobuf *iob      = NULL;
         ssize_t       retlen   = 0;
@@ -94,7 +94,15 @@ gfs_serialize_reply (rpcsvc_request_t *req, void *arg, struct iovec *outmsg,
          * be serialized.
          */
         if (arg && xdrproc) {
-                xdr_size = xdr_sizeof (xdrproc, arg);
+                xdr_size = xdr_sizeof_xdata (xdrproc, arg, xdata);
+                if (xdr_size < 0) {
+                        gf_log_callingfn (THIS->name, GF_LOG_WARNING,
+                                          "failed to get serialized length of "
+                                          "xdata, replying without it");
+                        xdata = NULL;
+                        xdr_size = xdr_sizeof (xdrproc, arg);
+                }
+
                 iob = iobuf_get2 (req->svc->ctx->iobuf_pool, xdr_size);
                 if (!iob) {
                         gf_log_callingfn (THIS->name, GF_LOG_ERROR,
@@ -110,7 +118,16 @@ gfs_serialize_reply (rpcsvc_request_t *req, void *arg, struct iovec *outmsg,
                  * need -1 for error notification during encoding.
                  */
 
-                retlen = xdr_serialize_generic (*outmsg, arg, xdrproc);
+                retlen = xdr_serialize_generic_xdata (*outmsg, arg, xdrproc,
+                                                      xdata);
+                if (retlen == -1 && xdata) {
+                        /* the dict changed size under us; the reply itself
+                           is still good without it */
+                        gf_log_callingfn (THIS->name, GF_LOG_WARNING,
+                                          "failed to serialize xdata, "
+                                          "replying without it");
+                        retlen = xdr_serialize_generic (*outmsg, arg, xdrproc);
+                }
                 if (retlen == -1) {
                         /* Failed to Encode 'GlusterFS' msg in RPC is not exactly
                            failure of RPC return values.. client should get
@@ -133,7 +150,7 @@ ret:
 int
 server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
                      struct iovec *payload, int payloadcount,
-                     struct iobref *iobref, xdrproc_t xdrproc)
+                     struct iobref *iobref, xdrproc_t xdrproc, dict_t *xdata)
 {
         struct iobuf           *iob        = NULL;
         int                     ret        = -1;
@@ -164,7 +181,7 @@ server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
                 new_iobref = 1;
         }
 
-        iob = gfs_serialize_reply (req, arg, &rsp, xdrproc);
+        iob = gfs_serialize_reply (req, arg, &rsp, xdrproc, xdata);
         if (!iob) {
                 gf_log ("", GF_LOG_ERROR, "Failed to serialize reply");
                 goto ret;
@@ -262,6 +279,22 @@ server_priv_to_dict (xlator_t *this, dict_t *dict)
                         if (ret)
                                 goto unlock;
 
+                        memset (key, 0, sizeof (key));
+                        snprintf (key, sizeof (key), "client%d.queuedepth",
+                                  count);
+                        ret = dict_set_int32 (dict, key,
+                                              xprt->queued_rpc_count);
+                        if (ret)
+                                goto unlock;
+
+                        memset (key, 0, sizeof (key));
+                        snprintf (key, sizeof (key), "client%d.throttletime",
+                                  count);
+                        ret = dict_set_uint64 (dict, key,
+                                               xprt->throttle_ns / 1000000);
+                        if (ret)
+                                goto unlock;
+
                         count++;
                 }
         }
@@ -284,6 +317,11 @@ server_priv (xlator_t *this)
         char              key[GF_DUMP_MAX_BUF_LEN] = {0,};
         uint64_t          total_read = 0;
         uint64_t          total_write = 0;
+        uint64_t          total_msgs = 0;
+        uint64_t          total_calls = 0;
+        uint64_t          total_msgs_read = 0;
+        uint64_t          total_read_calls = 0;
+        int               count = 0;
         int32_t           ret  = -1;
 
         GF_VALIDATE_OR_GOTO ("server", this, out);
@@ -302,6 +340,22 @@ server_priv (xlator_t *this)
                 list_for_each_entry (xprt, &conf->xprt_list, list) {
                         total_read  += xprt->total_bytes_read;
                         total_write += xprt->total_bytes_write;
+                        total_msgs  += xprt->total_msgs_write;
+                        total_calls += xprt->total_write_calls;
+                        total_msgs_read  += xprt->total_msgs_read;
+                        total_read_calls += xprt->total_read_calls;
+
+                        gf_proc_dump_build_key (key, "client", "%d",
+                                                count++);
+                        gf_proc_dump_write (key, "%s outstanding=%d queued=%d"
+                                            " limit=%d throttled=%d "
+                                            "throttle-ms=%"PRIu64,
+                                            xprt->peerinfo.identifier,
+                                            xprt->outstanding_rpc_count,
+                                            xprt->queued_rpc_count,
+                                            xprt->outstanding_rpc_limit,
+                                            xprt->throttled,
+                                            xprt->throttle_ns / 1000000);
                 }
         }
         pthread_mutex_unlock (&conf->mutex);
@@ -312,6 +366,18 @@ server_priv (xlator_t *this)
         gf_proc_dump_build_key(key, "server", "total-bytes-write");
         gf_proc_dump_write(key, "%"PRIu64, total_write);
 
+        if (total_msgs) {
+                gf_proc_dump_build_key(key, "server", "write-calls-per-msg");
+                gf_proc_dump_write(key, "%.2f",
+                                   (double)total_calls / total_msgs);
+        }
+
+        if (total_msgs_read) {
+                gf_proc_dump_build_key(key, "server", "read-calls-per-msg");
+                gf_proc_dump_write(key, "%.2f",
+                                   (double)total_read_calls / total_msgs_read);
+        }
+
         ret = 0;
 out:
         if (ret)
@@ -529,6 +595,14 @@ server_rpc_notify (rpcsvc_t *rpc, void *xl, rpcsvc_event_t event,
                         break;
                 }
                 trans->xl_private = NULL;
+
+                /* The connections of a client with connection-count > 1
+                 * all bind to it. Its locks stay with the ones that are
+                 * left; only the last to go releases them and waits for
+                 * the reconnect. */
+                if (gf_client_put_shared (client))
+                        break;
+
                 server_connection_cleanup (this, client, INTERNAL_LOCKS);
 
                 serv_ctx = server_ctx_get (client, this);
@@ -673,6 +747,7 @@ reconfigure (xlator_t *this, dict_t *options)
         rpcsvc_t                 *rpc_conf;
         rpcsvc_listener_t        *listeners;
         int                       inode_lru_limit;
+        int                       inode_hash_size;
         gf_boolean_t              trace;
         data_t                   *data;
         int                       ret = 0;
@@ -699,6 +774,15 @@ reconfigure (xlator_t *this, dict_t *options)
                                 &inode_lru_limit);
         }
 
+        /* only tables created from now on are sized with it, existing
+           ones grow on their own */
+        if (dict_get_int32 (options, "inode-hash-size",
+                            &inode_hash_size) == 0) {
+                conf->inode_hash_size = inode_hash_size;
+                gf_log (this->name, GF_LOG_TRACE, "Reconfigured "
+                        "inode-hash-size to %d", conf->inode_hash_size);
+        }
+
         data = dict_get (options, "trace");
         if (data) {
                 ret = gf_string2boolean (data->data, &trace);
@@ -773,6 +857,13 @@ reconfigure (xlator_t *this, dict_t *options)
                 goto out;
         }
 
+        ret = rpcsvc_set_queue_target (rpc_conf, options);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "Failed to reconfigure queue-target-latency");
+                goto out;
+        }
+
         list_for_each_entry (listeners, &(rpc_conf->listeners), list) {
                 if (listeners->trans != NULL) {
                         if (listeners->trans->reconfigure )
@@ -913,6 +1004,13 @@ init (xlator_t *this)
                 goto out;
         }
 
+        ret = rpcsvc_set_queue_target (conf->rpc, this->options);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "Failed to configure queue-target-latency");
+                goto out;
+        }
+
         /*
          * This is the only place where we want secure_srvr to reflect
          * the data-plane setting.
@@ -1095,6 +1193,16 @@ struct volume_options options[] = {
           .description = "Specifies the maximum megabytes of memory to be "
           "used in the inode cache."
         },
+        { .key   = {"inode-hash-size"},
+          .type  = GF_OPTION_TYPE_INT,
+          .min   = INODE_TABLE_STRIPES,
+          .max   = INODE_HASH_MAX_SIZE,
+          .default_value = "65536",
+          .description = "Initial number of buckets of the inode and dentry "
+          "hashes of the inode table, rounded up to a power of two. The "
+          "hashes grow as the inode cache fills up, a size close to the "
+          "expected number of cached inodes avoids growing them."
+        },
         { .key   = {"verify-volfile-checksum"},
           .type  = GF_OPTION_TYPE_BOOL
         },
@@ -1180,6 +1288,16 @@ struct volume_options options[] = {
                          "requests from a client. 0 means no limit (can "
                          "potentially run out of memory)"
         },
+        { .key  = {"rpc.queue-target-latency"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = 10000,
+          .default_value = "0",
+          .description = "Service latency, in milliseconds, above which the "
+                         "brick holds back incoming RPC requests, serves the "
+                         "clients in turn and lowers the outstanding RPC "
+                         "limit of the busiest ones. 0 disables this."
+        },
 
         { .key   = {"manage-gids"},
           .type  = GF_OPTION_TYPE_BOOL,
@@ -48,6 +48,7 @@ struct server_conf {
         rpcsvc_t               *rpc;
         struct rpcsvc_config    rpc_conf;
         int                     inode_lru_limit;
+        int                     inode_hash_size;
         gf_boolean_t            verify_volfile;
         gf_boolean_t            trace;
         gf_boolean_t            lk_heal; /* If true means lock self
@@ -145,6 +146,11 @@ struct _server_state {
 
         dict_t           *xdata;
         mode_t            umask;
+
+        /* members of a compound, resolved one after the other */
+        gfs3_compound_req *compound_req;
+        compound_args_t   *compound_args;
+        int                compound_next;
 };
 
 
@@ -162,7 +168,7 @@ typedef struct _server_ctx {
 int
 server_submit_reply (call_frame_t *frame, rpcsvc_request_t *req, void *arg,
                      struct iovec *payload, int payloadcount,
-                     struct iobref *iobref, xdrproc_t xdrproc);
+                     struct iobref *iobref, xdrproc_t xdrproc, dict_t *xdata);
 
 int gf_server_check_setxattr_cmd (call_frame_t *frame, dict_t *dict);
 int gf_server_check_getxattr_cmd (call_frame_t *frame, const char *name);